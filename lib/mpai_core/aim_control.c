@@ -0,0 +1,440 @@
+/*
+ * @file
+ * @brief Implementation of the cooperative lifecycle control of an AIM thread
+ *
+ * Copyright (c) 2022 University of Turin, Daniele Bortoluzzi <danieleb88@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "aim_control.h"
+
+LOG_MODULE_REGISTER(MPAI_CORE_AIM_CONTROL, LOG_LEVEL_INF);
+
+/************* PRIVATE HEADER *************/
+int _aim_control_request(mpai_aim_control_t* me, MPAI_AIM_CONTROL_WORD word, MPAI_AIM_STATE expected_state);
+void _aim_control_acknowledge(mpai_aim_control_t* me, MPAI_AIM_STATE state);
+/* start an activation of the AIM thread (called by the thread itself) */
+void _aim_control_release(mpai_aim_control_t* me);
+/* end the current activation, checking budget and deadline (called by the thread itself) */
+void _aim_control_complete(mpai_aim_control_t* me);
+uint64_t _aim_control_execution_cycles();
+const char* _aim_control_thread_name();
+
+/************* PUBLIC **************/
+void MPAI_AIM_Control_Default_Thread_Config(mpai_aim_thread_config_t* config)
+{
+	config->_priority = CONFIG_MPAI_AIM_DEFAULT_PRIORITY;
+	config->_stack_size = 0;
+	config->_deadline_ms = 0;
+	config->_budget_ms = 0;
+}
+
+void MPAI_AIM_Control_Init(mpai_aim_control_t* me, const mpai_aim_thread_config_t* config)
+{
+	atomic_set(&me->_control_word, MPAI_AIM_CONTROL_RUN);
+	atomic_set(&me->_state, MPAI_AIM_STATE_RUNNING);
+	k_sem_init(&me->_ack, 0, 1);
+	k_sem_init(&me->_wakeup, 0, 1);
+	MPAI_AIM_Control_Heartbeat(me);
+
+	if (config != NULL)
+	{
+		me->_config = *config;
+	}
+	else
+	{
+		MPAI_AIM_Control_Default_Thread_Config(&me->_config);
+	}
+	memset(&me->_stats, 0, sizeof(mpai_aim_control_stats_t));
+	me->_release_ts = 0;
+	me->_release_cycles = 0;
+	me->_demoted = false;
+	me->_runtime_wakeup = NULL;
+}
+
+int MPAI_AIM_Control_Get_Priority(mpai_aim_control_t* me)
+{
+#if defined(CONFIG_MPAI_AIM_SCHED_EDF)
+	// EDF orders only threads with the same priority: all the AIMs with a deadline share the highest one
+	return me->_config._deadline_ms > 0 ? CONFIG_MPAI_AIM_SCHED_PRIORITY_HIGHEST : CONFIG_MPAI_AIM_DEFAULT_PRIORITY;
+#elif defined(CONFIG_MPAI_AIM_SCHED_DEADLINE_MONOTONIC)
+	if (me->_config._deadline_ms == 0)
+	{
+		return CONFIG_MPAI_AIM_DEFAULT_PRIORITY;
+	}
+	// shorter deadline, higher priority: one priority level each time the deadline doubles (from 10ms)
+	int priority = CONFIG_MPAI_AIM_SCHED_PRIORITY_HIGHEST;
+	for (uint32_t deadline = me->_config._deadline_ms / 10; deadline > 0; deadline >>= 1)
+	{
+		priority++;
+	}
+	return MIN(priority, CONFIG_MPAI_AIM_DEFAULT_PRIORITY);
+#else
+	return me->_config._priority;
+#endif
+}
+
+size_t MPAI_AIM_Control_Get_Stack_Size(mpai_aim_control_t* me, size_t stack_area_size)
+{
+	if (me->_config._stack_size == 0)
+	{
+		return stack_area_size;
+	}
+	if (me->_config._stack_size > stack_area_size)
+	{
+		LOG_WRN("Stack size %u exceeds CONFIG_MPAI_AIM_STACK_SIZE_MAX: using %u", (unsigned int) me->_config._stack_size, (unsigned int) stack_area_size);
+		return stack_area_size;
+	}
+	return me->_config._stack_size;
+}
+
+void MPAI_AIM_Control_Get_Stats(mpai_aim_control_t* me, mpai_aim_control_stats_t* stats)
+{
+	*stats = me->_stats;
+}
+
+int MPAI_AIM_Control_Pause(mpai_aim_control_t* me)
+{
+	return _aim_control_request(me, MPAI_AIM_CONTROL_PAUSE, MPAI_AIM_STATE_PAUSED);
+}
+
+int MPAI_AIM_Control_Resume(mpai_aim_control_t* me)
+{
+	return _aim_control_request(me, MPAI_AIM_CONTROL_RUN, MPAI_AIM_STATE_RUNNING);
+}
+
+int MPAI_AIM_Control_Stop(mpai_aim_control_t* me)
+{
+	return _aim_control_request(me, MPAI_AIM_CONTROL_STOP, MPAI_AIM_STATE_STOPPED);
+}
+
+bool MPAI_AIM_Control_Checkpoint(mpai_aim_control_t* me)
+{
+	_aim_control_complete(me);
+	MPAI_AIM_Control_Heartbeat(me);
+
+	atomic_val_t word = atomic_get(&me->_control_word);
+
+	// fast path: nothing requested
+	if (word == MPAI_AIM_CONTROL_RUN)
+	{
+		return true;
+	}
+
+	if (word == MPAI_AIM_CONTROL_PAUSE)
+	{
+		_aim_control_acknowledge(me, MPAI_AIM_STATE_PAUSED);
+
+		// block (the cpu is free for other threads) until resume or stop
+		while ((word = atomic_get(&me->_control_word)) == MPAI_AIM_CONTROL_PAUSE)
+		{
+			k_sem_take(&me->_wakeup, K_FOREVER);
+		}
+
+		if (word == MPAI_AIM_CONTROL_RUN)
+		{
+			// the pause doesn't count as silence
+			MPAI_AIM_Control_Heartbeat(me);
+			_aim_control_acknowledge(me, MPAI_AIM_STATE_RUNNING);
+			return true;
+		}
+	}
+
+	_aim_control_acknowledge(me, MPAI_AIM_STATE_STOPPED);
+	return false;
+}
+
+int MPAI_AIM_Control_Poll(mpai_aim_control_t* me, MPAI_AIM_MessageStore_t* message_store, module_t* subscriber, int32_t timeout_ms, subscriber_channel_t channel)
+{
+	int64_t deadline = k_uptime_get() + timeout_ms;
+
+	while (1)
+	{
+		if (atomic_get(&me->_control_word) != MPAI_AIM_CONTROL_RUN)
+		{
+			return -EINTR;
+		}
+
+		MPAI_AIM_Control_Heartbeat(me);
+
+		int64_t remaining_ms = deadline - k_uptime_get();
+		if (remaining_ms <= 0)
+		{
+			return 0;
+		}
+
+		// poll in slices, so a pending request is seen within CONFIG_MPAI_AIM_CONTROL_POLL_SLICE_MS
+		int ret = MPAI_MessageStore_poll(message_store, subscriber, K_MSEC(MIN(remaining_ms, CONFIG_MPAI_AIM_CONTROL_POLL_SLICE_MS)), channel);
+		if (ret > 0)
+		{
+			_aim_control_release(me);
+		}
+		if (ret != 0)
+		{
+			return ret;
+		}
+	}
+}
+
+int MPAI_AIM_Control_Wait(mpai_aim_control_t* me, struct k_sem* data_ready, int32_t timeout_ms)
+{
+	int64_t deadline = k_uptime_get() + timeout_ms;
+
+	while (1)
+	{
+		if (atomic_get(&me->_control_word) != MPAI_AIM_CONTROL_RUN)
+		{
+			return -EINTR;
+		}
+
+		MPAI_AIM_Control_Heartbeat(me);
+
+		// a single wait: the wakeup semaphore is given by every request, data_ready by the publishers
+		struct k_poll_event events[] = {
+			K_POLL_EVENT_INITIALIZER(K_POLL_TYPE_SEM_AVAILABLE, K_POLL_MODE_NOTIFY_ONLY, &me->_wakeup),
+			K_POLL_EVENT_INITIALIZER(K_POLL_TYPE_SEM_AVAILABLE, K_POLL_MODE_NOTIFY_ONLY, data_ready),
+		};
+		// woken up at least every half heartbeat timeout, not to be seen as stalled
+		int64_t remaining_ms = MAX(deadline - k_uptime_get(), 0);
+		(void) k_poll(events, ARRAY_SIZE(events), K_MSEC(MIN(remaining_ms, CONFIG_MPAI_AIM_HEARTBEAT_TIMEOUT_MS / 2)));
+		// the request is read from the control word
+		(void) k_sem_take(&me->_wakeup, K_NO_WAIT);
+
+		if (k_sem_take(data_ready, K_NO_WAIT) == 0)
+		{
+			_aim_control_release(me);
+			return 1;
+		}
+		if (k_uptime_get() >= deadline)
+		{
+			_aim_control_release(me);
+			return 0;
+		}
+	}
+}
+
+int MPAI_AIM_Control_Sleep(mpai_aim_control_t* me, k_timeout_t timeout)
+{
+	MPAI_AIM_Control_Heartbeat(me);
+
+	if (atomic_get(&me->_control_word) != MPAI_AIM_CONTROL_RUN)
+	{
+		return -EINTR;
+	}
+
+	// the wakeup semaphore is given by every request, so the sleep ends as soon as one arrives
+	if (k_sem_take(&me->_wakeup, timeout) == 0 && atomic_get(&me->_control_word) != MPAI_AIM_CONTROL_RUN)
+	{
+		return -EINTR;
+	}
+	_aim_control_release(me);
+	return 0;
+}
+
+void MPAI_AIM_Control_Attach_Runtime(mpai_aim_control_t* me, struct k_sem* runtime_wakeup)
+{
+	me->_runtime_wakeup = runtime_wakeup;
+}
+
+MPAI_AIM_STATE MPAI_AIM_Control_Step(mpai_aim_control_t* me)
+{
+	_aim_control_complete(me);
+
+	MPAI_AIM_STATE state = MPAI_AIM_Control_Get_State(me);
+	if (state == MPAI_AIM_STATE_FAILED)
+	{
+		return state;
+	}
+
+	switch (atomic_get(&me->_control_word))
+	{
+	case MPAI_AIM_CONTROL_RUN:
+		// waiting for a message or a timer is not silence
+		MPAI_AIM_Control_Heartbeat(me);
+		if (state != MPAI_AIM_STATE_RUNNING)
+		{
+			_aim_control_acknowledge(me, MPAI_AIM_STATE_RUNNING);
+		}
+		return MPAI_AIM_STATE_RUNNING;
+	case MPAI_AIM_CONTROL_PAUSE:
+		if (state != MPAI_AIM_STATE_PAUSED)
+		{
+			_aim_control_acknowledge(me, MPAI_AIM_STATE_PAUSED);
+		}
+		return MPAI_AIM_STATE_PAUSED;
+	default:
+		if (state != MPAI_AIM_STATE_STOPPED)
+		{
+			_aim_control_acknowledge(me, MPAI_AIM_STATE_STOPPED);
+		}
+		return MPAI_AIM_STATE_STOPPED;
+	}
+}
+
+void MPAI_AIM_Control_Release(mpai_aim_control_t* me)
+{
+	_aim_control_release(me);
+}
+
+MPAI_AIM_STATE MPAI_AIM_Control_Get_State(mpai_aim_control_t* me)
+{
+	return (MPAI_AIM_STATE) atomic_get(&me->_state);
+}
+
+void MPAI_AIM_Control_Heartbeat(mpai_aim_control_t* me)
+{
+	atomic_set(&me->_heartbeat, (atomic_val_t) k_uptime_get_32());
+}
+
+void MPAI_AIM_Control_Fail(mpai_aim_control_t* me)
+{
+	_aim_control_acknowledge(me, MPAI_AIM_STATE_FAILED);
+}
+
+bool MPAI_AIM_Control_Is_Alive(mpai_aim_control_t* me, uint32_t heartbeat_timeout_ms)
+{
+	MPAI_AIM_STATE state = MPAI_AIM_Control_Get_State(me);
+	if (state == MPAI_AIM_STATE_FAILED)
+	{
+		return false;
+	}
+	// paused AIMs are blocked at their checkpoint: no heartbeat is expected
+	if (state == MPAI_AIM_STATE_RUNNING)
+	{
+		uint32_t silence_ms = k_uptime_get_32() - (uint32_t) atomic_get(&me->_heartbeat);
+		return silence_ms <= heartbeat_timeout_ms;
+	}
+	return true;
+}
+
+uint32_t MPAI_AIM_Control_Take_Window_Max_Response(mpai_aim_control_t* me)
+{
+	uint32_t window_max_response_ms = me->_stats._window_max_response_ms;
+	me->_stats._window_max_response_ms = 0;
+	return window_max_response_ms;
+}
+
+/************* PRIVATE IMPLEMENTATION *************/
+int _aim_control_request(mpai_aim_control_t* me, MPAI_AIM_CONTROL_WORD word, MPAI_AIM_STATE expected_state)
+{
+	MPAI_AIM_STATE state = MPAI_AIM_Control_Get_State(me);
+
+	// thread not running (never started or already left its loop): nothing to wait for
+	if (state == MPAI_AIM_STATE_IDLE || state == MPAI_AIM_STATE_STOPPED || state == MPAI_AIM_STATE_FAILED)
+	{
+		atomic_set(&me->_control_word, word);
+		return 0;
+	}
+
+	k_sem_reset(&me->_ack);
+	atomic_set(&me->_control_word, word);
+	k_sem_give(me->_runtime_wakeup != NULL ? me->_runtime_wakeup : &me->_wakeup);
+
+	if (MPAI_AIM_Control_Get_State(me) == expected_state)
+	{
+		return 0;
+	}
+
+	if (k_sem_take(&me->_ack, K_MSEC(CONFIG_MPAI_AIM_CONTROL_ACK_TIMEOUT_MS)) != 0)
+	{
+		LOG_WRN("AIM did not acknowledge the request %d within %d ms", word, CONFIG_MPAI_AIM_CONTROL_ACK_TIMEOUT_MS);
+		return -EAGAIN;
+	}
+	return 0;
+}
+
+void _aim_control_acknowledge(mpai_aim_control_t* me, MPAI_AIM_STATE state)
+{
+	atomic_set(&me->_state, state);
+	k_sem_give(&me->_ack);
+}
+
+void _aim_control_release(mpai_aim_control_t* me)
+{
+	// an activation can read more channels: it starts with the first one
+	if (me->_release_ts != 0)
+	{
+		return;
+	}
+	me->_release_ts = k_uptime_get();
+	me->_release_cycles = _aim_control_execution_cycles();
+
+#ifdef CONFIG_MPAI_AIM_SCHED_EDF
+	// the runtime thread is shared by all its AIMs: it keeps its own deadline
+	if (me->_config._deadline_ms > 0 && me->_runtime_wakeup == NULL)
+	{
+		// the deadline is relative to the release, so it has to be set at each activation
+		k_thread_deadline_set(k_current_get(), k_ms_to_cyc_ceil32(me->_config._deadline_ms));
+	}
+#endif
+}
+
+void _aim_control_complete(mpai_aim_control_t* me)
+{
+	if (me->_release_ts == 0)
+	{
+		return;
+	}
+	uint32_t response_ms = (uint32_t) (k_uptime_get() - me->_release_ts);
+#ifdef CONFIG_THREAD_RUNTIME_STATS
+	uint32_t execution_ms = k_cyc_to_ms_floor32((uint32_t) (_aim_control_execution_cycles() - me->_release_cycles));
+#else
+	// without runtime stats, the time spent by preempting threads is charged to the AIM
+	uint32_t execution_ms = response_ms;
+#endif
+	me->_release_ts = 0;
+
+	me->_stats._activations++;
+	me->_stats._execution_ms += execution_ms;
+	me->_stats._max_response_ms = MAX(me->_stats._max_response_ms, response_ms);
+	me->_stats._window_max_response_ms = MAX(me->_stats._window_max_response_ms, response_ms);
+
+	if (me->_config._deadline_ms > 0 && response_ms > me->_config._deadline_ms)
+	{
+		me->_stats._deadline_misses++;
+		LOG_WRN("AIM thread %s missed its deadline: %u ms > %u ms (%u misses)", log_strdup(_aim_control_thread_name()),
+			response_ms, me->_config._deadline_ms, me->_stats._deadline_misses);
+	}
+
+	if (me->_config._budget_ms > 0)
+	{
+		if (execution_ms > me->_config._budget_ms)
+		{
+			me->_stats._overruns++;
+			LOG_WRN("AIM thread %s overran its budget: %u ms > %u ms (%u overruns)", log_strdup(_aim_control_thread_name()),
+				execution_ms, me->_config._budget_ms, me->_stats._overruns);
+#ifdef CONFIG_MPAI_AIM_OVERRUN_ENFORCE
+			// the AIM can't steal the cpu from the others until it is back within its budget
+			if (!me->_demoted && me->_runtime_wakeup == NULL)
+			{
+				k_thread_priority_set(k_current_get(), CONFIG_MPAI_AIM_OVERRUN_PRIORITY);
+				me->_demoted = true;
+			}
+#endif
+		}
+		else if (me->_demoted)
+		{
+			k_thread_priority_set(k_current_get(), MPAI_AIM_Control_Get_Priority(me));
+			me->_demoted = false;
+		}
+	}
+}
+
+uint64_t _aim_control_execution_cycles()
+{
+#ifdef CONFIG_THREAD_RUNTIME_STATS
+	k_thread_runtime_stats_t stats;
+	if (k_thread_runtime_stats_get(k_current_get(), &stats) == 0)
+	{
+		return stats.execution_cycles;
+	}
+#endif
+	return 0;
+}
+
+const char* _aim_control_thread_name()
+{
+	const char* name = k_thread_name_get(k_current_get());
+	return name != NULL ? name : "unnamed";
+}
@@ -0,0 +1,233 @@
+/*
+ * @file
+ * @brief Headers of the cooperative lifecycle control of an AIM thread
+ *
+ * Copyright (c) 2022 University of Turin, Daniele Bortoluzzi <danieleb88@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef MPAI_CORE_AIM_CONTROL_H
+#define MPAI_CORE_AIM_CONTROL_H
+
+#include <core_common.h>
+#include <message_store.h>
+#include <sys/atomic.h>
+
+/* Control word written by the controller and read by the AIM thread at its safe points */
+typedef enum
+{
+	MPAI_AIM_CONTROL_RUN,
+	MPAI_AIM_CONTROL_PAUSE,
+	MPAI_AIM_CONTROL_STOP
+} MPAI_AIM_CONTROL_WORD;
+
+/* State acknowledged by the AIM thread */
+typedef enum
+{
+	MPAI_AIM_STATE_IDLE,
+	MPAI_AIM_STATE_RUNNING,
+	MPAI_AIM_STATE_PAUSED,
+	MPAI_AIM_STATE_STOPPED,
+	MPAI_AIM_STATE_FAILED		// the AIM gave up (i.e. polling error): it has to be restarted
+} MPAI_AIM_STATE;
+
+/* Scheduling parameters of an AIM thread, read from the "Scheduling" property of its metadata */
+typedef struct _mpai_aim_thread_config_t
+{
+	int _priority;				// Zephyr priority (used by the fixed priority policy)
+	size_t _stack_size;			// bytes, 0 means the whole stack area of the AIM
+	uint32_t _deadline_ms;		// max time from a release (new message or period) to the next checkpoint, 0 means none
+	uint32_t _budget_ms;		// max execution time of an activation, 0 means none
+} mpai_aim_thread_config_t;
+
+/* Counters of the activations of an AIM thread */
+typedef struct _mpai_aim_control_stats_t
+{
+	uint32_t _activations;
+	uint32_t _overruns;			// activations that exceeded the budget
+	uint32_t _deadline_misses;	// activations that exceeded the deadline
+	uint32_t _max_response_ms;	// worst time from a release to the next checkpoint
+	uint32_t _window_max_response_ms;	// worst time since the last MPAI_AIM_Control_Take_Window_Max_Response
+	uint32_t _execution_ms;		// total execution time of the activations (response time without runtime stats)
+} mpai_aim_control_stats_t;
+
+typedef struct _mpai_aim_control_t
+{
+	atomic_t _control_word;		// requested state (MPAI_AIM_CONTROL_WORD)
+	atomic_t _state;			// acknowledged state (MPAI_AIM_STATE)
+	struct k_sem _ack;			// given by the AIM thread when it reaches the requested state
+	struct k_sem _wakeup;		// given by the controller on every request
+	atomic_t _heartbeat;		// uptime (32 bit ms) of the last sign of life of the AIM
+	mpai_aim_thread_config_t _config;
+	mpai_aim_control_stats_t _stats;
+	int64_t _release_ts;		// uptime of the current release, 0 if the thread is waiting
+	uint64_t _release_cycles;	// execution cycles of the thread at the current release
+	bool _demoted;				// thread moved to CONFIG_MPAI_AIM_OVERRUN_PRIORITY after an overrun
+	struct k_sem* _runtime_wakeup;	// given on every request when the AIM is multiplexed on the runtime, NULL otherwise
+} mpai_aim_control_t;
+
+/**
+ * @brief Fill the scheduling parameters with the defaults of Kconfig
+ *
+ * @param config
+ */
+void MPAI_AIM_Control_Default_Thread_Config(mpai_aim_thread_config_t* config);
+
+/**
+ * @brief Initialize the control block before creating the AIM thread
+ *
+ * @param me
+ * @param config scheduling parameters of the AIM (NULL for defaults)
+ */
+void MPAI_AIM_Control_Init(mpai_aim_control_t* me, const mpai_aim_thread_config_t* config);
+
+/**
+ * @brief Priority to be used creating the AIM thread, according with the configured policy
+ *
+ * @param me
+ * @return int
+ */
+int MPAI_AIM_Control_Get_Priority(mpai_aim_control_t* me);
+
+/**
+ * @brief Stack size to be used creating the AIM thread
+ *
+ * @param me
+ * @param stack_area_size size of the stack area of the AIM (upper bound)
+ * @return size_t
+ */
+size_t MPAI_AIM_Control_Get_Stack_Size(mpai_aim_control_t* me, size_t stack_area_size);
+
+/**
+ * @brief Copy the activation counters of the AIM thread
+ *
+ * @param me
+ * @param stats
+ */
+void MPAI_AIM_Control_Get_Stats(mpai_aim_control_t* me, mpai_aim_control_stats_t* stats);
+
+/**
+ * @brief Ask the AIM thread to pause, waiting at most CONFIG_MPAI_AIM_CONTROL_ACK_TIMEOUT_MS for the acknowledgement
+ *
+ * @param me
+ * @return 0 if acknowledged, -EAGAIN on timeout
+ */
+int MPAI_AIM_Control_Pause(mpai_aim_control_t* me);
+
+/**
+ * @brief Ask a paused AIM thread to resume, waiting at most CONFIG_MPAI_AIM_CONTROL_ACK_TIMEOUT_MS for the acknowledgement
+ *
+ * @param me
+ * @return 0 if acknowledged, -EAGAIN on timeout
+ */
+int MPAI_AIM_Control_Resume(mpai_aim_control_t* me);
+
+/**
+ * @brief Ask the AIM thread to leave its loop, waiting at most CONFIG_MPAI_AIM_CONTROL_ACK_TIMEOUT_MS for the acknowledgement
+ *
+ * @param me
+ * @return 0 if acknowledged, -EAGAIN on timeout
+ */
+int MPAI_AIM_Control_Stop(mpai_aim_control_t* me);
+
+/**
+ * @brief Safe point of the AIM thread: ends the current activation (checking budget and deadline)
+ * and blocks while paused
+ *
+ * @param me
+ * @return true if the AIM has to keep running, false if it has to stop
+ */
+bool MPAI_AIM_Control_Checkpoint(mpai_aim_control_t* me);
+
+/**
+ * @brief Poll a channel of the message store in slices of CONFIG_MPAI_AIM_CONTROL_POLL_SLICE_MS,
+ * returning early when a control request is pending. New data starts an activation
+ *
+ * @return the same values of MPAI_MessageStore_poll, or -EINTR if a control request is pending
+ */
+int MPAI_AIM_Control_Poll(mpai_aim_control_t* me, MPAI_AIM_MessageStore_t* message_store, module_t* subscriber, int32_t timeout_ms, subscriber_channel_t channel);
+
+/**
+ * @brief Wait for the messages of more channels at once, on a semaphore given by their publishers
+ * (see MPAI_MessageStore_Set_Wakeup), returning early when a control request is pending.
+ * New data or the end of the whole timeout starts an activation
+ *
+ * @param data_ready given by the publishers
+ * @return 1 if data is ready (the channels are to be polled without waiting), 0 if the whole timeout elapsed,
+ * -EINTR if a control request is pending
+ */
+int MPAI_AIM_Control_Wait(mpai_aim_control_t* me, struct k_sem* data_ready, int32_t timeout_ms);
+
+/**
+ * @brief Sleep that is interrupted by any control request. The end of the whole timeout starts an activation
+ *
+ * @return 0 if the whole timeout elapsed, -EINTR if a control request is pending
+ */
+int MPAI_AIM_Control_Sleep(mpai_aim_control_t* me, k_timeout_t timeout);
+
+/**
+ * @brief Multiplex the AIM on the runtime (see aim_runtime.h): requests wake up the runtime
+ * instead of an AIM thread, and the thread priority is never changed. Call it after MPAI_AIM_Control_Init
+ *
+ * @param me
+ * @param runtime_wakeup semaphore the runtime is waiting on
+ */
+void MPAI_AIM_Control_Attach_Runtime(mpai_aim_control_t* me, struct k_sem* runtime_wakeup);
+
+/**
+ * @brief Non-blocking safe point of an AIM multiplexed on the runtime: ends the current activation
+ * and acknowledges the requested state
+ *
+ * @param me
+ * @return MPAI_AIM_STATE the state the runtime has to keep the AIM in
+ */
+MPAI_AIM_STATE MPAI_AIM_Control_Step(mpai_aim_control_t* me);
+
+/**
+ * @brief Start an activation of an AIM multiplexed on the runtime (AIM threads are released by polls and sleeps)
+ *
+ * @param me
+ */
+void MPAI_AIM_Control_Release(mpai_aim_control_t* me);
+
+/**
+ * @brief Get the state acknowledged by the AIM thread
+ *
+ */
+MPAI_AIM_STATE MPAI_AIM_Control_Get_State(mpai_aim_control_t* me);
+
+/**
+ * @brief Sign of life of the AIM. Checkpoints, polls and sleeps already call it:
+ * AIMs driven by interrupts (i.e. DMA callbacks) call it directly. ISR safe
+ *
+ * @param me
+ */
+void MPAI_AIM_Control_Heartbeat(mpai_aim_control_t* me);
+
+/**
+ * @brief Called by the AIM before leaving its thread for an unrecoverable error. ISR safe
+ *
+ * @param me
+ */
+void MPAI_AIM_Control_Fail(mpai_aim_control_t* me);
+
+/**
+ * @brief Check if the AIM is not failed and, when running, it gave a sign of life within the timeout
+ *
+ * @param me
+ * @param heartbeat_timeout_ms
+ * @return true
+ * @return false
+ */
+bool MPAI_AIM_Control_Is_Alive(mpai_aim_control_t* me, uint32_t heartbeat_timeout_ms);
+
+/**
+ * @brief Get the worst response time since the previous call, resetting it
+ *
+ * @param me
+ * @return uint32_t ms
+ */
+uint32_t MPAI_AIM_Control_Take_Window_Max_Response(mpai_aim_control_t* me);
+
+#endif
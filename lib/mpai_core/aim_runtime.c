@@ -0,0 +1,223 @@
+/*
+ * @file
+ * @brief Implementation of the single-stack cooperative runtime of the AIMs
+ *
+ * The runtime thread sleeps until the nearest timeout of the pending waits, or
+ * until a message is published or a lifecycle request arrives.
+ *
+ * Copyright (c) 2022 University of Turin, Daniele Bortoluzzi <danieleb88@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "aim_runtime.h"
+
+#ifdef CONFIG_MPAI_AIM_RUNTIME
+
+LOG_MODULE_REGISTER(MPAI_CORE_AIM_RUNTIME, LOG_LEVEL_INF);
+
+/************* PRIVATE HEADER *************/
+void th_aim_runtime(void *dummy1, void *dummy2, void *dummy3);
+/* check if the pending wait of the task is over, setting its result */
+bool _aim_runtime_ready(mpai_aim_task_t* task, int64_t now);
+/* run the task until its next wait: false if the task has left the runtime */
+bool _aim_runtime_step(mpai_aim_task_t* task, int64_t now);
+void _aim_runtime_remove_at(int index);
+
+static mpai_aim_task_t* aim_runtime_tasks[CONFIG_MPAI_AIM_RUNTIME_MAX_TASKS];
+static int aim_runtime_count = 0;
+
+K_MUTEX_DEFINE(aim_runtime_mutex);
+K_SEM_DEFINE(aim_runtime_wakeup, 0, 1);
+
+K_THREAD_STACK_DEFINE(thread_aim_runtime_stack_area, CONFIG_MPAI_AIM_RUNTIME_STACK_SIZE);
+static struct k_thread thread_aim_runtime;
+static k_tid_t aim_runtime_thread_id = NULL;
+
+/************* PUBLIC **************/
+void MPAI_AIM_Task_Init(mpai_aim_task_t* task, mpai_aim_task_handler_t* handler, mpai_aim_control_t* control, void* data)
+{
+	task->_handler = handler;
+	task->_control = control;
+	task->_data = data;
+	task->_lc = 0;
+	task->_wake_ts = 0;
+	task->_message_store = NULL;
+	task->_result = 0;
+}
+
+void MPAI_AIM_Task_Wait_Timeout(mpai_aim_task_t* task, int32_t timeout_ms)
+{
+	task->_message_store = NULL;
+	task->_wake_ts = k_uptime_get() + timeout_ms;
+}
+
+void MPAI_AIM_Task_Wait_Message(mpai_aim_task_t* task, MPAI_AIM_MessageStore_t* message_store, module_t* subscriber, subscriber_channel_t channel, int32_t timeout_ms)
+{
+	task->_message_store = message_store;
+	task->_subscriber = subscriber;
+	task->_channel = channel;
+	task->_wake_ts = k_uptime_get() + timeout_ms;
+}
+
+void MPAI_AIM_Runtime_Init()
+{
+	if (aim_runtime_thread_id != NULL)
+	{
+		return;
+	}
+	aim_runtime_thread_id = k_thread_create(&thread_aim_runtime, thread_aim_runtime_stack_area,
+										K_THREAD_STACK_SIZEOF(thread_aim_runtime_stack_area),
+										th_aim_runtime, NULL, NULL, NULL,
+										CONFIG_MPAI_AIM_RUNTIME_PRIORITY, 0, K_NO_WAIT);
+	k_thread_name_set(&thread_aim_runtime, "thread_aim_runtime");
+}
+
+mpai_error_t MPAI_AIM_Runtime_Add(mpai_aim_task_t* task)
+{
+	k_mutex_lock(&aim_runtime_mutex, K_FOREVER);
+	for (int i = 0; i < aim_runtime_count; i++)
+	{
+		// restarted before the runtime has dropped it
+		if (aim_runtime_tasks[i] == task)
+		{
+			_aim_runtime_remove_at(i);
+			break;
+		}
+	}
+	if (aim_runtime_count >= CONFIG_MPAI_AIM_RUNTIME_MAX_TASKS)
+	{
+		k_mutex_unlock(&aim_runtime_mutex);
+		LOG_ERR("Too many AIM tasks (max %d)", CONFIG_MPAI_AIM_RUNTIME_MAX_TASKS);
+		MPAI_ERR_INIT(err, MPAI_ERROR);
+		return err;
+	}
+	task->_lc = 0;
+	task->_wake_ts = 0;
+	task->_message_store = NULL;
+	MPAI_AIM_Control_Attach_Runtime(task->_control, &aim_runtime_wakeup);
+	aim_runtime_tasks[aim_runtime_count++] = task;
+	k_mutex_unlock(&aim_runtime_mutex);
+
+	MPAI_AIM_Runtime_Notify();
+
+	MPAI_ERR_INIT(err, MPAI_AIF_OK);
+	return err;
+}
+
+void MPAI_AIM_Runtime_Remove(mpai_aim_task_t* task)
+{
+	k_mutex_lock(&aim_runtime_mutex, K_FOREVER);
+	for (int i = 0; i < aim_runtime_count; i++)
+	{
+		if (aim_runtime_tasks[i] == task)
+		{
+			_aim_runtime_remove_at(i);
+			break;
+		}
+	}
+	k_mutex_unlock(&aim_runtime_mutex);
+}
+
+void MPAI_AIM_Runtime_Notify()
+{
+	k_sem_give(&aim_runtime_wakeup);
+}
+
+/************* PRIVATE IMPLEMENTATION *************/
+void th_aim_runtime(void *dummy1, void *dummy2, void *dummy3)
+{
+	ARG_UNUSED(dummy1);
+	ARG_UNUSED(dummy2);
+	ARG_UNUSED(dummy3);
+
+	LOG_DBG("START RUNTIME");
+
+	while (1)
+	{
+		k_mutex_lock(&aim_runtime_mutex, K_FOREVER);
+		int64_t now = k_uptime_get();
+		// wake up at least every half heartbeat timeout, so the waiting tasks are not seen as stalled
+		int64_t next_wake_ts = now + CONFIG_MPAI_AIM_HEARTBEAT_TIMEOUT_MS / 2;
+
+		for (int i = 0; i < aim_runtime_count; i++)
+		{
+			mpai_aim_task_t* task = aim_runtime_tasks[i];
+			if (!_aim_runtime_step(task, now))
+			{
+				_aim_runtime_remove_at(i--);
+				continue;
+			}
+			// a task that only yielded is resumed at the next round
+			if (task->_wake_ts == 0 && task->_message_store == NULL && MPAI_AIM_Control_Get_State(task->_control) == MPAI_AIM_STATE_RUNNING)
+			{
+				next_wake_ts = now;
+			}
+			else if (task->_wake_ts != 0)
+			{
+				next_wake_ts = MIN(next_wake_ts, task->_wake_ts);
+			}
+		}
+		k_mutex_unlock(&aim_runtime_mutex);
+
+		// published messages and lifecycle requests give the semaphore
+		int64_t sleep_ms = next_wake_ts - k_uptime_get();
+		k_sem_take(&aim_runtime_wakeup, sleep_ms > 0 ? K_MSEC(sleep_ms) : K_NO_WAIT);
+	}
+}
+
+bool _aim_runtime_ready(mpai_aim_task_t* task, int64_t now)
+{
+	if (task->_message_store != NULL)
+	{
+		int ret = MPAI_MessageStore_poll(task->_message_store, task->_subscriber, K_NO_WAIT, task->_channel);
+		// nothing published yet
+		if (ret != 0 && ret != -EAGAIN)
+		{
+			task->_result = ret;
+			return true;
+		}
+	}
+	if (task->_wake_ts != 0 && now < task->_wake_ts)
+	{
+		return false;
+	}
+	task->_result = 0;
+	return true;
+}
+
+bool _aim_runtime_step(mpai_aim_task_t* task, int64_t now)
+{
+	MPAI_AIM_STATE state = MPAI_AIM_Control_Step(task->_control);
+	if (state == MPAI_AIM_STATE_STOPPED || state == MPAI_AIM_STATE_FAILED)
+	{
+		return false;
+	}
+	// a paused task keeps its pending wait: timed out waits end as soon as it is resumed
+	if (state == MPAI_AIM_STATE_PAUSED || !_aim_runtime_ready(task, now))
+	{
+		return true;
+	}
+
+	task->_wake_ts = 0;
+	task->_message_store = NULL;
+	MPAI_AIM_Control_Release(task->_control);
+
+	int ret = task->_handler(task);
+	if (ret == MPAI_AIM_TASK_FAILED)
+	{
+		MPAI_AIM_Control_Fail(task->_control);
+		return false;
+	}
+	// end of the activation, checking budget and deadline
+	MPAI_AIM_Control_Step(task->_control);
+	return true;
+}
+
+void _aim_runtime_remove_at(int index)
+{
+	memmove(&aim_runtime_tasks[index], &aim_runtime_tasks[index + 1], (aim_runtime_count - index - 1) * sizeof(mpai_aim_task_t*));
+	aim_runtime_count--;
+}
+
+#endif
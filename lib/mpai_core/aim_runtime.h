@@ -0,0 +1,134 @@
+/*
+ * @file
+ * @brief Headers of the single-stack cooperative runtime of the AIMs
+ *
+ * AIMs are written as resumable state machines (protothreads): a task handler is
+ * called again and again by the runtime thread, restarting from the last
+ * MPAI_AIM_TASK_* wait it returned from. All the tasks share the thread and its stack,
+ * so local variables are NOT kept across waits: use static variables or the task data.
+ * A handler must never block (no k_sleep, no polls with timeout).
+ *
+ * Copyright (c) 2022 University of Turin, Daniele Bortoluzzi <danieleb88@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef MPAI_CORE_AIM_RUNTIME_H
+#define MPAI_CORE_AIM_RUNTIME_H
+
+#include <core_common.h>
+#include <message_store.h>
+#include <aim_control.h>
+
+/* values returned by the task handlers */
+#define MPAI_AIM_TASK_WAITING 0
+#define MPAI_AIM_TASK_FAILED 1
+
+typedef struct _mpai_aim_task_t mpai_aim_task_t;
+typedef int (mpai_aim_task_handler_t)(mpai_aim_task_t* task);
+
+struct _mpai_aim_task_t
+{
+	mpai_aim_task_handler_t* _handler;
+	mpai_aim_control_t* _control;		// lifecycle, heartbeats and stats of the AIM
+	void* _data;						// state of the AIM kept across waits
+	unsigned int _lc;					// local continuation: line of the wait the handler resumes from
+	int64_t _wake_ts;					// uptime when the pending wait times out, 0 if none
+	MPAI_AIM_MessageStore_t* _message_store;	// message store of the pending wait, NULL if none
+	module_t* _subscriber;
+	subscriber_channel_t _channel;
+	int _result;						// result of the last wait, like MPAI_AIM_Control_Poll (never -EINTR)
+};
+
+/* to be used as the first statement of a task handler */
+#define MPAI_AIM_TASK_BEGIN(task) switch ((task)->_lc) { case 0:
+
+/* to be used as the last statement of a task handler: the handler restarts from the beginning
+ * at the next round, like the loop of an AIM thread. Tasks leave the runtime only when stopped or failed */
+#define MPAI_AIM_TASK_END(task) } (task)->_lc = 0; return MPAI_AIM_TASK_WAITING;
+
+/* give the cpu to the other tasks, resuming as soon as possible */
+#define MPAI_AIM_TASK_YIELD(task)									\
+	do {															\
+		(task)->_lc = __LINE__;										\
+		return MPAI_AIM_TASK_WAITING;								\
+	case __LINE__:;													\
+	} while (0)
+
+/* resume after timeout_ms */
+#define MPAI_AIM_TASK_SLEEP(task, timeout_ms)						\
+	do {															\
+		MPAI_AIM_Task_Wait_Timeout(task, timeout_ms);				\
+		MPAI_AIM_TASK_YIELD(task);									\
+	} while (0)
+
+/* resume when a message is published on the channel, or after timeout_ms: see MPAI_AIM_TASK_RESULT */
+#define MPAI_AIM_TASK_AWAIT_MESSAGE(task, message_store, subscriber, channel, timeout_ms)	\
+	do {																				\
+		MPAI_AIM_Task_Wait_Message(task, message_store, subscriber, channel, timeout_ms);	\
+		MPAI_AIM_TASK_YIELD(task);														\
+	} while (0)
+
+/* leave the runtime for an unrecoverable error: the AIM is marked as failed */
+#define MPAI_AIM_TASK_FAIL(task) do { (task)->_lc = 0; return MPAI_AIM_TASK_FAILED; } while (0)
+
+/* result of the last wait: positive for new data, 0 on timeout, negative on polling errors */
+#define MPAI_AIM_TASK_RESULT(task) ((task)->_result)
+
+/**
+ * @brief Initialize a task, before adding it to the runtime
+ *
+ * @param task
+ * @param handler
+ * @param control control block of the AIM, already initialized with MPAI_AIM_Control_Init
+ * @param data state of the AIM kept across waits (can be NULL)
+ */
+void MPAI_AIM_Task_Init(mpai_aim_task_t* task, mpai_aim_task_handler_t* handler, mpai_aim_control_t* control, void* data);
+
+/**
+ * @brief Set the pending wait of a task on a timer (use MPAI_AIM_TASK_SLEEP)
+ *
+ * @param task
+ * @param timeout_ms
+ */
+void MPAI_AIM_Task_Wait_Timeout(mpai_aim_task_t* task, int32_t timeout_ms);
+
+/**
+ * @brief Set the pending wait of a task on a channel (use MPAI_AIM_TASK_AWAIT_MESSAGE)
+ *
+ * @param task
+ * @param message_store
+ * @param subscriber
+ * @param channel
+ * @param timeout_ms
+ */
+void MPAI_AIM_Task_Wait_Message(mpai_aim_task_t* task, MPAI_AIM_MessageStore_t* message_store, module_t* subscriber, subscriber_channel_t channel, int32_t timeout_ms);
+
+/**
+ * @brief Start the runtime thread
+ *
+ */
+void MPAI_AIM_Runtime_Init();
+
+/**
+ * @brief Add a task to the runtime: it is started from the beginning of its handler
+ *
+ * @param task
+ * @return mpai_error_t
+ */
+mpai_error_t MPAI_AIM_Runtime_Add(mpai_aim_task_t* task);
+
+/**
+ * @brief Remove a task from the runtime, waiting the end of its current step
+ *
+ * @param task
+ */
+void MPAI_AIM_Runtime_Remove(mpai_aim_task_t* task);
+
+/**
+ * @brief Wake up the runtime to check the pending waits (i.e. after a publish). ISR safe
+ *
+ */
+void MPAI_AIM_Runtime_Notify();
+
+#endif
@@ -0,0 +1,204 @@
+/*
+ * @file
+ * @brief Implementation of the duty-cycle scheduler of the AIMs
+ *
+ * A single one-shot timer is programmed to the nearest window edge among all
+ * the scheduled AIMs, so the cpu is not woken up between two edges. The AIMs are
+ * paused and resumed by a work queue of the scheduler: pausing an AIM waits for its
+ * thread, which would block the system work queue.
+ *
+ * Copyright (c) 2022 University of Turin, Daniele Bortoluzzi <danieleb88@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "aim_scheduler.h"
+
+#ifdef CONFIG_MPAI_AIM_SCHEDULER
+
+LOG_MODULE_REGISTER(MPAI_CORE_AIM_SCHEDULER, LOG_LEVEL_INF);
+
+typedef struct _aim_scheduler_entry_t
+{
+	MPAI_Component_AIM_t* _aim;
+	mpai_aim_duty_cycle_t _duty_cycle;
+	bool _active;					// AIM resumed by the scheduler
+} aim_scheduler_entry_t;
+
+/************* PRIVATE HEADER *************/
+/* check if the AIM is inside its active window at time t (from epoch), computing the time to its next edge */
+bool _aim_scheduler_window_active(const aim_scheduler_entry_t* entry, int64_t t, int64_t* next_edge_ms);
+void _aim_scheduler_work_handler(struct k_work *work);
+void _aim_scheduler_timer_handler(struct k_timer *timer);
+
+static aim_scheduler_entry_t aim_scheduler_entries[CONFIG_MPAI_AIM_SCHEDULER_MAX];
+static int aim_scheduler_count = 0;
+static int64_t aim_scheduler_epoch = 0;
+static bool aim_scheduler_running = false;
+
+K_THREAD_STACK_DEFINE(aim_scheduler_stack_area, CONFIG_MPAI_AIM_SCHEDULER_STACK_SIZE);
+static struct k_work_q aim_scheduler_work_q;
+static bool aim_scheduler_work_q_started = false;
+
+K_MUTEX_DEFINE(aim_scheduler_mutex);
+K_WORK_DEFINE(aim_scheduler_work, _aim_scheduler_work_handler);
+K_TIMER_DEFINE(aim_scheduler_timer, _aim_scheduler_timer_handler, NULL);
+
+/************* PUBLIC **************/
+void MPAI_AIM_Scheduler_Init()
+{
+	k_mutex_lock(&aim_scheduler_mutex, K_FOREVER);
+	if (!aim_scheduler_work_q_started)
+	{
+		const struct k_work_queue_config aim_scheduler_work_q_config = { .name = "mpai_aim_scheduler" };
+		k_work_queue_start(&aim_scheduler_work_q, aim_scheduler_stack_area, K_THREAD_STACK_SIZEOF(aim_scheduler_stack_area),
+			CONFIG_MPAI_AIM_SCHEDULER_PRIORITY, &aim_scheduler_work_q_config);
+		aim_scheduler_work_q_started = true;
+	}
+	aim_scheduler_count = 0;
+	aim_scheduler_epoch = k_uptime_get();
+	aim_scheduler_running = true;
+	k_mutex_unlock(&aim_scheduler_mutex);
+}
+
+mpai_error_t MPAI_AIM_Scheduler_Add(MPAI_Component_AIM_t* aim, const mpai_aim_duty_cycle_t* duty_cycle)
+{
+	if (aim == NULL || duty_cycle == NULL || duty_cycle->_period_ms == 0 || duty_cycle->_active_ms > duty_cycle->_period_ms)
+	{
+		LOG_ERR("Invalid duty cycle");
+		MPAI_ERR_INIT(err, MPAI_ERROR);
+		return err;
+	}
+
+	k_mutex_lock(&aim_scheduler_mutex, K_FOREVER);
+	if (aim_scheduler_count >= CONFIG_MPAI_AIM_SCHEDULER_MAX)
+	{
+		k_mutex_unlock(&aim_scheduler_mutex);
+		LOG_ERR("Too many scheduled AIMs (max %d)", CONFIG_MPAI_AIM_SCHEDULER_MAX);
+		MPAI_ERR_INIT(err, MPAI_ERROR);
+		return err;
+	}
+	aim_scheduler_entry_t* entry = &aim_scheduler_entries[aim_scheduler_count++];
+	entry->_aim = aim;
+	entry->_duty_cycle = *duty_cycle;
+	// the AIM has just been started
+	entry->_active = true;
+	k_mutex_unlock(&aim_scheduler_mutex);
+
+	LOG_INF("AIM %s scheduled: period %u ms, active %u ms, phase %u ms", log_strdup(MPAI_AIM_Get_Component(aim)->name),
+		duty_cycle->_period_ms, duty_cycle->_active_ms, duty_cycle->_phase_ms);
+
+	// apply the schedule now: the AIM could be outside of its window
+	k_work_submit_to_queue(&aim_scheduler_work_q, &aim_scheduler_work);
+
+	MPAI_ERR_INIT(err, MPAI_AIF_OK);
+	return err;
+}
+
+void MPAI_AIM_Scheduler_Remove(MPAI_Component_AIM_t* aim)
+{
+	k_mutex_lock(&aim_scheduler_mutex, K_FOREVER);
+	for (int i = 0; i < aim_scheduler_count; i++)
+	{
+		if (aim_scheduler_entries[i]._aim == aim)
+		{
+			memmove(&aim_scheduler_entries[i], &aim_scheduler_entries[i + 1], (aim_scheduler_count - i - 1) * sizeof(aim_scheduler_entry_t));
+			aim_scheduler_count--;
+			break;
+		}
+	}
+	k_mutex_unlock(&aim_scheduler_mutex);
+}
+
+void MPAI_AIM_Scheduler_Start()
+{
+	k_mutex_lock(&aim_scheduler_mutex, K_FOREVER);
+	// the AIMs have been resumed all together by the AIW
+	for (int i = 0; i < aim_scheduler_count; i++)
+	{
+		aim_scheduler_entries[i]._active = true;
+	}
+	aim_scheduler_running = true;
+	k_mutex_unlock(&aim_scheduler_mutex);
+
+	k_work_submit_to_queue(&aim_scheduler_work_q, &aim_scheduler_work);
+}
+
+void MPAI_AIM_Scheduler_Stop()
+{
+	k_mutex_lock(&aim_scheduler_mutex, K_FOREVER);
+	aim_scheduler_running = false;
+	k_timer_stop(&aim_scheduler_timer);
+	k_mutex_unlock(&aim_scheduler_mutex);
+}
+
+/************* PRIVATE IMPLEMENTATION *************/
+bool _aim_scheduler_window_active(const aim_scheduler_entry_t* entry, int64_t t, int64_t* next_edge_ms)
+{
+	int64_t period = entry->_duty_cycle._period_ms;
+	// position inside the period (t could be less than the phase)
+	int64_t pos = ((t - entry->_duty_cycle._phase_ms) % period + period) % period;
+
+	if (pos < entry->_duty_cycle._active_ms)
+	{
+		*next_edge_ms = entry->_duty_cycle._active_ms - pos;
+		return true;
+	}
+	*next_edge_ms = period - pos;
+	return false;
+}
+
+void _aim_scheduler_work_handler(struct k_work *work)
+{
+	bool active[CONFIG_MPAI_AIM_SCHEDULER_MAX];
+	int64_t next_edge_ms = INT64_MAX;
+
+	// held while switching the AIMs: once removed, an AIM is not touched anymore
+	k_mutex_lock(&aim_scheduler_mutex, K_FOREVER);
+	if (!aim_scheduler_running || aim_scheduler_count == 0)
+	{
+		k_mutex_unlock(&aim_scheduler_mutex);
+		return;
+	}
+
+	int64_t t = k_uptime_get() - aim_scheduler_epoch;
+	for (int i = 0; i < aim_scheduler_count; i++)
+	{
+		int64_t entry_edge_ms;
+		active[i] = _aim_scheduler_window_active(&aim_scheduler_entries[i], t, &entry_edge_ms);
+		next_edge_ms = MIN(next_edge_ms, entry_edge_ms);
+	}
+
+	// AIMs are added in the order of the AIW (producers before consumers):
+	// opening windows are handled backwards, so consumers are listening before producers publish
+	for (int i = aim_scheduler_count - 1; i >= 0; i--)
+	{
+		if (active[i] && !aim_scheduler_entries[i]._active)
+		{
+			LOG_DBG("AIM %s: window opened", log_strdup(MPAI_AIM_Get_Component(aim_scheduler_entries[i]._aim)->name));
+			MPAI_AIM_Resume(aim_scheduler_entries[i]._aim);
+			aim_scheduler_entries[i]._active = true;
+		}
+	}
+	// closing windows are handled forwards, so consumers can read the last messages of producers
+	for (int i = 0; i < aim_scheduler_count; i++)
+	{
+		if (!active[i] && aim_scheduler_entries[i]._active)
+		{
+			LOG_DBG("AIM %s: window closed", log_strdup(MPAI_AIM_Get_Component(aim_scheduler_entries[i]._aim)->name));
+			MPAI_AIM_Pause(aim_scheduler_entries[i]._aim);
+			aim_scheduler_entries[i]._active = false;
+		}
+	}
+
+	// one-shot: the cpu can idle until the next edge
+	k_timer_start(&aim_scheduler_timer, K_MSEC(next_edge_ms), K_NO_WAIT);
+	k_mutex_unlock(&aim_scheduler_mutex);
+}
+
+void _aim_scheduler_timer_handler(struct k_timer *timer)
+{
+	k_work_submit_to_queue(&aim_scheduler_work_q, &aim_scheduler_work);
+}
+
+#endif
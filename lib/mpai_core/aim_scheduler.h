@@ -0,0 +1,60 @@
+/*
+ * @file
+ * @brief Headers of the duty-cycle scheduler of the AIMs
+ *
+ * Copyright (c) 2022 University of Turin, Daniele Bortoluzzi <danieleb88@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef MPAI_CORE_AIM_SCHEDULER_H
+#define MPAI_CORE_AIM_SCHEDULER_H
+
+#include <core_common.h>
+#include <core_aim.h>
+
+/* Duty cycle of an AIM, read from the "DutyCycle" property of its metadata.
+ * All the times are in ms and relative to the same epoch, so AIMs with the same
+ * period and phase have their active windows aligned. */
+typedef struct _mpai_aim_duty_cycle_t
+{
+	uint32_t _period_ms;		// 0 means always active (AIM not scheduled)
+	uint32_t _active_ms;		// length of the active window inside the period
+	uint32_t _phase_ms;			// offset of the active window from the epoch
+} mpai_aim_duty_cycle_t;
+
+/**
+ * @brief Initialize the scheduler, setting the epoch of the duty cycles to now
+ *
+ */
+void MPAI_AIM_Scheduler_Init();
+
+/**
+ * @brief Add an already started AIM to the scheduler
+ *
+ * @param aim
+ * @param duty_cycle
+ * @return mpai_error_t
+ */
+mpai_error_t MPAI_AIM_Scheduler_Add(MPAI_Component_AIM_t* aim, const mpai_aim_duty_cycle_t* duty_cycle);
+
+/**
+ * @brief Remove an AIM from the scheduler, leaving it in its current state
+ *
+ * @param aim
+ */
+void MPAI_AIM_Scheduler_Remove(MPAI_Component_AIM_t* aim);
+
+/**
+ * @brief Restart switching the AIMs according with their duty cycles
+ *
+ */
+void MPAI_AIM_Scheduler_Start();
+
+/**
+ * @brief Stop switching the AIMs (i.e. when the whole AIW is paused)
+ *
+ */
+void MPAI_AIM_Scheduler_Stop();
+
+#endif
@@ -0,0 +1,254 @@
+/*
+ * @file
+ * @brief Implementation of the supervisor of the AIMs (heartbeats, latency SLA and automatic restart)
+ *
+ * The checks run on a work queue of the supervisor: restarting an AIM waits for its thread,
+ * which would block the system work queue. The AIMs to restart are collected under the mutex,
+ * and restarted after releasing it: only a Remove of the AIM being restarted waits for it.
+ *
+ * Copyright (c) 2022 University of Turin, Daniele Bortoluzzi <danieleb88@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "aim_supervisor.h"
+
+#ifdef CONFIG_MPAI_AIM_SUPERVISOR
+
+LOG_MODULE_REGISTER(MPAI_CORE_AIM_SUPERVISOR, LOG_LEVEL_INF);
+
+typedef struct _aim_supervisor_entry_t
+{
+	MPAI_Component_AIM_t* _aim;
+	mpai_aim_supervision_t _supervision;
+	mpai_aim_supervisor_status_t _status;
+} aim_supervisor_entry_t;
+
+/* AIM to restart (or to stop, after the max restarts), collected by a check */
+typedef struct _aim_supervisor_action_t
+{
+	MPAI_Component_AIM_t* _aim;
+	bool _give_up;
+} aim_supervisor_action_t;
+
+/************* PRIVATE HEADER *************/
+void _aim_supervisor_work_handler(struct k_work *work);
+/* check a single AIM, updating its counters: true if it has to be restarted or stopped (see action) */
+bool _aim_supervisor_check(aim_supervisor_entry_t* entry, aim_supervisor_action_t* action);
+/* restart or stop an AIM, if still supervised */
+void _aim_supervisor_apply(const aim_supervisor_action_t* action);
+/* check if an AIM is supervised: to be called with the mutex */
+bool _aim_supervisor_is_supervised(MPAI_Component_AIM_t* aim);
+
+static aim_supervisor_entry_t aim_supervisor_entries[CONFIG_MPAI_AIM_SUPERVISOR_MAX];
+static int aim_supervisor_count = 0;
+static struct k_work_delayable aim_supervisor_work;
+
+K_THREAD_STACK_DEFINE(aim_supervisor_stack_area, CONFIG_MPAI_AIM_SUPERVISOR_STACK_SIZE);
+static struct k_work_q aim_supervisor_work_q;
+static bool aim_supervisor_work_q_started = false;
+/* AIM being restarted or stopped by the supervisor, held by aim_supervisor_restart_mutex */
+static MPAI_Component_AIM_t* aim_supervisor_restarting = NULL;
+
+K_MUTEX_DEFINE(aim_supervisor_mutex);
+K_MUTEX_DEFINE(aim_supervisor_restart_mutex);
+
+/************* PUBLIC **************/
+void MPAI_AIM_Supervisor_Default_Supervision(mpai_aim_supervision_t* supervision)
+{
+	supervision->_heartbeat_timeout_ms = CONFIG_MPAI_AIM_HEARTBEAT_TIMEOUT_MS;
+	supervision->_latency_sla_ms = 0;
+	supervision->_max_restarts = CONFIG_MPAI_AIM_SUPERVISOR_MAX_RESTARTS;
+}
+
+void MPAI_AIM_Supervisor_Init()
+{
+	k_mutex_lock(&aim_supervisor_mutex, K_FOREVER);
+	aim_supervisor_count = 0;
+	if (!aim_supervisor_work_q_started)
+	{
+		const struct k_work_queue_config aim_supervisor_work_q_config = { .name = "mpai_aim_supervisor" };
+		k_work_queue_start(&aim_supervisor_work_q, aim_supervisor_stack_area, K_THREAD_STACK_SIZEOF(aim_supervisor_stack_area),
+			CONFIG_MPAI_AIM_SUPERVISOR_PRIORITY, &aim_supervisor_work_q_config);
+		k_work_init_delayable(&aim_supervisor_work, _aim_supervisor_work_handler);
+		aim_supervisor_work_q_started = true;
+	}
+	k_mutex_unlock(&aim_supervisor_mutex);
+
+	k_work_schedule_for_queue(&aim_supervisor_work_q, &aim_supervisor_work, K_MSEC(CONFIG_MPAI_AIM_SUPERVISOR_PERIOD_MS));
+}
+
+mpai_error_t MPAI_AIM_Supervisor_Add(MPAI_Component_AIM_t* aim, const mpai_aim_supervision_t* supervision)
+{
+	if (aim == NULL || supervision == NULL || MPAI_AIM_Get_Control(aim) == NULL)
+	{
+		LOG_ERR("AIM can't be supervised without a control block");
+		MPAI_ERR_INIT(err, MPAI_ERROR);
+		return err;
+	}
+
+	k_mutex_lock(&aim_supervisor_mutex, K_FOREVER);
+	if (aim_supervisor_count >= CONFIG_MPAI_AIM_SUPERVISOR_MAX)
+	{
+		k_mutex_unlock(&aim_supervisor_mutex);
+		LOG_ERR("Too many supervised AIMs (max %d)", CONFIG_MPAI_AIM_SUPERVISOR_MAX);
+		MPAI_ERR_INIT(err, MPAI_ERROR);
+		return err;
+	}
+	aim_supervisor_entry_t* entry = &aim_supervisor_entries[aim_supervisor_count++];
+	entry->_aim = aim;
+	entry->_supervision = *supervision;
+	memset(&entry->_status, 0, sizeof(mpai_aim_supervisor_status_t));
+	k_mutex_unlock(&aim_supervisor_mutex);
+
+	MPAI_ERR_INIT(err, MPAI_AIF_OK);
+	return err;
+}
+
+void MPAI_AIM_Supervisor_Remove(MPAI_Component_AIM_t* aim)
+{
+	k_mutex_lock(&aim_supervisor_mutex, K_FOREVER);
+	for (int i = 0; i < aim_supervisor_count; i++)
+	{
+		if (aim_supervisor_entries[i]._aim == aim)
+		{
+			memmove(&aim_supervisor_entries[i], &aim_supervisor_entries[i + 1], (aim_supervisor_count - i - 1) * sizeof(aim_supervisor_entry_t));
+			aim_supervisor_count--;
+			break;
+		}
+	}
+	bool restarting = aim_supervisor_restarting == aim;
+	k_mutex_unlock(&aim_supervisor_mutex);
+
+	// the caller is going to stop the AIM: wait for a restart in progress, not to be undone by it
+	if (restarting)
+	{
+		k_mutex_lock(&aim_supervisor_restart_mutex, K_FOREVER);
+		k_mutex_unlock(&aim_supervisor_restart_mutex);
+	}
+}
+
+mpai_error_t MPAI_AIM_Supervisor_Get_Status(MPAI_Component_AIM_t* aim, mpai_aim_supervisor_status_t* status)
+{
+	k_mutex_lock(&aim_supervisor_mutex, K_FOREVER);
+	for (int i = 0; i < aim_supervisor_count; i++)
+	{
+		if (aim_supervisor_entries[i]._aim == aim)
+		{
+			*status = aim_supervisor_entries[i]._status;
+			k_mutex_unlock(&aim_supervisor_mutex);
+
+			MPAI_ERR_INIT(err, MPAI_AIF_OK);
+			return err;
+		}
+	}
+	k_mutex_unlock(&aim_supervisor_mutex);
+
+	MPAI_ERR_INIT(err, MPAI_ERROR);
+	return err;
+}
+
+/************* PRIVATE IMPLEMENTATION *************/
+void _aim_supervisor_work_handler(struct k_work *work)
+{
+	aim_supervisor_action_t actions[CONFIG_MPAI_AIM_SUPERVISOR_MAX];
+	int action_count = 0;
+
+	k_mutex_lock(&aim_supervisor_mutex, K_FOREVER);
+	for (int i = 0; i < aim_supervisor_count; i++)
+	{
+		if (_aim_supervisor_check(&aim_supervisor_entries[i], &actions[action_count]))
+		{
+			action_count++;
+		}
+	}
+	k_mutex_unlock(&aim_supervisor_mutex);
+
+	for (int i = 0; i < action_count; i++)
+	{
+		_aim_supervisor_apply(&actions[i]);
+	}
+
+	k_work_schedule_for_queue(&aim_supervisor_work_q, &aim_supervisor_work, K_MSEC(CONFIG_MPAI_AIM_SUPERVISOR_PERIOD_MS));
+}
+
+bool _aim_supervisor_check(aim_supervisor_entry_t* entry, aim_supervisor_action_t* action)
+{
+	// paused (i.e. by the duty-cycle scheduler) or stopped AIMs are not expected to run
+	if (entry->_status._given_up || !MPAI_AIM_Is_Active(entry->_aim))
+	{
+		return false;
+	}
+	const char* name = MPAI_AIM_Get_Component(entry->_aim)->name;
+	mpai_aim_control_t* control = MPAI_AIM_Get_Control(entry->_aim);
+
+	// latency: worst message processed in the last period
+	uint32_t worst_response_ms = MPAI_AIM_Control_Take_Window_Max_Response(control);
+	if (entry->_supervision._latency_sla_ms > 0 && worst_response_ms > entry->_supervision._latency_sla_ms)
+	{
+		entry->_status._sla_violations++;
+		LOG_WRN("AIM %s: latency %u ms over SLA of %u ms (%u violations)", log_strdup(name),
+			worst_response_ms, entry->_supervision._latency_sla_ms, entry->_status._sla_violations);
+	}
+
+	if (MPAI_AIM_Control_Is_Alive(control, entry->_supervision._heartbeat_timeout_ms))
+	{
+		return false;
+	}
+
+	bool failed = MPAI_AIM_Control_Get_State(control) == MPAI_AIM_STATE_FAILED;
+	action->_aim = entry->_aim;
+	if (entry->_status._restarts >= entry->_supervision._max_restarts)
+	{
+		LOG_ERR("AIM %s %s after %u restarts: stopped", log_strdup(name), failed ? "failed" : "stalled", entry->_status._restarts);
+		entry->_status._given_up = true;
+		action->_give_up = true;
+		return true;
+	}
+
+	entry->_status._restarts++;
+	LOG_ERR("AIM %s %s: restarting (%u/%u)", log_strdup(name), failed ? "failed" : "stalled",
+		entry->_status._restarts, entry->_supervision._max_restarts);
+	action->_give_up = false;
+	return true;
+}
+
+void _aim_supervisor_apply(const aim_supervisor_action_t* action)
+{
+	// the restart mutex is taken before releasing the mutex, so a Remove can't get in between
+	k_mutex_lock(&aim_supervisor_mutex, K_FOREVER);
+	if (!_aim_supervisor_is_supervised(action->_aim))
+	{
+		k_mutex_unlock(&aim_supervisor_mutex);
+		return;
+	}
+	k_mutex_lock(&aim_supervisor_restart_mutex, K_FOREVER);
+	aim_supervisor_restarting = action->_aim;
+	k_mutex_unlock(&aim_supervisor_mutex);
+
+	// a stalled thread doesn't acknowledge the stop: the AIM aborts it
+	MPAI_AIM_Stop(action->_aim);
+	if (!action->_give_up)
+	{
+		MPAI_AIM_Start(action->_aim);
+	}
+
+	k_mutex_lock(&aim_supervisor_mutex, K_FOREVER);
+	aim_supervisor_restarting = NULL;
+	k_mutex_unlock(&aim_supervisor_mutex);
+	k_mutex_unlock(&aim_supervisor_restart_mutex);
+}
+
+bool _aim_supervisor_is_supervised(MPAI_Component_AIM_t* aim)
+{
+	for (int i = 0; i < aim_supervisor_count; i++)
+	{
+		if (aim_supervisor_entries[i]._aim == aim)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+#endif
@@ -0,0 +1,71 @@
+/*
+ * @file
+ * @brief Headers of the supervisor of the AIMs (heartbeats, latency SLA and automatic restart)
+ *
+ * Copyright (c) 2022 University of Turin, Daniele Bortoluzzi <danieleb88@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef MPAI_CORE_AIM_SUPERVISOR_H
+#define MPAI_CORE_AIM_SUPERVISOR_H
+
+#include <core_common.h>
+#include <core_aim.h>
+#include <aim_control.h>
+
+/* Supervision of an AIM, read from the "Supervision" property of its metadata */
+typedef struct _mpai_aim_supervision_t
+{
+	uint32_t _heartbeat_timeout_ms;	// max silence of a running AIM before restarting it
+	uint32_t _latency_sla_ms;		// max time to process a message, 0 means none
+	uint32_t _max_restarts;			// after that, the AIM is stopped and left down
+} mpai_aim_supervision_t;
+
+/* Counters of the supervisor for an AIM */
+typedef struct _mpai_aim_supervisor_status_t
+{
+	uint32_t _restarts;
+	uint32_t _sla_violations;		// supervisor periods with at least a message processed over the SLA
+	bool _given_up;					// max restarts reached
+} mpai_aim_supervisor_status_t;
+
+/**
+ * @brief Fill the supervision with the defaults of Kconfig
+ *
+ * @param supervision
+ */
+void MPAI_AIM_Supervisor_Default_Supervision(mpai_aim_supervision_t* supervision);
+
+/**
+ * @brief Initialize the supervisor and start its periodic check
+ *
+ */
+void MPAI_AIM_Supervisor_Init();
+
+/**
+ * @brief Supervise an already started AIM: it needs a control block (see MPAI_AIM_Set_Control)
+ *
+ * @param aim
+ * @param supervision
+ * @return mpai_error_t
+ */
+mpai_error_t MPAI_AIM_Supervisor_Add(MPAI_Component_AIM_t* aim, const mpai_aim_supervision_t* supervision);
+
+/**
+ * @brief Stop supervising an AIM (i.e. before stopping it on purpose)
+ *
+ * @param aim
+ */
+void MPAI_AIM_Supervisor_Remove(MPAI_Component_AIM_t* aim);
+
+/**
+ * @brief Get the counters of the supervisor for an AIM
+ *
+ * @param aim
+ * @param status
+ * @return mpai_error_t MPAI_ERROR if the AIM is not supervised
+ */
+mpai_error_t MPAI_AIM_Supervisor_Get_Status(MPAI_Component_AIM_t* aim, mpai_aim_supervisor_status_t* status);
+
+#endif
@@ -0,0 +1,259 @@
+/*
+ * @file
+ * @brief Implementation of the cache of the configurations in the flash store
+ *
+ * Copyright (c) 2022 University of Turin, Daniele Bortoluzzi <danieleb88@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "config_cache.h"
+
+#include <errno.h>
+#include <sys/crc.h>
+
+#ifdef CONFIG_MPAI_CONFIG_CACHE
+
+LOG_MODULE_REGISTER(MPAI_CORE_CONFIG_CACHE, LOG_LEVEL_INF);
+
+/* the keys of the configurations in the key-value store */
+#define CONFIG_CACHE_KEY_PREFIX "config/"
+
+/************* PRIVATE HEADER *************/
+/* fill a configuration from its value (etag, size and crc of the data): false if corrupted */
+bool _config_cache_load(mpai_config_cache_entry_t* entry);
+/* index of a configuration, -1 if not cached */
+int _config_cache_index_of(const char* name);
+/* add or replace the latest version of a configuration: false if the index is full */
+bool _config_cache_index_put(const mpai_config_cache_entry_t* entry);
+
+/* latest committed version of each configuration */
+static mpai_config_cache_entry_t config_cache_index[CONFIG_MPAI_CONFIG_CACHE_ENTRIES_MAX];
+static int config_cache_count = 0;
+static bool config_cache_loaded = false;
+
+K_MUTEX_DEFINE(config_cache_mutex);
+
+/************* PUBLIC **************/
+int MPAI_Config_Cache_Init(void)
+{
+	if (config_cache_loaded)
+	{
+		return 0;
+	}
+	int rc = MPAI_KV_Store_Init();
+	if (rc != 0)
+	{
+		return rc;
+	}
+
+	k_mutex_lock(&config_cache_mutex, K_FOREVER);
+	if (!config_cache_loaded)
+	{
+		for (int i = 0; i < MPAI_KV_Store_Count(); i++)
+		{
+			mpai_config_cache_entry_t entry = {};
+			if (!MPAI_KV_Store_Get_At(i, &entry._value) || strncmp(entry._value._key, CONFIG_CACHE_KEY_PREFIX, strlen(CONFIG_CACHE_KEY_PREFIX)) != 0)
+			{
+				continue;
+			}
+			if (!_config_cache_load(&entry))
+			{
+				LOG_WRN("Cached configuration %s corrupted: dropped", log_strdup(entry._value._key));
+			}
+			else if (!_config_cache_index_put(&entry))
+			{
+				LOG_WRN("Too many cached configurations (max %d): %s ignored", CONFIG_MPAI_CONFIG_CACHE_ENTRIES_MAX, log_strdup(entry._name));
+			}
+		}
+		LOG_INF("Config cache: %d configurations", config_cache_count);
+		config_cache_loaded = true;
+	}
+	k_mutex_unlock(&config_cache_mutex);
+	return 0;
+}
+
+bool MPAI_Config_Cache_Find(const char* name, mpai_config_cache_entry_t* entry)
+{
+	k_mutex_lock(&config_cache_mutex, K_FOREVER);
+	int index = _config_cache_index_of(name);
+	if (index >= 0)
+	{
+		*entry = config_cache_index[index];
+	}
+	k_mutex_unlock(&config_cache_mutex);
+	return index >= 0;
+}
+
+int MPAI_Config_Cache_Count(void)
+{
+	return config_cache_count;
+}
+
+bool MPAI_Config_Cache_Get(int index, mpai_config_cache_entry_t* entry)
+{
+	k_mutex_lock(&config_cache_mutex, K_FOREVER);
+	bool found = index >= 0 && index < config_cache_count;
+	if (found)
+	{
+		*entry = config_cache_index[index];
+	}
+	k_mutex_unlock(&config_cache_mutex);
+	return found;
+}
+
+int MPAI_Config_Cache_Read(const mpai_config_cache_entry_t* entry, size_t offset, void* buf, size_t len)
+{
+	if (offset >= entry->_len)
+	{
+		return 0;
+	}
+	// the data follow the etag in the value
+	return MPAI_KV_Store_Read(&entry->_value, 1 + entry->_etag_len + offset, buf, MIN(len, entry->_len - offset));
+}
+
+int MPAI_Config_Cache_Write_Begin(mpai_config_cache_writer_t* writer, const char* name, const uint8_t* etag, uint8_t etag_len)
+{
+	size_t name_len = strlen(name);
+	if (name_len == 0 || name_len > MPAI_CONFIG_CACHE_NAME_MAX_LEN || etag_len > MPAI_CONFIG_CACHE_ETAG_MAX_LEN)
+	{
+		return -EINVAL;
+	}
+	if (!config_cache_loaded)
+	{
+		return -ENODEV;
+	}
+
+	k_mutex_lock(&config_cache_mutex, K_FOREVER);
+	bool full = _config_cache_index_of(name) < 0 && config_cache_count >= CONFIG_MPAI_CONFIG_CACHE_ENTRIES_MAX;
+	k_mutex_unlock(&config_cache_mutex);
+	if (full)
+	{
+		LOG_WRN("Too many cached configurations (max %d)", CONFIG_MPAI_CONFIG_CACHE_ENTRIES_MAX);
+		return -ENOSPC;
+	}
+
+	memset(writer, 0, sizeof(mpai_config_cache_writer_t));
+	int rc = MPAI_KV_Store_Write_Begin(&writer->_writer, name, 1 + etag_len + CONFIG_MPAI_CONFIG_CACHE_ENTRY_MAX_SIZE);
+	if (rc != 0)
+	{
+		return rc;
+	}
+	mpai_config_cache_entry_t* entry = &writer->_entry;
+	strcpy(entry->_name, name);
+	uint8_t header[1 + MPAI_CONFIG_CACHE_ETAG_MAX_LEN];
+	header[0] = etag_len;
+	if (etag_len > 0)
+	{
+		memcpy(entry->_etag, etag, etag_len);
+		memcpy(&header[1], etag, etag_len);
+	}
+	entry->_etag_len = etag_len;
+	rc = MPAI_KV_Store_Write(&writer->_writer, header, 1 + etag_len);
+	if (rc != 0)
+	{
+		MPAI_KV_Store_Write_End(&writer->_writer, false);
+		return rc;
+	}
+	// unlocked by MPAI_Config_Cache_Write_End
+	return 0;
+}
+
+int MPAI_Config_Cache_Write(mpai_config_cache_writer_t* writer, const void* data, size_t len)
+{
+	if (writer->_failed)
+	{
+		return -EIO;
+	}
+	mpai_config_cache_entry_t* entry = &writer->_entry;
+	if (entry->_len + len > CONFIG_MPAI_CONFIG_CACHE_ENTRY_MAX_SIZE)
+	{
+		LOG_WRN("Configuration %s larger than %d bytes: not cached", log_strdup(entry->_name), CONFIG_MPAI_CONFIG_CACHE_ENTRY_MAX_SIZE);
+		writer->_failed = true;
+		return -EFBIG;
+	}
+	int rc = MPAI_KV_Store_Write(&writer->_writer, data, len);
+	if (rc != 0)
+	{
+		writer->_failed = true;
+		return rc;
+	}
+	entry->_crc = crc32_ieee_update(entry->_crc, data, len);
+	entry->_len += len;
+	return 0;
+}
+
+int MPAI_Config_Cache_Write_End(mpai_config_cache_writer_t* writer, bool commit)
+{
+	mpai_config_cache_entry_t* entry = &writer->_entry;
+	int rc = MPAI_KV_Store_Write_End(&writer->_writer, commit && !writer->_failed);
+	if (rc == 0 && MPAI_KV_Store_Find(entry->_name, &entry->_value))
+	{
+		k_mutex_lock(&config_cache_mutex, K_FOREVER);
+		_config_cache_index_put(entry);
+		k_mutex_unlock(&config_cache_mutex);
+		LOG_INF("Configuration %s cached (%u bytes)", log_strdup(entry->_name), entry->_len);
+	}
+	return rc;
+}
+
+/************* PRIVATE IMPLEMENTATION *************/
+bool _config_cache_load(mpai_config_cache_entry_t* entry)
+{
+	mpai_kv_store_entry_t* value = &entry->_value;
+	uint8_t header[1 + MPAI_CONFIG_CACHE_ETAG_MAX_LEN];
+	if (value->_len < 1 || MPAI_KV_Store_Read(value, 0, header, 1) != 1 || header[0] > MPAI_CONFIG_CACHE_ETAG_MAX_LEN
+		|| value->_len < 1 + header[0] || MPAI_KV_Store_Read(value, 1, &header[1], header[0]) != header[0])
+	{
+		return false;
+	}
+	strcpy(entry->_name, value->_key);
+	entry->_etag_len = header[0];
+	memcpy(entry->_etag, &header[1], entry->_etag_len);
+	entry->_len = value->_len - 1 - entry->_etag_len;
+
+	// crc of the value, and of the data alone
+	uint8_t buf[64];
+	uint32_t crc = crc32_ieee_update(0, header, 1 + entry->_etag_len);
+	entry->_crc = 0;
+	for (uint32_t offset = 0; offset < entry->_len; offset += sizeof(buf))
+	{
+		size_t len = MIN(sizeof(buf), entry->_len - offset);
+		if (MPAI_Config_Cache_Read(entry, offset, buf, len) != len)
+		{
+			return false;
+		}
+		crc = crc32_ieee_update(crc, buf, len);
+		entry->_crc = crc32_ieee_update(entry->_crc, buf, len);
+	}
+	return crc == value->_crc;
+}
+
+int _config_cache_index_of(const char* name)
+{
+	for (int i = 0; i < config_cache_count; i++)
+	{
+		if (strcmp(config_cache_index[i]._name, name) == 0)
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+bool _config_cache_index_put(const mpai_config_cache_entry_t* entry)
+{
+	int index = _config_cache_index_of(entry->_name);
+	if (index < 0)
+	{
+		if (config_cache_count >= CONFIG_MPAI_CONFIG_CACHE_ENTRIES_MAX)
+		{
+			return false;
+		}
+		index = config_cache_count++;
+	}
+	config_cache_index[index] = *entry;
+	return true;
+}
+
+#endif
@@ -0,0 +1,125 @@
+/*
+ * @file
+ * @brief Headers of the cache of the configurations in the flash store
+ *
+ * The configurations downloaded from the MPAI Config Store are kept by name, with the
+ * ETag (version) sent by the store, in the key-value store (the names, "config/...", are
+ * the keys). A version supersedes the previous one only once it is committed, so a download
+ * interrupted (or a power loss) leaves the previous version in place.
+ *
+ * Value layout: u8 etag length, etag, data
+ *
+ * Copyright (c) 2022 University of Turin, Daniele Bortoluzzi <danieleb88@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef MPAI_CORE_CONFIG_CACHE_H
+#define MPAI_CORE_CONFIG_CACHE_H
+
+#include <core_common.h>
+#include <kv_store.h>
+
+#define MPAI_CONFIG_CACHE_NAME_MAX_LEN 32
+/* max length of a CoAP ETag */
+#define MPAI_CONFIG_CACHE_ETAG_MAX_LEN 8
+
+/* Latest committed version of a configuration */
+typedef struct _mpai_config_cache_entry_t
+{
+	char _name[MPAI_CONFIG_CACHE_NAME_MAX_LEN + 1];
+	uint8_t _etag[MPAI_CONFIG_CACHE_ETAG_MAX_LEN];
+	uint8_t _etag_len;							// 0 if the store didn't send any
+	mpai_kv_store_entry_t _value;				// etag and data in the key-value store
+	uint32_t _len;
+	uint32_t _crc;								// crc32 (IEEE) of the data
+} mpai_config_cache_entry_t;
+
+/* Version being written: the key-value store is locked until it is ended */
+typedef struct _mpai_config_cache_writer_t
+{
+	mpai_config_cache_entry_t _entry;			// the version written so far
+	mpai_kv_store_writer_t _writer;
+	bool _failed;								// the version will be aborted
+} mpai_config_cache_writer_t;
+
+/**
+ * @brief Load the index of the cache from the key-value store: the latest version of
+ * each configuration is checked against its crc
+ *
+ * @return int 0 on success, negative on errors (the cache is disabled)
+ */
+int MPAI_Config_Cache_Init(void);
+
+/**
+ * @brief Search the latest version of a configuration
+ *
+ * @param name
+ * @param entry filled if found
+ * @return true
+ * @return false if not cached
+ */
+bool MPAI_Config_Cache_Find(const char* name, mpai_config_cache_entry_t* entry);
+
+/**
+ * @brief Number of configurations in the cache
+ *
+ * @return int
+ */
+int MPAI_Config_Cache_Count(void);
+
+/**
+ * @brief Get a configuration of the cache by index (see MPAI_Config_Cache_Count)
+ *
+ * @param index
+ * @param entry
+ * @return true
+ * @return false if the index is not valid
+ */
+bool MPAI_Config_Cache_Get(int index, mpai_config_cache_entry_t* entry);
+
+/**
+ * @brief Read the data of a configuration
+ *
+ * @param entry
+ * @param offset from the start of the data
+ * @param buf
+ * @param len
+ * @return int bytes read (0 at the end of the data), -ESTALE if a newer version was
+ * cached meanwhile, negative on other errors
+ */
+int MPAI_Config_Cache_Read(const mpai_config_cache_entry_t* entry, size_t offset, void* buf, size_t len);
+
+/**
+ * @brief Start writing a new version of a configuration, locking the key-value store
+ *
+ * @param writer
+ * @param name
+ * @param etag NULL if not known
+ * @param etag_len
+ * @return int 0 on success, -EBUSY if another version is being written by the same thread,
+ * negative on other errors (the cache is not locked)
+ */
+int MPAI_Config_Cache_Write_Begin(mpai_config_cache_writer_t* writer, const char* name, const uint8_t* etag, uint8_t etag_len);
+
+/**
+ * @brief Append data to the new version
+ *
+ * @param writer
+ * @param data
+ * @param len
+ * @return int 0 on success, negative if the configuration is larger than
+ * CONFIG_MPAI_CONFIG_CACHE_ENTRY_MAX_SIZE or on errors: the version will be aborted
+ */
+int MPAI_Config_Cache_Write(mpai_config_cache_writer_t* writer, const void* data, size_t len);
+
+/**
+ * @brief End the new version, unlocking the key-value store
+ *
+ * @param writer
+ * @param commit false to discard it, keeping the previous version
+ * @return int 0 if committed, negative if aborted
+ */
+int MPAI_Config_Cache_Write_End(mpai_config_cache_writer_t* writer, bool commit);
+
+#endif
@@ -9,40 +9,1287 @@
 
 #include "config_store.h"
 
+#include <errno.h>
+#include <sys/byteorder.h>
+#include <sys/crc.h>
+
 LOG_MODULE_REGISTER(MPAI_CONFIG_STORE, LOG_LEVEL_INF);
 
 /************* PRIVATE *************/
+#ifdef CONFIG_MPAI_CONFIG_STORE_USES_COAP
+typedef struct _config_store_buffer_t
+{
+	uint8_t* _data;
+	size_t _size;
+	size_t _len;
+} config_store_buffer_t;
+
+/* append a block to the buffer: false if it doesn't fit */
+bool _config_store_copy_chunk_callback(const uint8_t* data, size_t len, void* user_data);
+/* retrieve a configuration (<prefix><name>) from the cache, or from the MPAI Config Store */
+int _config_store_get_chunks(const char* prefix, const char* name, config_store_chunk_callback_t* chunk_callback, void* user_data);
+/* retrieve a configuration as a NUL terminated string (to be freed), NULL on errors */
+char* _config_store_get_string(const char* prefix, const char* name);
+/* download a configuration from the MPAI Config Store, caching it */
+int _config_store_download(const char* full_name, config_store_chunk_callback_t* chunk_callback, void* user_data);
+
+/* Configuration downloaded in advance, waiting to be retrieved */
+typedef struct _config_store_prefetched_t
+{
+	const char* _path[2];				// <prefix><name>, as CoAP path
+	coap_etag_t _etag;
+	coap_msg_buffer_t _buffer;
+	struct _config_store_prefetched_t* _next;
+} config_store_prefetched_t;
+
+/* new configuration to prefetch: NULL if already cached or prefetched */
+config_store_prefetched_t* _config_store_prefetch_new(const char* prefix, const char* name);
+void _config_store_prefetch_free(config_store_prefetched_t* prefetched);
+/* pass a prefetched configuration to the callback, dropping it: -ENOENT if not prefetched */
+int _config_store_read_prefetched(const char* full_name, config_store_chunk_callback_t* chunk_callback, void* user_data);
+/* true if a configuration is prefetched or cached */
+bool _config_store_is_available(const char* full_name);
+/* keep a configuration downloaded until retrieved (in the cache, if any, otherwise in memory), taking it */
+int _config_store_prefetch_keep(config_store_prefetched_t* prefetched);
+/* append a block to a prefetched configuration: false if larger than CONFIG_MPAI_CONFIG_STORE_PREFETCH_MAX_SIZE */
+bool _config_store_prefetch_append(const uint8_t* data, size_t len, void* user_data);
+/* download in parallel the configurations not NULL (and another transfer, if any): the ones kept are set to NULL */
+int _config_store_prefetch_round(config_store_prefetched_t** configs, size_t count, coap_transfer_t* transfers,
+									const coap_transfer_t* other_transfer);
+
+/* protected by config_store_mutex */
+static config_store_prefetched_t* config_store_prefetched = NULL;
+
+static bool config_store_connected = false;
+/* the local sources are read before the store (see MPAI_Config_Store_Set_Local_First) */
+static bool config_store_local_first = false;
+
+/* the socket is shared by the boot and the revalidation */
+K_MUTEX_DEFINE(config_store_mutex);
+#endif
+
+#ifdef CONFIG_MPAI_CONFIG_BUILTIN
+/* configuration built in the firmware, NULL if not found */
+const mpai_config_builtin_t* _config_store_find_builtin(const char* full_name);
+/* pass a configuration built in the firmware to the callback: -ENOENT if not built in */
+int _config_store_read_builtin(const char* full_name, config_store_chunk_callback_t* chunk_callback, void* user_data);
+
+/* configurations built in that have been read, by index (the ones after the 32nd are always considered read) */
+static uint32_t config_store_builtin_read = 0;
+#endif
+
+#ifdef CONFIG_MPAI_CONFIG_STORE_BUNDLE
+/*
+ * The bundle of an AIW (BUNDLE_CONFIG) has all its configurations, in a single transfer.
+ * Layout (little endian):
+ *   u32 magic "MPCB"
+ *   a record per configuration: u8 name length, u8 etag length, u32 data length,
+ *   full name (i.e. config/aim/<name>), etag, data
+ *   u8 0 (end of the bundle)
+ */
+#define CONFIG_STORE_BUNDLE_MAGIC 0x4243504D			// "MPCB"
+#define CONFIG_STORE_BUNDLE_MAGIC_SIZE 4
+#define CONFIG_STORE_BUNDLE_RECORD_SIZE 6
+#define CONFIG_STORE_BUNDLE_NAME_MAX_LEN 64
+
+/* Bundle demultiplexed while downloaded: each document is kept as soon as it is complete */
+typedef struct _config_store_bundle_t
+{
+	uint8_t _header[CONFIG_STORE_BUNDLE_RECORD_SIZE + CONFIG_STORE_BUNDLE_NAME_MAX_LEN + COAP_ETAG_MAX_LEN];
+	size_t _header_len;
+	bool _started;						// the magic has been read
+	bool _ended;
+	bool _reading;						// the data of a document, false while reading a header
+	size_t _remaining;					// data of the document still to read
+	config_store_prefetched_t* _document;	// being read in memory, NULL if cached while read or skipped
+#ifdef CONFIG_MPAI_CONFIG_CACHE
+	mpai_config_cache_writer_t _writer;
+	bool _writing;						// the document is written in the cache while read
+#endif
+	size_t _count;						// documents kept
+} config_store_bundle_t;
+
+/* split a block of the bundle into its configurations: false if not valid */
+bool _config_store_bundle_callback(const uint8_t* data, size_t len, void* user_data);
+/* start reading a document of the bundle: written in the cache, kept in memory or skipped (false on errors) */
+bool _config_store_bundle_document_begin(config_store_bundle_t* bundle, const char* name, const uint8_t* etag, uint8_t etag_len, uint32_t data_len);
+/* keep the document of the bundle just read */
+void _config_store_bundle_document_end(config_store_bundle_t* bundle);
+/* download the bundle of an AIW, with the AIF (if not NULL) in parallel, keeping its configurations */
+int _config_store_prefetch_bundle(const char* aiw_name, config_store_prefetched_t** aif_config, coap_transfer_t* transfers);
+#endif
+
+#ifdef CONFIG_MPAI_CONFIG_CACHE
+/* Download passed to the consumer and written in the cache */
+typedef struct _config_store_cache_tee_t
+{
+	const char* _name;
+	coap_etag_t _etag;					// filled by the first block
+	mpai_config_cache_writer_t _writer;
+	bool _started;						// the first block has arrived
+	bool _writing;
+	config_store_chunk_callback_t* _chunk_callback;	// NULL if only cached
+	void* _user_data;
+} config_store_cache_tee_t;
+
+bool _config_store_cache_tee_callback(const uint8_t* data, size_t len, void* user_data);
+/* write a prefetched configuration in the cache */
+int _config_store_cache_prefetched(const config_store_prefetched_t* prefetched);
+/* pass a cached configuration to the callback, chunk by chunk */
+int _config_store_read_cached(const mpai_config_cache_entry_t* entry, config_store_chunk_callback_t* chunk_callback, void* user_data);
+/* remember a configuration not cached while another one was being cached */
+void _config_store_add_uncached(const char* full_name);
+
+/* configurations downloaded while the cache was busy: cached by the revalidation */
+static char config_store_uncached[CONFIG_MPAI_CONFIG_CACHE_ENTRIES_MAX][MPAI_CONFIG_CACHE_NAME_MAX_LEN + 1];
+static int config_store_uncached_count = 0;
+#endif
+
+#if defined(CONFIG_MPAI_CONFIG_CACHE_REVALIDATE) || defined(CONFIG_MPAI_CONFIG_OBSERVE)
+/* Size and crc of a version downloaded, to be compared to the cached one */
+typedef struct _config_store_digest_t
+{
+	uint32_t _len;
+	uint32_t _crc;
+} config_store_digest_t;
+
+bool _config_store_digest_callback(const uint8_t* data, size_t len, void* user_data);
+#endif
+
+#ifdef CONFIG_MPAI_CONFIG_OBSERVE
+/* Configuration observed on the MPAI Config Store */
+typedef struct _config_store_observed_t
+{
+	const char* _prefix;
+	const char* _name;
+	const char* _path[2];				// <prefix><name>, as CoAP path
+	coap_observation_t _observation;
+	coap_etag_t _etag;					// of the version in use
+	config_store_digest_t _digest;		// of the version in use
+	bool _known;						// false until the version in use is known
+	bool _changed;						// notified, to be checked by the thread
+} config_store_observed_t;
+
+/* add a configuration to observe, knowing its version from the cache */
+void _config_store_observed_init(config_store_observed_t* observed, const char* prefix, const char* name);
+void _config_store_notification_callback(const char * const * path, const coap_etag_t* etag, void* user_data);
+/* check the version of a configuration notified, passing it to the callback if changed */
+void _config_store_check_observed(config_store_observed_t* observed);
+void th_config_store_observe(void *dummy1, void *dummy2, void *dummy3);
+
+/* max wait for notifications, without holding the socket, before the observations are checked for renewal */
+#define CONFIG_STORE_OBSERVE_POLL_MS 1000
+
+K_THREAD_STACK_DEFINE(thread_config_store_observe_stack_area, CONFIG_MPAI_CONFIG_OBSERVE_STACK_SIZE);
+static struct k_thread thread_config_store_observe;
+static atomic_t config_store_observing = ATOMIC_INIT(0);
+static config_store_observed_t* config_store_observed = NULL;
+static size_t config_store_observed_count = 0;
+static config_store_change_callback_t* config_store_change_callback = NULL;
+#endif
+
+#ifdef CONFIG_MPAI_CONFIG_CACHE_REVALIDATE
+void _config_store_revalidate_entry(const mpai_config_cache_entry_t* entry);
+void th_config_store_revalidate(void *dummy1, void *dummy2, void *dummy3);
+
+K_THREAD_STACK_DEFINE(thread_config_store_revalidate_stack_area, CONFIG_MPAI_CONFIG_CACHE_REVALIDATE_STACK_SIZE);
+static struct k_thread thread_config_store_revalidate;
+static atomic_t config_store_revalidating = ATOMIC_INIT(0);
+#endif
 
 /************* PUBLIC **************/
+int MPAI_Config_Store_Connect(void)
+{
+#ifdef CONFIG_MPAI_CONFIG_STORE_USES_COAP
+	k_mutex_lock(&config_store_mutex, K_FOREVER);
+	int ret = 0;
+	if (!config_store_connected)
+	{
+		wifi_connect();
+		ret = start_coap_client();
+		if (ret < 0)
+		{
+			(void)close(get_coap_sock());
+		}
+		config_store_connected = ret == 0;
+	}
+	k_mutex_unlock(&config_store_mutex);
+	return ret;
+#else
+	return -ENOTSUP;
+#endif
+}
+
+void MPAI_Config_Store_Disconnect(void)
+{
+#ifdef CONFIG_MPAI_CONFIG_STORE_USES_COAP
+	k_mutex_lock(&config_store_mutex, K_FOREVER);
+	if (config_store_connected)
+	{
+		coap_rtt_peer_t stats;
+		get_coap_rtt_stats(&stats);
+		LOG_INF("CoAP: %d requests, %d retransmissions, %d timeouts, RTT %d ms, RTO %d ms", stats.requests,
+			stats.retransmissions, stats.timeouts, stats.rtt_last_ms, stats.rto_ms);
+		/* Close the socket when it's no longer usefull*/
+		(void)close(get_coap_sock());
+		config_store_connected = false;
+	}
+	while (config_store_prefetched != NULL)
+	{
+		config_store_prefetched_t* prefetched = config_store_prefetched;
+		config_store_prefetched = prefetched->_next;
+		LOG_WRN("Configuration %s prefetched but not used", log_strdup(prefetched->_path[0]));
+		_config_store_prefetch_free(prefetched);
+	}
+	k_mutex_unlock(&config_store_mutex);
+#endif
+}
+
+void MPAI_Config_Store_Set_Local_First(bool local_first)
+{
+#ifdef CONFIG_MPAI_CONFIG_STORE_USES_COAP
+	config_store_local_first = local_first;
+#else
+	ARG_UNUSED(local_first);
+#endif
+}
+
+int MPAI_Config_Store_Revalidate(void)
+{
+#ifdef CONFIG_MPAI_CONFIG_CACHE_REVALIDATE
+	if (!atomic_cas(&config_store_revalidating, 0, 1))
+	{
+		return -EALREADY;
+	}
+	k_thread_create(&thread_config_store_revalidate, thread_config_store_revalidate_stack_area,
+					K_THREAD_STACK_SIZEOF(thread_config_store_revalidate_stack_area),
+					th_config_store_revalidate, NULL, NULL, NULL,
+					CONFIG_MPAI_CONFIG_CACHE_REVALIDATE_PRIORITY, 0, K_NO_WAIT);
+	k_thread_name_set(&thread_config_store_revalidate, "thread_config_store_revalidate");
+	return 0;
+#else
+	return -ENOTSUP;
+#endif
+}
+
+int MPAI_Config_Store_Prefetch(const char* aif_name, const char* aiw_name, const char* const* aim_names, size_t aim_count)
+{
+#ifdef CONFIG_MPAI_CONFIG_STORE_USES_COAP
+	size_t max_count = aim_count + 2;
+	config_store_prefetched_t** configs = (config_store_prefetched_t**) k_malloc(max_count * sizeof(config_store_prefetched_t*));
+	// one more for the bundle
+	coap_transfer_t* transfers = (coap_transfer_t*) k_malloc((max_count + 1) * sizeof(coap_transfer_t));
+	size_t count = 0;
+	int ret = 0;
+	if (configs == NULL || transfers == NULL)
+	{
+		ret = -ENOMEM;
+		goto end;
+	}
+
+	// the AIW (the largest one) is read block by block when retrieved, never kept in RAM
+	configs[count] = _config_store_prefetch_new(AIF_CONFIG[0], aif_name);
+	count += configs[count] != NULL;
+	for (size_t i = 0; i < aim_count; i++)
+	{
+		configs[count] = _config_store_prefetch_new(AIM_CONFIG[0], aim_names[i]);
+		count += configs[count] != NULL;
+	}
+	if (count == 0)
+	{
+		goto end;
+	}
+
+	ret = MPAI_Config_Store_Connect();
+	if (ret < 0)
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			_config_store_prefetch_free(configs[i]);
+		}
+		goto end;
+	}
+
+	k_mutex_lock(&config_store_mutex, K_FOREVER);
+#ifdef CONFIG_MPAI_CONFIG_STORE_BUNDLE
+	// the AIF is the first one, if not known yet
+	bool aif_needed = strncmp(configs[0]->_path[0], AIF_CONFIG[0], strlen(AIF_CONFIG[0])) == 0;
+	if (!aif_needed || count > 1)
+	{
+		(void)_config_store_prefetch_bundle(aiw_name, aif_needed ? &configs[0] : NULL, transfers);
+		// the ones not in the bundle (or all of them, if the store has no bundles) are requested one by one
+		for (size_t i = 0; i < count; i++)
+		{
+			if (configs[i] != NULL && _config_store_is_available(configs[i]->_path[0]))
+			{
+				_config_store_prefetch_free(configs[i]);
+				configs[i] = NULL;
+			}
+		}
+	}
+#endif
+	// in rounds, so that only a few buffers are on the heap at once
+	for (size_t first = 0; first < count; first += CONFIG_MPAI_CONFIG_STORE_PREFETCH_PARALLEL_MAX)
+	{
+		int round_ret = _config_store_prefetch_round(&configs[first], MIN(count - first, CONFIG_MPAI_CONFIG_STORE_PREFETCH_PARALLEL_MAX), transfers, NULL);
+		ret = ret < 0 ? ret : round_ret;
+	}
+	int prefetched_count = count;
+	for (size_t i = 0; i < count; i++)
+	{
+		// the failed ones are downloaded again when retrieved
+		if (configs[i] != NULL)
+		{
+			_config_store_prefetch_free(configs[i]);
+			prefetched_count--;
+		}
+	}
+	k_mutex_unlock(&config_store_mutex);
+	LOG_INF("%d of %zu configurations prefetched", prefetched_count, count);
+
+end:
+	k_free(transfers);
+	k_free(configs);
+	return ret;
+#else
+	ARG_UNUSED(aif_name);
+	ARG_UNUSED(aiw_name);
+	ARG_UNUSED(aim_names);
+	ARG_UNUSED(aim_count);
+	return 0;
+#endif
+}
+
+int MPAI_Config_Store_Observe(const char* aif_name, const char* aiw_name, const char* const* aim_names, size_t aim_count,
+								config_store_change_callback_t* change_callback)
+{
+#ifdef CONFIG_MPAI_CONFIG_OBSERVE
+	if (!atomic_cas(&config_store_observing, 0, 1))
+	{
+		return -EALREADY;
+	}
+	config_store_observed = (config_store_observed_t*) k_malloc((aim_count + 2) * sizeof(config_store_observed_t));
+	if (config_store_observed == NULL)
+	{
+		atomic_set(&config_store_observing, 0);
+		return -ENOMEM;
+	}
+	config_store_observed_count = 0;
+	_config_store_observed_init(&config_store_observed[config_store_observed_count++], AIF_CONFIG[0], aif_name);
+	_config_store_observed_init(&config_store_observed[config_store_observed_count++], AIW_CONFIG[0], aiw_name);
+	for (size_t i = 0; i < aim_count; i++)
+	{
+		_config_store_observed_init(&config_store_observed[config_store_observed_count++], AIM_CONFIG[0], aim_names[i]);
+	}
+	config_store_change_callback = change_callback;
+
+	k_thread_create(&thread_config_store_observe, thread_config_store_observe_stack_area,
+					K_THREAD_STACK_SIZEOF(thread_config_store_observe_stack_area),
+					th_config_store_observe, NULL, NULL, NULL,
+					CONFIG_MPAI_CONFIG_OBSERVE_PRIORITY, 0, K_NO_WAIT);
+	k_thread_name_set(&thread_config_store_observe, "thread_config_store_observe");
+	return 0;
+#else
+	ARG_UNUSED(aif_name);
+	ARG_UNUSED(aiw_name);
+	ARG_UNUSED(aim_names);
+	ARG_UNUSED(aim_count);
+	ARG_UNUSED(change_callback);
+	return -ENOTSUP;
+#endif
+}
+
 char* MPAI_Config_Store_Get_AIF(const char* aif_name)
 {
 #ifdef CONFIG_MPAI_CONFIG_STORE_USES_COAP
-	char* aif_full_name = append_strings(AIF_CONFIG[0], aif_name);
-	char * aif_config_path[] = { aif_full_name, NULL };/*TODO: UNION DEFAULT OPTIONS*/
-	return get_large_coap_msgs(aif_config_path);
+	return _config_store_get_string(AIF_CONFIG[0], aif_name);
 #else
 	return "{}";
 #endif
-} 
+}
 
 char* MPAI_Config_Store_Get_AIW(const char* aiw_name)
 {
 #ifdef CONFIG_MPAI_CONFIG_STORE_USES_COAP
-	char* aiw_full_name = append_strings(AIW_CONFIG[0], aiw_name);
-	char * aiw_config_path[] = { aiw_full_name, NULL };/*TODO: UNION DEFAULT OPTIONS*/
-	return get_large_coap_msgs(aiw_config_path);
+	return _config_store_get_string(AIW_CONFIG[0], aiw_name);
 #else
 	return "{}";
 #endif
 }
 
+int MPAI_Config_Store_Get_AIW_Chunks(const char* aiw_name, config_store_chunk_callback_t* chunk_callback, void* user_data)
+{
+#ifdef CONFIG_MPAI_CONFIG_STORE_USES_COAP
+	return _config_store_get_chunks(AIW_CONFIG[0], aiw_name, chunk_callback, user_data);
+#else
+	const char empty_config[] = "{}";
+	return chunk_callback((const uint8_t*) empty_config, strlen(empty_config), user_data) ? 0 : -ECANCELED;
+#endif
+}
+
 char* MPAI_Config_Store_Get_AIM(const char* aim_name)
 {
 #ifdef CONFIG_MPAI_CONFIG_STORE_USES_COAP
-	char* aim_full_name = append_strings(AIM_CONFIG[0], aim_name);
-	char * aim_config_path[] = { aim_full_name, NULL };/*TODO: UNION DEFAULT OPTIONS*/
-	return get_large_coap_msgs(aim_config_path);
+	return _config_store_get_string(AIM_CONFIG[0], aim_name);
 #else
 	return "{}";
 #endif
-}
\ No newline at end of file
+}
+
+int MPAI_Config_Store_Get_Binary(const char* aif_name, uint8_t* buffer, size_t buffer_size)
+{
+#if defined(CONFIG_MPAI_CONFIG_STORE_USES_COAP)
+	if (config_store_local_first)
+	{
+		// not waited for: the JSON configurations are read instead
+		char* full_name = append_strings(BINARY_CONFIG[0], aif_name);
+		bool available = full_name != NULL && _config_store_is_available(full_name);
+		k_free(full_name);
+		if (!available)
+		{
+			return -EAGAIN;
+		}
+	}
+	config_store_buffer_t config_buffer = { ._data = buffer, ._size = buffer_size, ._len = 0 };
+	int ret = _config_store_get_chunks(BINARY_CONFIG[0], aif_name, _config_store_copy_chunk_callback, &config_buffer);
+	return ret < 0 ? ret : config_buffer._len;
+#else
+	ARG_UNUSED(aif_name);
+	ARG_UNUSED(buffer);
+	ARG_UNUSED(buffer_size);
+	return -ENOTSUP;
+#endif
+}
+
+int MPAI_Config_Store_Put(const char* prefix, const char* name, const uint8_t* data, size_t len)
+{
+#ifdef CONFIG_MPAI_CONFIG_STORE_USES_COAP
+	char* full_name = append_strings(prefix, name);
+	config_store_prefetched_t* put = full_name == NULL ? NULL : (config_store_prefetched_t*) k_malloc(sizeof(config_store_prefetched_t));
+	if (put == NULL)
+	{
+		k_free(full_name);
+		return -ENOMEM;
+	}
+	memset(put, 0, sizeof(config_store_prefetched_t));
+	put->_path[0] = full_name;
+	if (!coap_msg_buffer_append(data, len, &put->_buffer))
+	{
+		_config_store_prefetch_free(put);
+		return -ENOMEM;
+	}
+
+	// a version put before and not read yet is replaced
+	k_mutex_lock(&config_store_mutex, K_FOREVER);
+	config_store_prefetched_t** link = &config_store_prefetched;
+	while (*link != NULL && strcmp((*link)->_path[0], full_name) != 0)
+	{
+		link = &(*link)->_next;
+	}
+	config_store_prefetched_t* replaced = *link;
+	if (replaced != NULL)
+	{
+		*link = replaced->_next;
+	}
+	k_mutex_unlock(&config_store_mutex);
+	if (replaced != NULL)
+	{
+		_config_store_prefetch_free(replaced);
+	}
+
+	LOG_INF("Configuration %s put (%zu bytes)", log_strdup(full_name), len);
+	return _config_store_prefetch_keep(put);
+#else
+	ARG_UNUSED(prefix);
+	ARG_UNUSED(name);
+	ARG_UNUSED(data);
+	ARG_UNUSED(len);
+	return -ENOTSUP;
+#endif
+}
+
+/************* PRIVATE IMPLEMENTATION *************/
+#ifdef CONFIG_MPAI_CONFIG_STORE_USES_COAP
+bool _config_store_copy_chunk_callback(const uint8_t* data, size_t len, void* user_data)
+{
+	config_store_buffer_t* config_buffer = (config_store_buffer_t*) user_data;
+	if (config_buffer->_len + len > config_buffer->_size)
+	{
+		LOG_ERR("Binary configuration larger than %zu bytes", config_buffer->_size);
+		return false;
+	}
+	memcpy(&config_buffer->_data[config_buffer->_len], data, len);
+	config_buffer->_len += len;
+	return true;
+}
+
+int _config_store_get_chunks(const char* prefix, const char* name, config_store_chunk_callback_t* chunk_callback, void* user_data)
+{
+	char* full_name = append_strings(prefix, name);
+	if (full_name == NULL)
+	{
+		return -ENOMEM;
+	}
+	int ret = _config_store_read_prefetched(full_name, chunk_callback, user_data);
+#ifdef CONFIG_MPAI_CONFIG_CACHE
+	mpai_config_cache_entry_t entry;
+	if (ret == -ENOENT && MPAI_Config_Cache_Init() == 0 && MPAI_Config_Cache_Find(full_name, &entry))
+	{
+		LOG_INF("Configuration %s read from the cache", log_strdup(full_name));
+		ret = _config_store_read_cached(&entry, chunk_callback, user_data);
+	}
+#endif
+#ifdef CONFIG_MPAI_CONFIG_BUILTIN
+	if ((ret == -ENOENT || ret == -EIO) && config_store_local_first)
+	{
+		ret = _config_store_read_builtin(full_name, chunk_callback, user_data);
+	}
+#endif
+#ifdef CONFIG_MPAI_CONFIG_CACHE
+	// the store is asked only if the cache can't be read
+	if (ret == -ENOENT || ret == -EIO)
+#else
+	if (ret == -ENOENT)
+#endif
+	{
+		ret = _config_store_download(full_name, chunk_callback, user_data);
+	}
+	k_free(full_name);
+	return ret;
+}
+
+char* _config_store_get_string(const char* prefix, const char* name)
+{
+	// rebuilt in a single buffer, grown geometrically
+	coap_msg_buffer_t config_buffer = { .data = NULL, .size = 0, .len = 0 };
+	int ret = _config_store_get_chunks(prefix, name, coap_msg_buffer_append, &config_buffer);
+	if (ret < 0 || coap_msg_buffer_reserve(&config_buffer, 1) < 0)
+	{
+		k_free(config_buffer.data);
+		return NULL;
+	}
+	return (char*) config_buffer.data;
+}
+
+int _config_store_download(const char* full_name, config_store_chunk_callback_t* chunk_callback, void* user_data)
+{
+	int ret = MPAI_Config_Store_Connect();
+	if (ret < 0)
+	{
+		return ret;
+	}
+
+	const char * config_path[] = { full_name, NULL };/*TODO: UNION DEFAULT OPTIONS*/
+	k_mutex_lock(&config_store_mutex, K_FOREVER);
+#ifdef CONFIG_MPAI_CONFIG_CACHE
+	config_store_cache_tee_t tee = { ._name = full_name, ._started = false, ._writing = false, ._chunk_callback = chunk_callback, ._user_data = user_data };
+	ret = get_large_coap_msgs_if_modified(config_path, &tee._etag, _config_store_cache_tee_callback, &tee);
+	if (tee._writing)
+	{
+		MPAI_Config_Cache_Write_End(&tee._writer, ret == 0);
+	}
+#else
+	ret = get_large_coap_msgs_with_callback(config_path, chunk_callback, user_data);
+#endif
+	k_mutex_unlock(&config_store_mutex);
+	return ret;
+}
+
+config_store_prefetched_t* _config_store_prefetch_new(const char* prefix, const char* name)
+{
+	char* full_name = append_strings(prefix, name);
+	if (full_name == NULL)
+	{
+		return NULL;
+	}
+	bool known = _config_store_is_available(full_name);
+	config_store_prefetched_t* prefetched = known ? NULL : (config_store_prefetched_t*) k_malloc(sizeof(config_store_prefetched_t));
+	if (prefetched == NULL)
+	{
+		k_free(full_name);
+		return NULL;
+	}
+	memset(prefetched, 0, sizeof(config_store_prefetched_t));
+	prefetched->_path[0] = full_name;
+	return prefetched;
+}
+
+void _config_store_prefetch_free(config_store_prefetched_t* prefetched)
+{
+	k_free((char*) prefetched->_path[0]);
+	k_free(prefetched->_buffer.data);
+	k_free(prefetched);
+}
+
+int _config_store_read_prefetched(const char* full_name, config_store_chunk_callback_t* chunk_callback, void* user_data)
+{
+	k_mutex_lock(&config_store_mutex, K_FOREVER);
+	config_store_prefetched_t** link = &config_store_prefetched;
+	while (*link != NULL && strcmp((*link)->_path[0], full_name) != 0)
+	{
+		link = &(*link)->_next;
+	}
+	config_store_prefetched_t* prefetched = *link;
+	if (prefetched != NULL)
+	{
+		*link = prefetched->_next;
+	}
+	k_mutex_unlock(&config_store_mutex);
+
+	if (prefetched == NULL)
+	{
+		return -ENOENT;
+	}
+	LOG_INF("Configuration %s prefetched", log_strdup(full_name));
+	int ret = chunk_callback(prefetched->_buffer.data, prefetched->_buffer.len, user_data) ? 0 : -ECANCELED;
+	_config_store_prefetch_free(prefetched);
+	return ret;
+}
+
+bool _config_store_is_available(const char* full_name)
+{
+	bool known = false;
+	k_mutex_lock(&config_store_mutex, K_FOREVER);
+	for (config_store_prefetched_t* prefetched = config_store_prefetched; prefetched != NULL && !known; prefetched = prefetched->_next)
+	{
+		known = strcmp(prefetched->_path[0], full_name) == 0;
+	}
+	k_mutex_unlock(&config_store_mutex);
+#ifdef CONFIG_MPAI_CONFIG_CACHE
+	mpai_config_cache_entry_t entry;
+	known = known || (MPAI_Config_Cache_Init() == 0 && MPAI_Config_Cache_Find(full_name, &entry));
+#endif
+	return known;
+}
+
+int _config_store_prefetch_keep(config_store_prefetched_t* prefetched)
+{
+	if (coap_msg_buffer_reserve(&prefetched->_buffer, 1) < 0)
+	{
+		_config_store_prefetch_free(prefetched);
+		return -ENOMEM;
+	}
+#ifdef CONFIG_MPAI_CONFIG_CACHE
+	if (_config_store_cache_prefetched(prefetched) == 0)
+	{
+		_config_store_prefetch_free(prefetched);
+		return 0;
+	}
+#endif
+	k_mutex_lock(&config_store_mutex, K_FOREVER);
+	prefetched->_next = config_store_prefetched;
+	config_store_prefetched = prefetched;
+	k_mutex_unlock(&config_store_mutex);
+	return 0;
+}
+
+bool _config_store_prefetch_append(const uint8_t* data, size_t len, void* user_data)
+{
+	coap_msg_buffer_t* buffer = (coap_msg_buffer_t*) user_data;
+	if (buffer->len + len > CONFIG_MPAI_CONFIG_STORE_PREFETCH_MAX_SIZE)
+	{
+		LOG_INF("Configuration larger than %d bytes: not prefetched", CONFIG_MPAI_CONFIG_STORE_PREFETCH_MAX_SIZE);
+		return false;
+	}
+	return coap_msg_buffer_append(data, len, buffer);
+}
+
+int _config_store_prefetch_round(config_store_prefetched_t** configs, size_t count, coap_transfer_t* transfers,
+									const coap_transfer_t* other_transfer)
+{
+	size_t transfer_count = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		if (configs[i] == NULL)
+		{
+			continue;
+		}
+		memset(&transfers[transfer_count], 0, sizeof(coap_transfer_t));
+		transfers[transfer_count].path = configs[i]->_path;
+		transfers[transfer_count].etag = &configs[i]->_etag;
+		transfers[transfer_count].block_callback = _config_store_prefetch_append;
+		transfers[transfer_count].user_data = &configs[i]->_buffer;
+		transfer_count++;
+	}
+	if (other_transfer != NULL)
+	{
+		transfers[transfer_count++] = *other_transfer;
+	}
+	if (transfer_count == 0)
+	{
+		return 0;
+	}
+
+	int ret = get_large_coap_msgs_parallel(transfers, transfer_count);
+	transfer_count = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		if (configs[i] == NULL)
+		{
+			continue;
+		}
+		if (transfers[transfer_count++].result == 0)
+		{
+			// taken, even if it can't be kept
+			(void)_config_store_prefetch_keep(configs[i]);
+			configs[i] = NULL;
+		}
+		else
+		{
+			k_free(configs[i]->_buffer.data);
+			memset(&configs[i]->_buffer, 0, sizeof(coap_msg_buffer_t));
+		}
+	}
+	return ret;
+}
+#endif
+
+#ifdef CONFIG_MPAI_CONFIG_STORE_BUNDLE
+bool _config_store_bundle_callback(const uint8_t* data, size_t len, void* user_data)
+{
+	config_store_bundle_t* bundle = (config_store_bundle_t*) user_data;
+	while (len > 0 && !bundle->_ended)
+	{
+		// data of a document
+		if (bundle->_reading)
+		{
+			size_t chunk_len = MIN(len, bundle->_remaining);
+			if (bundle->_document != NULL && !coap_msg_buffer_append(data, chunk_len, &bundle->_document->_buffer))
+			{
+				return false;
+			}
+#ifdef CONFIG_MPAI_CONFIG_CACHE
+			if (bundle->_writing)
+			{
+				// a document not cached is downloaded again when retrieved
+				(void)MPAI_Config_Cache_Write(&bundle->_writer, data, chunk_len);
+			}
+#endif
+			data += chunk_len;
+			len -= chunk_len;
+			bundle->_remaining -= chunk_len;
+			if (bundle->_remaining == 0)
+			{
+				_config_store_bundle_document_end(bundle);
+			}
+			continue;
+		}
+
+		// a name length 0 ends the bundle
+		if (bundle->_started && bundle->_header_len == 0 && data[0] == 0)
+		{
+			bundle->_ended = true;
+			break;
+		}
+
+		// header of a document, maybe split across blocks
+		size_t header_size = CONFIG_STORE_BUNDLE_MAGIC_SIZE;
+		if (bundle->_started)
+		{
+			header_size = CONFIG_STORE_BUNDLE_RECORD_SIZE;
+			if (bundle->_header_len >= CONFIG_STORE_BUNDLE_RECORD_SIZE)
+			{
+				header_size += bundle->_header[0] + bundle->_header[1];
+			}
+		}
+		size_t chunk_len = MIN(len, header_size - bundle->_header_len);
+		memcpy(&bundle->_header[bundle->_header_len], data, chunk_len);
+		bundle->_header_len += chunk_len;
+		data += chunk_len;
+		len -= chunk_len;
+		if (bundle->_header_len < header_size)
+		{
+			continue;
+		}
+
+		if (!bundle->_started)
+		{
+			if (sys_get_le32(bundle->_header) != CONFIG_STORE_BUNDLE_MAGIC)
+			{
+				LOG_ERR("Bundle not valid");
+				return false;
+			}
+			bundle->_started = true;
+			bundle->_header_len = 0;
+			continue;
+		}
+		uint8_t name_len = bundle->_header[0];
+		uint8_t etag_len = bundle->_header[1];
+		if (name_len > CONFIG_STORE_BUNDLE_NAME_MAX_LEN || etag_len > COAP_ETAG_MAX_LEN)
+		{
+			LOG_ERR("Bundle not valid");
+			return false;
+		}
+		if (header_size == CONFIG_STORE_BUNDLE_RECORD_SIZE)
+		{
+			// name and etag
+			continue;
+		}
+
+		char name[CONFIG_STORE_BUNDLE_NAME_MAX_LEN + 1];
+		memcpy(name, &bundle->_header[CONFIG_STORE_BUNDLE_RECORD_SIZE], name_len);
+		name[name_len] = '\0';
+		uint32_t data_len = sys_get_le32(&bundle->_header[2]);
+		bundle->_header_len = 0;
+		bundle->_remaining = data_len;
+		bundle->_reading = true;
+		if (!_config_store_bundle_document_begin(bundle, name, &bundle->_header[CONFIG_STORE_BUNDLE_RECORD_SIZE + name_len], etag_len, data_len))
+		{
+			return false;
+		}
+		if (data_len == 0)
+		{
+			_config_store_bundle_document_end(bundle);
+		}
+	}
+	return true;
+}
+
+bool _config_store_bundle_document_begin(config_store_bundle_t* bundle, const char* name, const uint8_t* etag, uint8_t etag_len, uint32_t data_len)
+{
+	if (_config_store_is_available(name))
+	{
+		return true;
+	}
+#ifdef CONFIG_MPAI_CONFIG_CACHE
+	// written while read: nothing is kept in memory
+	if (data_len <= CONFIG_MPAI_CONFIG_CACHE_ENTRY_MAX_SIZE && MPAI_Config_Cache_Init() == 0
+		&& MPAI_Config_Cache_Write_Begin(&bundle->_writer, name, etag, etag_len) == 0)
+	{
+		bundle->_writing = true;
+		return true;
+	}
+#endif
+	if (data_len > CONFIG_MPAI_CONFIG_STORE_PREFETCH_MAX_SIZE)
+	{
+		LOG_INF("Configuration %s larger than %d bytes: not prefetched", log_strdup(name), CONFIG_MPAI_CONFIG_STORE_PREFETCH_MAX_SIZE);
+		return true;
+	}
+
+	config_store_prefetched_t* document = (config_store_prefetched_t*) k_malloc(sizeof(config_store_prefetched_t));
+	char* full_name = (char*) k_malloc(strlen(name) + 1);
+	if (document == NULL || full_name == NULL)
+	{
+		k_free(document);
+		k_free(full_name);
+		return false;
+	}
+	memset(document, 0, sizeof(config_store_prefetched_t));
+	strcpy(full_name, name);
+	document->_path[0] = full_name;
+	memcpy(document->_etag.value, etag, etag_len);
+	document->_etag.len = etag_len;
+	bundle->_document = document;
+	// the size is known: a single allocation
+	return coap_msg_buffer_reserve(&document->_buffer, data_len + 1) == 0;
+}
+
+void _config_store_bundle_document_end(config_store_bundle_t* bundle)
+{
+	bundle->_reading = false;
+#ifdef CONFIG_MPAI_CONFIG_CACHE
+	if (bundle->_writing)
+	{
+		bundle->_writing = false;
+		bundle->_count += MPAI_Config_Cache_Write_End(&bundle->_writer, true) == 0;
+	}
+#endif
+	if (bundle->_document != NULL)
+	{
+		// taken, even if it can't be kept
+		bundle->_count += _config_store_prefetch_keep(bundle->_document) == 0;
+		bundle->_document = NULL;
+	}
+}
+
+int _config_store_prefetch_bundle(const char* aiw_name, config_store_prefetched_t** aif_config, coap_transfer_t* transfers)
+{
+	char* bundle_name = append_strings(BUNDLE_CONFIG[0], aiw_name);
+	config_store_bundle_t bundle = {};
+	int ret = -ENOMEM;
+	if (bundle_name != NULL)
+	{
+		const char* bundle_path[] = { bundle_name, NULL };
+		coap_transfer_t bundle_transfer = {
+			.path = bundle_path,
+			.block_callback = _config_store_bundle_callback,
+			.user_data = &bundle,
+		};
+		size_t aif_count = aif_config != NULL;
+		(void)_config_store_prefetch_round(aif_config, aif_count, transfers, &bundle_transfer);
+		ret = transfers[aif_count].result;
+		if (ret == 0 && !bundle._ended)
+		{
+			LOG_ERR("Bundle truncated");
+			ret = -EBADMSG;
+		}
+	}
+
+	// the documents completed are kept even if the bundle is not
+#ifdef CONFIG_MPAI_CONFIG_CACHE
+	if (bundle._writing)
+	{
+		MPAI_Config_Cache_Write_End(&bundle._writer, false);
+	}
+#endif
+	if (bundle._document != NULL)
+	{
+		_config_store_prefetch_free(bundle._document);
+	}
+	if (ret == 0)
+	{
+		LOG_INF("Bundle %s: %zu configurations", log_strdup(bundle_name), bundle._count);
+	}
+	else
+	{
+		LOG_WRN("Bundle of %s not available (%d): the configurations are requested one by one", log_strdup(aiw_name), ret);
+	}
+	k_free(bundle_name);
+	return ret;
+}
+#endif
+
+#ifdef CONFIG_MPAI_CONFIG_BUILTIN
+const mpai_config_builtin_t* _config_store_find_builtin(const char* full_name)
+{
+	for (size_t i = 0; i < mpai_config_builtin_count; i++)
+	{
+		if (strcmp(mpai_config_builtin[i]._name, full_name) == 0)
+		{
+			return &mpai_config_builtin[i];
+		}
+	}
+	return NULL;
+}
+
+int _config_store_read_builtin(const char* full_name, config_store_chunk_callback_t* chunk_callback, void* user_data)
+{
+	const mpai_config_builtin_t* builtin = _config_store_find_builtin(full_name);
+	if (builtin == NULL)
+	{
+		return -ENOENT;
+	}
+	LOG_INF("Configuration %s built in", log_strdup(full_name));
+	size_t index = builtin - mpai_config_builtin;
+	config_store_builtin_read |= index < 32 ? BIT(index) : 0;
+	return chunk_callback((const uint8_t*) builtin->_data, builtin->_len, user_data) ? 0 : -ECANCELED;
+}
+#endif
+
+#ifdef CONFIG_MPAI_CONFIG_CACHE
+int _config_store_cache_prefetched(const config_store_prefetched_t* prefetched)
+{
+	mpai_config_cache_writer_t writer;
+	int ret = MPAI_Config_Cache_Init();
+	if (ret == 0)
+	{
+		ret = MPAI_Config_Cache_Write_Begin(&writer, prefetched->_path[0], prefetched->_etag.value, prefetched->_etag.len);
+	}
+	if (ret < 0)
+	{
+		return ret;
+	}
+	ret = MPAI_Config_Cache_Write(&writer, prefetched->_buffer.data, prefetched->_buffer.len);
+	return MPAI_Config_Cache_Write_End(&writer, ret == 0);
+}
+
+bool _config_store_cache_tee_callback(const uint8_t* data, size_t len, void* user_data)
+{
+	config_store_cache_tee_t* tee = (config_store_cache_tee_t*) user_data;
+	// the ETag is known once the first block has arrived
+	if (!tee->_started)
+	{
+		tee->_started = true;
+		int ret = MPAI_Config_Cache_Init();
+		if (ret == 0)
+		{
+			ret = MPAI_Config_Cache_Write_Begin(&tee->_writer, tee->_name, tee->_etag.value, tee->_etag.len);
+		}
+		if (ret == -EBUSY)
+		{
+			_config_store_add_uncached(tee->_name);
+		}
+		tee->_writing = ret == 0;
+	}
+	if (tee->_writing)
+	{
+		// a configuration not cached is still used
+		MPAI_Config_Cache_Write(&tee->_writer, data, len);
+	}
+	return tee->_chunk_callback == NULL || tee->_chunk_callback(data, len, tee->_user_data);
+}
+
+int _config_store_read_cached(const mpai_config_cache_entry_t* entry, config_store_chunk_callback_t* chunk_callback, void* user_data)
+{
+	uint8_t chunk[128];
+	size_t offset = 0;
+	while (offset < entry->_len)
+	{
+		int len = MPAI_Config_Cache_Read(entry, offset, chunk, sizeof(chunk));
+		if (len <= 0)
+		{
+			LOG_ERR("Cached configuration %s not readable (%d)", log_strdup(entry->_name), len);
+			// nothing has been passed yet: the caller falls back to the store
+			return offset == 0 ? -EIO : -EFAULT;
+		}
+		if (!chunk_callback(chunk, len, user_data))
+		{
+			return -ECANCELED;
+		}
+		offset += len;
+	}
+	return 0;
+}
+
+void _config_store_add_uncached(const char* full_name)
+{
+	for (int i = 0; i < config_store_uncached_count; i++)
+	{
+		if (strcmp(config_store_uncached[i], full_name) == 0)
+		{
+			return;
+		}
+	}
+	if (config_store_uncached_count < CONFIG_MPAI_CONFIG_CACHE_ENTRIES_MAX)
+	{
+		strncpy(config_store_uncached[config_store_uncached_count++], full_name, MPAI_CONFIG_CACHE_NAME_MAX_LEN);
+	}
+}
+#endif
+
+#if defined(CONFIG_MPAI_CONFIG_CACHE_REVALIDATE) || defined(CONFIG_MPAI_CONFIG_OBSERVE)
+bool _config_store_digest_callback(const uint8_t* data, size_t len, void* user_data)
+{
+	config_store_digest_t* digest = (config_store_digest_t*) user_data;
+	digest->_crc = crc32_ieee_update(digest->_crc, data, len);
+	digest->_len += len;
+	return true;
+}
+#endif
+
+#ifdef CONFIG_MPAI_CONFIG_CACHE_REVALIDATE
+
+void _config_store_revalidate_entry(const mpai_config_cache_entry_t* entry)
+{
+	const char * config_path[] = { entry->_name, NULL };
+	coap_etag_t etag = { .len = entry->_etag_len };
+	memcpy(etag.value, entry->_etag, entry->_etag_len);
+	config_store_digest_t digest = { ._len = 0, ._crc = 0 };
+
+	k_mutex_lock(&config_store_mutex, K_FOREVER);
+	int ret = get_large_coap_msgs_if_modified(config_path, &etag, _config_store_digest_callback, &digest);
+	k_mutex_unlock(&config_store_mutex);
+	if (ret < 0)
+	{
+		LOG_WRN("Configuration %s not revalidated (%d)", log_strdup(entry->_name), ret);
+		return;
+	}
+	// a store without ETags sends the whole configuration every time: the flash is written only if it has changed
+	if (ret == COAP_REPLY_NOT_MODIFIED || (digest._len == entry->_len && digest._crc == entry->_crc
+		&& etag.len == entry->_etag_len && memcmp(etag.value, entry->_etag, etag.len) == 0))
+	{
+		LOG_INF("Configuration %s up to date", log_strdup(entry->_name));
+		return;
+	}
+
+	ret = _config_store_download(entry->_name, NULL, NULL);
+	if (ret == 0)
+	{
+		LOG_INF("Configuration %s updated: used from the next boot", log_strdup(entry->_name));
+	}
+}
+
+void th_config_store_revalidate(void *dummy1, void *dummy2, void *dummy3)
+{
+	ARG_UNUSED(dummy1);
+	ARG_UNUSED(dummy2);
+	ARG_UNUSED(dummy3);
+
+	if (MPAI_Config_Cache_Init() == 0 && MPAI_Config_Store_Connect() == 0)
+	{
+		// the configurations not cached at boot are not in the cache yet
+		int uncached_count = config_store_uncached_count;
+		for (int i = 0; i < MPAI_Config_Cache_Count(); i++)
+		{
+			mpai_config_cache_entry_t entry;
+			if (MPAI_Config_Cache_Get(i, &entry))
+			{
+				_config_store_revalidate_entry(&entry);
+			}
+		}
+		for (int i = 0; i < uncached_count; i++)
+		{
+			_config_store_download(config_store_uncached[i], NULL, NULL);
+		}
+		config_store_uncached_count = 0;
+	}
+
+	MPAI_Config_Store_Disconnect();
+	atomic_set(&config_store_revalidating, 0);
+}
+#endif
+
+#ifdef CONFIG_MPAI_CONFIG_OBSERVE
+void _config_store_observed_init(config_store_observed_t* observed, const char* prefix, const char* name)
+{
+	memset(observed, 0, sizeof(config_store_observed_t));
+	observed->_prefix = prefix;
+	observed->_name = name;
+	observed->_path[0] = append_strings(prefix, name);
+	observed->_observation.path = observed->_path;
+	observed->_observation.callback = _config_store_notification_callback;
+	observed->_observation.user_data = observed;
+#ifdef CONFIG_MPAI_CONFIG_CACHE
+	mpai_config_cache_entry_t entry;
+	if (observed->_path[0] != NULL && MPAI_Config_Cache_Init() == 0 && MPAI_Config_Cache_Find(observed->_path[0], &entry))
+	{
+		memcpy(observed->_etag.value, entry._etag, entry._etag_len);
+		observed->_etag.len = entry._etag_len;
+		observed->_digest._len = entry._len;
+		observed->_digest._crc = entry._crc;
+		observed->_known = true;
+	}
+#endif
+#ifdef CONFIG_MPAI_CONFIG_BUILTIN
+	// not cached: the version in use is the one built in, if read at boot
+	const mpai_config_builtin_t* builtin = observed->_path[0] != NULL ? _config_store_find_builtin(observed->_path[0]) : NULL;
+	size_t index = builtin != NULL ? builtin - mpai_config_builtin : 0;
+	if (!observed->_known && builtin != NULL && (index >= 32 || (config_store_builtin_read & BIT(index)) != 0))
+	{
+		memcpy(observed->_etag.value, builtin->_etag, MIN(builtin->_etag_len, sizeof(observed->_etag.value)));
+		observed->_etag.len = MIN(builtin->_etag_len, sizeof(observed->_etag.value));
+		observed->_digest._len = builtin->_len;
+		observed->_digest._crc = crc32_ieee((const uint8_t*) builtin->_data, builtin->_len);
+		observed->_known = true;
+	}
+#endif
+}
+
+void _config_store_notification_callback(const char * const * path, const coap_etag_t* etag, void* user_data)
+{
+	config_store_observed_t* observed = (config_store_observed_t*) user_data;
+	// the notifications of the renewals carry the same version
+	if (observed->_known && etag->len > 0 && etag->len == observed->_etag.len && memcmp(etag->value, observed->_etag.value, etag->len) == 0)
+	{
+		return;
+	}
+	observed->_changed = true;
+}
+
+void _config_store_check_observed(config_store_observed_t* observed)
+{
+	coap_etag_t etag = observed->_etag;
+	config_store_digest_t digest = { ._len = 0, ._crc = 0 };
+
+	// a store without ETags sends the whole configuration: it is compared to the version in use
+	k_mutex_lock(&config_store_mutex, K_FOREVER);
+	int ret = get_large_coap_msgs_if_modified(observed->_path, observed->_known ? &etag : NULL, _config_store_digest_callback, &digest);
+	k_mutex_unlock(&config_store_mutex);
+	if (ret < 0)
+	{
+		LOG_WRN("Configuration %s not checked (%d)", log_strdup(observed->_path[0]), ret);
+		return;
+	}
+	if (ret == COAP_REPLY_NOT_MODIFIED)
+	{
+		return;
+	}
+	if (observed->_known && digest._len == observed->_digest._len && digest._crc == observed->_digest._crc)
+	{
+		// same version with another ETag (i.e. built in): the next notifications carry this one
+		observed->_etag = etag;
+		return;
+	}
+
+	// the first check finds the version in use, if not cached
+	bool changed = observed->_known;
+	observed->_etag = etag;
+	observed->_digest = digest;
+	observed->_known = true;
+	if (!changed)
+	{
+#ifdef CONFIG_MPAI_CONFIG_CACHE
+		// not cached at boot (i.e. while another one was being cached)
+		_config_store_download(observed->_path[0], NULL, NULL);
+#endif
+		return;
+	}
+
+	LOG_INF("Configuration %s changed on the MPAI Config Store", log_strdup(observed->_path[0]));
+#ifdef CONFIG_MPAI_CONFIG_CACHE
+	// the new version is read from the cache
+	if (_config_store_download(observed->_path[0], NULL, NULL) < 0)
+	{
+		return;
+	}
+#endif
+	if (config_store_change_callback != NULL)
+	{
+		config_store_change_callback(observed->_prefix, observed->_name);
+	}
+}
+
+void th_config_store_observe(void *dummy1, void *dummy2, void *dummy3)
+{
+	ARG_UNUSED(dummy1);
+	ARG_UNUSED(dummy2);
+	ARG_UNUSED(dummy3);
+
+	while (1)
+	{
+		if (MPAI_Config_Store_Connect() < 0)
+		{
+			k_sleep(K_SECONDS(CONFIG_MPAI_CONFIG_OBSERVE_KEEPALIVE));
+			continue;
+		}
+
+		k_mutex_lock(&config_store_mutex, K_FOREVER);
+		int64_t now = k_uptime_get();
+		for (size_t i = 0; i < config_store_observed_count; i++)
+		{
+			coap_observation_t* observation = &config_store_observed[i]._observation;
+			// renewed at a low rate to keep it alive, or registered again if ended by the store
+			if (config_store_observed[i]._path[0] != NULL && (!observation->registered
+				|| now - observation->registered_at >= CONFIG_MPAI_CONFIG_OBSERVE_KEEPALIVE * MSEC_PER_SEC))
+			{
+				int ret = coap_observe(observation);
+				if (ret < 0)
+				{
+					LOG_WRN("Configuration %s not observed (%d)", log_strdup(config_store_observed[i]._path[0]), ret);
+				}
+			}
+		}
+		k_mutex_unlock(&config_store_mutex);
+
+		// the socket is shared: it is taken only to read the notifications arrived
+		int ret = coap_wait_notifications(CONFIG_STORE_OBSERVE_POLL_MS);
+		if (ret > 0)
+		{
+			k_mutex_lock(&config_store_mutex, K_FOREVER);
+			ret = coap_process_notifications(0);
+			k_mutex_unlock(&config_store_mutex);
+		}
+		if (ret < 0)
+		{
+			// the observations are registered again on a new connection
+			LOG_WRN("Connection to the MPAI Config Store lost (%d)", ret);
+			MPAI_Config_Store_Disconnect();
+			for (size_t i = 0; i < config_store_observed_count; i++)
+			{
+				config_store_observed[i]._observation.registered = false;
+			}
+			k_sleep(K_SECONDS(1));
+			continue;
+		}
+
+		for (size_t i = 0; i < config_store_observed_count; i++)
+		{
+			if (config_store_observed[i]._changed)
+			{
+				config_store_observed[i]._changed = false;
+				_config_store_check_observed(&config_store_observed[i]);
+			}
+		}
+	}
+}
+#endif
@@ -18,12 +18,120 @@
 #include <misc_utils.h>
 #ifdef CONFIG_MPAI_CONFIG_STORE_USES_COAP
     #include <coap_connect.h>
+    #include <wifi_connect.h>
 
     static const char * const AIF_CONFIG[] = { "config/aif/", NULL };
     static const char * const AIW_CONFIG[] = { "config/aiw/", NULL };
     static const char * const AIM_CONFIG[] = { "config/aim/", NULL };
+    static const char * const BINARY_CONFIG[] = { "config/bin/", NULL };
+    static const char * const BUNDLE_CONFIG[] = { "config/bundle/", NULL };
+#endif
+#ifdef CONFIG_MPAI_CONFIG_CACHE
+    #include <config_cache.h>
+#endif
+
+/**
+ * @brief Called with each chunk of a configuration, in order
+ * 
+ * @return false to stop the retrieval
+ */
+typedef bool (config_store_chunk_callback_t)(const uint8_t* data, size_t len, void* user_data);
+
+/**
+ * @brief Called when a configuration observed has changed on the MPAI Config Store
+ * (and it has been cached, if the cache is enabled)
+ * 
+ * @param prefix of the configuration (i.e. AIM_CONFIG[0])
+ * @param name 
+ */
+typedef void (config_store_change_callback_t)(const char* prefix, const char* name);
+
+/**
+ * @brief Configuration built in the firmware (generated by tools/mpai_builtin_config.py from docs)
+ */
+typedef struct _mpai_config_builtin_t
+{
+	const char* _name;					// full name, i.e. config/aim/<name>
+	const uint8_t* _etag;				// as given by tools/mpai_store_server.py
+	size_t _etag_len;
+	const char* _data;
+	size_t _len;
+} mpai_config_builtin_t;
+
+#ifdef CONFIG_MPAI_CONFIG_BUILTIN
+extern const mpai_config_builtin_t mpai_config_builtin[];
+extern const size_t mpai_config_builtin_count;
 #endif
 
+/**
+ * @brief Connect to the MPAI Config Store (Wi-Fi and CoAP client), if not connected yet.
+ * The configurations are retrieved from the cache first, so the store is connected only when needed
+ * 
+ * @return int 0 on success, negative on errors
+ */
+int MPAI_Config_Store_Connect(void);
+
+/**
+ * @brief Close the connection to the MPAI Config Store, if any
+ */
+void MPAI_Config_Store_Disconnect(void);
+
+/**
+ * @brief Read the configurations from the local sources first (prefetched, cached, then built in the
+ * firmware), so that the boot doesn't wait for the MPAI Config Store: only the ones missing are downloaded.
+ * The binary configuration is read only if prefetched or cached.
+ * Observed with MPAI_Config_Store_Observe, the versions built in are compared to the ones of the store
+ * 
+ * @param local_first 
+ */
+void MPAI_Config_Store_Set_Local_First(bool local_first);
+
+/**
+ * @brief Revalidate the cached configurations against the MPAI Config Store in background,
+ * with conditional requests (ETag): the new versions are cached and used from the next boot.
+ * The connection is closed at the end
+ * 
+ * @return int 0 if started, -EALREADY if running, -ENOTSUP without the cache
+ */
+int MPAI_Config_Store_Revalidate(void);
+
+/**
+ * @brief Download in parallel the configurations of an AIF and its AIMs not cached yet: they
+ * are kept (in the cache, if any, otherwise in memory) until retrieved, so that the boot waits
+ * for the slowest one instead of all of them in turn. At most
+ * CONFIG_MPAI_CONFIG_STORE_PREFETCH_PARALLEL_MAX of them are downloaded at once, and the ones
+ * larger than CONFIG_MPAI_CONFIG_STORE_PREFETCH_MAX_SIZE are left to be downloaded when
+ * retrieved. The AIW is not prefetched: it is read block by block when retrieved.
+ * With CONFIG_MPAI_CONFIG_STORE_BUNDLE, the AIW and its AIMs are requested first as a single bundle
+ * (BUNDLE_CONFIG), falling back to a request for each of them not found in it.
+ * The configurations not retrieved are dropped by MPAI_Config_Store_Disconnect
+ * 
+ * @param aif_name 
+ * @param aiw_name 
+ * @param aim_names 
+ * @param aim_count 
+ * @return int 0 on success, negative if some of them have not been downloaded (they are
+ * downloaded again when retrieved)
+ */
+int MPAI_Config_Store_Prefetch(const char* aif_name, const char* aiw_name, const char* const* aim_names, size_t aim_count);
+
+/**
+ * @brief Observe in background the configurations of an AIF, its AIW and AIMs on the MPAI Config Store,
+ * which notifies their changes (CoAP Observe): each change is checked with a conditional request and
+ * passed to the callback. The observations are renewed every CONFIG_MPAI_CONFIG_OBSERVE_KEEPALIVE seconds.
+ * The connection stays open
+ * 
+ * @param aif_name 
+ * @param aiw_name 
+ * @param aim_names 
+ * @param aim_count 
+ * @param change_callback called by the observation thread
+ * @return int 0 if started, -EALREADY if running, -ENOTSUP without CONFIG_MPAI_CONFIG_OBSERVE,
+ * negative on other errors. The names must stay valid
+ */
+int MPAI_Config_Store_Observe(const char* aif_name, const char* aiw_name, const char* const* aim_names, size_t aim_count,
+								config_store_change_callback_t* change_callback);
+
 /**
  * @brief Retrieve AIF configuration in a JSON format
  * 
@@ -40,6 +148,17 @@ char* MPAI_Config_Store_Get_AIF(const char* aif_name);
  */
 char* MPAI_Config_Store_Get_AIW(const char* aiw_name);
 
+/**
+ * @brief Retrieve AIW configuration in a JSON format, passing each chunk to the callback
+ * as soon as it arrives (nothing is kept in memory)
+ * 
+ * @param aiw_name 
+ * @param chunk_callback 
+ * @param user_data 
+ * @return int 0 on success, negative on errors
+ */
+int MPAI_Config_Store_Get_AIW_Chunks(const char* aiw_name, config_store_chunk_callback_t* chunk_callback, void* user_data);
+
 /**
  * @brief Retrieve AIM configuration in a JSON format
  * 
@@ -48,4 +167,30 @@ char* MPAI_Config_Store_Get_AIW(const char* aiw_name);
  */
 char* MPAI_Config_Store_Get_AIM(const char* aim_name);
 
+/**
+ * @brief Retrieve the binary configuration of an AIF (compiled by tools/mpai_config_compiler.py)
+ * from the MPAI Config Store.
+ * It is not validated: see MPAI_Metadata_Parser_Binary_Open
+ * 
+ * @param aif_name 
+ * @param buffer 
+ * @param buffer_size 
+ * @return int size of the configuration, negative on errors (-ENOTSUP if there isn't any source)
+ */
+int MPAI_Config_Store_Get_Binary(const char* aif_name, uint8_t* buffer, size_t buffer_size);
+
+/**
+ * @brief Put a configuration received out of the MPAI Config Store (i.e. over Bluetooth): it is
+ * retrieved, instead of the version in use, by the next read (from the cache, if enabled, so also
+ * after a reboot). It has no ETag: the version of the store replaces it once the store is revalidated
+ * or notifies a change
+ * 
+ * @param prefix i.e. AIM_CONFIG[0]
+ * @param name 
+ * @param data 
+ * @param len 
+ * @return int 0 on success, negative on errors (-ENOTSUP without CONFIG_MPAI_CONFIG_STORE_USES_COAP)
+ */
+int MPAI_Config_Store_Put(const char* prefix, const char* name, const uint8_t* data, size_t len);
+
 #endif
\ No newline at end of file
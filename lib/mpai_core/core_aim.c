@@ -8,6 +8,9 @@
  */
 
 #include "core_aim.h"
+#include "aim_control.h"
+
+#include <boot_trace.h>
 
 LOG_MODULE_REGISTER(MPAI_CORE_AIM, LOG_LEVEL_INF);
 
@@ -25,6 +28,8 @@ struct MPAI_Component_AIM_t
 	module_t* _resume;		 // AIM's resume function
 	module_t* _pause;		 // AIM's pause function
 	bool _active;		 	 // indicates if AIM is started or not		
+	mpai_aim_thread_config_t _thread_config; // scheduling parameters of the AIM's thread
+	mpai_aim_control_t* _control; // control block of the AIM's thread
 };
 
 mpai_error_t MPAI_AIM_Start(MPAI_Component_AIM_t* me)
@@ -37,7 +42,9 @@ mpai_error_t MPAI_AIM_Start(MPAI_Component_AIM_t* me)
 	}
 	
 	// let's start the AIM
-	*(me->_start)();
+	BOOT_TRACE_BEGIN(me->_component->name);
+	*(me->_start)(&me->_thread_config);
+	BOOT_TRACE_END(me->_component->name);
 	me->_active = true;
 
 	LOG_INF("AIM %s started with success.", log_strdup(me->_component->name));
@@ -110,10 +117,44 @@ module_t* MPAI_AIM_Get_Subscriber(MPAI_Component_AIM_t* me)
 }
 
 bool MPAI_AIM_Is_Alive(MPAI_Component_AIM_t* me)
+{
+	if (!me->_active)
+	{
+		return false;
+	}
+	// without control block, there are no signs of life to check
+	if (me->_control == NULL)
+	{
+		return true;
+	}
+	return MPAI_AIM_Control_Is_Alive(me->_control, CONFIG_MPAI_AIM_HEARTBEAT_TIMEOUT_MS);
+}
+
+bool MPAI_AIM_Is_Active(MPAI_Component_AIM_t* me)
 {
 	return me->_active;
 }
 
+void MPAI_AIM_Set_Control(MPAI_Component_AIM_t* me, mpai_aim_control_t* control)
+{
+	me->_control = control;
+}
+
+mpai_aim_control_t* MPAI_AIM_Get_Control(MPAI_Component_AIM_t* me)
+{
+	return me->_control;
+}
+
+int MPAI_AIM_Get_AIW_ID(MPAI_Component_AIM_t* me)
+{
+	return me->_aiw_id;
+}
+
+void MPAI_AIM_Set_Thread_Config(MPAI_Component_AIM_t* me, const mpai_aim_thread_config_t* config)
+{
+	me->_thread_config = *config;
+}
+
 MPAI_Component_AIM_t* MPAI_AIM_Creator(
 	char* name, 
 	int aiw_id,
@@ -140,6 +181,8 @@ MPAI_Component_AIM_t* MPAI_AIM_Creator(
 	this->_resume = resume;
 	this->_pause = pause;
 	this->_active = false;
+	MPAI_AIM_Control_Default_Thread_Config(&this->_thread_config);
+	this->_control = NULL;
 
 	return this;
 }
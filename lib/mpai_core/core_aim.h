@@ -14,6 +14,9 @@
 #include <message_store.h>
 
 typedef struct MPAI_Component_AIM_t MPAI_Component_AIM_t;
+/* defined in aim_control.h */
+typedef struct _mpai_aim_thread_config_t mpai_aim_thread_config_t;
+typedef struct _mpai_aim_control_t mpai_aim_control_t;
 
 /**
  * @brief Start the AIM
@@ -52,11 +55,42 @@ component_t* MPAI_AIM_Get_Component(MPAI_Component_AIM_t* me);
 module_t* MPAI_AIM_Get_Subscriber(MPAI_Component_AIM_t* me);
 
 /**
- * @brief Get the status of the AIM
+ * @brief Get the status of the AIM: started, not paused, not failed and giving signs of life
+ * within CONFIG_MPAI_AIM_HEARTBEAT_TIMEOUT_MS
  * 
  */
 bool MPAI_AIM_Is_Alive(MPAI_Component_AIM_t* me);
 
+/**
+ * @brief Check if the AIM has been started and not paused
+ * 
+ */
+bool MPAI_AIM_Is_Active(MPAI_Component_AIM_t* me);
+
+/**
+ * @brief Set the control block of the AIM's thread, used to check its liveness
+ * 
+ */
+void MPAI_AIM_Set_Control(MPAI_Component_AIM_t* me, mpai_aim_control_t* control);
+
+/**
+ * @brief Get the control block of the AIM's thread (NULL if not set)
+ * 
+ */
+mpai_aim_control_t* MPAI_AIM_Get_Control(MPAI_Component_AIM_t* me);
+
+/**
+ * @brief Get the identifier of the AIW of the AIM
+ * 
+ */
+int MPAI_AIM_Get_AIW_ID(MPAI_Component_AIM_t* me);
+
+/**
+ * @brief Set the scheduling parameters passed to the AIM at the next start
+ * 
+ */
+void MPAI_AIM_Set_Thread_Config(MPAI_Component_AIM_t* me, const mpai_aim_thread_config_t* config);
+
 /**
  * Constructor and set up the AIM
  * @param name name of the AIM
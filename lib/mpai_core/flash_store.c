@@ -19,13 +19,10 @@ LOG_MODULE_REGISTER(MPAI_FLASH_STORE, LOG_LEVEL_INF);
 
 struct device* init_flash()
 {
-	printf("\n" FLASH_NAME " SPI flash testing\n");
-	printf("==========================\n");
-
 	struct device* flash_dev = device_get_binding(FLASH_DEVICE);
 
 	if (!flash_dev) {
-		LOG_ERR("SPI flash driver %s was not found!\n",
+		LOG_ERR(FLASH_NAME " flash driver %s was not found!",
 		       FLASH_DEVICE);
 		return NULL;
 	}
@@ -33,36 +30,34 @@ struct device* init_flash()
 	return flash_dev;
 }
 
-int erase_flash(const struct device* flash_dev)
+int erase_flash(const struct device* flash_dev, off_t offset, size_t size)
 {
-	int rc = flash_erase(flash_dev, FLASH_TEST_REGION_OFFSET,
-			 FLASH_SECTOR_SIZE);
+	int rc = flash_erase(flash_dev, FLASH_STORE_REGION_OFFSET + offset, size);
 	if (rc != 0) {
-		LOG_ERR("Flash erase failed! %d\n", rc);
+		LOG_ERR("Flash erase failed at 0x%x! %d", (uint32_t) offset, rc);
 	} else {
-		LOG_INF("Flash erase succeeded!\n");
+		LOG_DBG("Flash erase of %zu bytes at 0x%x succeeded", size, (uint32_t) offset);
 	}
 	return rc;
 }
 
-int write_flash(const struct device* flash_dev, size_t len, void* data)
+int write_flash(const struct device* flash_dev, off_t offset, size_t len, const void* data)
 {
-	LOG_INF("Attempting to write %zu bytes\n", len);
-	int rc = flash_write(flash_dev, FLASH_TEST_REGION_OFFSET, data, len);
+	LOG_DBG("Attempting to write %zu bytes at 0x%x", len, (uint32_t) offset);
+	int rc = flash_write(flash_dev, FLASH_STORE_REGION_OFFSET + offset, data, len);
 	if (rc != 0) {
-		LOG_ERR("Flash write failed! %d\n", rc);
+		LOG_ERR("Flash write failed at 0x%x! %d", (uint32_t) offset, rc);
 		return rc;
 	}
 	return rc;
 }
 
-int read_flash(const struct device* flash_dev, size_t len, void* buf)
+int read_flash(const struct device* flash_dev, off_t offset, size_t len, void* buf)
 {
-	memset(buf, 0, len);
-	int rc = flash_read(flash_dev, FLASH_TEST_REGION_OFFSET, buf, len);
+	int rc = flash_read(flash_dev, FLASH_STORE_REGION_OFFSET + offset, buf, len);
 	if (rc != 0) {
-		LOG_ERR("Flash read failed! %d\n", rc);
+		LOG_ERR("Flash read failed at 0x%x! %d", (uint32_t) offset, rc);
 		return rc;
 	}
 	return rc;
-}
\ No newline at end of file
+}
@@ -34,24 +34,56 @@
 #error Unsupported flash driver
 #endif
 
+/* Start of the region of the flash store: offsets of the functions below are from here */
 #if defined(CONFIG_BOARD_ADAFRUIT_FEATHER_STM32F405)
-#define FLASH_TEST_REGION_OFFSET 0xf000
+#define FLASH_STORE_REGION_OFFSET 0xf000
 #elif defined(CONFIG_BOARD_ARTY_A7_ARM_DESIGNSTART_M1) || \
 	defined(CONFIG_BOARD_ARTY_A7_ARM_DESIGNSTART_M3)
 /* The FPGA bitstream is stored in the lower 536 sectors of the flash. */
-#define FLASH_TEST_REGION_OFFSET \
+#define FLASH_STORE_REGION_OFFSET \
 	DT_REG_SIZE(DT_NODE_BY_FIXED_PARTITION_LABEL(fpga_bitstream))
 #else
-#define FLASH_TEST_REGION_OFFSET 0xff000
+#define FLASH_STORE_REGION_OFFSET 0xff000
 #endif
 #define FLASH_SECTOR_SIZE        4096
 
+/**
+ * @brief Get the flash device of the store
+ * 
+ * @return struct device* NULL if not found
+ */
 struct device* init_flash();
 
-int erase_flash(const struct device* dev);
+/**
+ * @brief Erase the sectors of a range of the region
+ * 
+ * @param dev 
+ * @param offset multiple of FLASH_SECTOR_SIZE
+ * @param size multiple of FLASH_SECTOR_SIZE
+ * @return int 0 on success
+ */
+int erase_flash(const struct device* dev, off_t offset, size_t size);
 
-int write_flash(const struct device* dev, size_t len, void* data);
+/**
+ * @brief Write in an erased range of the region (NOR flash: bits can only be cleared)
+ * 
+ * @param dev 
+ * @param offset 
+ * @param len 
+ * @param data 
+ * @return int 0 on success
+ */
+int write_flash(const struct device* dev, off_t offset, size_t len, const void* data);
 
-int read_flash(const struct device* dev, size_t len, void* buf);
+/**
+ * @brief Read a range of the region
+ * 
+ * @param dev 
+ * @param offset 
+ * @param len 
+ * @param buf 
+ * @return int 0 on success
+ */
+int read_flash(const struct device* dev, off_t offset, size_t len, void* buf);
 
 #endif
\ No newline at end of file
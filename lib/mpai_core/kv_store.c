@@ -0,0 +1,896 @@
+/*
+ * @file
+ * @brief Implementation of the key-value store in the flash store
+ *
+ * Copyright (c) 2022 University of Turin, Daniele Bortoluzzi <danieleb88@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "kv_store.h"
+
+#include <errno.h>
+#include <sys/byteorder.h>
+#include <sys/crc.h>
+
+#ifdef CONFIG_MPAI_KV_STORE
+
+LOG_MODULE_REGISTER(MPAI_CORE_KV_STORE, LOG_LEVEL_INF);
+
+#define KV_STORE_BLOCK_MAGIC 0x564B504D			// "MPKV"
+#define KV_STORE_RECORD_MAGIC 0x524B504D		// "MPKR"
+#define KV_STORE_BLOCK_HEADER_SIZE 16
+#define KV_STORE_RECORD_HEADER_SIZE 20
+#define KV_STORE_ERASED 0xFFFFFFFF
+#define KV_STORE_STATE_COMMITTED 0x00C0FFEE
+#define KV_STORE_STATE_DELETED 0x00DE1E7E
+#define KV_STORE_STATE_ABORTED 0x00000000
+/* the sequence of a block is never erased (nor 0, erased block in RAM) */
+#define KV_STORE_SEQ_MAX 0xFFFFFFFE
+
+#define KV_STORE_SIZE ((uint32_t) CONFIG_MPAI_KV_STORE_BLOCKS * CONFIG_MPAI_KV_STORE_BLOCK_SIZE)
+#define KV_STORE_BLOCK_START(block) ((uint32_t) (block) * CONFIG_MPAI_KV_STORE_BLOCK_SIZE)
+#define KV_STORE_BLOCK_OF(offset) ((int) ((offset) / CONFIG_MPAI_KV_STORE_BLOCK_SIZE))
+/* room for the records: the block after the head is always erased */
+#define KV_STORE_CAPACITY ((uint32_t) (CONFIG_MPAI_KV_STORE_BLOCKS - 1) * (CONFIG_MPAI_KV_STORE_BLOCK_SIZE - KV_STORE_BLOCK_HEADER_SIZE))
+/* slots of the hash table of the index: at least one is always free */
+#define KV_STORE_SLOTS (2 * CONFIG_MPAI_KV_STORE_ENTRIES_MAX)
+
+/* A block of the store, erased if its sequence is 0 */
+typedef struct _kv_store_block_t
+{
+	uint32_t _seq;
+	uint32_t _erases;
+	uint32_t _end;								// first free offset in the block
+} kv_store_block_t;
+
+/************* PRIVATE HEADER *************/
+/* size of a record in a block */
+uint32_t _kv_store_record_size(size_t key_len, uint32_t value_len);
+int _kv_store_read(uint32_t offset, void* buf, size_t len);
+int _kv_store_write(uint32_t offset, const void* data, size_t len);
+/* load the blocks and the index, rolling back a collection interrupted */
+int _kv_store_mount(void);
+/* add the records of a block to the index */
+void _kv_store_scan_block(int block);
+bool _kv_store_is_erased(int block);
+int _kv_store_erase_block(int block);
+/* start writing the records in an erased block: on errors, the head is left closed */
+int _kv_store_open_block(int block);
+/* open the next block, collecting the oldest one: a collection failed is rolled back */
+int _kv_store_advance(void);
+/* make room in the head for a record, advancing as needed */
+int _kv_store_reserve(uint32_t size);
+/* size of the records of the live values */
+uint32_t _kv_store_live_size(void);
+/* records appended to the head (with the mutex locked) */
+int _kv_store_record_begin(mpai_kv_store_writer_t* writer, const char* key, size_t max_len);
+int _kv_store_record_append(mpai_kv_store_writer_t* writer, const void* data, size_t len);
+int _kv_store_record_end(mpai_kv_store_writer_t* writer, uint32_t state);
+/* copy a live value to the head, updating its offset */
+int _kv_store_copy(mpai_kv_store_entry_t* entry);
+/* offset of the value of an entry, if not replaced since it was found */
+int _kv_store_locate(const mpai_kv_store_entry_t* entry, uint32_t* offset);
+uint32_t _kv_store_hash(const char* key);
+/* index of a key, -1 if not stored */
+int _kv_store_index_of(const char* key);
+/* add or replace the value of a key: false if the index is full */
+bool _kv_store_index_put(const mpai_kv_store_entry_t* entry);
+void _kv_store_index_remove_at(int index);
+void _kv_store_slot_add(int index);
+
+static const struct device* kv_store_dev = NULL;
+/* latest committed value of each key */
+static mpai_kv_store_entry_t kv_store_index[CONFIG_MPAI_KV_STORE_ENTRIES_MAX];
+static int kv_store_count = 0;
+/* index of the entries by hash of their key (open addressing), -1 if free */
+static int16_t kv_store_slots[KV_STORE_SLOTS];
+static kv_store_block_t kv_store_blocks[CONFIG_MPAI_KV_STORE_BLOCKS];
+/* block written, and its first free offset in the region */
+static int kv_store_head = 0;
+static uint32_t kv_store_head_end = 0;
+/* a torn record was found: nothing can be appended until the next block is opened */
+static bool kv_store_head_closed = false;
+/* sequence of the head */
+static uint32_t kv_store_seq = 0;
+/* incremented when the values of a block are moved by a collection */
+static uint32_t kv_store_generation = 0;
+/* a record is being written (by the thread owning the mutex) */
+static bool kv_store_writing = false;
+
+K_MUTEX_DEFINE(kv_store_mutex);
+
+/************* PUBLIC **************/
+int MPAI_KV_Store_Init(void)
+{
+	if (kv_store_dev != NULL)
+	{
+		return 0;
+	}
+	if (CONFIG_MPAI_KV_STORE_BLOCK_SIZE % FLASH_SECTOR_SIZE != 0)
+	{
+		LOG_ERR("KV store block of %d bytes: not a multiple of the flash sector", CONFIG_MPAI_KV_STORE_BLOCK_SIZE);
+		return -EINVAL;
+	}
+
+	const struct device* flash_dev = init_flash();
+	if (flash_dev == NULL)
+	{
+		return -ENODEV;
+	}
+	// records are completed writing the erased fields of their header
+	if (flash_get_parameters(flash_dev)->write_block_size > 1)
+	{
+		LOG_ERR("KV store not supported: the flash write block is %zu bytes", flash_get_parameters(flash_dev)->write_block_size);
+		return -ENOTSUP;
+	}
+
+	k_mutex_lock(&kv_store_mutex, K_FOREVER);
+	int rc = 0;
+	if (kv_store_dev == NULL)
+	{
+		kv_store_dev = flash_dev;
+		rc = _kv_store_mount();
+		if (rc != 0)
+		{
+			LOG_ERR("KV store not mounted (%d)", rc);
+			kv_store_dev = NULL;
+		}
+		else
+		{
+			mpai_kv_store_stats_t stats;
+			MPAI_KV_Store_Get_Stats(&stats);
+			LOG_INF("KV store: %d keys, %u of %u bytes used, blocks erased %u to %u times", stats._keys, stats._used, stats._size,
+					stats._min_erases, stats._max_erases);
+		}
+	}
+	k_mutex_unlock(&kv_store_mutex);
+	return rc;
+}
+
+int MPAI_KV_Store_Unmount(void)
+{
+	k_mutex_lock(&kv_store_mutex, K_FOREVER);
+	int rc = kv_store_writing ? -EBUSY : 0;
+	if (rc == 0)
+	{
+		kv_store_dev = NULL;
+		kv_store_count = 0;
+	}
+	k_mutex_unlock(&kv_store_mutex);
+	return rc;
+}
+
+bool MPAI_KV_Store_Find(const char* key, mpai_kv_store_entry_t* entry)
+{
+	k_mutex_lock(&kv_store_mutex, K_FOREVER);
+	int index = _kv_store_index_of(key);
+	if (index >= 0)
+	{
+		*entry = kv_store_index[index];
+		entry->_generation = kv_store_generation;
+	}
+	k_mutex_unlock(&kv_store_mutex);
+	return index >= 0;
+}
+
+int MPAI_KV_Store_Get(const char* key, void* buf, size_t size)
+{
+	mpai_kv_store_entry_t entry;
+	if (!MPAI_KV_Store_Find(key, &entry))
+	{
+		return kv_store_dev != NULL ? -ENOENT : -ENODEV;
+	}
+	if (entry._len > size)
+	{
+		return -ENOBUFS;
+	}
+	int rc = MPAI_KV_Store_Read(&entry, 0, buf, entry._len);
+	if (rc < 0)
+	{
+		return rc;
+	}
+	if (crc32_ieee(buf, entry._len) != entry._crc)
+	{
+		LOG_WRN("Value of %s corrupted", log_strdup(key));
+		return -EBADMSG;
+	}
+	return entry._len;
+}
+
+int MPAI_KV_Store_Set(const char* key, const void* data, size_t len)
+{
+	mpai_kv_store_writer_t writer;
+	int rc = MPAI_KV_Store_Write_Begin(&writer, key, len);
+	if (rc != 0)
+	{
+		return rc;
+	}
+	rc = MPAI_KV_Store_Write(&writer, data, len);
+	int end = MPAI_KV_Store_Write_End(&writer, rc == 0);
+	return rc != 0 ? rc : end;
+}
+
+int MPAI_KV_Store_Delete(const char* key)
+{
+	size_t key_len = strlen(key);
+	if (key_len == 0 || key_len > MPAI_KV_STORE_KEY_MAX_LEN)
+	{
+		return -EINVAL;
+	}
+	if (kv_store_dev == NULL)
+	{
+		return -ENODEV;
+	}
+
+	k_mutex_lock(&kv_store_mutex, K_FOREVER);
+	if (kv_store_writing)
+	{
+		k_mutex_unlock(&kv_store_mutex);
+		return -EBUSY;
+	}
+	int index = _kv_store_index_of(key);
+	if (index < 0)
+	{
+		k_mutex_unlock(&kv_store_mutex);
+		return -ENOENT;
+	}
+	mpai_kv_store_writer_t writer;
+	int rc = _kv_store_reserve(_kv_store_record_size(key_len, 0));
+	if (rc == 0)
+	{
+		rc = _kv_store_record_begin(&writer, key, 0);
+	}
+	if (rc == 0)
+	{
+		rc = _kv_store_record_end(&writer, KV_STORE_STATE_DELETED);
+	}
+	if (rc == 0)
+	{
+		// collections move the values, not the entries of the index
+		_kv_store_index_remove_at(index);
+		LOG_DBG("Key %s deleted", log_strdup(key));
+	}
+	k_mutex_unlock(&kv_store_mutex);
+	return rc;
+}
+
+int MPAI_KV_Store_Count(void)
+{
+	return kv_store_count;
+}
+
+bool MPAI_KV_Store_Get_At(int index, mpai_kv_store_entry_t* entry)
+{
+	k_mutex_lock(&kv_store_mutex, K_FOREVER);
+	bool found = index >= 0 && index < kv_store_count;
+	if (found)
+	{
+		*entry = kv_store_index[index];
+		entry->_generation = kv_store_generation;
+	}
+	k_mutex_unlock(&kv_store_mutex);
+	return found;
+}
+
+int MPAI_KV_Store_Read(const mpai_kv_store_entry_t* entry, size_t offset, void* buf, size_t len)
+{
+	if (offset >= entry->_len)
+	{
+		return 0;
+	}
+	len = MIN(len, entry->_len - offset);
+
+	k_mutex_lock(&kv_store_mutex, K_FOREVER);
+	uint32_t value = 0;
+	int rc = kv_store_dev != NULL ? _kv_store_locate(entry, &value) : -ENODEV;
+	if (rc == 0)
+	{
+		rc = _kv_store_read(value + offset, buf, len);
+	}
+	k_mutex_unlock(&kv_store_mutex);
+	return rc != 0 ? rc : len;
+}
+
+int MPAI_KV_Store_Write_Begin(mpai_kv_store_writer_t* writer, const char* key, size_t max_len)
+{
+	size_t key_len = strlen(key);
+	if (key_len == 0 || key_len > MPAI_KV_STORE_KEY_MAX_LEN)
+	{
+		return -EINVAL;
+	}
+	if (kv_store_dev == NULL)
+	{
+		return -ENODEV;
+	}
+
+	k_mutex_lock(&kv_store_mutex, K_FOREVER);
+	if (kv_store_writing)
+	{
+		// records are appended one at a time
+		k_mutex_unlock(&kv_store_mutex);
+		return -EBUSY;
+	}
+	if (_kv_store_index_of(key) < 0 && kv_store_count >= CONFIG_MPAI_KV_STORE_ENTRIES_MAX)
+	{
+		LOG_WRN("Too many keys in the KV store (max %d)", CONFIG_MPAI_KV_STORE_ENTRIES_MAX);
+		k_mutex_unlock(&kv_store_mutex);
+		return -ENOSPC;
+	}
+	int rc = _kv_store_reserve(_kv_store_record_size(key_len, max_len));
+	if (rc == 0)
+	{
+		rc = _kv_store_record_begin(writer, key, max_len);
+	}
+	if (rc != 0)
+	{
+		k_mutex_unlock(&kv_store_mutex);
+		return rc;
+	}
+	// unlocked by MPAI_KV_Store_Write_End
+	kv_store_writing = true;
+	return 0;
+}
+
+int MPAI_KV_Store_Write(mpai_kv_store_writer_t* writer, const void* data, size_t len)
+{
+	if (!writer->_failed && writer->_entry._len + len > writer->_max_len)
+	{
+		LOG_WRN("Value of %s larger than %u bytes reserved", log_strdup(writer->_entry._key), writer->_max_len);
+	}
+	return _kv_store_record_append(writer, data, len);
+}
+
+int MPAI_KV_Store_Write_End(mpai_kv_store_writer_t* writer, bool commit)
+{
+	commit = commit && !writer->_failed;
+	int rc = _kv_store_record_end(writer, commit ? KV_STORE_STATE_COMMITTED : KV_STORE_STATE_ABORTED);
+	commit = commit && rc == 0;
+	if (commit)
+	{
+		// room in the index checked by MPAI_KV_Store_Write_Begin
+		_kv_store_index_put(&writer->_entry);
+		LOG_DBG("Key %s set (%u bytes)", log_strdup(writer->_entry._key), writer->_entry._len);
+	}
+	kv_store_writing = false;
+	k_mutex_unlock(&kv_store_mutex);
+	return commit ? 0 : (rc != 0 ? rc : -ECANCELED);
+}
+
+int MPAI_KV_Store_Get_Stats(mpai_kv_store_stats_t* stats)
+{
+	if (kv_store_dev == NULL)
+	{
+		return -ENODEV;
+	}
+
+	k_mutex_lock(&kv_store_mutex, K_FOREVER);
+	memset(stats, 0, sizeof(mpai_kv_store_stats_t));
+	stats->_keys = kv_store_count;
+	stats->_size = KV_STORE_SIZE;
+	stats->_min_erases = KV_STORE_ERASED;
+	for (int b = 0; b < CONFIG_MPAI_KV_STORE_BLOCKS; b++)
+	{
+		if (kv_store_blocks[b]._seq != 0)
+		{
+			stats->_used += kv_store_blocks[b]._end;
+		}
+		stats->_min_erases = MIN(stats->_min_erases, kv_store_blocks[b]._erases);
+		stats->_max_erases = MAX(stats->_max_erases, kv_store_blocks[b]._erases);
+	}
+	k_mutex_unlock(&kv_store_mutex);
+	return 0;
+}
+
+/************* PRIVATE IMPLEMENTATION *************/
+uint32_t _kv_store_record_size(size_t key_len, uint32_t value_len)
+{
+	return ROUND_UP(KV_STORE_RECORD_HEADER_SIZE + key_len + value_len, 4);
+}
+
+int _kv_store_read(uint32_t offset, void* buf, size_t len)
+{
+	return read_flash(kv_store_dev, CONFIG_MPAI_KV_STORE_OFFSET + offset, len, buf);
+}
+
+int _kv_store_write(uint32_t offset, const void* data, size_t len)
+{
+	return write_flash(kv_store_dev, CONFIG_MPAI_KV_STORE_OFFSET + offset, len, data);
+}
+
+int _kv_store_mount(void)
+{
+	kv_store_count = 0;
+	memset(kv_store_slots, 0xFF, sizeof(kv_store_slots));
+	kv_store_seq = 0;
+
+	int head = -1;
+	uint32_t max_erases = 0;
+	for (int b = 0; b < CONFIG_MPAI_KV_STORE_BLOCKS; b++)
+	{
+		kv_store_block_t* block = &kv_store_blocks[b];
+		memset(block, 0, sizeof(kv_store_block_t));
+		uint8_t header[KV_STORE_BLOCK_HEADER_SIZE];
+		int rc = _kv_store_read(KV_STORE_BLOCK_START(b), header, sizeof(header));
+		if (rc != 0)
+		{
+			return rc;
+		}
+		uint32_t magic = sys_get_le32(&header[0]);
+		uint32_t seq = sys_get_le32(&header[4]);
+		bool header_valid = magic == KV_STORE_BLOCK_MAGIC && seq != 0 && seq <= KV_STORE_SEQ_MAX
+			&& crc32_ieee(&header[4], 8) == sys_get_le32(&header[12]);
+		if (header_valid)
+		{
+			block->_seq = seq;
+			block->_erases = sys_get_le32(&header[8]);
+			max_erases = MAX(max_erases, block->_erases);
+			if (head < 0 || seq > kv_store_blocks[head]._seq)
+			{
+				head = b;
+			}
+		}
+		else if (magic != KV_STORE_ERASED || sys_get_le32(&header[4]) != KV_STORE_ERASED
+			|| sys_get_le32(&header[8]) != KV_STORE_ERASED || sys_get_le32(&header[12]) != KV_STORE_ERASED)
+		{
+			// opened when the power was lost (torn header), or written by something else (e.g. an older firmware)
+			LOG_WRN("KV store: block %d not formatted, erasing it", b);
+			rc = _kv_store_erase_block(b);
+			if (rc != 0)
+			{
+				return rc;
+			}
+		}
+	}
+	// the erases of the blocks erased are counted only once they are opened
+	for (int b = 0; b < CONFIG_MPAI_KV_STORE_BLOCKS; b++)
+	{
+		if (kv_store_blocks[b]._seq == 0)
+		{
+			kv_store_blocks[b]._erases = MAX(kv_store_blocks[b]._erases, max_erases);
+		}
+	}
+
+	if (head < 0)
+	{
+		// a new store
+		return _kv_store_open_block(0);
+	}
+	kv_store_seq = kv_store_blocks[head]._seq;
+
+	bool rolled_back = false;
+	if (kv_store_blocks[(head + 1) % CONFIG_MPAI_KV_STORE_BLOCKS]._seq != 0)
+	{
+		// the block after the head is erased but while it is collected: the head holds only copies of its values
+		LOG_WRN("KV store: collection of block %d interrupted, rolled back", (head + 1) % CONFIG_MPAI_KV_STORE_BLOCKS);
+		int rc = _kv_store_erase_block(head);
+		if (rc != 0)
+		{
+			return rc;
+		}
+		head = (head + CONFIG_MPAI_KV_STORE_BLOCKS - 1) % CONFIG_MPAI_KV_STORE_BLOCKS;
+		rolled_back = true;
+	}
+
+	// from the oldest block to the head: the latest record of a key wins
+	kv_store_head = head;
+	kv_store_head_closed = false;
+	for (int i = 1; i <= CONFIG_MPAI_KV_STORE_BLOCKS; i++)
+	{
+		int b = (head + i) % CONFIG_MPAI_KV_STORE_BLOCKS;
+		if (kv_store_blocks[b]._seq != 0)
+		{
+			_kv_store_scan_block(b);
+		}
+	}
+	kv_store_head_end = KV_STORE_BLOCK_START(head) + kv_store_blocks[head]._end;
+	// the head was full: the next record collects the block again
+	kv_store_head_closed = kv_store_head_closed || rolled_back;
+	return 0;
+}
+
+void _kv_store_scan_block(int block)
+{
+	uint32_t start = KV_STORE_BLOCK_START(block);
+	uint32_t end = start + CONFIG_MPAI_KV_STORE_BLOCK_SIZE;
+	uint32_t offset = start + KV_STORE_BLOCK_HEADER_SIZE;
+	bool torn = false;
+	while (offset + KV_STORE_RECORD_HEADER_SIZE <= end)
+	{
+		uint8_t header[KV_STORE_RECORD_HEADER_SIZE];
+		if (_kv_store_read(offset, header, sizeof(header)) != 0)
+		{
+			torn = true;
+			break;
+		}
+		uint32_t magic = sys_get_le32(&header[0]);
+		if (magic == KV_STORE_ERASED)
+		{
+			// end of the block
+			break;
+		}
+
+		mpai_kv_store_entry_t entry = {};
+		uint8_t key_len = header[4];
+		entry._len = sys_get_le32(&header[8]);
+		entry._crc = sys_get_le32(&header[12]);
+		uint32_t state = sys_get_le32(&header[16]);
+		if (magic != KV_STORE_RECORD_MAGIC || key_len == 0 || key_len > MPAI_KV_STORE_KEY_MAX_LEN || state == KV_STORE_ERASED
+			|| entry._len > CONFIG_MPAI_KV_STORE_BLOCK_SIZE || offset + _kv_store_record_size(key_len, entry._len) > end)
+		{
+			// interrupted while written, or not a record
+			LOG_WRN("KV store: torn record at 0x%x", offset);
+			torn = true;
+			break;
+		}
+
+		if (state == KV_STORE_STATE_COMMITTED || state == KV_STORE_STATE_DELETED)
+		{
+			if (_kv_store_read(offset + KV_STORE_RECORD_HEADER_SIZE, entry._key, key_len) != 0)
+			{
+				torn = true;
+				break;
+			}
+			entry._key[key_len] = '\0';
+			entry._offset = offset + KV_STORE_RECORD_HEADER_SIZE + key_len;
+			if (state == KV_STORE_STATE_DELETED)
+			{
+				int index = _kv_store_index_of(entry._key);
+				if (index >= 0)
+				{
+					_kv_store_index_remove_at(index);
+				}
+			}
+			else if (!_kv_store_index_put(&entry))
+			{
+				LOG_WRN("Too many keys in the KV store (max %d): %s ignored", CONFIG_MPAI_KV_STORE_ENTRIES_MAX, log_strdup(entry._key));
+			}
+		}
+		offset += _kv_store_record_size(key_len, entry._len);
+	}
+	kv_store_blocks[block]._end = offset - start;
+	if (torn && block == kv_store_head)
+	{
+		kv_store_head_closed = true;
+	}
+}
+
+bool _kv_store_is_erased(int block)
+{
+	uint32_t buf[16];
+	for (uint32_t offset = 0; offset < CONFIG_MPAI_KV_STORE_BLOCK_SIZE; offset += sizeof(buf))
+	{
+		if (_kv_store_read(KV_STORE_BLOCK_START(block) + offset, buf, sizeof(buf)) != 0)
+		{
+			return false;
+		}
+		for (int i = 0; i < ARRAY_SIZE(buf); i++)
+		{
+			if (buf[i] != KV_STORE_ERASED)
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+int _kv_store_erase_block(int block)
+{
+	kv_store_block_t* kv_block = &kv_store_blocks[block];
+	kv_block->_seq = 0;
+	kv_block->_end = 0;
+	kv_block->_erases++;
+
+	// the header first: an erase interrupted leaves a block looking erased, checked when opened
+	uint32_t start = CONFIG_MPAI_KV_STORE_OFFSET + KV_STORE_BLOCK_START(block);
+	int rc = erase_flash(kv_store_dev, start, FLASH_SECTOR_SIZE);
+	if (rc == 0 && CONFIG_MPAI_KV_STORE_BLOCK_SIZE > FLASH_SECTOR_SIZE)
+	{
+		rc = erase_flash(kv_store_dev, start + FLASH_SECTOR_SIZE, CONFIG_MPAI_KV_STORE_BLOCK_SIZE - FLASH_SECTOR_SIZE);
+	}
+	return rc;
+}
+
+int _kv_store_open_block(int block)
+{
+	// the head is not moved until the block is opened: the next advance opens the same block
+	kv_store_head_closed = true;
+
+	if (kv_store_seq >= KV_STORE_SEQ_MAX)
+	{
+		LOG_ERR("KV store: sequence of the blocks exhausted");
+		return -EOVERFLOW;
+	}
+	int rc = 0;
+	if (!_kv_store_is_erased(block))
+	{
+		rc = _kv_store_erase_block(block);
+		if (rc != 0)
+		{
+			return rc;
+		}
+	}
+	uint8_t header[KV_STORE_BLOCK_HEADER_SIZE];
+	sys_put_le32(KV_STORE_BLOCK_MAGIC, &header[0]);
+	sys_put_le32(kv_store_seq + 1, &header[4]);
+	sys_put_le32(kv_store_blocks[block]._erases, &header[8]);
+	sys_put_le32(crc32_ieee(&header[4], 8), &header[12]);
+	// the magic last: a header interrupted while written is not valid at mount
+	rc = _kv_store_write(KV_STORE_BLOCK_START(block) + 4, &header[4], sizeof(header) - 4);
+	if (rc == 0)
+	{
+		rc = _kv_store_write(KV_STORE_BLOCK_START(block), header, 4);
+	}
+	if (rc != 0)
+	{
+		return rc;
+	}
+	kv_store_head = block;
+	kv_store_head_end = KV_STORE_BLOCK_START(block) + KV_STORE_BLOCK_HEADER_SIZE;
+	kv_store_blocks[block]._seq = ++kv_store_seq;
+	kv_store_blocks[block]._end = KV_STORE_BLOCK_HEADER_SIZE;
+	kv_store_head_closed = false;
+	return 0;
+}
+
+int _kv_store_advance(void)
+{
+	int rc = _kv_store_open_block((kv_store_head + 1) % CONFIG_MPAI_KV_STORE_BLOCKS);
+	int oldest = (kv_store_head + 1) % CONFIG_MPAI_KV_STORE_BLOCKS;
+	if (rc != 0 || kv_store_blocks[oldest]._seq == 0)
+	{
+		return rc;
+	}
+
+	// the live values of the oldest block are copied to the new one (they fit, as they did in
+	// the oldest), then it is erased: the spare of the next advance
+	for (int i = 0; i < kv_store_count && rc == 0; i++)
+	{
+		if (KV_STORE_BLOCK_OF(kv_store_index[i]._offset) == oldest)
+		{
+			rc = _kv_store_copy(&kv_store_index[i]);
+		}
+	}
+	if (rc != 0)
+	{
+		// the head holds only some of the copies (the index points to them), and the next advance
+		// would erase the oldest block: rolled back as at mount, so the next advance collects it again
+		LOG_ERR("KV store: collection of block %d failed (%d), rolled back", oldest, rc);
+		kv_store_generation++;
+		int mount_rc = _kv_store_mount();
+		if (mount_rc != 0)
+		{
+			LOG_ERR("KV store not mounted (%d)", mount_rc);
+			kv_store_dev = NULL;
+			kv_store_count = 0;
+		}
+		return rc;
+	}
+	kv_store_generation++;
+	LOG_DBG("KV store: block %d collected", oldest);
+	return _kv_store_erase_block(oldest);
+}
+
+int _kv_store_reserve(uint32_t size)
+{
+	if (size > CONFIG_MPAI_KV_STORE_BLOCK_SIZE - KV_STORE_BLOCK_HEADER_SIZE)
+	{
+		return -EFBIG;
+	}
+	bool fits = !kv_store_head_closed && kv_store_head_end + size <= KV_STORE_BLOCK_START(kv_store_head + 1);
+	if (!fits && _kv_store_live_size() + size > KV_STORE_CAPACITY)
+	{
+		// not collecting the blocks in vain
+		LOG_WRN("KV store full");
+		return -ENOSPC;
+	}
+	// each advance collects a block: after a round of the blocks, the live values fill the store
+	for (int i = 0; kv_store_head_closed || kv_store_head_end + size > KV_STORE_BLOCK_START(kv_store_head + 1); i++)
+	{
+		if (i == CONFIG_MPAI_KV_STORE_BLOCKS)
+		{
+			LOG_WRN("KV store full");
+			return -ENOSPC;
+		}
+		int rc = _kv_store_advance();
+		if (rc != 0)
+		{
+			return rc;
+		}
+	}
+	return 0;
+}
+
+uint32_t _kv_store_live_size(void)
+{
+	uint32_t size = 0;
+	for (int i = 0; i < kv_store_count; i++)
+	{
+		size += _kv_store_record_size(strlen(kv_store_index[i]._key), kv_store_index[i]._len);
+	}
+	return size;
+}
+
+int _kv_store_record_begin(mpai_kv_store_writer_t* writer, const char* key, size_t max_len)
+{
+	size_t key_len = strlen(key);
+	memset(writer, 0, sizeof(mpai_kv_store_writer_t));
+	mpai_kv_store_entry_t* entry = &writer->_entry;
+	strcpy(entry->_key, key);
+	writer->_record = kv_store_head_end;
+	writer->_max_len = max_len;
+	entry->_offset = writer->_record + KV_STORE_RECORD_HEADER_SIZE + key_len;
+
+	// length, crc and state are left erased until the end
+	uint8_t header[8];
+	sys_put_le32(KV_STORE_RECORD_MAGIC, &header[0]);
+	header[4] = (uint8_t) key_len;
+	header[5] = 0xFF;
+	sys_put_le16(0xFFFF, &header[6]);
+	int rc = _kv_store_write(writer->_record, header, sizeof(header));
+	if (rc == 0)
+	{
+		rc = _kv_store_write(writer->_record + KV_STORE_RECORD_HEADER_SIZE, key, key_len);
+	}
+	if (rc != 0)
+	{
+		kv_store_head_closed = true;
+	}
+	return rc;
+}
+
+int _kv_store_record_append(mpai_kv_store_writer_t* writer, const void* data, size_t len)
+{
+	if (writer->_failed)
+	{
+		return -EIO;
+	}
+	mpai_kv_store_entry_t* entry = &writer->_entry;
+	if (entry->_len + len > writer->_max_len)
+	{
+		writer->_failed = true;
+		return -EFBIG;
+	}
+	int rc = _kv_store_write(entry->_offset + entry->_len, data, len);
+	if (rc != 0)
+	{
+		// the bytes after the record may be dirty
+		kv_store_head_closed = true;
+		writer->_failed = true;
+		return rc;
+	}
+	entry->_crc = crc32_ieee_update(entry->_crc, data, len);
+	entry->_len += len;
+	return 0;
+}
+
+int _kv_store_record_end(mpai_kv_store_writer_t* writer, uint32_t state)
+{
+	mpai_kv_store_entry_t* entry = &writer->_entry;
+	uint8_t tail[12];
+	sys_put_le32(entry->_len, &tail[0]);
+	sys_put_le32(entry->_crc, &tail[4]);
+	sys_put_le32(state, &tail[8]);
+	int rc = _kv_store_write(writer->_record + 8, tail, sizeof(tail));
+	if (rc != 0)
+	{
+		kv_store_head_closed = true;
+		return rc;
+	}
+	kv_store_head_end = writer->_record + _kv_store_record_size(strlen(entry->_key), entry->_len);
+	kv_store_blocks[kv_store_head]._end = kv_store_head_end - KV_STORE_BLOCK_START(kv_store_head);
+	return 0;
+}
+
+int _kv_store_copy(mpai_kv_store_entry_t* entry)
+{
+	mpai_kv_store_writer_t writer;
+	int rc = _kv_store_record_begin(&writer, entry->_key, entry->_len);
+	uint8_t buf[64];
+	for (uint32_t offset = 0; rc == 0 && offset < entry->_len; offset += sizeof(buf))
+	{
+		size_t len = MIN(sizeof(buf), entry->_len - offset);
+		rc = _kv_store_read(entry->_offset + offset, buf, len);
+		if (rc == 0)
+		{
+			rc = _kv_store_record_append(&writer, buf, len);
+		}
+	}
+	if (rc != 0)
+	{
+		// left torn: at mount, the collection is rolled back
+		kv_store_head_closed = true;
+		return rc;
+	}
+	// the crc of the original: a value corrupted stays detected
+	writer._entry._crc = entry->_crc;
+	rc = _kv_store_record_end(&writer, KV_STORE_STATE_COMMITTED);
+	if (rc == 0)
+	{
+		entry->_offset = writer._entry._offset;
+	}
+	return rc;
+}
+
+int _kv_store_locate(const mpai_kv_store_entry_t* entry, uint32_t* offset)
+{
+	*offset = entry->_offset;
+	if (entry->_generation == kv_store_generation)
+	{
+		return 0;
+	}
+	// blocks were collected since the entry was found: the value may have moved
+	int index = _kv_store_index_of(entry->_key);
+	if (index < 0 || kv_store_index[index]._len != entry->_len || kv_store_index[index]._crc != entry->_crc)
+	{
+		return -ESTALE;
+	}
+	*offset = kv_store_index[index]._offset;
+	return 0;
+}
+
+uint32_t _kv_store_hash(const char* key)
+{
+	// FNV-1a
+	uint32_t hash = 2166136261u;
+	while (*key != '\0')
+	{
+		hash ^= (uint8_t) *key++;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+int _kv_store_index_of(const char* key)
+{
+	for (uint32_t slot = _kv_store_hash(key) % KV_STORE_SLOTS; kv_store_slots[slot] >= 0; slot = (slot + 1) % KV_STORE_SLOTS)
+	{
+		if (strcmp(kv_store_index[kv_store_slots[slot]]._key, key) == 0)
+		{
+			return kv_store_slots[slot];
+		}
+	}
+	return -1;
+}
+
+bool _kv_store_index_put(const mpai_kv_store_entry_t* entry)
+{
+	int index = _kv_store_index_of(entry->_key);
+	if (index >= 0)
+	{
+		kv_store_index[index] = *entry;
+		return true;
+	}
+	if (kv_store_count >= CONFIG_MPAI_KV_STORE_ENTRIES_MAX)
+	{
+		return false;
+	}
+	index = kv_store_count++;
+	kv_store_index[index] = *entry;
+	_kv_store_slot_add(index);
+	return true;
+}
+
+void _kv_store_index_remove_at(int index)
+{
+	// the last entry takes its place, and the slots are rebuilt
+	kv_store_index[index] = kv_store_index[--kv_store_count];
+	memset(kv_store_slots, 0xFF, sizeof(kv_store_slots));
+	for (int i = 0; i < kv_store_count; i++)
+	{
+		_kv_store_slot_add(i);
+	}
+}
+
+void _kv_store_slot_add(int index)
+{
+	uint32_t slot = _kv_store_hash(kv_store_index[index]._key) % KV_STORE_SLOTS;
+	while (kv_store_slots[slot] >= 0)
+	{
+		slot = (slot + 1) % KV_STORE_SLOTS;
+	}
+	kv_store_slots[slot] = (int16_t) index;
+}
+
+#endif
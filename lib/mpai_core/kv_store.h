@@ -0,0 +1,190 @@
+/*
+ * @file
+ * @brief Headers of the key-value store in the flash store
+ *
+ * Values (AIM parameters, calibrations, counters, the cached configurations) are kept by key
+ * in a log of records, written in rotation on CONFIG_MPAI_KV_STORE_BLOCKS blocks of the flash
+ * store region, so the erases are spread on all of them (wear leveling). A record supersedes
+ * the previous value of its key only once it is committed: an update interrupted (or a power
+ * loss) leaves the previous value in place. When the block written is full, the next one is
+ * opened and the oldest is collected: its live values are copied to the new block, then it is
+ * erased. The block after the one written is always erased, ready for the next collection.
+ *
+ * The latest value of each key is indexed in RAM (a hash table), loaded at init from the
+ * headers of the records: values are found without reading the flash.
+ *
+ * Block layout (little endian): u32 magic "MPKV", u32 sequence, u32 erases, u32 crc32 (IEEE)
+ * of sequence and erases (the magic is written last), then the records, aligned to 4 bytes:
+ *   u32 magic "MPKR"
+ *   u8 key length, u8 reserved, u16 reserved
+ *   u32 value length, u32 crc32 (IEEE) of the value, u32 state
+ *   key, value
+ * Length, crc and state are written after the value, in the erased (0xFF) fields. A key is
+ * deleted by a record without value and with the deleted state.
+ *
+ * Copyright (c) 2022 University of Turin, Daniele Bortoluzzi <danieleb88@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef MPAI_CORE_KV_STORE_H
+#define MPAI_CORE_KV_STORE_H
+
+#include <core_common.h>
+#include <flash_store.h>
+
+#define MPAI_KV_STORE_KEY_MAX_LEN 32
+
+/* Latest committed value of a key */
+typedef struct _mpai_kv_store_entry_t
+{
+	char _key[MPAI_KV_STORE_KEY_MAX_LEN + 1];
+	uint32_t _offset;							// of the value in the store region
+	uint32_t _len;
+	uint32_t _crc;								// crc32 (IEEE) of the value
+	uint32_t _generation;						// of the blocks when found: collections move the values
+} mpai_kv_store_entry_t;
+
+/* Record being written: the store is locked until it is ended */
+typedef struct _mpai_kv_store_writer_t
+{
+	mpai_kv_store_entry_t _entry;				// the value written so far
+	uint32_t _record;							// offset of the record in the store region
+	uint32_t _max_len;							// room reserved for the value
+	bool _failed;								// the record will be aborted
+} mpai_kv_store_writer_t;
+
+typedef struct _mpai_kv_store_stats_t
+{
+	int _keys;
+	uint32_t _used;								// bytes of the records in the blocks, live or not
+	uint32_t _size;
+	uint32_t _min_erases;						// of a block
+	uint32_t _max_erases;
+} mpai_kv_store_stats_t;
+
+/**
+ * @brief Mount the store, loading the index from the headers of the records: a collection
+ * interrupted is rolled back, and a region not formatted for the store is erased
+ *
+ * @return int 0 on success, negative on errors (the store is disabled)
+ */
+int MPAI_KV_Store_Init(void);
+
+/**
+ * @brief Unmount the store (e.g. before erasing the flash store region): the next
+ * MPAI_KV_Store_Init mounts it again
+ *
+ * @return int 0 on success, -EBUSY if a value is being written
+ */
+int MPAI_KV_Store_Unmount(void);
+
+/**
+ * @brief Search the value of a key
+ *
+ * @param key
+ * @param entry filled if found
+ * @return true
+ * @return false if not stored
+ */
+bool MPAI_KV_Store_Find(const char* key, mpai_kv_store_entry_t* entry);
+
+/**
+ * @brief Get the value of a key, checked against its crc
+ *
+ * @param key
+ * @param buf
+ * @param size
+ * @return int bytes of the value, -ENOENT if not stored, -ENOBUFS if larger than size,
+ * -EBADMSG if corrupted, negative on other errors
+ */
+int MPAI_KV_Store_Get(const char* key, void* buf, size_t size);
+
+/**
+ * @brief Set the value of a key, replacing the previous one atomically
+ *
+ * @param key
+ * @param data
+ * @param len
+ * @return int 0 on success, -EFBIG if the value doesn't fit a block, -ENOSPC if the values
+ * fill the store, negative on other errors
+ */
+int MPAI_KV_Store_Set(const char* key, const void* data, size_t len);
+
+/**
+ * @brief Delete a key
+ *
+ * @param key
+ * @return int 0 on success, -ENOENT if not stored, negative on other errors
+ */
+int MPAI_KV_Store_Delete(const char* key);
+
+/**
+ * @brief Number of keys in the store
+ *
+ * @return int
+ */
+int MPAI_KV_Store_Count(void);
+
+/**
+ * @brief Get a key of the store by index (see MPAI_KV_Store_Count)
+ *
+ * @param index
+ * @param entry
+ * @return true
+ * @return false if the index is not valid
+ */
+bool MPAI_KV_Store_Get_At(int index, mpai_kv_store_entry_t* entry);
+
+/**
+ * @brief Read the value of an entry: if moved by a collection, it is found again by its key
+ *
+ * @param entry
+ * @param offset from the start of the value
+ * @param buf
+ * @param len
+ * @return int bytes read (0 at the end of the value), -ESTALE if the value was replaced or
+ * deleted, negative on other errors
+ */
+int MPAI_KV_Store_Read(const mpai_kv_store_entry_t* entry, size_t offset, void* buf, size_t len);
+
+/**
+ * @brief Start writing a new value of a key, locking the store
+ *
+ * @param writer
+ * @param key
+ * @param max_len room reserved for the value
+ * @return int 0 on success, -EBUSY if another value is being written by the same thread,
+ * negative on other errors (the store is not locked)
+ */
+int MPAI_KV_Store_Write_Begin(mpai_kv_store_writer_t* writer, const char* key, size_t max_len);
+
+/**
+ * @brief Append data to the new value
+ *
+ * @param writer
+ * @param data
+ * @param len
+ * @return int 0 on success, negative if the value is larger than reserved or on errors:
+ * the record will be aborted
+ */
+int MPAI_KV_Store_Write(mpai_kv_store_writer_t* writer, const void* data, size_t len);
+
+/**
+ * @brief End the new value, unlocking the store
+ *
+ * @param writer
+ * @param commit false to discard it, keeping the previous value
+ * @return int 0 if committed, negative if aborted
+ */
+int MPAI_KV_Store_Write_End(mpai_kv_store_writer_t* writer, bool commit);
+
+/**
+ * @brief Get the usage and the wear of the store
+ *
+ * @param stats
+ * @return int 0 on success, -ENODEV if not initialized
+ */
+int MPAI_KV_Store_Get_Stats(mpai_kv_store_stats_t* stats);
+
+#endif
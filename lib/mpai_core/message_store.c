@@ -8,6 +8,9 @@
  */
 
 #include "message_store.h"
+#ifdef CONFIG_MPAI_AIM_RUNTIME
+#include <aim_runtime.h>
+#endif
 
 LOG_MODULE_REGISTER(MPAI_MESSAGE_STORE, LOG_LEVEL_INF);
 
@@ -15,6 +18,8 @@ K_SEM_DEFINE(subscriber_channel_sem, 0, 1);
 
 /************* PRIVATE HEADER *************/
 subscriber_item* _linear_search(subscriber_item *items, size_t size, module_t *subscriber_key, subscriber_channel_t channel);
+/* statistics of a channel, NULL if out of range */
+mpai_message_store_channel_stats_t* _channel_stats(MPAI_AIM_MessageStore_t *me, subscriber_channel_t channel);
 
 /************* PUBLIC **************/
 
@@ -65,6 +70,13 @@ mpai_error_t MPAI_MessageStore_register(MPAI_AIM_MessageStore_t *me, module_t *s
 	// add subscriber_item to this list
 	me->message_store_subscribers[subscriber_item_count++] = item;
 
+	mpai_message_store_channel_stats_t *stats = _channel_stats(me, channel);
+	if (stats != NULL) {
+		k_spinlock_key_t key = k_spin_lock(&me->_stats_lock);
+		stats->_subscribers++;
+		k_spin_unlock(&me->_stats_lock, key);
+	}
+
 	// TODO: error management
 	MPAI_ERR_INIT(err, MPAI_AIF_OK);
 	return err;
@@ -82,6 +94,38 @@ mpai_error_t MPAI_MessageStore_publish(MPAI_AIM_MessageStore_t *me, mpai_message
 	// publish message to a specified topic and channel (using PubSub library)
 	pubsub_publish(me->_topic, channel, message);
 
+	mpai_message_store_channel_stats_t *stats = _channel_stats(me, channel);
+	if (stats != NULL) {
+#ifdef CONFIG_MPAI_TELEMETRY_SERVER
+		// encoded out of the lock, which is taken by the telemetry too
+		uint8_t latest[CONFIG_MPAI_TELEMETRY_LATEST_MAX_SIZE];
+		int latest_len = me->_encoders[channel] != NULL ? me->_encoders[channel](message, latest, sizeof(latest)) : 0;
+#endif
+		k_spinlock_key_t key = k_spin_lock(&me->_stats_lock);
+		if (stats->_last_timestamp != 0) {
+			stats->_last_interval_ms = (uint32_t)(message->timestamp - stats->_last_timestamp);
+		}
+		stats->_last_timestamp = message->timestamp;
+		stats->_published++;
+#ifdef CONFIG_MPAI_TELEMETRY_SERVER
+		me->_latest_len[channel] = latest_len > 0 ? latest_len : 0;
+		memcpy(me->_latest[channel], latest, me->_latest_len[channel]);
+#endif
+		k_spin_unlock(&me->_stats_lock, key);
+	}
+
+	// subscribers waiting for more channels at once
+	for (int i = 0; i < subscriber_item_count; i++) {
+		if (me->message_store_subscribers[i].channel == channel && me->message_store_subscribers[i].wakeup != NULL) {
+			k_sem_give(me->message_store_subscribers[i].wakeup);
+		}
+	}
+
+#ifdef CONFIG_MPAI_AIM_RUNTIME
+	// AIMs multiplexed on the runtime don't block on the poll: wake it up to check their waits
+	MPAI_AIM_Runtime_Notify();
+#endif
+
 	// TODO: error management
 	MPAI_ERR_INIT(err, MPAI_AIF_OK);
 	return err;
@@ -109,6 +153,20 @@ int MPAI_MessageStore_poll(MPAI_AIM_MessageStore_t *me, module_t *subscriber, k_
 	return -EINVAL;
 }
 
+void MPAI_MessageStore_Set_Wakeup(MPAI_AIM_MessageStore_t *me, module_t *subscriber, struct k_sem *wakeup)
+{
+	if (me == NULL) {
+		return;
+	}
+
+	// all the channels registered by the subscriber
+	for (int i = 0; i < subscriber_item_count; i++) {
+		if (me->message_store_subscribers[i].subscriber_key == subscriber) {
+			me->message_store_subscribers[i].wakeup = wakeup;
+		}
+	}
+}
+
 mpai_error_t MPAI_MessageStore_copy(MPAI_AIM_MessageStore_t *me, module_t *subscriber, subscriber_channel_t channel, mpai_message_t *message)
 {
 	// check errors
@@ -128,6 +186,16 @@ mpai_error_t MPAI_MessageStore_copy(MPAI_AIM_MessageStore_t *me, module_t *subsc
 	subscriber_item *sub_found = _linear_search(me->message_store_subscribers, (size_t)subscriber_item_count, subscriber, channel);
 	if (sub_found != NULL) {
 		pubsub_copy(sub_found->value, message);
+
+		mpai_message_store_channel_stats_t *stats = _channel_stats(me, channel);
+		if (stats != NULL) {
+			uint32_t latency_ms = (uint32_t)(k_uptime_get() - message->timestamp);
+			k_spinlock_key_t key = k_spin_lock(&me->_stats_lock);
+			stats->_copied++;
+			stats->_last_latency_ms = latency_ms;
+			stats->_max_latency_ms = MAX(stats->_max_latency_ms, latency_ms);
+			k_spin_unlock(&me->_stats_lock, key);
+		}
 	}
 
 	// TODO: error management
@@ -135,12 +203,62 @@ mpai_error_t MPAI_MessageStore_copy(MPAI_AIM_MessageStore_t *me, module_t *subsc
 	return err;
 }
 
+mpai_error_t MPAI_MessageStore_Get_Channel_Stats(MPAI_AIM_MessageStore_t *me, subscriber_channel_t channel, mpai_message_store_channel_stats_t *stats)
+{
+	mpai_message_store_channel_stats_t *channel_stats = me != NULL ? _channel_stats(me, channel) : NULL;
+	if (channel_stats == NULL) {
+		MPAI_ERR_INIT(err, MPAI_ERROR);
+		return err;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&me->_stats_lock);
+	*stats = *channel_stats;
+	k_spin_unlock(&me->_stats_lock, key);
+
+	MPAI_ERR_INIT(err, MPAI_AIF_OK);
+	return err;
+}
+
+void MPAI_MessageStore_Set_Channel_Encoder(MPAI_AIM_MessageStore_t *me, subscriber_channel_t channel, message_store_encoder_t *encoder)
+{
+#ifdef CONFIG_MPAI_TELEMETRY_SERVER
+	if (me != NULL && _channel_stats(me, channel) != NULL) {
+		me->_encoders[channel] = encoder;
+	}
+#endif
+}
+
+int MPAI_MessageStore_Get_Latest_Encoded(MPAI_AIM_MessageStore_t *me, subscriber_channel_t channel, uint8_t *buffer, size_t size)
+{
+#ifdef CONFIG_MPAI_TELEMETRY_SERVER
+	if (me == NULL || _channel_stats(me, channel) == NULL) {
+		return -EINVAL;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&me->_stats_lock);
+	int len = me->_latest_len[channel] <= size ? me->_latest_len[channel] : -ENOMEM;
+	if (len > 0) {
+		memcpy(buffer, me->_latest[channel], len);
+	}
+	k_spin_unlock(&me->_stats_lock, key);
+	return len;
+#else
+	return -ENOTSUP;
+#endif
+}
+
 MPAI_AIM_MessageStore_t *MPAI_MessageStore_Creator(int aiw_id, char *topic_name, size_t topic_size)
 {
 	MPAI_AIM_MessageStore_t *this = (MPAI_AIM_MessageStore_t *)k_malloc(sizeof(MPAI_AIM_MessageStore_t));
 	this->_topic = (struct pubsub_topic_s *)k_malloc(sizeof(struct pubsub_topic_s));
 	this->_topic_name = (char *)k_malloc(strlen(topic_name));
 	this->message_store_subscribers = (subscriber_item *)k_calloc(PUB_SUB_MAX_SUBSCRIBERS, sizeof(subscriber_item));
+	memset(&this->_stats_lock, 0, sizeof(this->_stats_lock));
+	memset(this->_stats, 0, sizeof(this->_stats));
+#ifdef CONFIG_MPAI_TELEMETRY_SERVER
+	memset(this->_encoders, 0, sizeof(this->_encoders));
+	memset(this->_latest_len, 0, sizeof(this->_latest_len));
+#endif
 
 	strcpy(this->_topic_name, topic_name);
 	this->_aiw_id = aiw_id;
@@ -177,4 +295,9 @@ subscriber_item* _linear_search(subscriber_item *items, size_t size, module_t *s
 		}
 	}
 	return NULL;
+}
+
+mpai_message_store_channel_stats_t* _channel_stats(MPAI_AIM_MessageStore_t *me, subscriber_channel_t channel)
+{
+	return channel < MPAI_MESSAGE_STORE_CHANNEL_MAX ? &me->_stats[channel] : NULL;
 }
\ No newline at end of file
@@ -18,20 +18,50 @@
 
 #define PUB_SUB_MAX_SUBSCRIBERS 20
 #define PUB_SUB_DEFAULT_CHANNEL 0
+/* channels with statistics: identifiers are given from 1 */
+#define MPAI_MESSAGE_STORE_CHANNEL_MAX 12
 
 typedef uint16_t subscriber_channel_t;
 typedef struct _subscriber_item{
     module_t* subscriber_key;
 	subscriber_channel_t channel;
     struct pubsub_subscriber_s* value;
+	struct k_sem* wakeup;		// given on every message published on the channel, NULL if none
 } subscriber_item;
 
+/* Statistics of a channel, updated by publishers and subscribers */
+typedef struct _mpai_message_store_channel_stats_t
+{
+	uint32_t _published;
+	uint32_t _copied;				// messages read by the subscribers
+	uint8_t _subscribers;
+	int64_t _last_timestamp;		// of the latest message published, 0 if none
+	uint32_t _last_interval_ms;		// between the latest two messages
+	uint32_t _last_latency_ms;		// from the publication to the latest read
+	uint32_t _max_latency_ms;
+} mpai_message_store_channel_stats_t;
+
+/**
+ * @brief Encode the payload of a message (i.e. in CBOR), for the telemetry
+ *
+ * @return int bytes written in buffer, negative if it doesn't fit
+ */
+typedef int (message_store_encoder_t)(const mpai_message_t* message, uint8_t* buffer, size_t size);
+
 typedef struct MPAI_AIM_MessageStore_t
 {
 	struct pubsub_topic_s* _topic;
 	char* _topic_name;
 	int _aiw_id;
 	subscriber_item* message_store_subscribers;
+	struct k_spinlock _stats_lock;
+	mpai_message_store_channel_stats_t _stats[MPAI_MESSAGE_STORE_CHANNEL_MAX];
+#ifdef CONFIG_MPAI_TELEMETRY_SERVER
+	/* latest message of each channel, encoded when published */
+	message_store_encoder_t* _encoders[MPAI_MESSAGE_STORE_CHANNEL_MAX];
+	uint8_t _latest[MPAI_MESSAGE_STORE_CHANNEL_MAX][CONFIG_MPAI_TELEMETRY_LATEST_MAX_SIZE];
+	uint8_t _latest_len[MPAI_MESSAGE_STORE_CHANNEL_MAX];
+#endif
 } MPAI_AIM_MessageStore_t; 
 
 static int subscriber_item_count = 0;
@@ -59,11 +89,52 @@ mpai_error_t MPAI_MessageStore_publish(MPAI_AIM_MessageStore_t* me, mpai_message
  */
 int MPAI_MessageStore_poll(MPAI_AIM_MessageStore_t* me, module_t* subscriber, k_timeout_t timeout, subscriber_channel_t channel);
 
+/**
+ * @brief Set the semaphore given on every message published on the channels of a subscriber,
+ * so that it can wait for all of them at once (see MPAI_AIM_Control_Wait). Call it after registering the channels
+ * 
+ * @param me 
+ * @param subscriber 
+ * @param wakeup NULL to remove it
+ */
+void MPAI_MessageStore_Set_Wakeup(MPAI_AIM_MessageStore_t* me, module_t* subscriber, struct k_sem* wakeup);
+
 /**
  * @brief Copy a message message store when is available
  */
 mpai_error_t MPAI_MessageStore_copy(MPAI_AIM_MessageStore_t* me, module_t* subscriber, subscriber_channel_t channel, mpai_message_t* message);
 
+/**
+ * @brief Get the statistics of a channel
+ * 
+ * @param me 
+ * @param channel 
+ * @param stats 
+ * @return mpai_error_t MPAI_ERROR if the channel has no statistics
+ */
+mpai_error_t MPAI_MessageStore_Get_Channel_Stats(MPAI_AIM_MessageStore_t* me, subscriber_channel_t channel, mpai_message_store_channel_stats_t* stats);
+
+/**
+ * @brief Set the encoder of the messages of a channel: the latest one is encoded when
+ * published, and kept for the telemetry (without CONFIG_MPAI_TELEMETRY_SERVER it is ignored)
+ * 
+ * @param me 
+ * @param channel 
+ * @param encoder NULL to keep only the timestamp
+ */
+void MPAI_MessageStore_Set_Channel_Encoder(MPAI_AIM_MessageStore_t* me, subscriber_channel_t channel, message_store_encoder_t* encoder);
+
+/**
+ * @brief Copy the latest message of a channel, as encoded when published
+ * 
+ * @param me 
+ * @param channel 
+ * @param buffer 
+ * @param size 
+ * @return int bytes copied (0 without encoder or messages), negative on errors
+ */
+int MPAI_MessageStore_Get_Latest_Encoded(MPAI_AIM_MessageStore_t* me, subscriber_channel_t channel, uint8_t* buffer, size_t size);
+
 /**
  * @brief Create the message store
  */
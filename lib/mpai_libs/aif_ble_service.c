@@ -0,0 +1,627 @@
+/*
+ * @file
+ * @brief Implementation of the Bluetooth LE service of the MPAI AIF: configuration and control of the AIMs
+ *
+ * Copyright (c) 2022 University of Turin, Daniele Bortoluzzi <danieleb88@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "aif_ble_service.h"
+
+#include <errno.h>
+#include <sys/crc.h>
+
+LOG_MODULE_REGISTER(MPAI_LIBS_AIF_BLE_SERVICE, LOG_LEVEL_INF);
+
+#ifdef CONFIG_MPAI_BLE_SERVICE
+
+#include <bluetooth/bluetooth.h>
+#include <bluetooth/conn.h>
+#include <bluetooth/gatt.h>
+
+/* header of the writes of the config characteristic */
+#define BLE_SERVICE_BEGIN_LEN 4
+#define BLE_SERVICE_DATA_LEN 3
+#define BLE_SERVICE_END_LEN 5
+/* requests waiting for the thread */
+#define BLE_SERVICE_MAX_REQUESTS 4
+/* index of the status and stream values in the attributes of the service */
+#define BLE_SERVICE_STATUS_ATTR 6
+#define BLE_SERVICE_STREAM_ATTR 9
+/* ATT MTU until exchanged */
+#define BLE_SERVICE_DEFAULT_MTU 23
+/* header of a notification (opcode and handle) */
+#define BLE_SERVICE_NOTIFY_HEADER_LEN 3
+/* connection interval, in units of 1.25 ms */
+#define BLE_SERVICE_INTERVAL_UNIT_US 1250
+
+typedef enum
+{
+	BLE_SERVICE_TRANSFER_IDLE,
+	BLE_SERVICE_TRANSFER_RECEIVING,
+	BLE_SERVICE_TRANSFER_APPLYING
+} BLE_SERVICE_TRANSFER_STATE;
+
+/* Configuration being received: owned by the Bluetooth thread while receiving, by the service thread while applying */
+typedef struct _ble_service_transfer_t
+{
+	atomic_t _state;
+	uint8_t _kind;
+	char _name[MPAI_BLE_SERVICE_NAME_MAX_LEN + 1];
+	uint8_t* _data;
+	uint16_t _len;
+	uint16_t _received;
+	uint32_t _crc;							// sent with the end
+} ble_service_transfer_t;
+
+/* Request applied by the service thread */
+typedef struct _ble_service_request_t
+{
+	uint8_t _op;
+	char _name[MPAI_BLE_SERVICE_NAME_MAX_LEN + 1];
+} ble_service_request_t;
+
+/* Value of the status characteristic (little endian) */
+typedef struct __packed _ble_service_status_t
+{
+	uint8_t _op;
+	int8_t _result;
+	uint16_t _received;
+	uint16_t _mtu;
+} ble_service_status_t;
+
+/************* PRIVATE HEADER *************/
+ssize_t _ble_service_config_write(struct bt_conn* conn, const struct bt_gatt_attr* attr, const void* buf, uint16_t len,
+								  uint16_t offset, uint8_t flags);
+ssize_t _ble_service_control_write(struct bt_conn* conn, const struct bt_gatt_attr* attr, const void* buf, uint16_t len,
+								   uint16_t offset, uint8_t flags);
+ssize_t _ble_service_status_read(struct bt_conn* conn, const struct bt_gatt_attr* attr, void* buf, uint16_t len, uint16_t offset);
+void _ble_service_status_ccc_changed(const struct bt_gatt_attr* attr, uint16_t value);
+ssize_t _ble_service_stream_read(struct bt_conn* conn, const struct bt_gatt_attr* attr, void* buf, uint16_t len, uint16_t offset);
+void _ble_service_stream_ccc_changed(const struct bt_gatt_attr* attr, uint16_t value);
+void _ble_service_stream_sent(struct bt_conn* conn, void* user_data);
+/* start receiving a configuration: the one being received, if any, is dropped */
+int _ble_service_config_begin(const uint8_t* buf, uint16_t len);
+int _ble_service_config_data(const uint8_t* buf, uint16_t len);
+int _ble_service_config_end(const uint8_t* buf, uint16_t len);
+void _ble_service_config_free(void);
+/* the ATT error of a result, for the writes with response */
+ssize_t _ble_service_write_result(uint8_t op, int result, uint16_t len, uint8_t flags);
+void _ble_service_notify_status(uint8_t op, int result);
+/* put the configuration received in the config store, and apply it */
+int _ble_service_apply_config(void);
+int _ble_service_apply_control(const ble_service_request_t* request);
+void _ble_service_connected(struct bt_conn* conn, uint8_t err);
+void _ble_service_disconnected(struct bt_conn* conn, uint8_t reason);
+void _ble_service_le_param_updated(struct bt_conn* conn, uint16_t interval, uint16_t latency, uint16_t timeout);
+#ifdef CONFIG_BT_GATT_CLIENT
+void _ble_service_mtu_exchanged(struct bt_conn* conn, uint8_t err, struct bt_gatt_exchange_params* params);
+#endif
+void th_ble_service(void *dummy1, void *dummy2, void *dummy3);
+
+K_THREAD_STACK_DEFINE(thread_ble_service_stack_area, CONFIG_MPAI_BLE_SERVICE_STACK_SIZE);
+static struct k_thread thread_ble_service;
+static atomic_t ble_service_started = ATOMIC_INIT(0);
+K_MSGQ_DEFINE(ble_service_requests, sizeof(ble_service_request_t), BLE_SERVICE_MAX_REQUESTS, 4);
+
+static ble_service_transfer_t ble_service_transfer = { ._state = ATOMIC_INIT(BLE_SERVICE_TRANSFER_IDLE) };
+static ble_service_status_t ble_service_status;
+static bool ble_service_notify_enabled = false;
+/* ATT MTU and connection interval of the latest connection */
+static uint16_t ble_service_mtu = BLE_SERVICE_DEFAULT_MTU;
+static uint16_t ble_service_interval = 0;
+static bool ble_service_stream_enabled = false;
+static atomic_t ble_service_stream_in_flight = ATOMIC_INIT(0);
+static char ble_service_stream_channels[MPAI_BLE_SERVICE_STREAM_CHANNELS_MAX_LEN + 1];
+#ifdef CONFIG_BT_GATT_CLIENT
+static struct bt_gatt_exchange_params ble_service_exchange_params = { .func = _ble_service_mtu_exchanged };
+#endif
+
+static struct bt_uuid_128 ble_service_uuid = BT_UUID_INIT_128(MPAI_BLE_SERVICE_UUID_VAL);
+static struct bt_uuid_128 ble_service_config_uuid = BT_UUID_INIT_128(MPAI_BLE_SERVICE_CONFIG_UUID_VAL);
+static struct bt_uuid_128 ble_service_control_uuid = BT_UUID_INIT_128(MPAI_BLE_SERVICE_CONTROL_UUID_VAL);
+static struct bt_uuid_128 ble_service_status_uuid = BT_UUID_INIT_128(MPAI_BLE_SERVICE_STATUS_UUID_VAL);
+static struct bt_uuid_128 ble_service_stream_uuid = BT_UUID_INIT_128(MPAI_BLE_SERVICE_STREAM_UUID_VAL);
+
+BT_GATT_SERVICE_DEFINE(mpai_ble_svc,
+	BT_GATT_PRIMARY_SERVICE(&ble_service_uuid),
+	BT_GATT_CHARACTERISTIC(&ble_service_config_uuid.uuid,
+						   BT_GATT_CHRC_WRITE | BT_GATT_CHRC_WRITE_WITHOUT_RESP,
+						   BT_GATT_PERM_WRITE, NULL, _ble_service_config_write, NULL),
+	BT_GATT_CHARACTERISTIC(&ble_service_control_uuid.uuid,
+						   BT_GATT_CHRC_WRITE | BT_GATT_CHRC_WRITE_WITHOUT_RESP,
+						   BT_GATT_PERM_WRITE, NULL, _ble_service_control_write, NULL),
+	BT_GATT_CHARACTERISTIC(&ble_service_status_uuid.uuid,
+						   BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY,
+						   BT_GATT_PERM_READ, _ble_service_status_read, NULL, &ble_service_status),
+	BT_GATT_CCC(_ble_service_status_ccc_changed, BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
+	BT_GATT_CHARACTERISTIC(&ble_service_stream_uuid.uuid,
+						   BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY,
+						   BT_GATT_PERM_READ, _ble_service_stream_read, NULL, ble_service_stream_channels),
+	BT_GATT_CCC(_ble_service_stream_ccc_changed, BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
+);
+
+BT_CONN_CB_DEFINE(ble_service_conn_callbacks) = {
+	.connected = _ble_service_connected,
+	.disconnected = _ble_service_disconnected,
+	.le_param_updated = _ble_service_le_param_updated,
+};
+#endif
+
+/************* PUBLIC **************/
+int MPAI_BLE_Service_Start(void)
+{
+#ifdef CONFIG_MPAI_BLE_SERVICE
+	if (!atomic_cas(&ble_service_started, 0, 1))
+	{
+		return -EALREADY;
+	}
+	k_thread_create(&thread_ble_service, thread_ble_service_stack_area,
+					K_THREAD_STACK_SIZEOF(thread_ble_service_stack_area),
+					th_ble_service, NULL, NULL, NULL,
+					CONFIG_MPAI_BLE_SERVICE_PRIORITY, 0, K_NO_WAIT);
+	k_thread_name_set(&thread_ble_service, "thread_ble_service");
+	return 0;
+#else
+	return -ENOTSUP;
+#endif
+}
+
+bool MPAI_BLE_Service_Stream_Get_Link(uint16_t* payload_len, uint32_t* interval_us)
+{
+#ifdef CONFIG_MPAI_BLE_SERVICE
+	*payload_len = ble_service_mtu - BLE_SERVICE_NOTIFY_HEADER_LEN;
+	*interval_us = ble_service_interval * BLE_SERVICE_INTERVAL_UNIT_US;
+	return ble_service_stream_enabled;
+#else
+	return false;
+#endif
+}
+
+int MPAI_BLE_Service_Stream_Notify(const uint8_t* data, uint16_t len)
+{
+#ifdef CONFIG_MPAI_BLE_SERVICE
+	if (!ble_service_stream_enabled)
+	{
+		return -ENOTCONN;
+	}
+	// the notifications are sent once per connection event: the ones waiting hold the ACL buffers
+	if (atomic_inc(&ble_service_stream_in_flight) >= CONFIG_MPAI_BLE_SERVICE_STREAM_MAX_IN_FLIGHT)
+	{
+		atomic_dec(&ble_service_stream_in_flight);
+		return -EAGAIN;
+	}
+
+	struct bt_gatt_notify_params params = {
+		.attr = &mpai_ble_svc.attrs[BLE_SERVICE_STREAM_ATTR],
+		.data = data,
+		.len = len,
+		.func = _ble_service_stream_sent,
+	};
+	int ret = bt_gatt_notify_cb(NULL, &params);
+	if (ret < 0)
+	{
+		atomic_dec(&ble_service_stream_in_flight);
+	}
+	return ret;
+#else
+	return -ENOTSUP;
+#endif
+}
+
+void MPAI_BLE_Service_Stream_Set_Channels(const char* names)
+{
+#ifdef CONFIG_MPAI_BLE_SERVICE
+	strncpy(ble_service_stream_channels, names, MPAI_BLE_SERVICE_STREAM_CHANNELS_MAX_LEN);
+#endif
+}
+
+/************* PRIVATE **************/
+#ifdef CONFIG_MPAI_BLE_SERVICE
+ssize_t _ble_service_config_write(struct bt_conn* conn, const struct bt_gatt_attr* attr, const void* buf, uint16_t len,
+								  uint16_t offset, uint8_t flags)
+{
+	ARG_UNUSED(attr);
+	const uint8_t* data = (const uint8_t*) buf;
+	ble_service_mtu = bt_gatt_get_mtu(conn);
+	if (offset != 0)
+	{
+		// a request per write: long writes are not supported
+		return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
+	}
+	if (len == 0)
+	{
+		return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+	}
+
+	int ret;
+	switch (data[0])
+	{
+	case MPAI_BLE_SERVICE_CONFIG_BEGIN:
+		ret = _ble_service_config_begin(data, len);
+		break;
+	case MPAI_BLE_SERVICE_CONFIG_DATA:
+		ret = _ble_service_config_data(data, len);
+		break;
+	case MPAI_BLE_SERVICE_CONFIG_END:
+		ret = _ble_service_config_end(data, len);
+		break;
+	case MPAI_BLE_SERVICE_CONFIG_ABORT:
+		if (atomic_cas(&ble_service_transfer._state, BLE_SERVICE_TRANSFER_RECEIVING, BLE_SERVICE_TRANSFER_IDLE))
+		{
+			_ble_service_config_free();
+		}
+		ret = 0;
+		break;
+	default:
+		ret = -ENOTSUP;
+		break;
+	}
+	return _ble_service_write_result(data[0], ret, len, flags);
+}
+
+ssize_t _ble_service_control_write(struct bt_conn* conn, const struct bt_gatt_attr* attr, const void* buf, uint16_t len,
+								   uint16_t offset, uint8_t flags)
+{
+	ARG_UNUSED(attr);
+	const uint8_t* data = (const uint8_t*) buf;
+	ble_service_mtu = bt_gatt_get_mtu(conn);
+	if (offset != 0)
+	{
+		return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
+	}
+	if (len < 2 || len - 1 > MPAI_BLE_SERVICE_NAME_MAX_LEN)
+	{
+		return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+	}
+
+	ble_service_request_t request = { ._op = data[0] };
+	memcpy(request._name, &data[1], len - 1);
+	int ret = -ENOTSUP;
+	if (request._op >= MPAI_BLE_SERVICE_CONTROL_START && request._op <= MPAI_BLE_SERVICE_CONTROL_RESUME)
+	{
+		// applied by the service thread, which notifies the result
+		ret = atomic_get(&ble_service_started) ? k_msgq_put(&ble_service_requests, &request, K_NO_WAIT) : -EAGAIN;
+	}
+	if (ret < 0)
+	{
+		return _ble_service_write_result(request._op, ret, len, flags);
+	}
+	return len;
+}
+
+ssize_t _ble_service_status_read(struct bt_conn* conn, const struct bt_gatt_attr* attr, void* buf, uint16_t len, uint16_t offset)
+{
+	ble_service_status_t status = ble_service_status;
+	status._received = sys_cpu_to_le16(ble_service_transfer._received);
+	status._mtu = sys_cpu_to_le16(bt_gatt_get_mtu(conn));
+	return bt_gatt_attr_read(conn, attr, buf, len, offset, &status, sizeof(status));
+}
+
+void _ble_service_status_ccc_changed(const struct bt_gatt_attr* attr, uint16_t value)
+{
+	ARG_UNUSED(attr);
+	ble_service_notify_enabled = value == BT_GATT_CCC_NOTIFY;
+}
+
+ssize_t _ble_service_stream_read(struct bt_conn* conn, const struct bt_gatt_attr* attr, void* buf, uint16_t len, uint16_t offset)
+{
+	return bt_gatt_attr_read(conn, attr, buf, len, offset, ble_service_stream_channels, strlen(ble_service_stream_channels));
+}
+
+void _ble_service_stream_ccc_changed(const struct bt_gatt_attr* attr, uint16_t value)
+{
+	ARG_UNUSED(attr);
+	ble_service_stream_enabled = value == BT_GATT_CCC_NOTIFY;
+	LOG_INF("Stream %s", ble_service_stream_enabled ? "subscribed" : "unsubscribed");
+}
+
+void _ble_service_stream_sent(struct bt_conn* conn, void* user_data)
+{
+	ARG_UNUSED(conn);
+	ARG_UNUSED(user_data);
+	// the counter is reset on disconnection: the notifications dropped with the link may still complete
+	atomic_val_t in_flight;
+	do
+	{
+		in_flight = atomic_get(&ble_service_stream_in_flight);
+	} while (in_flight > 0 && !atomic_cas(&ble_service_stream_in_flight, in_flight, in_flight - 1));
+}
+
+int _ble_service_config_begin(const uint8_t* buf, uint16_t len)
+{
+	uint16_t name_len = len - BLE_SERVICE_BEGIN_LEN;
+	if (len <= BLE_SERVICE_BEGIN_LEN || name_len > MPAI_BLE_SERVICE_NAME_MAX_LEN || buf[1] > MPAI_BLE_SERVICE_CONFIG_AIM)
+	{
+		return -EINVAL;
+	}
+	uint16_t config_len = sys_get_le16(&buf[2]);
+	if (config_len == 0 || config_len > CONFIG_MPAI_BLE_SERVICE_CONFIG_MAX_SIZE)
+	{
+		return -EFBIG;
+	}
+	if (atomic_get(&ble_service_transfer._state) == BLE_SERVICE_TRANSFER_APPLYING)
+	{
+		return -EBUSY;
+	}
+
+	// a new configuration replaces the one interrupted
+	_ble_service_config_free();
+	ble_service_transfer._data = (uint8_t*) k_malloc(config_len);
+	if (ble_service_transfer._data == NULL)
+	{
+		atomic_set(&ble_service_transfer._state, BLE_SERVICE_TRANSFER_IDLE);
+		return -ENOMEM;
+	}
+	ble_service_transfer._kind = buf[1];
+	memcpy(ble_service_transfer._name, &buf[BLE_SERVICE_BEGIN_LEN], name_len);
+	ble_service_transfer._name[name_len] = '\0';
+	ble_service_transfer._len = config_len;
+	ble_service_transfer._received = 0;
+	atomic_set(&ble_service_transfer._state, BLE_SERVICE_TRANSFER_RECEIVING);
+	LOG_INF("Receiving configuration %s (%d bytes)", log_strdup(ble_service_transfer._name), config_len);
+	return 0;
+}
+
+int _ble_service_config_data(const uint8_t* buf, uint16_t len)
+{
+	if (atomic_get(&ble_service_transfer._state) != BLE_SERVICE_TRANSFER_RECEIVING)
+	{
+		return -EPROTO;
+	}
+	if (len < BLE_SERVICE_DATA_LEN)
+	{
+		return -EINVAL;
+	}
+	// a chunk lost (i.e. a write command dropped) is sent again by the client, from the bytes received
+	if (sys_get_le16(&buf[1]) != ble_service_transfer._received)
+	{
+		return -EILSEQ;
+	}
+	uint16_t chunk_len = len - BLE_SERVICE_DATA_LEN;
+	if (chunk_len > ble_service_transfer._len - ble_service_transfer._received)
+	{
+		return -EFBIG;
+	}
+	memcpy(&ble_service_transfer._data[ble_service_transfer._received], &buf[BLE_SERVICE_DATA_LEN], chunk_len);
+	ble_service_transfer._received += chunk_len;
+	return 0;
+}
+
+int _ble_service_config_end(const uint8_t* buf, uint16_t len)
+{
+	if (!atomic_get(&ble_service_started))
+	{
+		return -EAGAIN;
+	}
+	if (atomic_get(&ble_service_transfer._state) != BLE_SERVICE_TRANSFER_RECEIVING)
+	{
+		return -EPROTO;
+	}
+	if (len < BLE_SERVICE_END_LEN)
+	{
+		return -EINVAL;
+	}
+	if (ble_service_transfer._received != ble_service_transfer._len)
+	{
+		return -EILSEQ;
+	}
+
+	// checked and applied by the service thread, which notifies the result
+	ble_service_transfer._crc = sys_get_le32(&buf[1]);
+	atomic_set(&ble_service_transfer._state, BLE_SERVICE_TRANSFER_APPLYING);
+	ble_service_request_t request = { ._op = MPAI_BLE_SERVICE_CONFIG_END };
+	int ret = k_msgq_put(&ble_service_requests, &request, K_NO_WAIT);
+	if (ret < 0)
+	{
+		atomic_set(&ble_service_transfer._state, BLE_SERVICE_TRANSFER_RECEIVING);
+		return ret;
+	}
+	return 1;
+}
+
+void _ble_service_config_free(void)
+{
+	k_free(ble_service_transfer._data);
+	ble_service_transfer._data = NULL;
+	ble_service_transfer._received = 0;
+}
+
+ssize_t _ble_service_write_result(uint8_t op, int result, uint16_t len, uint8_t flags)
+{
+	// the data are acknowledged only by the write responses, if any: the end is notified once applied
+	if (result < 0 || (result == 0 && op != MPAI_BLE_SERVICE_CONFIG_DATA))
+	{
+		_ble_service_notify_status(op, result);
+	}
+
+	if (result >= 0 || (flags & BT_GATT_WRITE_FLAG_CMD))
+	{
+		return len;
+	}
+	switch (result)
+	{
+	case -EINVAL:
+		return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+	case -EFBIG:
+	case -ENOMEM:
+		return BT_GATT_ERR(BT_ATT_ERR_INSUFFICIENT_RESOURCES);
+	case -ENOTSUP:
+		return BT_GATT_ERR(BT_ATT_ERR_NOT_SUPPORTED);
+	default:
+		return BT_GATT_ERR(BT_ATT_ERR_UNLIKELY);
+	}
+}
+
+void _ble_service_notify_status(uint8_t op, int result)
+{
+	ble_service_status._op = op;
+	ble_service_status._result = MAX(result, INT8_MIN);
+	ble_service_status._received = sys_cpu_to_le16(ble_service_transfer._received);
+	ble_service_status._mtu = sys_cpu_to_le16(ble_service_mtu);
+	if (ble_service_notify_enabled)
+	{
+		(void)bt_gatt_notify(NULL, &mpai_ble_svc.attrs[BLE_SERVICE_STATUS_ATTR], &ble_service_status, sizeof(ble_service_status));
+	}
+}
+
+int _ble_service_apply_config(void)
+{
+	const char* prefix[] = { AIF_CONFIG[0], AIW_CONFIG[0], AIM_CONFIG[0] };
+	ble_service_transfer_t* transfer = &ble_service_transfer;
+	if (crc32_ieee(transfer->_data, transfer->_len) != transfer->_crc)
+	{
+		LOG_ERR("Configuration %s received with a wrong crc", log_strdup(transfer->_name));
+		return -EBADMSG;
+	}
+#ifndef CONFIG_MPAI_CONFIG_CACHE
+	// without the cache, it would be lost before the next boot
+	if (transfer->_kind != MPAI_BLE_SERVICE_CONFIG_AIM)
+	{
+		return -ENOTSUP;
+	}
+#endif
+
+	int ret = MPAI_Config_Store_Put(prefix[transfer->_kind], transfer->_name, transfer->_data, transfer->_len);
+	if (ret < 0)
+	{
+		return ret;
+	}
+	if (transfer->_kind != MPAI_BLE_SERVICE_CONFIG_AIM)
+	{
+		// the topology can't change while the AIW is running
+		LOG_WRN("Configuration %s%s received: applied from the next boot", log_strdup(prefix[transfer->_kind]), log_strdup(transfer->_name));
+		return 0;
+	}
+#if defined(CONFIG_MPAI_CONFIG_STORE)
+	mpai_error_t err = MPAI_Controller_Reload_AIM(transfer->_name);
+	return err.code == MPAI_AIF_OK ? 0 : -EIO;
+#else
+	return 0;
+#endif
+}
+
+int _ble_service_apply_control(const ble_service_request_t* request)
+{
+	mpai_error_t err;
+	if (strcmp(request->_name, MPAI_LIBS_IOT_REV_AIW_NAME) == 0)
+	{
+		switch (request->_op)
+		{
+		case MPAI_BLE_SERVICE_CONTROL_STOP:
+			err = MPAI_AIFU_AIW_Stop(AIW_IOT_REV);
+			break;
+		case MPAI_BLE_SERVICE_CONTROL_PAUSE:
+			err = MPAI_AIFU_AIW_Pause(AIW_IOT_REV);
+			break;
+		case MPAI_BLE_SERVICE_CONTROL_RESUME:
+			err = MPAI_AIFU_AIW_Resume(AIW_IOT_REV);
+			break;
+		default:
+			// the AIW is started at boot
+			return -ENOTSUP;
+		}
+	}
+	else
+	{
+		switch (request->_op)
+		{
+		case MPAI_BLE_SERVICE_CONTROL_START:
+			err = MPAI_AIFM_AIM_Start(request->_name);
+			break;
+		case MPAI_BLE_SERVICE_CONTROL_STOP:
+			err = MPAI_AIFM_AIM_Stop(request->_name);
+			break;
+		case MPAI_BLE_SERVICE_CONTROL_PAUSE:
+			err = MPAI_AIFM_AIM_Pause(request->_name);
+			break;
+		default:
+			err = MPAI_AIFM_AIM_Resume(request->_name);
+			break;
+		}
+	}
+	LOG_INF("Command 0x%02x to %s over Bluetooth: %s", request->_op, log_strdup(request->_name), log_strdup(MPAI_ERR_STR(err.code)));
+	return err.code == MPAI_AIF_OK ? 0 : -EIO;
+}
+
+void _ble_service_connected(struct bt_conn* conn, uint8_t err)
+{
+	if (err)
+	{
+		return;
+	}
+	ble_service_mtu = bt_gatt_get_mtu(conn);
+	struct bt_conn_info info;
+	if (bt_conn_get_info(conn, &info) == 0)
+	{
+		ble_service_interval = info.le.interval;
+	}
+#ifdef CONFIG_BT_GATT_CLIENT
+	// the largest MTU both sides support: fewer writes for each configuration
+	int ret = bt_gatt_exchange_mtu(conn, &ble_service_exchange_params);
+	if (ret < 0)
+	{
+		LOG_WRN("MTU exchange failed (err %d)", ret);
+	}
+#endif
+}
+
+void _ble_service_disconnected(struct bt_conn* conn, uint8_t reason)
+{
+	ARG_UNUSED(conn);
+	ARG_UNUSED(reason);
+	// a configuration interrupted is sent again from the start
+	if (atomic_cas(&ble_service_transfer._state, BLE_SERVICE_TRANSFER_RECEIVING, BLE_SERVICE_TRANSFER_IDLE))
+	{
+		_ble_service_config_free();
+	}
+	ble_service_mtu = BLE_SERVICE_DEFAULT_MTU;
+	ble_service_interval = 0;
+	ble_service_stream_enabled = false;
+	atomic_set(&ble_service_stream_in_flight, 0);
+}
+
+void _ble_service_le_param_updated(struct bt_conn* conn, uint16_t interval, uint16_t latency, uint16_t timeout)
+{
+	ARG_UNUSED(conn);
+	ARG_UNUSED(timeout);
+	// the stream adapts its notifications to the new interval
+	ble_service_interval = interval;
+	LOG_INF("Connection interval %d us, latency %d", interval * BLE_SERVICE_INTERVAL_UNIT_US, latency);
+}
+
+#ifdef CONFIG_BT_GATT_CLIENT
+void _ble_service_mtu_exchanged(struct bt_conn* conn, uint8_t err, struct bt_gatt_exchange_params* params)
+{
+	ARG_UNUSED(params);
+	ble_service_mtu = bt_gatt_get_mtu(conn);
+	LOG_INF("ATT MTU %d (err %d)", ble_service_mtu, err);
+}
+#endif
+
+void th_ble_service(void *dummy1, void *dummy2, void *dummy3)
+{
+	ARG_UNUSED(dummy1);
+	ARG_UNUSED(dummy2);
+	ARG_UNUSED(dummy3);
+
+	ble_service_request_t request;
+	while (1)
+	{
+		k_msgq_get(&ble_service_requests, &request, K_FOREVER);
+		int ret;
+		if (request._op == MPAI_BLE_SERVICE_CONFIG_END)
+		{
+			ret = _ble_service_apply_config();
+			_ble_service_config_free();
+			atomic_set(&ble_service_transfer._state, BLE_SERVICE_TRANSFER_IDLE);
+		}
+		else
+		{
+			ret = _ble_service_apply_control(&request);
+		}
+		_ble_service_notify_status(request._op, ret);
+	}
+}
+#endif
@@ -0,0 +1,98 @@
+/*
+ * @file
+ * @brief Headers of the Bluetooth LE service of the MPAI AIF: configuration and control of the AIMs
+ *
+ * A GATT service (MPAI_BLE_SERVICE_UUID) lets a phone configure and control the node without
+ * Wi-Fi and the MPAI Config Store. Its characteristics are written with or without response
+ * (write commands, faster), a request per write; the first byte is the operation:
+ *
+ *   Config (MPAI_BLE_SERVICE_CONFIG_UUID): a configuration (json), in chunks
+ *     0x01 begin   u8 kind (0 AIF, 1 AIW, 2 AIM), u16 length, name
+ *     0x02 data    u16 offset, bytes (up to the ATT MTU - 6)
+ *     0x03 end     u32 crc32 (IEEE) of the configuration: it is put in the config store
+ *                  (MPAI_Config_Store_Put) and applied, restarting the AIM; the configurations
+ *                  of the AIF and the AIW are applied from the next boot (through the cache)
+ *     0x04 abort
+ *   Control (MPAI_BLE_SERVICE_CONTROL_UUID): a command to an AIM, or to the AIW if named
+ *     0x11 start, 0x12 stop, 0x13 pause, 0x14 resume   name
+ *   Status (MPAI_BLE_SERVICE_STATUS_UUID): read or notified after each request but data
+ *     u8 operation, i8 result (0 or negative errno), u16 bytes of the configuration received,
+ *     u16 ATT MTU
+ *   Stream (MPAI_BLE_SERVICE_STREAM_UUID): notified with the messages of the channels streamed
+ *     (see ble_stream_aim.h) while subscribed; read, the names of the channels, comma separated
+ *
+ * A chunk written at an offset different from the bytes received is refused (-EILSEQ), and
+ * the status tells where to resume from. The ATT MTU is negotiated by the node when connected.
+ *
+ * Copyright (c) 2022 University of Turin, Daniele Bortoluzzi <danieleb88@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef MPAI_LIBS_AIF_BLE_SERVICE_H
+#define MPAI_LIBS_AIF_BLE_SERVICE_H
+
+#include <aif_controller.h>
+#include <bluetooth/uuid.h>
+
+/* 6d706169-xxxx-4000-8000-6d7061690000 ("mpai") */
+#define MPAI_BLE_SERVICE_UUID_VAL BT_UUID_128_ENCODE(0x6d706169, 0x0000, 0x4000, 0x8000, 0x6d7061690000)
+#define MPAI_BLE_SERVICE_CONFIG_UUID_VAL BT_UUID_128_ENCODE(0x6d706169, 0x0001, 0x4000, 0x8000, 0x6d7061690000)
+#define MPAI_BLE_SERVICE_CONTROL_UUID_VAL BT_UUID_128_ENCODE(0x6d706169, 0x0002, 0x4000, 0x8000, 0x6d7061690000)
+#define MPAI_BLE_SERVICE_STATUS_UUID_VAL BT_UUID_128_ENCODE(0x6d706169, 0x0003, 0x4000, 0x8000, 0x6d7061690000)
+#define MPAI_BLE_SERVICE_STREAM_UUID_VAL BT_UUID_128_ENCODE(0x6d706169, 0x0004, 0x4000, 0x8000, 0x6d7061690000)
+
+/* operations */
+#define MPAI_BLE_SERVICE_CONFIG_BEGIN 0x01
+#define MPAI_BLE_SERVICE_CONFIG_DATA 0x02
+#define MPAI_BLE_SERVICE_CONFIG_END 0x03
+#define MPAI_BLE_SERVICE_CONFIG_ABORT 0x04
+#define MPAI_BLE_SERVICE_CONTROL_START 0x11
+#define MPAI_BLE_SERVICE_CONTROL_STOP 0x12
+#define MPAI_BLE_SERVICE_CONTROL_PAUSE 0x13
+#define MPAI_BLE_SERVICE_CONTROL_RESUME 0x14
+
+/* kinds of configurations */
+#define MPAI_BLE_SERVICE_CONFIG_AIF 0
+#define MPAI_BLE_SERVICE_CONFIG_AIW 1
+#define MPAI_BLE_SERVICE_CONFIG_AIM 2
+
+#define MPAI_BLE_SERVICE_NAME_MAX_LEN 40
+/* names of the channels streamed, read from the stream characteristic */
+#define MPAI_BLE_SERVICE_STREAM_CHANNELS_MAX_LEN 160
+
+/**
+ * @brief Start the thread applying the requests (once Bluetooth is enabled): the
+ * requests written before are refused
+ *
+ * @return int 0 if started, -EALREADY if running, -ENOTSUP without CONFIG_MPAI_BLE_SERVICE
+ */
+int MPAI_BLE_Service_Start(void);
+
+/**
+ * @brief Get the link the stream is notified on
+ *
+ * @param payload_len bytes of a notification (ATT MTU - 3)
+ * @param interval_us connection interval
+ * @return bool false if the stream is not subscribed
+ */
+bool MPAI_BLE_Service_Stream_Get_Link(uint16_t* payload_len, uint32_t* interval_us);
+
+/**
+ * @brief Notify the stream to the subscribed client, up to
+ * CONFIG_MPAI_BLE_SERVICE_STREAM_MAX_IN_FLIGHT notifications not sent yet
+ *
+ * @param data
+ * @param len up to the payload of the link
+ * @return int 0 if queued, -EAGAIN if too many are in flight, -ENOTCONN if not subscribed
+ */
+int MPAI_BLE_Service_Stream_Notify(const uint8_t* data, uint16_t len);
+
+/**
+ * @brief Set the names of the channels streamed, read by the clients
+ *
+ * @param names comma separated, in order of their index in the notifications
+ */
+void MPAI_BLE_Service_Stream_Set_Channels(const char* names);
+
+#endif
@@ -0,0 +1,579 @@
+/*
+ * @file
+ * @brief Configurations built in the firmware, read at boot when not cached
+ *
+ * Generated by tools/mpai_builtin_config.py from docs: do not edit.
+ *
+ * Copyright (c) 2022 University of Turin, Daniele Bortoluzzi <danieleb88@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <config_store.h>
+
+#ifdef CONFIG_MPAI_CONFIG_BUILTIN
+
+/* docs/mpai_aif.json */
+static const uint8_t config_builtin_etag_0[] = { 0xf1, 0x66, 0x31, 0xd5, 0x93, 0xaf, 0x16, 0x22 };
+static const char config_builtin_data_0[] =
+	"{\n"
+	"  \"$schema\": \"https://json-schema.org/draft/2020-12/schema\",\n"
+	"  \"$id\": \"https://mpai.community/standards/resources/MPAI-AIF/V1/AIF-metadata.schema.json\",\n"
+	"  \"title\": \"MPAI-AIF V1 AIF metadata\",\n"
+	"  \"ImplementerID\": 1,\n"
+	"  \"Version\": \"v1.0\",\n"
+	"  \"APIProfile\": \"Main\",\n"
+	"  \"ResourcePolicies\": [\n"
+	"    {\n"
+	"      \"Name\": \"Memory\",\n"
+	"      \"Minimum\": \"50000\",\n"
+	"      \"Maximum\": \"120000\",\n"
+	"      \"Request\": \"80000\"\n"
+	"    },\n"
+	"    {\n"
+	"      \"Name\": \"CPUNumber\",\n"
+	"      \"Minimum\": \"1\",\n"
+	"      \"Maximum\": \"2\",\n"
+	"      \"Request\": \"1\"\n"
+	"    },\n"
+	"    {\n"
+	"      \"Name\": \"CPU:Class\",\n"
+	"      \"Minimum\": \"Low\",\n"
+	"      \"Maximum\": \"High\",\n"
+	"      \"Request\": \"Low\"\n"
+	"    }\n"
+	"  ],\n"
+	"  \"Authentication\": \"admin\",\n"
+	"  \"TimeBase\": \"NTP\"\n"
+	"}\n";
+
+/* docs/mpai_aiw_iot_rev.json */
+static const uint8_t config_builtin_etag_1[] = { 0x59, 0x58, 0x28, 0x90, 0xc6, 0x41, 0xa6, 0xb2 };
+static const char config_builtin_data_1[] =
+	"{\n"
+	"  \"$schema\": \"https://json-schema.org/draft/2020-12/schema\",\n"
+	"  \"$id\": \"https://mpai.community/standards/resources/MPAI-AIF/V1/AIW-AIM-metadata.schema.json\",\n"
+	"  \"title\": \"IOT AIF v1 AIW/AIM metadata\",\n"
+	"  \"Identifier\": {\n"
+	"    \"ImplementerID\": 1,\n"
+	"    \"Specification\": {\n"
+	"      \"Standard\": \"MPAI-IOT\",\n"
+	"      \"AIW\": \"IOT-REV\",\n"
+	"      \"AIM\": \"IOT-REV\",\n"
+	"      \"Version\": \"1\"\n"
+	"    }\n"
+	"  },\n"
+	"  \"APIProfile\": \"Main\",\n"
+	"  \"Description\": \"AIW that implements Use-Case IOT-REV (Rehabilitation Exercises Validation)\",\n"
+	"  \"Types\": [\n"
+	"    {\n"
+	"      \"Name\": \"Sensors_Data_t\",\n"
+	"      \"Type\": \"mpai_message_t\"\n"
+	"    },\n"
+	"    {\n"
+	"      \"Name\": \"Mic_Buffer_Data_t\",\n"
+	"      \"Type\": \"mpai_message_t\"\n"
+	"    },\n"
+	"    {\n"
+	"      \"Name\": \"Mic_Peak_Data_t\",\n"
+	"      \"Type\": \"mpai_message_t\"\n"
+	"    },\n"
+	"    {\n"
+	"      \"Name\": \"Motion_Data_t\",\n"
+	"      \"Type\": \"mpai_message_t\"\n"
+	"    }\n"
+	"  ],\n"
+	"  \"Ports\": [\n"
+	"    {\n"
+	"      \"Name\": \"SensorsDataChannel\",\n"
+	"      \"Direction\": \"InputOutput\",\n"
+	"      \"RecordType\": \"Sensors_Data_t\",\n"
+	"      \"Technology\": \"Software\",\n"
+	"      \"Protocol\": \"\",\n"
+	"      \"IsRemote\": false\n"
+	"    },\n"
+	"    {\n"
+	"      \"Name\": \"MicBufferDataChannel\",\n"
+	"      \"Direction\": \"InputOutput\",\n"
+	"      \"RecordType\": \"Mic_Buffer_Data_t\",\n"
+	"      \"Technology\": \"Software\",\n"
+	"      \"Protocol\": \"\",\n"
+	"      \"IsRemote\": false\n"
+	"    },\n"
+	"    {\n"
+	"      \"Name\": \"MicPeakDataChannel\",\n"
+	"      \"Direction\": \"InputOutput\",\n"
+	"      \"RecordType\": \"Mic_Peak_Data_t\",\n"
+	"      \"Technology\": \"Software\",\n"
+	"      \"Protocol\": \"\",\n"
+	"      \"IsRemote\": false\n"
+	"    },\n"
+	"    {\n"
+	"      \"Name\": \"MotionDataChannel\",\n"
+	"      \"Direction\": \"InputOutput\",\n"
+	"      \"RecordType\": \"Motion_Data_t\",\n"
+	"      \"Technology\": \"Software\",\n"
+	"      \"Protocol\": \"\",\n"
+	"      \"IsRemote\": false\n"
+	"    }\n"
+	"  ],\n"
+	"  \"Topology\": [\n"
+	"    {\n"
+	"      \"Output\": {\n"
+	"        \"AIMName\": \"MotionRecognitionAnalysis\",\n"
+	"        \"PortName\": \"SensorsDataChannel\"\n"
+	"      },\n"
+	"      \"Input\": {\n"
+	"        \"AIMName\": \"ControlUnitSensorsReading\",\n"
+	"        \"PortName\": \"SensorsDataChannel\"\n"
+	"      }\n"
+	"    },\n"
+	"    {\n"
+	"      \"Output\": {\n"
+	"        \"AIMName\": \"MovementsWithAudioValidation\",\n"
+	"        \"PortName\": \"MicPeakDataChannel\"\n"
+	"      },\n"
+	"      \"Input\": {\n"
+	"        \"AIMName\": \"VolumePeaksAnalysis\",\n"
+	"        \"PortName\": \"MicPeakDataChannel\"\n"
+	"      }\n"
+	"    },\n"
+	"    {\n"
+	"      \"Output\": {\n"
+	"        \"AIMName\": \"\",\n"
+	"        \"PortName\": \"MicBufferDataChannel\"\n"
+	"      },\n"
+	"      \"Input\": {\n"
+	"        \"AIMName\": \"VolumePeaksAnalysis\",\n"
+	"        \"PortName\": \"\"\n"
+	"      }\n"
+	"    },\n"
+	"    {\n"
+	"      \"Output\": {\n"
+	"        \"AIMName\": \"MovementsWithAudioValidation\",\n"
+	"        \"PortName\": \"MotionDataChannel\"\n"
+	"      },\n"
+	"      \"Input\": {\n"
+	"        \"AIMName\": \"MotionRecognitionAnalysis\",\n"
+	"        \"PortName\": \"MotionDataChannel\"\n"
+	"      }\n"
+	"    },\n"
+	"    {\n"
+	"      \"Output\": {\n"
+	"        \"AIMName\": \"TelemetryUplink\",\n"
+	"        \"PortName\": \"SensorsDataChannel\"\n"
+	"      },\n"
+	"      \"Input\": {\n"
+	"        \"AIMName\": \"ControlUnitSensorsReading\",\n"
+	"        \"PortName\": \"SensorsDataChannel\"\n"
+	"      }\n"
+	"    },\n"
+	"    {\n"
+	"      \"Output\": {\n"
+	"        \"AIMName\": \"TelemetryUplink\",\n"
+	"        \"PortName\": \"MicPeakDataChannel\"\n"
+	"      },\n"
+	"      \"Input\": {\n"
+	"        \"AIMName\": \"VolumePeaksAnalysis\",\n"
+	"        \"PortName\": \"MicPeakDataChannel\"\n"
+	"      }\n"
+	"    },\n"
+	"    {\n"
+	"      \"Output\": {\n"
+	"        \"AIMName\": \"TelemetryUplink\",\n"
+	"        \"PortName\": \"MotionDataChannel\"\n"
+	"      },\n"
+	"      \"Input\": {\n"
+	"        \"AIMName\": \"MotionRecognitionAnalysis\",\n"
+	"        \"PortName\": \"MotionDataChannel\"\n"
+	"      }\n"
+	"    },\n"
+	"    {\n"
+	"      \"Output\": {\n"
+	"        \"AIMName\": \"BluetoothStream\",\n"
+	"        \"PortName\": \"MotionDataChannel\"\n"
+	"      },\n"
+	"      \"Input\": {\n"
+	"        \"AIMName\": \"MotionRecognitionAnalysis\",\n"
+	"        \"PortName\": \"MotionDataChannel\"\n"
+	"      }\n"
+	"    },\n"
+	"    {\n"
+	"      \"Output\": {\n"
+	"        \"AIMName\": \"BluetoothStream\",\n"
+	"        \"PortName\": \"MicPeakDataChannel\"\n"
+	"      },\n"
+	"      \"Input\": {\n"
+	"        \"AIMName\": \"VolumePeaksAnalysis\",\n"
+	"        \"PortName\": \"MicPeakDataChannel\"\n"
+	"      }\n"
+	"    }\n"
+	"  ],\n"
+	"  \"SubAIMs\": [\n"
+	"    {\n"
+	"      \"Name\": \"VolumePeaksAnalysis\",\n"
+	"      \"Identifier\": {\n"
+	"        \"ImplementerID\": 1,\n"
+	"        \"Specification\": {\n"
+	"          \"Standard\": \"MPAI-IOT\",\n"
+	"          \"AIW\": \"IOT-REV\",\n"
+	"          \"AIM\": \"VolumePeaksAnalysis\",\n"
+	"          \"Version\": \"1\"\n"
+	"        }\n"
+	"      }\n"
+	"    },\n"
+	"    {\n"
+	"      \"Name\": \"ControlUnitSensorsReading\",\n"
+	"      \"Identifier\": {\n"
+	"        \"ImplementerID\": 1,\n"
+	"        \"Specification\": {\n"
+	"          \"Standard\": \"MPAI-IOT\",\n"
+	"          \"AIW\": \"IOT-REV\",\n"
+	"          \"AIM\": \"ControlUnitSensorsReading\",\n"
+	"          \"Version\": \"1\"\n"
+	"        }\n"
+	"      }\n"
+	"    },\n"
+	"    {\n"
+	"      \"Name\": \"MotionRecognitionAnalysis\",\n"
+	"      \"Identifier\": {\n"
+	"        \"ImplementerID\": 1,\n"
+	"        \"Specification\": {\n"
+	"          \"Standard\": \"MPAI-IOT\",\n"
+	"          \"AIW\": \"IOT-REV\",\n"
+	"          \"AIM\": \"MotionRecognitionAnalysis\",\n"
+	"          \"Version\": \"1\"\n"
+	"        }\n"
+	"      }\n"
+	"    },\n"
+	"    {\n"
+	"      \"Name\": \"MovementsWithAudioValidation\",\n"
+	"      \"Identifier\": {\n"
+	"        \"ImplementerID\": 1,\n"
+	"        \"Specification\": {\n"
+	"          \"Standard\": \"MPAI-IOT\",\n"
+	"          \"AIW\": \"IOT-REV\",\n"
+	"          \"AIM\": \"MovementsWithAudioValidation\",\n"
+	"          \"Version\": \"1\"\n"
+	"        }\n"
+	"      }\n"
+	"    },\n"
+	"    {\n"
+	"      \"Name\": \"TelemetryUplink\",\n"
+	"      \"Identifier\": {\n"
+	"        \"ImplementerID\": 1,\n"
+	"        \"Specification\": {\n"
+	"          \"Standard\": \"MPAI-IOT\",\n"
+	"          \"AIW\": \"IOT-REV\",\n"
+	"          \"AIM\": \"TelemetryUplink\",\n"
+	"          \"Version\": \"1\"\n"
+	"        }\n"
+	"      }\n"
+	"    },\n"
+	"    {\n"
+	"      \"Name\": \"BluetoothStream\",\n"
+	"      \"Identifier\": {\n"
+	"        \"ImplementerID\": 1,\n"
+	"        \"Specification\": {\n"
+	"          \"Standard\": \"MPAI-IOT\",\n"
+	"          \"AIW\": \"IOT-REV\",\n"
+	"          \"AIM\": \"BluetoothStream\",\n"
+	"          \"Version\": \"1\"\n"
+	"        }\n"
+	"      }\n"
+	"    }\n"
+	"  ],\n"
+	"  \"Implementations\": [\n"
+	"    {\n"
+	"      \"BinaryName\": \"firmware.bin\",\n"
+	"      \"Architecture\": \"arm\",\n"
+	"      \"OperatingSystem\": \"Zephyr RTOS\",\n"
+	"      \"Version\": \"v0.1\",\n"
+	"      \"Source\": \"AIMStorage\",\n"
+	"      \"Destination\": \"\"\n"
+	"    }\n"
+	"  ],\n"
+	"  \"ResourcePolicies\": [\n"
+	"    {\n"
+	"      \"Name\": \"Memory\",\n"
+	"      \"Minimum\": \"50000\",\n"
+	"      \"Maximum\": \"120000\",\n"
+	"      \"Request\": \"80000\"\n"
+	"    },\n"
+	"    {\n"
+	"      \"Name\": \"CPUNumber\",\n"
+	"      \"Minimum\": \"1\",\n"
+	"      \"Maximum\": \"2\",\n"
+	"      \"Request\": \"1\"\n"
+	"    },\n"
+	"    {\n"
+	"      \"Name\": \"CPU:Class\",\n"
+	"      \"Minimum\": \"Low\",\n"
+	"      \"Maximum\": \"High\",\n"
+	"      \"Request\": \"Low\"\n"
+	"    }\n"
+	"  ],\n"
+	"  \"Documentation\": [\n"
+	"    {\n"
+	"      \"Type\": \"Tutorial\",\n"
+	"      \"URI\": \"https://mpai.community/standards/mpai-iot/\"\n"
+	"    }\n"
+	"  ]\n"
+	"}\n";
+
+/* docs/mpai_aim_BluetoothStream.json */
+static const uint8_t config_builtin_etag_2[] = { 0xe9, 0x13, 0x78, 0x88, 0x47, 0x9f, 0x43, 0x48 };
+static const char config_builtin_data_2[] =
+	"{\n"
+	"  \"Identifier\": {\n"
+	"    \"ImplementerID\": 1,\n"
+	"    \"Specification\": {\n"
+	"      \"Name\": \"IOT\",\n"
+	"      \"AIW\": \"REV\",\n"
+	"      \"AIM\": \"BluetoothStream\",\n"
+	"      \"Version\": \"1\"\n"
+	"    }\n"
+	"  },\n"
+	"  \"Description\": \"This AIM streams the messages of its input channels over Bluetooth LE, in notif"
+	"ications.\",\n"
+	"  \"Scheduling\": {\n"
+	"    \"Priority\": 10,\n"
+	"    \"Deadline\": 200,\n"
+	"    \"Budget\": 50\n"
+	"  },\n"
+	"  \"Supervision\": {\n"
+	"    \"HeartbeatTimeout\": 15000,\n"
+	"    \"LatencySLA\": 1000,\n"
+	"    \"MaxRestarts\": 3\n"
+	"  },\n"
+	"  \"Ports\": [],\n"
+	"  \"Topology\": [],\n"
+	"  \"SubAIMs\": [],\n"
+	"  \"Topology\": [],\n"
+	"  \"Implementations\": [],\n"
+	"  \"Documentation\": [\n"
+	"    {\n"
+	"      \"Type\": \"Tutorial\",\n"
+	"      \"URI\": \"https://mpai.community/standards/mpai-iot/\"\n"
+	"    }\n"
+	"  ]\n"
+	"}\n";
+
+/* docs/mpai_aim_ControlUnitSensorsReading.json */
+static const uint8_t config_builtin_etag_3[] = { 0x68, 0x50, 0xf7, 0x45, 0x4f, 0x42, 0x0e, 0x24 };
+static const char config_builtin_data_3[] =
+	"{\n"
+	"  \"Identifier\": {\n"
+	"    \"ImplementerID\": 1,\n"
+	"    \"Specification\": {\n"
+	"      \"Name\": \"IOT\",\n"
+	"      \"AIW\": \"REV\",\n"
+	"      \"AIM\": \"ControlUnitSensorsReading\",\n"
+	"      \"Version\": \"1\"\n"
+	"    }\n"
+	"  },\n"
+	"  \"Description\": \"This AIM implements sensor readings from control unit.\",\n"
+	"  \"DutyCycle\": {\n"
+	"    \"Period\": 10000,\n"
+	"    \"ActiveWindow\": 4000,\n"
+	"    \"Phase\": 0\n"
+	"  },\n"
+	"  \"Scheduling\": {\n"
+	"    \"Priority\": 6,\n"
+	"    \"Deadline\": 100,\n"
+	"    \"Budget\": 20\n"
+	"  },\n"
+	"  \"Supervision\": {\n"
+	"    \"HeartbeatTimeout\": 3000,\n"
+	"    \"MaxRestarts\": 3\n"
+	"  },\n"
+	"  \"Ports\": [],\n"
+	"  \"Topology\": [],\n"
+	"  \"SubAIMs\": [],\n"
+	"  \"Topology\": [],\n"
+	"  \"Implementations\": [],\n"
+	"  \"Documentation\": [\n"
+	"    {\n"
+	"      \"Type\": \"Tutorial\",\n"
+	"      \"URI\": \"https://mpai.community/standards/mpai-iot/\"\n"
+	"    }\n"
+	"  ]\n"
+	"}\n";
+
+/* docs/mpai_aim_MotionRecognitionAnalysis.json */
+static const uint8_t config_builtin_etag_4[] = { 0x1b, 0x30, 0x6b, 0xd9, 0xfa, 0xf9, 0xd3, 0x22 };
+static const char config_builtin_data_4[] =
+	"{\n"
+	"  \"Identifier\": {\n"
+	"    \"ImplementerID\": 1,\n"
+	"    \"Specification\": {\n"
+	"      \"Name\": \"IOT\",\n"
+	"      \"AIW\": \"REV\",\n"
+	"      \"AIM\": \"MotionRecognitionAnalysis\",\n"
+	"      \"Version\": \"1\"\n"
+	"    }\n"
+	"  },\n"
+	"  \"Description\": \"This AIM implements motion recognition analysing data from inertial unit.\",\n"
+	"  \"DutyCycle\": {\n"
+	"    \"Period\": 10000,\n"
+	"    \"ActiveWindow\": 4000,\n"
+	"    \"Phase\": 0\n"
+	"  },\n"
+	"  \"Scheduling\": {\n"
+	"    \"Priority\": 6,\n"
+	"    \"Deadline\": 100,\n"
+	"    \"Budget\": 10\n"
+	"  },\n"
+	"  \"Supervision\": {\n"
+	"    \"HeartbeatTimeout\": 3000,\n"
+	"    \"LatencySLA\": 200,\n"
+	"    \"MaxRestarts\": 3\n"
+	"  },\n"
+	"  \"Ports\": [],\n"
+	"  \"Topology\": [],\n"
+	"  \"SubAIMs\": [],\n"
+	"  \"Topology\": [],\n"
+	"  \"Implementations\": [],\n"
+	"  \"Documentation\": [\n"
+	"    {\n"
+	"      \"Type\": \"Tutorial\",\n"
+	"      \"URI\": \"https://mpai.community/standards/mpai-iot/\"\n"
+	"    }\n"
+	"  ]\n"
+	"}\n";
+
+/* docs/mpai_aim_MovementsWithAudioValidation.json */
+static const uint8_t config_builtin_etag_5[] = { 0x86, 0xca, 0x3e, 0x2a, 0xf1, 0xb1, 0xf9, 0x76 };
+static const char config_builtin_data_5[] =
+	"{\n"
+	"  \"Identifier\": {\n"
+	"    \"ImplementerID\": 1,\n"
+	"    \"Specification\": {\n"
+	"      \"Name\": \"IOT\",\n"
+	"      \"AIW\": \"REV\",\n"
+	"      \"AIM\": \"MovementsWithAudioValidation\",\n"
+	"      \"Version\": \"1\"\n"
+	"    }\n"
+	"  },\n"
+	"  \"Description\": \"This AIM implements a validation of limbs movements during rehabilitation exerc"
+	"ises, according to music rhythm\",\n"
+	"  \"DutyCycle\": {\n"
+	"    \"Period\": 10000,\n"
+	"    \"ActiveWindow\": 4000,\n"
+	"    \"Phase\": 0\n"
+	"  },\n"
+	"  \"Scheduling\": {\n"
+	"    \"Priority\": 5,\n"
+	"    \"Deadline\": 100,\n"
+	"    \"Budget\": 20\n"
+	"  },\n"
+	"  \"Supervision\": {\n"
+	"    \"HeartbeatTimeout\": 3000,\n"
+	"    \"LatencySLA\": 200,\n"
+	"    \"MaxRestarts\": 3\n"
+	"  },\n"
+	"  \"Ports\": [],\n"
+	"  \"Topology\": [],\n"
+	"  \"SubAIMs\": [],\n"
+	"  \"Topology\": [],\n"
+	"  \"Implementations\": [],\n"
+	"  \"Documentation\": [\n"
+	"    {\n"
+	"      \"Type\": \"Tutorial\",\n"
+	"      \"URI\": \"https://mpai.community/standards/mpai-iot/\"\n"
+	"    }\n"
+	"  ]\n"
+	"}\n";
+
+/* docs/mpai_aim_TelemetryUplink.json */
+static const uint8_t config_builtin_etag_6[] = { 0x9c, 0xbb, 0x7e, 0xdd, 0xe3, 0x0a, 0x29, 0x54 };
+static const char config_builtin_data_6[] =
+	"{\n"
+	"  \"Identifier\": {\n"
+	"    \"ImplementerID\": 1,\n"
+	"    \"Specification\": {\n"
+	"      \"Name\": \"IOT\",\n"
+	"      \"AIW\": \"REV\",\n"
+	"      \"AIM\": \"TelemetryUplink\",\n"
+	"      \"Version\": \"1\"\n"
+	"    }\n"
+	"  },\n"
+	"  \"Description\": \"This AIM sends the messages of its input channels to the MPAI Store, in batches"
+	".\",\n"
+	"  \"Scheduling\": {\n"
+	"    \"Priority\": 10,\n"
+	"    \"Deadline\": 1000,\n"
+	"    \"Budget\": 50\n"
+	"  },\n"
+	"  \"Supervision\": {\n"
+	"    \"HeartbeatTimeout\": 15000,\n"
+	"    \"LatencySLA\": 1000,\n"
+	"    \"MaxRestarts\": 3\n"
+	"  },\n"
+	"  \"Ports\": [],\n"
+	"  \"Topology\": [],\n"
+	"  \"SubAIMs\": [],\n"
+	"  \"Topology\": [],\n"
+	"  \"Implementations\": [],\n"
+	"  \"Documentation\": [\n"
+	"    {\n"
+	"      \"Type\": \"Tutorial\",\n"
+	"      \"URI\": \"https://mpai.community/standards/mpai-iot/\"\n"
+	"    }\n"
+	"  ]\n"
+	"}\n";
+
+/* docs/mpai_aim_VolumePeaksAnalysis.json */
+static const uint8_t config_builtin_etag_7[] = { 0xae, 0x15, 0x19, 0x43, 0xae, 0x4b, 0xc6, 0x97 };
+static const char config_builtin_data_7[] =
+	"{\n"
+	"  \"Identifier\": {\n"
+	"    \"ImplementerID\": 1,\n"
+	"    \"Specification\": {\n"
+	"      \"Name\": \"IOT\",\n"
+	"      \"AIW\": \"REV\",\n"
+	"      \"AIM\": \"VolumePeaksAnalysis\",\n"
+	"      \"Version\": \"1\"\n"
+	"    }\n"
+	"  },\n"
+	"  \"Description\": \"This AIM implements analysis transform function for IOT-REV that recognizes vol"
+	"ume peaks from microphone array audio.\",\n"
+	"  \"DutyCycle\": {\n"
+	"    \"Period\": 10000,\n"
+	"    \"ActiveWindow\": 4000,\n"
+	"    \"Phase\": 0\n"
+	"  },\n"
+	"  \"Scheduling\": {\n"
+	"    \"Priority\": 5,\n"
+	"    \"Deadline\": 50\n"
+	"  },\n"
+	"  \"Supervision\": {\n"
+	"    \"HeartbeatTimeout\": 3000,\n"
+	"    \"MaxRestarts\": 3\n"
+	"  },\n"
+	"  \"Ports\": [],\n"
+	"  \"Topology\": [],\n"
+	"  \"SubAIMs\": [],\n"
+	"  \"Topology\": [],\n"
+	"  \"Implementations\": [],\n"
+	"  \"Documentation\": [\n"
+	"    {\n"
+	"      \"Type\": \"Tutorial\",\n"
+	"      \"URI\": \"https://mpai.community/standards/mpai-iot/\"\n"
+	"    }\n"
+	"  ]\n"
+	"}\n";
+
+const mpai_config_builtin_t mpai_config_builtin[] = {
+	{ "config/aif/demo", config_builtin_etag_0, sizeof(config_builtin_etag_0), config_builtin_data_0, sizeof(config_builtin_data_0) - 1 },
+	{ "config/aiw/IOT-REV", config_builtin_etag_1, sizeof(config_builtin_etag_1), config_builtin_data_1, sizeof(config_builtin_data_1) - 1 },
+	{ "config/aim/BluetoothStream", config_builtin_etag_2, sizeof(config_builtin_etag_2), config_builtin_data_2, sizeof(config_builtin_data_2) - 1 },
+	{ "config/aim/ControlUnitSensorsReading", config_builtin_etag_3, sizeof(config_builtin_etag_3), config_builtin_data_3, sizeof(config_builtin_data_3) - 1 },
+	{ "config/aim/MotionRecognitionAnalysis", config_builtin_etag_4, sizeof(config_builtin_etag_4), config_builtin_data_4, sizeof(config_builtin_data_4) - 1 },
+	{ "config/aim/MovementsWithAudioValidation", config_builtin_etag_5, sizeof(config_builtin_etag_5), config_builtin_data_5, sizeof(config_builtin_data_5) - 1 },
+	{ "config/aim/TelemetryUplink", config_builtin_etag_6, sizeof(config_builtin_etag_6), config_builtin_data_6, sizeof(config_builtin_data_6) - 1 },
+	{ "config/aim/VolumePeaksAnalysis", config_builtin_etag_7, sizeof(config_builtin_etag_7), config_builtin_data_7, sizeof(config_builtin_data_7) - 1 },
+};
+
+const size_t mpai_config_builtin_count = ARRAY_SIZE(mpai_config_builtin);
+#endif
@@ -11,8 +11,11 @@
 
 LOG_MODULE_REGISTER(MPAI_LIBS_AIF_CONTROLLER, LOG_LEVEL_INF);
 
-#include <wifi_connect.h>
 #include <net_private.h>
+#include <boot_trace.h>
+#ifdef CONFIG_MPAI_TELEMETRY_SERVER
+	#include <aif_telemetry.h>
+#endif
 
 /************* STATIC HEADER *************/
 static int aiw_id;
@@ -26,6 +29,55 @@ bool _start_aim_after_parsing_callback(const char * aim_name);
 void _update_input_channels_after_parsing_callback(const char * aim_name, const char* port_name); 
 /* search message store by aiw_id*/
 message_store_map_element_t _linear_search_message_store(int aiw_id);
+/* check that each AIM of MPAI_AIM_List has its own thread control block */
+bool _check_aim_controls(void);
+#if defined(CONFIG_MPAI_CONFIG_STORE)
+/* load the AIW from its JSON configuration */
+bool _load_aiw_json(const char *name, int aiw_id);
+#endif
+#ifdef CONFIG_MPAI_CONFIG_STORE_STREAMING
+/* parse a block of the AIW metadata coming from MPAI Store Config */
+bool _parse_aiw_chunk_callback(const uint8_t* data, size_t len, void* user_data);
+
+static mpai_aiw_stream_parser_t aiw_stream_parser;
+#endif
+#if defined(CONFIG_MPAI_CONFIG_STORE)
+/* add a started AIM to the scheduler and the supervisor, according to its metadata */
+void _schedule_aim(aim_initialization_cb_t *aim_init_cb, const mpai_aim_metadata_t* aim_metadata);
+#endif
+#if defined(CONFIG_MPAI_CONFIG_OBSERVE)
+/* apply a configuration changed on MPAI Store Config */
+void _config_changed_callback(const char* prefix, const char* name);
+#endif
+#if defined(CONFIG_MPAI_CONFIG_STORE)
+/* synchronize the configurations with MPAI Store Config, once the AIW has been started */
+void _sync_config_store(bool aif_from_json);
+#endif
+#ifdef CONFIG_MPAI_ASYNC_BOOT
+void th_controller_sync(void *dummy1, void *dummy2, void *dummy3);
+
+K_THREAD_STACK_DEFINE(thread_controller_sync_stack_area, CONFIG_MPAI_ASYNC_BOOT_SYNC_STACK_SIZE);
+static struct k_thread thread_controller_sync;
+#endif
+#if defined(CONFIG_MPAI_CONFIG_STORE)
+/* check the ports of the AIW against the channels of the message store */
+void _check_channels_from_model(const mpai_aiw_model_t* model);
+
+/* apply the new configuration of a running AIM (called with controller_reload_mutex) */
+mpai_error_t _reload_aim(const char *name);
+
+/* metadata of the AIW, filled while it is loaded */
+static uint8_t aiw_model_arena_buffer[CONFIG_MPAI_METADATA_MODEL_ARENA_SIZE] __aligned(MEM_ARENA_ALIGN);
+static mpai_aiw_model_t aiw_model;
+/* the reloads are requested by the BLE service and by the configurations observed, from their threads:
+ * the model and the AIMs are changed by one of them at a time */
+K_MUTEX_DEFINE(controller_reload_mutex);
+#endif
+#ifdef CONFIG_MPAI_CONFIG_BINARY
+/* precompiled configuration, read in place while the AIMs are started */
+static uint8_t config_binary_buffer[CONFIG_MPAI_CONFIG_BINARY_MAX_SIZE];
+static mpai_metadata_binary_t config_binary;
+#endif
 
 /* AIM initialization List */
 aim_initialization_cb_t *MPAI_AIM_List[MPAI_AIF_AIM_MAX] = {};
@@ -36,6 +88,8 @@ message_store_map_element_t message_store_list[MPAI_AIF_AIW_MAX] = {};
 int mpai_controller_aim_count = 0;
 int mpai_message_store_channel_count = 0;
 int mpai_message_store_count = 0;
+/* names of the AIMs in MPAI_AIM_List, observed on MPAI Store Config */
+static const char *aim_names[MPAI_AIF_AIM_MAX];
 
 /*** START COAP ***/
 #ifdef CONFIG_COAP_SERVER
@@ -49,65 +103,10 @@ const char *const obs_path[] = {"obs", NULL};
 mpai_error_t MPAI_AIFU_Controller_Initialize()
 {
 
-#ifdef CONFIG_APP_TEST_WRITE_TO_FLASH
-	/*** START SPI FLASH ***/
-	const char expected[] = "{\"name\":\"Daniele\"}";
-	const size_t len = sizeof(expected);
-	char buf[sizeof(expected)];
-
-	const struct device *flash_dev = init_flash();
-
-	LOG_INF("Test 1: Flash erase\n");
-	erase_flash(flash_dev);
-
-	LOG_INF("Test 2: Flash write\n");
-	int rc_write = write_flash(flash_dev, len, (void *)expected);
-	if (rc_write != 0)
-	{
-		return;
-	}
-
-	int rc_read = read_flash(flash_dev, len, (void *)buf);
-	if (rc_read != 0)
-	{
-		return;
-	}
-	if (memcmp(expected, buf, len) == 0)
-	{
-		LOG_INF("Data read matches data written. Good!!\n");
-	}
-	else
-	{
-		const char *wp = expected;
-		const char *rp = buf;
-		const char *rpe = rp + len;
-
-		LOG_ERR("Data read does not match data written!!\n");
-		while (rp < rpe)
-		{
-			LOG_ERR("%08x wrote %02x read %02x %s\n",
-					(uint32_t)(FLASH_TEST_REGION_OFFSET + (rp - buf)),
-					*wp, *rp, (*rp == *wp) ? "match" : "MISMATCH");
-			++rp;
-			++wp;
-		}
-	}
-	LOG_INF("Hello, %s.", log_strdup(buf));
-	/*** END SPI FLASH ***/
-#endif
-
-	wifi_connect();
-
 #ifdef CONFIG_COAP_SERVER
 	/*** START COAP ***/
-	int r;
-
-	LOG_DBG("Start CoAP-client sample");
-	r = start_coap_client();
-	if (r < 0)
-	{
-		(void)close(get_coap_sock());
-	}
+	// the MPAI Config Store is connected only if a configuration is not cached
+	// r = MPAI_Config_Store_Connect();
 
 	// // /* GET, PUT, POST, DELETE */
 	// uint8_t* data_result = (uint8_t *)k_malloc(MAX_COAP_MSG_LEN * sizeof(uint8_t));
@@ -117,36 +116,82 @@ mpai_error_t MPAI_AIFU_Controller_Initialize()
 	// /* Block-wise transfer */
 	// char* data_large_result = get_large_coap_msgs(large_path);
 	// k_free(data_large_result);
-
-	/* Register observer, get notifications and unregister */
-	// r = register_observer();
-	// if (r < 0) {
-	// 	(void)close(get_coap_sock());
-	// }
 #endif
 
 	bool aif_ok = false;
+	bool aif_from_json = false;
+	for (size_t i = 0; i < mpai_controller_aim_count; i++)
+	{
+		aim_names[i] = MPAI_AIM_List[i]->_aim_name;
+	}
+#ifdef CONFIG_MPAI_ASYNC_BOOT
+	// the AIW is started from the cached or built in configurations: the store is synchronized in background
+	MPAI_Config_Store_Set_Local_First(true);
+#endif
+#ifdef CONFIG_MPAI_CONFIG_BINARY
+	BOOT_TRACE_BEGIN("config_binary");
+	int binary_size = MPAI_Config_Store_Get_Binary(MPAI_LIBS_AIF_NAME, config_binary_buffer, sizeof(config_binary_buffer));
+	if (MPAI_Metadata_Parser_Binary_Open(&config_binary, config_binary_buffer, binary_size > 0 ? binary_size : 0))
+	{
+		aif_ok = MPAI_Metadata_Parser_Binary_Parse_AIF(&config_binary);
+	}
+	if (!aif_ok)
+	{
+		LOG_WRN("Binary configuration not available (%d): using JSON", binary_size);
+		MPAI_Metadata_Parser_Binary_Close(&config_binary);
+	}
+	BOOT_TRACE_END("config_binary");
+#endif
 #if defined(CONFIG_MPAI_CONFIG_STORE) && defined(CONFIG_MPAI_CONFIG_STORE_USES_COAP)
-	char *aif_result = MPAI_Config_Store_Get_AIF(MPAI_LIBS_AIF_NAME);
-	aif_ok = MPAI_Metadata_Parser_Parse_AIF_JSON(aif_result);
+	if (!aif_ok)
+	{
+#ifndef CONFIG_MPAI_ASYNC_BOOT
+		// the AIF, the AIW and the AIMs not cached are downloaded at once, instead of in turn while parsing
+		MPAI_Config_Store_Prefetch(MPAI_LIBS_AIF_NAME, MPAI_LIBS_IOT_REV_AIW_NAME, aim_names, mpai_controller_aim_count);
+#endif
+
+		BOOT_TRACE_BEGIN("aif_get");
+		char *aif_result = MPAI_Config_Store_Get_AIF(MPAI_LIBS_AIF_NAME);
+		BOOT_TRACE_END("aif_get");
+		BOOT_TRACE_BEGIN("aif_parse");
+		aif_ok = MPAI_Metadata_Parser_Parse_AIF_JSON(aif_result);
+		BOOT_TRACE_END("aif_parse");
+		aif_from_json = aif_ok;
+	}
 #endif
 
 	if (aif_ok)
 	{
+		BOOT_TRACE_BEGIN("aiw_start");
 		mpai_error_t err_aiw = MPAI_AIFU_AIW_Start(MPAI_LIBS_IOT_REV_AIW_NAME, &aiw_id);
+		BOOT_TRACE_END("aiw_start");
 		if (err_aiw.code != MPAI_AIF_OK)
 		{
 			LOG_ERR("Error starting AIW %s: %s", MPAI_LIBS_IOT_REV_AIW_NAME, log_strdup(MPAI_ERR_STR(err_aiw.code)));
 			return;
 		}
 
-		LOG_INF("MPAI_AIF initialized correctly");
+		BOOT_TRACE_MARK("aiw_running");
+		LOG_INF("MPAI_AIF initialized correctly in %u ms from boot", k_uptime_get_32());
 	}
 
+#ifdef CONFIG_MPAI_ASYNC_BOOT
+	MPAI_Config_Store_Set_Local_First(false);
+	/* Wi-Fi and the store are waited for by this thread only */
+	k_thread_create(&thread_controller_sync, thread_controller_sync_stack_area,
+					K_THREAD_STACK_SIZEOF(thread_controller_sync_stack_area),
+					th_controller_sync, INT_TO_POINTER(aif_from_json), NULL, NULL,
+					CONFIG_MPAI_ASYNC_BOOT_SYNC_PRIORITY, 0, K_NO_WAIT);
+	k_thread_name_set(&thread_controller_sync, "thread_controller_sync");
+#elif defined(CONFIG_MPAI_CONFIG_STORE)
+	BOOT_TRACE_BEGIN("store_sync");
+	_sync_config_store(aif_from_json);
+	BOOT_TRACE_END("store_sync");
+#endif
 
-#if defined(CONFIG_MPAI_CONFIG_STORE) && defined(CONFIG_MPAI_CONFIG_STORE_USES_COAP)
-	/* Close the socket when it's no longer usefull*/
-	(void)close(get_coap_sock());
+#ifdef CONFIG_MPAI_TELEMETRY_SERVER
+	/* the state of the AIMs and channels is served on CoAP */
+	MPAI_Telemetry_Server_Start();
 #endif
 
 	// k_sleep(K_SECONDS(5));
@@ -176,6 +221,11 @@ mpai_error_t MPAI_AIFU_AIW_Start(const char *name, int *AIW_ID)
 	{
 		int aiw_id = MPAI_AIW_IOT_REV_Init();
 		*AIW_ID = aiw_id;
+		if (!_check_aim_controls())
+		{
+			MPAI_ERR_INIT(err, MPAI_ERROR);
+			return err;
+		}
 
 #if defined(CONFIG_MPAI_CONFIG_STORE)
 		mpai_error_t err_aiw = MPAI_Controller_Start_Loading_AIW_From_MPAI_Store(name, aiw_id);
@@ -194,6 +244,10 @@ mpai_error_t MPAI_AIFU_AIW_Pause(int AIW_ID)
 	// At the moment, we handle only AIW IOT-REV
 	if (AIW_ID == AIW_IOT_REV)
 	{
+#ifdef CONFIG_MPAI_AIM_SCHEDULER
+		// the windows must not resume the paused AIMs
+		MPAI_AIM_Scheduler_Stop();
+#endif
 		MPAI_AIW_IOT_REV_Pause();
 
 		MPAI_ERR_INIT(err, MPAI_AIF_OK);
@@ -212,6 +266,10 @@ mpai_error_t MPAI_AIFU_AIW_Resume(int AIW_ID)
 	if (AIW_ID == AIW_IOT_REV)
 	{
 		MPAI_AIW_IOT_REV_Resume();
+#ifdef CONFIG_MPAI_AIM_SCHEDULER
+		// pause again the AIMs outside of their windows
+		MPAI_AIM_Scheduler_Start();
+#endif
 
 		MPAI_ERR_INIT(err, MPAI_AIF_OK);
 		return err;
@@ -242,7 +300,7 @@ mpai_error_t MPAI_AIFU_AIW_Stop(int AIW_ID)
 
 mpai_error_t MPAI_AIFU_AIM_GetStatus(int AIW_ID, const char *name, int *status)
 {
-	aim_initialization_cb_t* aim_init = MPAI_AIFU_AIM_Find_AIM(name);
+	aim_initialization_cb_t* aim_init = MPAI_Controller_Find_AIM_Init_Config(name);
 	if (aim_init != NULL)
 	{
 		if (MPAI_AIM_Is_Alive(aim_init->_aim))
@@ -261,6 +319,26 @@ mpai_error_t MPAI_AIFU_AIM_GetStatus(int AIW_ID, const char *name, int *status)
 	return err;
 }
 
+mpai_error_t MPAI_AIFU_AIM_GetRestarts(int AIW_ID, const char *name, int *restarts)
+{
+#ifdef CONFIG_MPAI_AIM_SUPERVISOR
+	aim_initialization_cb_t* aim_init = MPAI_Controller_Find_AIM_Init_Config(name);
+	if (aim_init != NULL)
+	{
+		mpai_aim_supervisor_status_t supervisor_status;
+		mpai_error_t err_status = MPAI_AIM_Supervisor_Get_Status(aim_init->_aim, &supervisor_status);
+		if (err_status.code == MPAI_AIF_OK)
+		{
+			*restarts = supervisor_status._restarts;
+		}
+		return err_status;
+	}
+#endif
+
+	MPAI_ERR_INIT(err, MPAI_ERROR);
+	return err;
+}
+
 mpai_error_t MPAI_AIFM_AIM_Start(const char *name)
 {
 	aim_initialization_cb_t* aim_init = MPAI_Controller_Find_AIM_Init_Config(name);
@@ -280,6 +358,13 @@ mpai_error_t MPAI_AIFM_AIM_Stop(const char *name)
 		MPAI_ERR_INIT(err, MPAI_ERROR);
 		return err;
 	}
+#ifdef CONFIG_MPAI_AIM_SCHEDULER
+	MPAI_AIM_Scheduler_Remove(aim_init->_aim);
+#endif
+#ifdef CONFIG_MPAI_AIM_SUPERVISOR
+	// stopped on purpose: it must not be restarted
+	MPAI_AIM_Supervisor_Remove(aim_init->_aim);
+#endif
 	return MPAI_AIM_Stop(aim_init->_aim);
 }
 
@@ -308,18 +393,23 @@ mpai_error_t MPAI_AIFM_AIM_Resume(const char *name)
 #if defined(CONFIG_MPAI_CONFIG_STORE)
 mpai_error_t MPAI_Controller_Start_Loading_AIW_From_MPAI_Store(const char *name, int aiw_id)
 {
-	char *aiw_result = MPAI_Config_Store_Get_AIW(name);
-	// printk("AIW RESULT: \n");
-	// for ( size_t i = 0; i < strlen(aiw_result); i++ )
-	// {
-	// 	printk("%c", (char)aiw_result[i]);
-	// 	k_sleep(K_MSEC(5));
-	// }
-	// printk("\n");
+	bool aiw_ok;
+	MPAI_Metadata_Model_Init(&aiw_model, aiw_model_arena_buffer, sizeof(aiw_model_arena_buffer));
+#ifdef CONFIG_MPAI_CONFIG_BINARY
+	if (MPAI_Metadata_Parser_Binary_Is_Open(&config_binary))
+	{
+		aiw_ok = MPAI_Metadata_Parser_Binary_Parse_AIW(&config_binary, aiw_id, &aiw_model, _start_aim_after_parsing_callback, _update_input_channels_after_parsing_callback);
+	}
+	else
+#endif
+	{
+		aiw_ok = _load_aiw_json(name, aiw_id);
+	}
 
-	bool aiw_ok = MPAI_Metadata_Parser_Parse_AIW_JSON(aiw_result, aiw_id, _start_aim_after_parsing_callback, _update_input_channels_after_parsing_callback);
 	if (aiw_ok)
 	{
+		_check_channels_from_model(&aiw_model);
+
 		MPAI_ERR_INIT(err, MPAI_AIF_OK);
 		return err;
 	}
@@ -331,12 +421,82 @@ mpai_error_t MPAI_Controller_Start_Loading_AIW_From_MPAI_Store(const char *name,
 }
 #endif
 
+#if defined(CONFIG_MPAI_CONFIG_STORE)
+mpai_error_t MPAI_Controller_Reload_AIM(const char *name)
+{
+	k_mutex_lock(&controller_reload_mutex, K_FOREVER);
+	mpai_error_t err = _reload_aim(name);
+	k_mutex_unlock(&controller_reload_mutex);
+	return err;
+}
+
+mpai_error_t _reload_aim(const char *name)
+{
+	aim_initialization_cb_t *aim_init_cb = MPAI_Controller_Find_AIM_Init_Config(name);
+	mpai_metadata_aim_t *aim_model = MPAI_Metadata_Model_Find_AIM(&aiw_model, name);
+	if (aim_init_cb == NULL || aim_init_cb->_aim == NULL || aim_model == NULL)
+	{
+		LOG_WRN("AIM %s not running: nothing to reload", log_strdup(name));
+		MPAI_ERR_INIT(err, MPAI_ERROR);
+		return err;
+	}
+
+	// parsed aside: the AIM keeps running if the new configuration is not valid
+	mpai_metadata_aim_t reloaded_model = *aim_model;
+	char *aim_result = MPAI_Config_Store_Get_AIM(name);
+	bool aim_parse_ok = MPAI_Metadata_Parser_Parse_AIM_JSON(aim_result, &aiw_model, &reloaded_model);
+	k_free(aim_result);
+	if (!aim_parse_ok)
+	{
+		LOG_ERR("New configuration of AIM %s not valid: not applied", log_strdup(name));
+		MPAI_ERR_INIT(err, MPAI_ERROR);
+		return err;
+	}
+
+	LOG_INF("Reloading AIM %s...", log_strdup(name));
+	MPAI_AIFM_AIM_Stop(name);
+	*aim_model = reloaded_model;
+	aim_init_cb->_thread_config = aim_model->_metadata._thread_config;
+	MPAI_AIM_Set_Thread_Config(aim_init_cb->_aim, &aim_init_cb->_thread_config);
+	mpai_error_t err_aim = MPAI_AIM_Start(aim_init_cb->_aim);
+	if (err_aim.code == MPAI_AIF_OK)
+	{
+		_schedule_aim(aim_init_cb, &aim_model->_metadata);
+	}
+	return err_aim;
+}
+
+bool _load_aiw_json(const char *name, int aiw_id)
+{
+#ifdef CONFIG_MPAI_CONFIG_STORE_STREAMING
+	// parse each block as soon as it arrives: AIMs are started during the download
+	MPAI_Metadata_Parser_AIW_Stream_Init(&aiw_stream_parser, aiw_id, &aiw_model, _start_aim_after_parsing_callback, _update_input_channels_after_parsing_callback);
+	int ret = MPAI_Config_Store_Get_AIW_Chunks(name, _parse_aiw_chunk_callback, &aiw_stream_parser);
+	return MPAI_Metadata_Parser_AIW_Stream_End(&aiw_stream_parser) && ret == 0;
+#else
+	char *aiw_result = MPAI_Config_Store_Get_AIW(name);
+	// printk("AIW RESULT: \n");
+	// for ( size_t i = 0; i < strlen(aiw_result); i++ )
+	// {
+	// 	printk("%c", (char)aiw_result[i]);
+	// 	k_sleep(K_MSEC(5));
+	// }
+	// printk("\n");
+
+	return MPAI_Metadata_Parser_Parse_AIW_JSON(aiw_result, aiw_id, &aiw_model, _start_aim_after_parsing_callback, _update_input_channels_after_parsing_callback);
+#endif
+}
+#endif
+
 mpai_error_t MPAI_Controller_Start_Loading_AIM_From_Init_Config(int aiw_id, aim_initialization_cb_t *aim_init)
 {
 	// create AIM
 	MPAI_Component_AIM_t *aim = MPAI_AIM_Creator(aim_init->_aim_name, aiw_id, aim_init->_subscriber, aim_init->_start, aim_init->_stop, aim_init->_resume, aim_init->_pause);
 	// set AIM in init configuration
 	aim_init->_aim = aim;
+	// scheduling parameters used by the AIM creating its thread
+	MPAI_AIM_Set_Thread_Config(aim, &aim_init->_thread_config);
+	MPAI_AIM_Set_Control(aim, aim_init->_control);
 
 	// check if there are input channels configured
 	if (aim_init->_input_channels != NULL)
@@ -368,7 +528,8 @@ aim_initialization_cb_t *MPAI_Controller_Find_AIM_Init_Config(const char *name)
 	for (size_t i = 0; i < mpai_controller_aim_count; i++)
 	{
 		// verify aim name
-		if (strcmp(MPAI_AIM_Get_Component(MPAI_AIM_List[i]->_aim)->name, name) == 0 || strcmp(MPAI_AIM_List[i]->_aim_name, name) == 0)
+		// the AIM is created only when started
+		if ((MPAI_AIM_List[i]->_aim != NULL && strcmp(MPAI_AIM_Get_Component(MPAI_AIM_List[i]->_aim)->name, name) == 0) || strcmp(MPAI_AIM_List[i]->_aim_name, name) == 0)
 		{
 			return MPAI_AIM_List[i];
 		}
@@ -403,22 +564,70 @@ message_store_map_element_t _linear_search_message_store(int aiw_id)
 	return empty;
 }
 
+bool _check_aim_controls(void)
+{
+	bool unique = true;
+	for (size_t i = 0; i < mpai_controller_aim_count; i++)
+	{
+		for (size_t j = 0; j < i; j++)
+		{
+			// an AIM would be started, stopped and scheduled through the thread of another one
+			if (MPAI_AIM_List[i]->_control != NULL && MPAI_AIM_List[i]->_control == MPAI_AIM_List[j]->_control)
+			{
+				LOG_ERR("AIMs %s and %s share the same control block", log_strdup(MPAI_AIM_List[j]->_aim_name), log_strdup(MPAI_AIM_List[i]->_aim_name));
+				unique = false;
+			}
+		}
+	}
+	return unique;
+}
+
+#ifdef CONFIG_MPAI_CONFIG_STORE_STREAMING
+bool _parse_aiw_chunk_callback(const uint8_t* data, size_t len, void* user_data)
+{
+	return MPAI_Metadata_Parser_AIW_Stream_Feed((mpai_aiw_stream_parser_t*) user_data, (const char*) data, len);
+}
+#endif
+
 bool _start_aim_after_parsing_callback(const char * aim_name)
 {
 	aim_initialization_cb_t *aim_init_cb = MPAI_Controller_Find_AIM_Init_Config(aim_name);
-	if (aim_init_cb != NULL)
+	// the AIW description is the same for all the builds
+	if (aim_init_cb == NULL && MPAI_AIW_IOT_REV_Is_AIM_Disabled(aim_name))
+	{
+		LOG_INF("AIM %s disabled in the firmware: skipped", log_strdup(aim_name));
+		return true;
+	}
+	// the parser adds the AIM to the model before calling back
+	mpai_metadata_aim_t *aim_model = MPAI_Metadata_Model_Find_AIM(&aiw_model, aim_name);
+	if (aim_init_cb != NULL && aim_model != NULL)
 	{
 		LOG_INF("AIM %s found, now initializing...", log_strdup(aim_name));
-		char *aim_result = MPAI_Config_Store_Get_AIM(aim_name);
-		bool aim_parse_ok = MPAI_Metadata_Parser_Parse_AIM_JSON(aim_result);
+		bool aim_parse_ok;
+#ifdef CONFIG_MPAI_CONFIG_BINARY
+		if (MPAI_Metadata_Parser_Binary_Is_Open(&config_binary))
+		{
+			aim_parse_ok = MPAI_Metadata_Parser_Binary_Parse_AIM(&config_binary, aim_model);
+		}
+		else
+#endif
+		{
+			char *aim_result = MPAI_Config_Store_Get_AIM(aim_name);
+			aim_parse_ok = MPAI_Metadata_Parser_Parse_AIM_JSON(aim_result, &aiw_model, aim_model);
+			k_free(aim_result);
+		}
 		if (aim_parse_ok)
 		{
 			LOG_DBG("Calling AIM %s: success", log_strdup(aim_name));
+			const mpai_aim_metadata_t* aim_metadata = &aim_model->_metadata;
+			aim_init_cb->_metadata = aim_model;
+			aim_init_cb->_thread_config = aim_metadata->_thread_config;
 
 			// start AIM according with the aim_init configuration
 			mpai_error_t err_aim = MPAI_Controller_Start_Loading_AIM_From_Init_Config(aiw_id, aim_init_cb);
 			if (err_aim.code == MPAI_AIF_OK)
 			{
+				_schedule_aim(aim_init_cb, aim_metadata);
 				return true;
 			}
 			else
@@ -429,13 +638,95 @@ bool _start_aim_after_parsing_callback(const char * aim_name)
 				};
 			}
 		}
-		k_free(aim_result);
 	}
 	else
 	{
 		LOG_ERR("AIM %s not found", log_strdup(aim_name));
 	}
+	return false;
+}
+
+#if defined(CONFIG_MPAI_CONFIG_STORE)
+void _schedule_aim(aim_initialization_cb_t *aim_init_cb, const mpai_aim_metadata_t* aim_metadata)
+{
+#ifdef CONFIG_MPAI_AIM_SCHEDULER
+	if (aim_metadata->_duty_cycle._period_ms > 0)
+	{
+		MPAI_AIM_Scheduler_Add(aim_init_cb->_aim, &aim_metadata->_duty_cycle);
+	}
+#endif
+#ifdef CONFIG_MPAI_AIM_SUPERVISOR
+	if (aim_init_cb->_control != NULL)
+	{
+		MPAI_AIM_Supervisor_Add(aim_init_cb->_aim, &aim_metadata->_supervision);
+	}
+#endif
+}
+#endif
+
+#if defined(CONFIG_MPAI_CONFIG_STORE)
+void _sync_config_store(bool aif_from_json)
+{
+#if defined(CONFIG_MPAI_CONFIG_OBSERVE)
+	/* the store pushes the changes of the configurations: the socket stays open */
+	if (aif_from_json && MPAI_Config_Store_Observe(MPAI_LIBS_AIF_NAME, MPAI_LIBS_IOT_REV_AIW_NAME, aim_names, mpai_controller_aim_count, _config_changed_callback) == 0)
+	{
+		LOG_INF("Observing the configurations on MPAI Store");
+		return;
+	}
+#endif
+#if defined(CONFIG_MPAI_ASYNC_BOOT) && defined(CONFIG_MPAI_CONFIG_CACHE)
+	/* the configurations not cached yet (i.e. built in) are cached for the next boot */
+	MPAI_Config_Store_Prefetch(MPAI_LIBS_AIF_NAME, MPAI_LIBS_IOT_REV_AIW_NAME, aim_names, mpai_controller_aim_count);
+#endif
+#if defined(CONFIG_MPAI_CONFIG_CACHE_REVALIDATE)
+	/* the AIW runs with the cached configurations, checked in background: the socket is closed at the end */
+	MPAI_Config_Store_Revalidate();
+#else
+	/* Close the socket when it's no longer usefull*/
+	MPAI_Config_Store_Disconnect();
+#endif
 }
+#endif
+
+#ifdef CONFIG_MPAI_ASYNC_BOOT
+void th_controller_sync(void *dummy1, void *dummy2, void *dummy3)
+{
+	ARG_UNUSED(dummy2);
+	ARG_UNUSED(dummy3);
+
+	bool aif_from_json = POINTER_TO_INT(dummy1);
+	int64_t sync_start = k_uptime_get();
+	BOOT_TRACE_BEGIN("store_connect");
+	int ret = MPAI_Config_Store_Connect();
+	BOOT_TRACE_END("store_connect");
+	if (ret < 0)
+	{
+		// the observation and the revalidation connect again
+		LOG_WRN("MPAI Store not reachable: the AIW keeps its configurations");
+	}
+	else
+	{
+		LOG_INF("MPAI Store reached in %lld ms", k_uptime_get() - sync_start);
+	}
+	BOOT_TRACE_BEGIN("store_sync");
+	_sync_config_store(aif_from_json);
+	BOOT_TRACE_END("store_sync");
+}
+#endif
+
+#if defined(CONFIG_MPAI_CONFIG_OBSERVE)
+void _config_changed_callback(const char* prefix, const char* name)
+{
+	if (strcmp(prefix, AIM_CONFIG[0]) == 0)
+	{
+		MPAI_Controller_Reload_AIM(name);
+		return;
+	}
+	// the topology can't change while the AIW is running
+	LOG_WRN("Configuration %s%s changed: applied from the next boot", log_strdup(prefix), log_strdup(name));
+}
+#endif
 
 void _update_input_channels_after_parsing_callback(const char * aim_name, const char* output_port_name)
 {
@@ -445,6 +736,14 @@ void _update_input_channels_after_parsing_callback(const char * aim_name, const
 	{
 		// search aim_init to add the input ports
 		aim_initialization_cb_t *aim_init_cb = MPAI_Controller_Find_AIM_Init_Config(aim_name);
+		if (aim_init_cb == NULL)
+		{
+			if (!MPAI_AIW_IOT_REV_Is_AIM_Disabled(aim_name))
+			{
+				LOG_WRN("AIM %s of the topology not found", log_strdup(aim_name));
+			}
+			return;
+		}
 		if (aim_init_cb->_input_channels == NULL || sizeof(aim_init_cb->_input_channels) == 0)
 		{
 			aim_init_cb->_input_channels = (subscriber_channel_t *)k_malloc(sizeof(subscriber_channel_t));
@@ -462,4 +761,26 @@ void _update_input_channels_after_parsing_callback(const char * aim_name, const
 			aim_init_cb->_count_channels++;
 		}
 	}	
-}
\ No newline at end of file
+}
+
+#if defined(CONFIG_MPAI_CONFIG_STORE)
+void _check_channels_from_model(const mpai_aiw_model_t* model)
+{
+	for (int i = 0; i < model->_port_count; i++)
+	{
+		const mpai_metadata_port_t* port = &model->_ports[i];
+		channel_map_element_t channel_map_element = _linear_search_channel(port->_name);
+		if (channel_map_element._channel_name == NULL)
+		{
+			LOG_WRN("Port %s of the AIW has no channel in the message store", log_strdup(port->_name));
+			continue;
+		}
+		// records of the message store have a fixed size
+		if (port->_record_type == NULL || strcmp(port->_record_type->_type, "mpai_message_t") != 0)
+		{
+			LOG_WRN("Port %s: record type %s not supported by the message store", log_strdup(port->_name), log_strdup(port->_record_type_name));
+		}
+		LOG_DBG("Port %s: %d AIMs subscribed", log_strdup(port->_name), MPAI_Metadata_Model_Count_Readers(model, port));
+	}
+}
+#endif
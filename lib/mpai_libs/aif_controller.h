@@ -32,10 +32,6 @@
 #include <sys/byteorder.h>
 #include <aif_metadata_parser.h>
 
-#ifdef CONFIG_APP_TEST_WRITE_TO_FLASH
-	#include <flash_store.h>
-#endif
-
 #include <aiw_iot_rev.h>
 
 #ifdef CONFIG_COAP_SERVER
@@ -63,6 +59,9 @@ typedef struct _aim_initialization_cb_t{
 	module_t* _pause;		 				// AIM's pause function
 	subscriber_channel_t* _input_channels;	// AIM subscribes to these input channels
 	int8_t _count_channels;					// number of AIM's input channels
+	mpai_aim_thread_config_t _thread_config; // AIM's scheduling parameters, read from its metadata
+	mpai_aim_control_t* _control;			// AIM's thread control block (NULL if the AIM has no thread)
+	const mpai_metadata_aim_t* _metadata;	// AIM's metadata (NULL until parsed)
 } aim_initialization_cb_t;
 
 /* Tuple of channel and related channel_name */
@@ -143,6 +142,16 @@ mpai_error_t MPAI_AIFU_AIW_Stop(int AIW_ID);
  */
 mpai_error_t MPAI_AIFU_AIM_GetStatus(int AIW_ID, const char* name, int* status);
 
+/**
+ * @brief Get how many times the supervisor restarted an AIM of an AIW
+ * 
+ * @param AIW_ID 
+ * @param name 
+ * @param restarts 
+ * @return mpai_error_t MPAI_ERROR if the AIM is not found or not supervised
+ */
+mpai_error_t MPAI_AIFU_AIM_GetRestarts(int AIW_ID, const char* name, int* restarts);
+
 /**
  * @brief Starts an AIW by name
  * 
@@ -192,6 +201,15 @@ mpai_error_t MPAI_Controller_Start_Loading_AIM_From_Init_Config(int aiw_id, aim_
  * @return mpai_error_t 
  */
 mpai_error_t MPAI_Controller_Start_Loading_AIW_From_MPAI_Store(const char *name, int aiw_id);
+
+/**
+ * @brief Apply the new configuration of a running AIM, restarting it: if it is not valid,
+ * the AIM keeps running with the previous one
+ * 
+ * @param name 
+ * @return mpai_error_t 
+ */
+mpai_error_t MPAI_Controller_Reload_AIM(const char *name);
 #endif
 
 /**
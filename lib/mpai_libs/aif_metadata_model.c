@@ -0,0 +1,288 @@
+/*
+ * @file
+ * @brief Implementation of the typed model of the AIW/AIM metadata
+ *
+ * Copyright (c) 2022 University of Turin, Daniele Bortoluzzi <danieleb88@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "aif_metadata_model.h"
+
+LOG_MODULE_REGISTER(MPAI_LIBS_AIF_METADATA_MODEL, LOG_LEVEL_INF);
+
+/************* PRIVATE HEADER *************/
+/* string kept by the model: equal strings are shared, NULL if the arena is exhausted */
+const char* _model_string(mpai_aiw_model_t* me, const char* value);
+/* search a string already kept by the model */
+const char* _model_find_string(const mpai_aiw_model_t* me, const char* value);
+const mpai_metadata_type_t* _model_find_type(const mpai_aiw_model_t* me, const char* name);
+
+/************* PUBLIC **************/
+void MPAI_Metadata_Model_Init(mpai_aiw_model_t* me, void* arena_buffer, size_t arena_size)
+{
+	memset(me, 0, sizeof(mpai_aiw_model_t));
+	mem_arena_init(&me->_arena, arena_buffer, arena_size);
+	me->_title = "";
+}
+
+void MPAI_Metadata_Model_Set_Strings_In_Place(mpai_aiw_model_t* me, bool in_place)
+{
+	me->_strings_in_place = in_place;
+}
+
+bool MPAI_Metadata_Model_Set_Title(mpai_aiw_model_t* me, const char* title)
+{
+	const char* model_title = _model_string(me, title);
+	if (model_title == NULL)
+	{
+		return false;
+	}
+	me->_title = model_title;
+	return true;
+}
+
+mpai_metadata_type_t* MPAI_Metadata_Model_Add_Type(mpai_aiw_model_t* me, const char* name, const char* type)
+{
+	if (me->_type_count >= MPAI_METADATA_MODEL_TYPES_MAX)
+	{
+		LOG_ERR("Too many types (max %d): %s ignored", MPAI_METADATA_MODEL_TYPES_MAX, log_strdup(name));
+		return NULL;
+	}
+	mpai_metadata_type_t* model_type = &me->_types[me->_type_count];
+	model_type->_name = _model_string(me, name);
+	model_type->_type = _model_string(me, type);
+	if (model_type->_name == NULL || model_type->_type == NULL)
+	{
+		return NULL;
+	}
+	me->_type_count++;
+	return model_type;
+}
+
+mpai_metadata_port_t* MPAI_Metadata_Model_Add_Port(mpai_aiw_model_t* me, mpai_metadata_aim_t* aim, const char* name, MPAI_METADATA_PORT_DIRECTION direction, const char* record_type_name, bool is_remote)
+{
+	uint8_t* port_count = aim != NULL ? &aim->_port_count : &me->_port_count;
+	int port_max = aim != NULL ? MPAI_METADATA_MODEL_AIM_PORTS_MAX : MPAI_METADATA_MODEL_PORTS_MAX;
+	if (*port_count >= port_max)
+	{
+		LOG_ERR("Too many ports (max %d): %s ignored", port_max, log_strdup(name));
+		return NULL;
+	}
+	mpai_metadata_port_t* port = aim != NULL ? &aim->_ports[*port_count] : &me->_ports[*port_count];
+	port->_name = _model_string(me, name);
+	port->_direction = direction;
+	port->_record_type_name = _model_string(me, record_type_name);
+	port->_record_type = NULL;
+	port->_is_remote = is_remote;
+	if (port->_name == NULL || port->_record_type_name == NULL)
+	{
+		return NULL;
+	}
+	(*port_count)++;
+	return port;
+}
+
+mpai_metadata_edge_t* MPAI_Metadata_Model_Add_Edge(mpai_aiw_model_t* me, const char* output_aim_name, const char* output_port_name, const char* input_aim_name, const char* input_port_name)
+{
+	if (me->_edge_count >= MPAI_METADATA_MODEL_EDGES_MAX)
+	{
+		LOG_ERR("Too many edges in the topology (max %d)", MPAI_METADATA_MODEL_EDGES_MAX);
+		return NULL;
+	}
+	mpai_metadata_edge_t* edge = &me->_edges[me->_edge_count];
+	memset(edge, 0, sizeof(mpai_metadata_edge_t));
+	edge->_output_aim_name = _model_string(me, output_aim_name);
+	edge->_output_port_name = _model_string(me, output_port_name);
+	edge->_input_aim_name = _model_string(me, input_aim_name);
+	edge->_input_port_name = _model_string(me, input_port_name);
+	if (edge->_output_aim_name == NULL || edge->_output_port_name == NULL || edge->_input_aim_name == NULL || edge->_input_port_name == NULL)
+	{
+		return NULL;
+	}
+	me->_edge_count++;
+	return edge;
+}
+
+mpai_metadata_aim_t* MPAI_Metadata_Model_Add_AIM(mpai_aiw_model_t* me, const char* name)
+{
+	if (me->_aim_count >= MPAI_METADATA_MODEL_AIMS_MAX)
+	{
+		LOG_ERR("Too many AIMs (max %d): %s ignored", MPAI_METADATA_MODEL_AIMS_MAX, log_strdup(name));
+		return NULL;
+	}
+	mpai_metadata_aim_t* aim = &me->_aims[me->_aim_count];
+	memset(aim, 0, sizeof(mpai_metadata_aim_t));
+	aim->_name = _model_string(me, name);
+	if (aim->_name == NULL)
+	{
+		return NULL;
+	}
+	// by default the AIM is always active, with the default scheduling parameters
+	MPAI_AIM_Control_Default_Thread_Config(&aim->_metadata._thread_config);
+#ifdef CONFIG_MPAI_AIM_SUPERVISOR
+	MPAI_AIM_Supervisor_Default_Supervision(&aim->_metadata._supervision);
+#endif
+	me->_aim_count++;
+	return aim;
+}
+
+void MPAI_Metadata_Model_Link(mpai_aiw_model_t* me)
+{
+	for (int i = 0; i < me->_port_count; i++)
+	{
+		me->_ports[i]._record_type = _model_find_type(me, me->_ports[i]._record_type_name);
+		if (me->_ports[i]._record_type == NULL)
+		{
+			LOG_WRN("Port %s: record type %s not found", log_strdup(me->_ports[i]._name), log_strdup(me->_ports[i]._record_type_name));
+		}
+	}
+	for (int i = 0; i < me->_aim_count; i++)
+	{
+		for (int j = 0; j < me->_aims[i]._port_count; j++)
+		{
+			me->_aims[i]._ports[j]._record_type = _model_find_type(me, me->_aims[i]._ports[j]._record_type_name);
+		}
+	}
+	for (int i = 0; i < me->_edge_count; i++)
+	{
+		mpai_metadata_edge_t* edge = &me->_edges[i];
+		edge->_port = MPAI_Metadata_Model_Find_Port(me, edge->_output_port_name);
+		edge->_output_aim = MPAI_Metadata_Model_Find_AIM(me, edge->_output_aim_name);
+		edge->_input_aim = MPAI_Metadata_Model_Find_AIM(me, edge->_input_aim_name);
+	}
+}
+
+mpai_metadata_aim_t* MPAI_Metadata_Model_Find_AIM(mpai_aiw_model_t* me, const char* name)
+{
+	for (int i = 0; i < me->_aim_count; i++)
+	{
+		if (strcmp(me->_aims[i]._name, name) == 0)
+		{
+			return &me->_aims[i];
+		}
+	}
+	return NULL;
+}
+
+const mpai_metadata_port_t* MPAI_Metadata_Model_Find_Port(const mpai_aiw_model_t* me, const char* name)
+{
+	for (int i = 0; i < me->_port_count; i++)
+	{
+		if (strcmp(me->_ports[i]._name, name) == 0)
+		{
+			return &me->_ports[i];
+		}
+	}
+	return NULL;
+}
+
+int MPAI_Metadata_Model_Count_Readers(const mpai_aiw_model_t* me, const mpai_metadata_port_t* port)
+{
+	int readers = 0;
+	for (int i = 0; i < me->_edge_count; i++)
+	{
+		if (me->_edges[i]._port == port && me->_edges[i]._output_aim_name[0] != '\0')
+		{
+			readers++;
+		}
+	}
+	return readers;
+}
+
+bool MPAI_Metadata_Model_Parse_Direction(const char* direction, MPAI_METADATA_PORT_DIRECTION* result)
+{
+	if (strcmp(direction, "Input") == 0)
+	{
+		*result = MPAI_METADATA_PORT_INPUT;
+	}
+	else if (strcmp(direction, "Output") == 0)
+	{
+		*result = MPAI_METADATA_PORT_OUTPUT;
+	}
+	else if (strcmp(direction, "InputOutput") == 0)
+	{
+		*result = MPAI_METADATA_PORT_INPUT_OUTPUT;
+	}
+	else
+	{
+		return false;
+	}
+	return true;
+}
+
+/************* PRIVATE IMPLEMENTATION *************/
+const char* _model_string(mpai_aiw_model_t* me, const char* value)
+{
+	if (me->_strings_in_place)
+	{
+		return value;
+	}
+	const char* model_value = _model_find_string(me, value);
+	if (model_value != NULL)
+	{
+		return model_value;
+	}
+	char* copy = mem_arena_alloc(&me->_arena, strlen(value) + 1);
+	if (copy == NULL)
+	{
+		LOG_ERR("Metadata model larger than its arena: increase CONFIG_MPAI_METADATA_MODEL_ARENA_SIZE");
+		return NULL;
+	}
+	strcpy(copy, value);
+	return copy;
+}
+
+const char* _model_find_string(const mpai_aiw_model_t* me, const char* value)
+{
+	// names are repeated among types, ports, edges and AIMs
+	for (int i = 0; i < me->_type_count; i++)
+	{
+		if (strcmp(me->_types[i]._name, value) == 0)
+		{
+			return me->_types[i]._name;
+		}
+		if (strcmp(me->_types[i]._type, value) == 0)
+		{
+			return me->_types[i]._type;
+		}
+	}
+	for (int i = 0; i < me->_port_count; i++)
+	{
+		if (strcmp(me->_ports[i]._name, value) == 0)
+		{
+			return me->_ports[i]._name;
+		}
+	}
+	for (int i = 0; i < me->_aim_count; i++)
+	{
+		if (strcmp(me->_aims[i]._name, value) == 0)
+		{
+			return me->_aims[i]._name;
+		}
+	}
+	for (int i = 0; i < me->_edge_count; i++)
+	{
+		const char* edge_names[] = { me->_edges[i]._output_aim_name, me->_edges[i]._output_port_name, me->_edges[i]._input_aim_name, me->_edges[i]._input_port_name };
+		for (int j = 0; j < ARRAY_SIZE(edge_names); j++)
+		{
+			if (strcmp(edge_names[j], value) == 0)
+			{
+				return edge_names[j];
+			}
+		}
+	}
+	return NULL;
+}
+
+const mpai_metadata_type_t* _model_find_type(const mpai_aiw_model_t* me, const char* name)
+{
+	for (int i = 0; i < me->_type_count; i++)
+	{
+		if (strcmp(me->_types[i]._name, name) == 0)
+		{
+			return &me->_types[i];
+		}
+	}
+	return NULL;
+}
@@ -0,0 +1,215 @@
+/*
+ * @file
+ * @brief Headers of the typed model of the AIW/AIM metadata
+ *
+ * The model is filled by the metadata parsers (JSON or binary) and read by the
+ * controller. Tables have a fixed size; strings are copied in an arena released
+ * with the model, unless they outlive it (i.e. read in place from the binary configuration).
+ *
+ * Copyright (c) 2022 University of Turin, Daniele Bortoluzzi <danieleb88@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef MPAI_AIF_METADATA_MODEL_H
+#define MPAI_AIF_METADATA_MODEL_H
+
+#include <core_common.h>
+#include <aim_scheduler.h>
+#include <aim_control.h>
+#include <aim_supervisor.h>
+#include <mem_arena.h>
+
+#define MPAI_METADATA_MODEL_TYPES_MAX 8
+#define MPAI_METADATA_MODEL_PORTS_MAX 10
+#define MPAI_METADATA_MODEL_EDGES_MAX 12
+#define MPAI_METADATA_MODEL_AIMS_MAX 10
+#define MPAI_METADATA_MODEL_AIM_PORTS_MAX 4
+
+typedef enum
+{
+	MPAI_METADATA_PORT_INPUT,
+	MPAI_METADATA_PORT_OUTPUT,
+	MPAI_METADATA_PORT_INPUT_OUTPUT
+} MPAI_METADATA_PORT_DIRECTION;
+
+/* Optional properties of the AIM metadata used to run the AIM */
+typedef struct _mpai_aim_metadata_t
+{
+	mpai_aim_duty_cycle_t _duty_cycle;			// "DutyCycle"
+	mpai_aim_thread_config_t _thread_config;	// "Scheduling"
+	mpai_aim_supervision_t _supervision;		// "Supervision"
+} mpai_aim_metadata_t;
+
+/* Element of "Types" */
+typedef struct _mpai_metadata_type_t
+{
+	const char* _name;
+	const char* _type;							// type of the implementation (i.e. mpai_message_t)
+} mpai_metadata_type_t;
+
+/* Element of "Ports" */
+typedef struct _mpai_metadata_port_t
+{
+	const char* _name;
+	MPAI_METADATA_PORT_DIRECTION _direction;
+	const char* _record_type_name;
+	const mpai_metadata_type_t* _record_type;	// NULL if not in "Types" of the AIW
+	bool _is_remote;
+} mpai_metadata_port_t;
+
+/* AIM of "SubAIMs", with its own metadata */
+typedef struct _mpai_metadata_aim_t
+{
+	const char* _name;
+	bool _metadata_loaded;						// false until the metadata of the AIM are parsed
+	mpai_aim_metadata_t _metadata;
+	mpai_metadata_port_t _ports[MPAI_METADATA_MODEL_AIM_PORTS_MAX];
+	uint8_t _port_count;
+} mpai_metadata_aim_t;
+
+/* Element of "Topology": the "Output" AIM subscribes to the channel of its port, where the
+ * "Input" AIM publishes ("" is the AIW itself) */
+typedef struct _mpai_metadata_edge_t
+{
+	const char* _output_aim_name;
+	const char* _output_port_name;
+	const char* _input_aim_name;
+	const char* _input_port_name;
+	const mpai_metadata_port_t* _port;			// port of the AIW of the "Output", NULL if not found
+	const mpai_metadata_aim_t* _output_aim;		// NULL for the AIW itself or an AIM not in "SubAIMs"
+	const mpai_metadata_aim_t* _input_aim;
+} mpai_metadata_edge_t;
+
+/* Metadata of an AIW */
+typedef struct _mpai_aiw_model_t
+{
+	const char* _title;
+	mpai_metadata_type_t _types[MPAI_METADATA_MODEL_TYPES_MAX];
+	uint8_t _type_count;
+	mpai_metadata_port_t _ports[MPAI_METADATA_MODEL_PORTS_MAX];
+	uint8_t _port_count;
+	mpai_metadata_edge_t _edges[MPAI_METADATA_MODEL_EDGES_MAX];
+	uint8_t _edge_count;
+	mpai_metadata_aim_t _aims[MPAI_METADATA_MODEL_AIMS_MAX];
+	uint8_t _aim_count;
+	mem_arena_t _arena;							// copies of the strings
+	bool _strings_in_place;
+} mpai_aiw_model_t;
+
+/**
+ * @brief Initialize an empty model
+ *
+ * @param me
+ * @param arena_buffer where the strings are copied (aligned to MEM_ARENA_ALIGN)
+ * @param arena_size
+ */
+void MPAI_Metadata_Model_Init(mpai_aiw_model_t* me, void* arena_buffer, size_t arena_size);
+
+/**
+ * @brief Don't copy the strings added from now on, since they outlive the model
+ *
+ * @param me
+ * @param in_place
+ */
+void MPAI_Metadata_Model_Set_Strings_In_Place(mpai_aiw_model_t* me, bool in_place);
+
+/**
+ * @brief Set the title of the AIW
+ *
+ * @param me
+ * @param title
+ * @return true
+ * @return false if the arena is exhausted
+ */
+bool MPAI_Metadata_Model_Set_Title(mpai_aiw_model_t* me, const char* title);
+
+/**
+ * @brief Add an element of "Types"
+ *
+ * @param me
+ * @param name
+ * @param type
+ * @return mpai_metadata_type_t* NULL if the model is full
+ */
+mpai_metadata_type_t* MPAI_Metadata_Model_Add_Type(mpai_aiw_model_t* me, const char* name, const char* type);
+
+/**
+ * @brief Add a port of the AIW, or of an AIM
+ *
+ * @param me
+ * @param aim NULL for the ports of the AIW
+ * @param name
+ * @param direction
+ * @param record_type_name
+ * @param is_remote
+ * @return mpai_metadata_port_t* NULL if the model is full
+ */
+mpai_metadata_port_t* MPAI_Metadata_Model_Add_Port(mpai_aiw_model_t* me, mpai_metadata_aim_t* aim, const char* name, MPAI_METADATA_PORT_DIRECTION direction, const char* record_type_name, bool is_remote);
+
+/**
+ * @brief Add an element of "Topology"
+ *
+ * @param me
+ * @param output_aim_name
+ * @param output_port_name
+ * @param input_aim_name
+ * @param input_port_name
+ * @return mpai_metadata_edge_t* NULL if the model is full
+ */
+mpai_metadata_edge_t* MPAI_Metadata_Model_Add_Edge(mpai_aiw_model_t* me, const char* output_aim_name, const char* output_port_name, const char* input_aim_name, const char* input_port_name);
+
+/**
+ * @brief Add an AIM of "SubAIMs", with the default metadata
+ *
+ * @param me
+ * @param name
+ * @return mpai_metadata_aim_t* NULL if the model is full
+ */
+mpai_metadata_aim_t* MPAI_Metadata_Model_Add_AIM(mpai_aiw_model_t* me, const char* name);
+
+/**
+ * @brief Resolve the references among types, ports, edges and AIMs: to be called after adding them
+ *
+ * @param me
+ */
+void MPAI_Metadata_Model_Link(mpai_aiw_model_t* me);
+
+/**
+ * @brief Search an AIM by name
+ *
+ * @param me
+ * @param name
+ * @return mpai_metadata_aim_t* NULL if not found
+ */
+mpai_metadata_aim_t* MPAI_Metadata_Model_Find_AIM(mpai_aiw_model_t* me, const char* name);
+
+/**
+ * @brief Search a port of the AIW by name
+ *
+ * @param me
+ * @param name
+ * @return const mpai_metadata_port_t* NULL if not found
+ */
+const mpai_metadata_port_t* MPAI_Metadata_Model_Find_Port(const mpai_aiw_model_t* me, const char* name);
+
+/**
+ * @brief Count the AIMs subscribed to a port of the AIW (edges with an "Output" AIM)
+ *
+ * @param me
+ * @param port
+ * @return int
+ */
+int MPAI_Metadata_Model_Count_Readers(const mpai_aiw_model_t* me, const mpai_metadata_port_t* port);
+
+/**
+ * @brief Convert the "Direction" of a port
+ *
+ * @param direction "Input", "Output" or "InputOutput"
+ * @param result
+ * @return true
+ * @return false if not valid
+ */
+bool MPAI_Metadata_Model_Parse_Direction(const char* direction, MPAI_METADATA_PORT_DIRECTION* result);
+
+#endif
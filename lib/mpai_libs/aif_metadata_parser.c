@@ -10,39 +10,113 @@
 
 #include "aif_metadata_parser.h"
 
+#include <sys/byteorder.h>
+#include <sys/crc.h>
+#include <mem_arena.h>
+
 LOG_MODULE_REGISTER(MPAI_LIBS_AIF_METADATA_PARSER, LOG_LEVEL_INF);
 
+/* layout of the binary configuration: see tools/mpai_config_compiler.py */
+#define BINARY_MAGIC "MPAI"
+#define BINARY_VERSION_OFFSET 4
+#define BINARY_HEADER_SIZE_OFFSET 6
+#define BINARY_SIZE_OFFSET 8
+#define BINARY_CRC_OFFSET 12
+#define BINARY_AIF_TITLE_OFFSET 16
+#define BINARY_AIW_TITLE_OFFSET 18
+#define BINARY_TYPES_OFFSET 20
+#define BINARY_PORTS_OFFSET 24
+#define BINARY_TOPOLOGY_OFFSET 28
+#define BINARY_AIMS_OFFSET 32
+#define BINARY_STRINGS_OFFSET 36
+/* each table has its offset, followed by the count of its entries */
+#define BINARY_COUNT(offset) ((offset) + 2)
+#define BINARY_TYPE_ENTRY_SIZE 4
+#define BINARY_PORT_ENTRY_SIZE 6
+#define BINARY_TOPOLOGY_ENTRY_SIZE 8
+#define BINARY_AIM_ENTRY_SIZE 44
+
+/* properties found in the json of an AIM entry */
+#define BINARY_AIM_DUTY_CYCLE BIT(0)
+#define BINARY_AIM_PRIORITY BIT(1)
+#define BINARY_AIM_STACK_SIZE BIT(2)
+#define BINARY_AIM_DEADLINE BIT(3)
+#define BINARY_AIM_BUDGET BIT(4)
+#define BINARY_AIM_HEARTBEAT_TIMEOUT BIT(5)
+#define BINARY_AIM_LATENCY_SLA BIT(6)
+#define BINARY_AIM_MAX_RESTARTS BIT(7)
+
+/************* PRIVATE HEADER *************/
+/* handle the tokens of the AIW metadata */
+bool _aiw_stream_parser_event(JSON_STREAM_EVENT event, const char* value, int depth, void* user_data);
+/* check the key of a level of the current path */
+bool _aiw_stream_parser_key_is(mpai_aiw_stream_parser_t* me, int depth, const char* key);
+/* add an element of "Types", "Ports" or "Topology" when it's complete */
+void _aiw_stream_parser_end_item(mpai_aiw_stream_parser_t* me);
+void _aiw_stream_parser_add_aim(mpai_aiw_stream_parser_t* me, const char* aim_name);
+/* check that a string kept by the model was not truncated by the tokenizer: false stops the parsing */
+bool _aiw_stream_parser_value_whole(mpai_aiw_stream_parser_t* me, const char* value);
+/* pass the AIMs of the model not yet started to the callback, if the "Topology" is complete (and the document valid) */
+void _aiw_stream_parser_start_aims(mpai_aiw_stream_parser_t* me);
+/* read the "Ports" of the AIM metadata */
+bool _parse_aim_ports(cJSON* ports_cjson, mpai_aiw_model_t* model, mpai_metadata_aim_t* aim);
+/* string at an offset of the binary configuration: NULL if outside of the string table */
+const char* _binary_string(const mpai_metadata_binary_t* me, uint16_t offset);
+/* first entry of a table of the binary configuration, and the count of its entries */
+const uint8_t* _binary_table(const mpai_metadata_binary_t* me, size_t table_offset, uint16_t* count);
+/* check that a table of the binary configuration is before the string table */
+bool _binary_table_is_valid(const uint8_t* blob, size_t table_offset, size_t entry_size);
+/* parse a JSON document with all its nodes in the arena: release it with _metadata_parser_json_release */
+cJSON* _metadata_parser_json_parse(const char* document);
+/* release a document and all its nodes at once */
+void _metadata_parser_json_release(cJSON* root);
+void* _metadata_parser_arena_malloc(size_t size);
+void _metadata_parser_arena_free(void* ptr);
+
+/* cJSON nodes of the document being parsed: one document at a time */
+static uint8_t metadata_arena_buffer[CONFIG_MPAI_METADATA_PARSER_ARENA_SIZE] __aligned(MEM_ARENA_ALIGN);
+static mem_arena_t metadata_arena = MEM_ARENA_INITIALIZER(metadata_arena_buffer, sizeof(metadata_arena_buffer));
+static cJSON_Hooks metadata_arena_hooks = { .malloc_fn = _metadata_parser_arena_malloc, .free_fn = _metadata_parser_arena_free };
+
+K_MUTEX_DEFINE(metadata_arena_mutex);
+
+/* used parsing the AIW metadata as a whole */
+static mpai_aiw_stream_parser_t aiw_parser;
+
+/************* PUBLIC **************/
+
 bool MPAI_Metadata_Parser_Parse_AIF_JSON(const char *aif_result)
 {
 	if (aif_result != NULL)
 	{
-		// TODO: validate according with JSON schema
+#if defined(CONFIG_MPAI_METADATA_SCHEMA_VALIDATION)
+		if (!MPAI_Metadata_Schema_Validate(&MPAI_METADATA_SCHEMA_AIF, aif_result, strlen(aif_result)))
+		{
+			k_free(aif_result);
+			return false;
+		}
+#endif
 
 		// Parse AIF Json Metadata
-		cJSON *root_aif = cJSON_Parse(aif_result);
-		if (root_aif != NULL)
-		{
-			// read aif
-			cJSON *aif_name_cjson = cJSON_GetObjectItem(root_aif, "title");
-			if (aif_name_cjson != NULL)
-			{
-				char *aif_name = aif_name_cjson->valuestring;
-				LOG_INF("Initializing AIF with title \"%s\"...", log_strdup(aif_name));
-			} 
-			else 
-			{
-				return false;
-			}
-			free(aif_name_cjson);
-		} 
-		else 
+		cJSON *root_aif = _metadata_parser_json_parse(aif_result);
+		k_free(aif_result);
+		if (root_aif == NULL)
 		{
 			return false;
 		}
-		free(root_aif);
-		k_free(aif_result);
 
-		return true;
+		// read aif: nodes are owned by the root, released with it
+		bool aif_ok = false;
+		cJSON *aif_name_cjson = cJSON_GetObjectItem(root_aif, "title");
+		if (cJSON_IsString(aif_name_cjson))
+		{
+			char *aif_name = aif_name_cjson->valuestring;
+			LOG_INF("Initializing AIF with title \"%s\"...", log_strdup(aif_name));
+			aif_ok = true;
+		}
+		_metadata_parser_json_release(root_aif);
+
+		return aif_ok;
 	}
 	else 
 	{
@@ -50,108 +124,694 @@ bool MPAI_Metadata_Parser_Parse_AIF_JSON(const char *aif_result)
 	}
 }
 
-bool MPAI_Metadata_Parser_Parse_AIW_JSON(const char *aiw_result, int aiw_id, aim_callback_t aim_callback, topology_output_callback_t topology_output_callback)
+bool MPAI_Metadata_Parser_Parse_AIW_JSON(const char *aiw_result, int aiw_id, mpai_aiw_model_t* model, aim_callback_t aim_callback, topology_output_callback_t topology_output_callback)
+{
+	if (aiw_result == NULL)
+	{
+		return false;
+	}
+
+	// the whole document is a single chunk
+	MPAI_Metadata_Parser_AIW_Stream_Init(&aiw_parser, aiw_id, model, aim_callback, topology_output_callback);
+	bool aiw_ok = MPAI_Metadata_Parser_AIW_Stream_Feed(&aiw_parser, aiw_result, strlen(aiw_result));
+	return MPAI_Metadata_Parser_AIW_Stream_End(&aiw_parser) && aiw_ok;
+}
+
+void MPAI_Metadata_Parser_AIW_Stream_Init(mpai_aiw_stream_parser_t* me, int aiw_id, mpai_aiw_model_t* model, aim_callback_t aim_callback, topology_output_callback_t topology_output_callback)
+{
+	memset(me, 0, sizeof(mpai_aiw_stream_parser_t));
+	json_stream_init(&me->_json, _aiw_stream_parser_event, me);
+	MPAI_Metadata_Schema_Validator_Init(&me->_validator, &MPAI_METADATA_SCHEMA_AIW_AIM);
+	me->_aiw_id = aiw_id;
+	me->_model = model;
+	me->_aim_callback = aim_callback;
+	me->_topology_output_callback = topology_output_callback;
+	me->_aiw_ok = true;
+}
+
+bool MPAI_Metadata_Parser_AIW_Stream_Feed(mpai_aiw_stream_parser_t* me, const char* data, size_t len)
+{
+	int ret = json_stream_feed(&me->_json, data, len);
+	if (ret != 0)
+	{
+		LOG_ERR("Invalid AIW metadata: %d", ret);
+		return false;
+	}
+	return true;
+}
+
+bool MPAI_Metadata_Parser_AIW_Stream_End(mpai_aiw_stream_parser_t* me)
+{
+	int ret = json_stream_end(&me->_json);
+	if (ret != 0)
+	{
+		LOG_ERR("Invalid AIW metadata: %d", ret);
+		return false;
+	}
+	// AIW without "Topology": the AIMs are linked before starting them
+	MPAI_Metadata_Model_Link(me->_model);
+	me->_topology_done = true;
+	_aiw_stream_parser_start_aims(me);
+
+#if defined(CONFIG_MPAI_METADATA_SCHEMA_VALIDATION)
+	if (!MPAI_Metadata_Schema_Validator_Is_Valid(&me->_validator))
+	{
+		return false;
+	}
+#endif
+	return me->_title_found && me->_subaims_found && me->_aiw_ok;
+}
+
+bool MPAI_Metadata_Parser_Parse_AIM_JSON(const char *aim_result, mpai_aiw_model_t* model, mpai_metadata_aim_t* aim)
 {
+	if (aim_result == NULL)
+	{
+		return false;
+	}
+#if defined(CONFIG_MPAI_METADATA_SCHEMA_VALIDATION)
+	if (!MPAI_Metadata_Schema_Validate(&MPAI_METADATA_SCHEMA_AIW_AIM, aim_result, strlen(aim_result)))
+	{
+		return false;
+	}
+#endif
+
+	// by default the AIM is always active, with the default scheduling parameters
+	mpai_aim_metadata_t* aim_metadata = &aim->_metadata;
+	memset(&aim_metadata->_duty_cycle, 0, sizeof(mpai_aim_duty_cycle_t));
+	MPAI_AIM_Control_Default_Thread_Config(&aim_metadata->_thread_config);
+#ifdef CONFIG_MPAI_AIM_SUPERVISOR
+	MPAI_AIM_Supervisor_Default_Supervision(&aim_metadata->_supervision);
+#endif
+	aim->_port_count = 0;
+
+	cJSON *root = _metadata_parser_json_parse(aim_result);
+	if (root == NULL)
+	{
+		return false;
+	}
+
+	// the document must describe the requested AIM
+	cJSON *identifier_cjson = cJSON_GetObjectItem(root, "Identifier");
+	cJSON *specification_cjson = cJSON_GetObjectItem(identifier_cjson, "Specification");
+	cJSON *aim_name_cjson = cJSON_GetObjectItem(specification_cjson, "AIM");
+	if (!cJSON_IsString(aim_name_cjson) || strcmp(aim_name_cjson->valuestring, aim->_name) != 0)
+	{
+		LOG_ERR("Metadata of AIM %s not valid: Identifier/Specification/AIM is missing or different", log_strdup(aim->_name));
+		_metadata_parser_json_release(root);
+		return false;
+	}
+
+	// read optional ports
+	cJSON *ports_cjson = cJSON_GetObjectItem(root, "Ports");
+	if (ports_cjson != NULL && !_parse_aim_ports(ports_cjson, model, aim))
+	{
+		_metadata_parser_json_release(root);
+		return false;
+	}
+
+	// read optional duty cycle
+	cJSON *duty_cycle_cjson = cJSON_GetObjectItem(root, "DutyCycle");
+	if (duty_cycle_cjson != NULL)
+	{
+		cJSON *period_cjson = cJSON_GetObjectItem(duty_cycle_cjson, "Period");
+		cJSON *active_window_cjson = cJSON_GetObjectItem(duty_cycle_cjson, "ActiveWindow");
+		cJSON *phase_cjson = cJSON_GetObjectItem(duty_cycle_cjson, "Phase");
+		if (cJSON_IsNumber(period_cjson) && cJSON_IsNumber(active_window_cjson))
+		{
+			aim_metadata->_duty_cycle._period_ms = period_cjson->valueint;
+			aim_metadata->_duty_cycle._active_ms = active_window_cjson->valueint;
+			aim_metadata->_duty_cycle._phase_ms = cJSON_IsNumber(phase_cjson) ? phase_cjson->valueint : 0;
+		}
+		else
+		{
+			LOG_WRN("DutyCycle without Period or ActiveWindow: ignored");
+		}
+	}
+
+	// read optional scheduling parameters: each one is optional
+	cJSON *scheduling_cjson = cJSON_GetObjectItem(root, "Scheduling");
+	if (scheduling_cjson != NULL)
+	{
+		cJSON *priority_cjson = cJSON_GetObjectItem(scheduling_cjson, "Priority");
+		cJSON *stack_size_cjson = cJSON_GetObjectItem(scheduling_cjson, "StackSize");
+		cJSON *deadline_cjson = cJSON_GetObjectItem(scheduling_cjson, "Deadline");
+		cJSON *budget_cjson = cJSON_GetObjectItem(scheduling_cjson, "Budget");
+		if (cJSON_IsNumber(priority_cjson))
+		{
+			aim_metadata->_thread_config._priority = priority_cjson->valueint;
+		}
+		if (cJSON_IsNumber(stack_size_cjson))
+		{
+			aim_metadata->_thread_config._stack_size = stack_size_cjson->valueint;
+		}
+		if (cJSON_IsNumber(deadline_cjson))
+		{
+			aim_metadata->_thread_config._deadline_ms = deadline_cjson->valueint;
+		}
+		if (cJSON_IsNumber(budget_cjson))
+		{
+			aim_metadata->_thread_config._budget_ms = budget_cjson->valueint;
+		}
+	}
+
+	// read optional supervision parameters: each one is optional
+	cJSON *supervision_cjson = cJSON_GetObjectItem(root, "Supervision");
+	if (supervision_cjson != NULL)
+	{
+		cJSON *heartbeat_timeout_cjson = cJSON_GetObjectItem(supervision_cjson, "HeartbeatTimeout");
+		cJSON *latency_sla_cjson = cJSON_GetObjectItem(supervision_cjson, "LatencySLA");
+		cJSON *max_restarts_cjson = cJSON_GetObjectItem(supervision_cjson, "MaxRestarts");
+		if (cJSON_IsNumber(heartbeat_timeout_cjson))
+		{
+			aim_metadata->_supervision._heartbeat_timeout_ms = heartbeat_timeout_cjson->valueint;
+		}
+		if (cJSON_IsNumber(latency_sla_cjson))
+		{
+			aim_metadata->_supervision._latency_sla_ms = latency_sla_cjson->valueint;
+		}
+		if (cJSON_IsNumber(max_restarts_cjson))
+		{
+			aim_metadata->_supervision._max_restarts = max_restarts_cjson->valueint;
+		}
+	}
+
+	_metadata_parser_json_release(root);
+	// record types of the ports of the AIM
+	MPAI_Metadata_Model_Link(model);
+	aim->_metadata_loaded = true;
+	return true;
+}
+
+size_t MPAI_Metadata_Parser_Get_Arena_Peak()
+{
+	return mem_arena_get_peak(&metadata_arena);
+}
+
+bool MPAI_Metadata_Parser_Binary_Open(mpai_metadata_binary_t* me, const uint8_t* blob, size_t size)
+{
+	MPAI_Metadata_Parser_Binary_Close(me);
+
+	if (blob == NULL || size < MPAI_METADATA_PARSER_BINARY_HEADER_SIZE || memcmp(blob, BINARY_MAGIC, strlen(BINARY_MAGIC)) != 0)
+	{
+		LOG_WRN("Binary configuration not found");
+		return false;
+	}
+	uint16_t version = sys_get_le16(&blob[BINARY_VERSION_OFFSET]);
+	if (version != MPAI_METADATA_PARSER_BINARY_VERSION)
+	{
+		LOG_WRN("Binary configuration version %u not supported", version);
+		return false;
+	}
+	if (sys_get_le16(&blob[BINARY_HEADER_SIZE_OFFSET]) < MPAI_METADATA_PARSER_BINARY_HEADER_SIZE || sys_get_le32(&blob[BINARY_SIZE_OFFSET]) != size)
+	{
+		LOG_WRN("Binary configuration truncated");
+		return false;
+	}
+	if (crc32_ieee(&blob[BINARY_AIF_TITLE_OFFSET], size - BINARY_AIF_TITLE_OFFSET) != sys_get_le32(&blob[BINARY_CRC_OFFSET]))
+	{
+		LOG_WRN("Binary configuration corrupted");
+		return false;
+	}
+
+	// tables must be inside the blob, before the strings, and the last string must be terminated
+	if (!_binary_table_is_valid(blob, BINARY_TYPES_OFFSET, BINARY_TYPE_ENTRY_SIZE) || !_binary_table_is_valid(blob, BINARY_PORTS_OFFSET, BINARY_PORT_ENTRY_SIZE)
+		|| !_binary_table_is_valid(blob, BINARY_TOPOLOGY_OFFSET, BINARY_TOPOLOGY_ENTRY_SIZE) || !_binary_table_is_valid(blob, BINARY_AIMS_OFFSET, BINARY_AIM_ENTRY_SIZE)
+		|| sys_get_le16(&blob[BINARY_STRINGS_OFFSET]) >= size || blob[size - 1] != '\0')
+	{
+		LOG_WRN("Binary configuration malformed");
+		return false;
+	}
+
+	me->_blob = blob;
+	me->_size = size;
+	return true;
+}
+
+bool MPAI_Metadata_Parser_Binary_Is_Open(const mpai_metadata_binary_t* me)
+{
+	return me->_blob != NULL;
+}
+
+void MPAI_Metadata_Parser_Binary_Close(mpai_metadata_binary_t* me)
+{
+	me->_blob = NULL;
+	me->_size = 0;
+}
+
+bool MPAI_Metadata_Parser_Binary_Parse_AIF(const mpai_metadata_binary_t* me)
+{
+	const char* aif_name = _binary_string(me, sys_get_le16(&me->_blob[BINARY_AIF_TITLE_OFFSET]));
+	if (aif_name == NULL)
+	{
+		return false;
+	}
+	LOG_INF("Initializing AIF with title \"%s\"...", log_strdup(aif_name));
+	return true;
+}
+
+bool MPAI_Metadata_Parser_Binary_Parse_AIW(const mpai_metadata_binary_t* me, int aiw_id, mpai_aiw_model_t* model, aim_callback_t aim_callback, topology_output_callback_t topology_output_callback)
+{
+	// strings are read in place: the blob outlives the model
+	MPAI_Metadata_Model_Set_Strings_In_Place(model, true);
+
+	const char* aiw_name = _binary_string(me, sys_get_le16(&me->_blob[BINARY_AIW_TITLE_OFFSET]));
+	if (aiw_name == NULL)
+	{
+		return false;
+	}
+	LOG_INF("Initializing AIW with title \"%s\"...", log_strdup(aiw_name));
+	MPAI_Metadata_Model_Set_Title(model, aiw_name);
+
+	uint16_t types_count;
+	const uint8_t* types = _binary_table(me, BINARY_TYPES_OFFSET, &types_count);
+	for (uint16_t i = 0; i < types_count; i++)
+	{
+		const uint8_t* entry = &types[i * BINARY_TYPE_ENTRY_SIZE];
+		const char* name = _binary_string(me, sys_get_le16(&entry[0]));
+		const char* type = _binary_string(me, sys_get_le16(&entry[2]));
+		if (name == NULL || type == NULL || MPAI_Metadata_Model_Add_Type(model, name, type) == NULL)
+		{
+			return false;
+		}
+	}
+
+	uint16_t ports_count;
+	const uint8_t* ports = _binary_table(me, BINARY_PORTS_OFFSET, &ports_count);
+	for (uint16_t i = 0; i < ports_count; i++)
+	{
+		const uint8_t* entry = &ports[i * BINARY_PORT_ENTRY_SIZE];
+		const char* name = _binary_string(me, sys_get_le16(&entry[0]));
+		const char* record_type_name = _binary_string(me, sys_get_le16(&entry[2]));
+		if (name == NULL || record_type_name == NULL || entry[4] > MPAI_METADATA_PORT_INPUT_OUTPUT
+			|| MPAI_Metadata_Model_Add_Port(model, NULL, name, (MPAI_METADATA_PORT_DIRECTION) entry[4], record_type_name, entry[5] != 0) == NULL)
+		{
+			return false;
+		}
+	}
+
+	// read input channel by aim: all of them are known before starting the AIMs
+	uint16_t topology_count;
+	const uint8_t* topology = _binary_table(me, BINARY_TOPOLOGY_OFFSET, &topology_count);
+	for (uint16_t i = 0; i < topology_count; i++)
+	{
+		const uint8_t* entry = &topology[i * BINARY_TOPOLOGY_ENTRY_SIZE];
+		const char* output_aim_name = _binary_string(me, sys_get_le16(&entry[0]));
+		const char* output_port_name = _binary_string(me, sys_get_le16(&entry[2]));
+		const char* input_aim_name = _binary_string(me, sys_get_le16(&entry[4]));
+		const char* input_port_name = _binary_string(me, sys_get_le16(&entry[6]));
+		if (output_aim_name == NULL || output_port_name == NULL || input_aim_name == NULL || input_port_name == NULL
+			|| MPAI_Metadata_Model_Add_Edge(model, output_aim_name, output_port_name, input_aim_name, input_port_name) == NULL)
+		{
+			return false;
+		}
+		topology_output_callback(output_aim_name, output_port_name);
+	}
+
+	uint16_t aims_count;
+	const uint8_t* aims = _binary_table(me, BINARY_AIMS_OFFSET, &aims_count);
+	for (uint16_t i = 0; i < aims_count; i++)
+	{
+		const char* aim_name = _binary_string(me, sys_get_le16(&aims[i * BINARY_AIM_ENTRY_SIZE]));
+		if (aim_name == NULL || MPAI_Metadata_Model_Add_AIM(model, aim_name) == NULL)
+		{
+			return false;
+		}
+	}
+	MPAI_Metadata_Model_Link(model);
+
 	bool aiw_ok = true;
-	cJSON *root = cJSON_Parse(aiw_result);
-	if (root != NULL)
+	for (int i = 0; i < model->_aim_count; i++)
 	{
-		// TODO: validate according with JSON schema
+		aiw_ok = aim_callback(model->_aims[i]._name) && aiw_ok;
+	}
+	return aiw_ok;
+}
 
-		// read aiw
-		cJSON *aiw_name_cjson = cJSON_GetObjectItem(root, "title");
-		if (aiw_name_cjson != NULL)
+bool MPAI_Metadata_Parser_Binary_Parse_AIM(const mpai_metadata_binary_t* me, mpai_metadata_aim_t* aim)
+{
+	mpai_aim_metadata_t* aim_metadata = &aim->_metadata;
+	uint16_t aims_count;
+	const uint8_t* aims = _binary_table(me, BINARY_AIMS_OFFSET, &aims_count);
+	for (uint16_t i = 0; i < aims_count; i++)
+	{
+		const uint8_t* entry = &aims[i * BINARY_AIM_ENTRY_SIZE];
+		const char* entry_name = _binary_string(me, sys_get_le16(&entry[0]));
+		if (entry_name == NULL || strcmp(entry_name, aim->_name) != 0)
 		{
-			bool aiw_init_ok = true;
-			char *aiw_name = aiw_name_cjson->valuestring;
-			LOG_INF("Initializing AIW with title \"%s\"...", log_strdup(aiw_name));
+			continue;
+		}
 
-			// read aiw topology
-			cJSON *aiw_topology_cjson = cJSON_GetObjectItem(root, "Topology");
-			if (aiw_topology_cjson != NULL)
+		// same defaults of the AIM json
+		memset(&aim_metadata->_duty_cycle, 0, sizeof(mpai_aim_duty_cycle_t));
+		MPAI_AIM_Control_Default_Thread_Config(&aim_metadata->_thread_config);
+#ifdef CONFIG_MPAI_AIM_SUPERVISOR
+		MPAI_AIM_Supervisor_Default_Supervision(&aim_metadata->_supervision);
+#endif
+
+		uint16_t flags = sys_get_le16(&entry[2]);
+		if (flags & BINARY_AIM_DUTY_CYCLE)
+		{
+			aim_metadata->_duty_cycle._period_ms = sys_get_le32(&entry[4]);
+			aim_metadata->_duty_cycle._active_ms = sys_get_le32(&entry[8]);
+			aim_metadata->_duty_cycle._phase_ms = sys_get_le32(&entry[12]);
+		}
+		if (flags & BINARY_AIM_PRIORITY)
+		{
+			aim_metadata->_thread_config._priority = (int32_t) sys_get_le32(&entry[16]);
+		}
+		if (flags & BINARY_AIM_STACK_SIZE)
+		{
+			aim_metadata->_thread_config._stack_size = sys_get_le32(&entry[20]);
+		}
+		if (flags & BINARY_AIM_DEADLINE)
+		{
+			aim_metadata->_thread_config._deadline_ms = sys_get_le32(&entry[24]);
+		}
+		if (flags & BINARY_AIM_BUDGET)
+		{
+			aim_metadata->_thread_config._budget_ms = sys_get_le32(&entry[28]);
+		}
+		if (flags & BINARY_AIM_HEARTBEAT_TIMEOUT)
+		{
+			aim_metadata->_supervision._heartbeat_timeout_ms = sys_get_le32(&entry[32]);
+		}
+		if (flags & BINARY_AIM_LATENCY_SLA)
+		{
+			aim_metadata->_supervision._latency_sla_ms = sys_get_le32(&entry[36]);
+		}
+		if (flags & BINARY_AIM_MAX_RESTARTS)
+		{
+			aim_metadata->_supervision._max_restarts = sys_get_le32(&entry[40]);
+		}
+		aim->_metadata_loaded = true;
+		return true;
+	}
+	LOG_ERR("AIM %s not found in the binary configuration", log_strdup(aim->_name));
+	return false;
+}
+
+/************* PRIVATE IMPLEMENTATION *************/
+bool _aiw_stream_parser_event(JSON_STREAM_EVENT event, const char* value, int depth, void* user_data)
+{
+	mpai_aiw_stream_parser_t* me = (mpai_aiw_stream_parser_t*) user_data;
+
+#if defined(CONFIG_MPAI_METADATA_SCHEMA_VALIDATION)
+	if (!MPAI_Metadata_Schema_Validator_Event(&me->_validator, event, value, depth))
+	{
+		me->_aiw_ok = false;
+		return false;
+	}
+#endif
+
+	switch (event)
+	{
+	case JSON_STREAM_KEY:
+		if (depth <= MPAI_METADATA_PARSER_PATH_DEPTH)
+		{
+			strcpy(me->_keys[depth], value);
+		}
+		break;
+	case JSON_STREAM_OBJECT_START:
+	case JSON_STREAM_ARRAY_START:
+		// members of arrays have no key
+		if (depth < MPAI_METADATA_PARSER_PATH_DEPTH)
+		{
+			me->_keys[depth + 1][0] = '\0';
+		}
+		// new element of "Types", "Ports" or "Topology"
+		if (event == JSON_STREAM_OBJECT_START && depth == 2)
+		{
+			me->_item_name[0] = '\0';
+			me->_item_type[0] = '\0';
+			me->_item_direction[0] = '\0';
+			me->_item_is_remote = false;
+			me->_output_aim_name[0] = '\0';
+			me->_output_port_name[0] = '\0';
+			me->_input_aim_name[0] = '\0';
+			me->_input_port_name[0] = '\0';
+		}
+		if (event == JSON_STREAM_ARRAY_START && depth == 1 && _aiw_stream_parser_key_is(me, 1, "SubAIMs"))
+		{
+			me->_subaims_found = true;
+		}
+		break;
+	case JSON_STREAM_OBJECT_END:
+		// read input channel by aim (the json describe input channel match to output channel)
+		if (depth == 3 && _aiw_stream_parser_key_is(me, 1, "Topology") && _aiw_stream_parser_key_is(me, 3, "Output"))
+		{
+			me->_topology_output_callback(me->_output_aim_name, me->_output_port_name);
+		}
+		if (depth == 2)
+		{
+			_aiw_stream_parser_end_item(me);
+		}
+		break;
+	case JSON_STREAM_ARRAY_END:
+		if (depth == 1 && _aiw_stream_parser_key_is(me, 1, "Topology"))
+		{
+			// the input channels are known: the AIMs can be started
+			MPAI_Metadata_Model_Link(me->_model);
+			me->_topology_done = true;
+			_aiw_stream_parser_start_aims(me);
+		}
+		break;
+	case JSON_STREAM_STRING:
+		if (depth == 1 && _aiw_stream_parser_key_is(me, 1, "title"))
+		{
+			if (!_aiw_stream_parser_value_whole(me, value))
 			{
-				if (cJSON_Array == aiw_topology_cjson->type)
+				return false;
+			}
+			me->_title_found = true;
+			LOG_INF("Initializing AIW with title \"%s\"...", log_strdup(value));
+			me->_aiw_ok = MPAI_Metadata_Model_Set_Title(me->_model, value) && me->_aiw_ok;
+		}
+		else if (depth == 3 && (_aiw_stream_parser_key_is(me, 1, "Types") || _aiw_stream_parser_key_is(me, 1, "Ports")))
+		{
+			char* field = NULL;
+			if (_aiw_stream_parser_key_is(me, 3, "Name"))
+			{
+				field = me->_item_name;
+			}
+			else if (_aiw_stream_parser_key_is(me, 3, "Type") || _aiw_stream_parser_key_is(me, 3, "RecordType"))
+			{
+				field = me->_item_type;
+			}
+			else if (_aiw_stream_parser_key_is(me, 3, "Direction"))
+			{
+				field = me->_item_direction;
+			}
+			if (field != NULL)
+			{
+				if (!_aiw_stream_parser_value_whole(me, value))
 				{
-					int aiw_topology_el_count = cJSON_GetArraySize(aiw_topology_cjson);
-					// read each topology element topology
-					for (int idx = 0; idx < aiw_topology_el_count; idx++)
-					{
-						cJSON *aiw_topology_el_cjson = cJSON_GetArrayItem(aiw_topology_cjson, idx);
-						// read input channel by aim (the json describe input channel match to output channel)
-						cJSON *aiw_topology_output_cjson = cJSON_GetObjectItem(aiw_topology_el_cjson, "Output");
-						if (aiw_topology_output_cjson != NULL)
-						{
-
-							cJSON *aiw_output_aim_name_cjson = cJSON_GetObjectItem(aiw_topology_output_cjson, "AIMName");
-							cJSON *aiw_output_channel_cjson = cJSON_GetObjectItem(aiw_topology_output_cjson, "PortName");
-
-							const char* aim_name = aiw_output_aim_name_cjson->valuestring;
-							const char* output_port_name = aiw_output_channel_cjson->valuestring;
-
-							topology_output_callback(aim_name, output_port_name);
-
-							free(aiw_output_aim_name_cjson);
-							free(aiw_output_channel_cjson);
-						}
-						free(aiw_topology_output_cjson);
-						free(aiw_topology_el_cjson);
-					}
+					return false;
 				}
+				strcpy(field, value);
 			}
-
-			// read AIMs of AIW
-			cJSON *aiw_subaims_cjson = cJSON_GetObjectItem(root, "SubAIMs");
-			if (cJSON_Array == aiw_subaims_cjson->type)
+		}
+		else if (depth == 4 && _aiw_stream_parser_key_is(me, 1, "Topology") && (_aiw_stream_parser_key_is(me, 3, "Output") || _aiw_stream_parser_key_is(me, 3, "Input")))
+		{
+			bool output = _aiw_stream_parser_key_is(me, 3, "Output");
+			char* field = NULL;
+			if (_aiw_stream_parser_key_is(me, 4, "AIMName"))
 			{
-				int aims_count = cJSON_GetArraySize(aiw_subaims_cjson);
-				// loop on AIMs
-				for (int idx = 0; idx < aims_count; idx++)
+				field = output ? me->_output_aim_name : me->_input_aim_name;
+			}
+			else if (_aiw_stream_parser_key_is(me, 4, "PortName"))
+			{
+				field = output ? me->_output_port_name : me->_input_port_name;
+			}
+			if (field != NULL)
+			{
+				if (!_aiw_stream_parser_value_whole(me, value))
 				{
-					bool aim_init_ok = false;
-					cJSON *aim_cjson = cJSON_GetArrayItem(aiw_subaims_cjson, idx);
-					cJSON *aim_identifier_cjson = cJSON_GetObjectItem(aim_cjson, "Identifier");
-					if (aim_identifier_cjson != NULL)
-					{
-						cJSON *aim_specification_cjson = cJSON_GetObjectItem(aim_identifier_cjson, "Specification");
-						if (aim_identifier_cjson != NULL)
-						{
-							cJSON *aim_name_cjson = cJSON_GetObjectItem(aim_specification_cjson, "AIM");
-							char *aim_name = aim_name_cjson->valuestring;
-
-							aim_init_ok = aim_callback(aim_name);
-							free(aim_name_cjson);
-						}
-						free(aim_specification_cjson);
-					}
-					free(aim_identifier_cjson);
-					aiw_init_ok = aiw_init_ok & aim_init_ok;
+					return false;
 				}
+				strcpy(field, value);
 			}
-			else
+		}
+		else if (depth == 5 && _aiw_stream_parser_key_is(me, 1, "SubAIMs") && _aiw_stream_parser_key_is(me, 3, "Identifier")
+			&& _aiw_stream_parser_key_is(me, 4, "Specification") && _aiw_stream_parser_key_is(me, 5, "AIM"))
+		{
+			if (!_aiw_stream_parser_value_whole(me, value))
 			{
-				aiw_init_ok = false;
+				return false;
 			}
+			_aiw_stream_parser_add_aim(me, value);
+		}
+		break;
+	case JSON_STREAM_TRUE:
+		if (depth == 3 && _aiw_stream_parser_key_is(me, 1, "Ports") && _aiw_stream_parser_key_is(me, 3, "IsRemote"))
+		{
+			me->_item_is_remote = true;
+		}
+		break;
+	default:
+		break;
+	}
+	return true;
+}
+
+bool _aiw_stream_parser_key_is(mpai_aiw_stream_parser_t* me, int depth, const char* key)
+{
+	return strcmp(me->_keys[depth], key) == 0;
+}
 
-			free(aiw_name_cjson);
-			free(aiw_topology_cjson);
-			free(root);
-			aiw_ok = aiw_ok && aiw_init_ok;
+void _aiw_stream_parser_end_item(mpai_aiw_stream_parser_t* me)
+{
+	if (_aiw_stream_parser_key_is(me, 1, "Types"))
+	{
+		me->_aiw_ok = MPAI_Metadata_Model_Add_Type(me->_model, me->_item_name, me->_item_type) != NULL && me->_aiw_ok;
+	}
+	else if (_aiw_stream_parser_key_is(me, 1, "Ports"))
+	{
+		MPAI_METADATA_PORT_DIRECTION direction;
+		if (!MPAI_Metadata_Model_Parse_Direction(me->_item_direction, &direction))
+		{
+			LOG_ERR("Port %s: direction \"%s\" not valid", log_strdup(me->_item_name), log_strdup(me->_item_direction));
+			me->_aiw_ok = false;
+			return;
 		}
-		else 
+		me->_aiw_ok = MPAI_Metadata_Model_Add_Port(me->_model, NULL, me->_item_name, direction, me->_item_type, me->_item_is_remote) != NULL && me->_aiw_ok;
+	}
+	else if (_aiw_stream_parser_key_is(me, 1, "Topology"))
+	{
+		me->_aiw_ok = MPAI_Metadata_Model_Add_Edge(me->_model, me->_output_aim_name, me->_output_port_name, me->_input_aim_name, me->_input_port_name) != NULL && me->_aiw_ok;
+	}
+}
+
+bool _aiw_stream_parser_value_whole(mpai_aiw_stream_parser_t* me, const char* value)
+{
+	if (json_stream_token_truncated(&me->_json))
+	{
+		LOG_ERR("Value \"%s...\" longer than %d chars", log_strdup(value), JSON_STREAM_MAX_TOKEN_LEN - 1);
+		me->_aiw_ok = false;
+		return false;
+	}
+	return true;
+}
+
+void _aiw_stream_parser_add_aim(mpai_aiw_stream_parser_t* me, const char* aim_name)
+{
+	if (MPAI_Metadata_Model_Add_AIM(me->_model, aim_name) == NULL)
+	{
+		me->_aiw_ok = false;
+		return;
+	}
+	// "SubAIMs" before "Topology": the AIM waits for its input channels
+	_aiw_stream_parser_start_aims(me);
+}
+
+void _aiw_stream_parser_start_aims(mpai_aiw_stream_parser_t* me)
+{
+	if (!me->_topology_done)
+	{
+		return;
+	}
+#if defined(CONFIG_MPAI_METADATA_SCHEMA_VALIDATION)
+	// no AIM is started before the whole document is valid
+	if (!MPAI_Metadata_Schema_Validator_Is_Valid(&me->_validator))
+	{
+		return;
+	}
+#endif
+	for (; me->_started_aims < me->_model->_aim_count; me->_started_aims++)
+	{
+		me->_aiw_ok = me->_aim_callback(me->_model->_aims[me->_started_aims]._name) && me->_aiw_ok;
+	}
+}
+
+bool _parse_aim_ports(cJSON* ports_cjson, mpai_aiw_model_t* model, mpai_metadata_aim_t* aim)
+{
+	if (!cJSON_IsArray(ports_cjson))
+	{
+		LOG_ERR("Ports of AIM %s is not an array", log_strdup(aim->_name));
+		return false;
+	}
+	cJSON *port_cjson = NULL;
+	cJSON_ArrayForEach(port_cjson, ports_cjson)
+	{
+		cJSON *name_cjson = cJSON_GetObjectItem(port_cjson, "Name");
+		cJSON *direction_cjson = cJSON_GetObjectItem(port_cjson, "Direction");
+		cJSON *record_type_cjson = cJSON_GetObjectItem(port_cjson, "RecordType");
+		MPAI_METADATA_PORT_DIRECTION direction;
+		if (!cJSON_IsString(name_cjson) || !cJSON_IsString(direction_cjson) || !cJSON_IsString(record_type_cjson)
+			|| !MPAI_Metadata_Model_Parse_Direction(direction_cjson->valuestring, &direction))
 		{
-			aiw_ok = false;
+			LOG_ERR("Port of AIM %s without a valid Name, Direction or RecordType", log_strdup(aim->_name));
+			return false;
+		}
+		if (MPAI_Metadata_Model_Add_Port(model, aim, name_cjson->valuestring, direction, record_type_cjson->valuestring,
+			cJSON_IsTrue(cJSON_GetObjectItem(port_cjson, "IsRemote"))) == NULL)
+		{
+			return false;
 		}
 	}
-	else
+	return true;
+}
+
+const char* _binary_string(const mpai_metadata_binary_t* me, uint16_t offset)
+{
+	// the blob ends with a NUL, so any string of the table is terminated
+	if (offset < sys_get_le16(&me->_blob[BINARY_STRINGS_OFFSET]) || offset >= me->_size)
 	{
-		aiw_ok = false;
+		return NULL;
 	}
-	return aiw_ok;
+	return (const char*) &me->_blob[offset];
+}
+
+cJSON* _metadata_parser_json_parse(const char* document)
+{
+	k_mutex_lock(&metadata_arena_mutex, K_FOREVER);
+	mem_arena_reset(&metadata_arena);
+	// hooks are global: they are installed only while the arena is owned
+	cJSON_InitHooks(&metadata_arena_hooks);
+
+	cJSON* root = cJSON_Parse(document);
+	if (root == NULL)
+	{
+		if (mem_arena_is_exhausted(&metadata_arena))
+		{
+			LOG_ERR("Metadata larger than the arena of %zu bytes: increase CONFIG_MPAI_METADATA_PARSER_ARENA_SIZE", sizeof(metadata_arena_buffer));
+		}
+		_metadata_parser_json_release(NULL);
+	}
+	return root;
+}
+
+void _metadata_parser_json_release(cJSON* root)
+{
+	if (root != NULL)
+	{
+		LOG_DBG("Metadata parsed in %zu bytes of the arena (peak %zu of %zu)", mem_arena_get_used(&metadata_arena),
+			mem_arena_get_peak(&metadata_arena), sizeof(metadata_arena_buffer));
+	}
+	// nodes are not freed one by one: cJSON_Delete is not needed
+	mem_arena_reset(&metadata_arena);
+	cJSON_InitHooks(NULL);
+	k_mutex_unlock(&metadata_arena_mutex);
 }
 
-// TODO: at the moment, we only check the AIM exists
-bool MPAI_Metadata_Parser_Parse_AIM_JSON(const char *aim_result)
+void* _metadata_parser_arena_malloc(size_t size)
 {
-	// TODO: validate according with JSON schema
-	return aim_result != NULL;
-}
\ No newline at end of file
+	return mem_arena_alloc(&metadata_arena, size);
+}
+
+void _metadata_parser_arena_free(void* ptr)
+{
+	// released with the whole arena
+	ARG_UNUSED(ptr);
+}
+
+const uint8_t* _binary_table(const mpai_metadata_binary_t* me, size_t table_offset, uint16_t* count)
+{
+	*count = sys_get_le16(&me->_blob[BINARY_COUNT(table_offset)]);
+	return &me->_blob[sys_get_le16(&me->_blob[table_offset])];
+}
+
+bool _binary_table_is_valid(const uint8_t* blob, size_t table_offset, size_t entry_size)
+{
+	size_t table_end = sys_get_le16(&blob[table_offset]) + sys_get_le16(&blob[BINARY_COUNT(table_offset)]) * entry_size;
+	return sys_get_le16(&blob[table_offset]) >= MPAI_METADATA_PARSER_BINARY_HEADER_SIZE && table_end <= sys_get_le16(&blob[BINARY_STRINGS_OFFSET]);
+}
@@ -13,6 +13,50 @@
 
 #include <core_common.h>
 #include <cJSON.h>
+#include <aim_scheduler.h>
+#include <aim_control.h>
+#include <aim_supervisor.h>
+#include <json_stream.h>
+#include <aif_metadata_model.h>
+#include <aif_metadata_schema.h>
+
+/* depth of the AIW metadata paths used by the stream parser (SubAIMs/Identifier/Specification/AIM) */
+#define MPAI_METADATA_PARSER_PATH_DEPTH 6
+/* version of the binary configuration compiled by tools/mpai_config_compiler.py */
+#define MPAI_METADATA_PARSER_BINARY_VERSION 2
+#define MPAI_METADATA_PARSER_BINARY_HEADER_SIZE 40
+
+/* State of the stream parser of the AIW metadata: the document is kept only as its model */
+typedef struct _mpai_aiw_stream_parser_t
+{
+	json_stream_parser_t _json;
+	mpai_metadata_schema_validator_t _validator;	// checked in the same pass of the parsing
+	int _aiw_id;
+	mpai_aiw_model_t* _model;
+	aim_callback_t* _aim_callback;
+	topology_output_callback_t* _topology_output_callback;
+	char _keys[MPAI_METADATA_PARSER_PATH_DEPTH + 1][JSON_STREAM_MAX_TOKEN_LEN];	// key of each level of the current path
+	char _item_name[JSON_STREAM_MAX_TOKEN_LEN];		// "Name" of the current element of "Types" or "Ports"
+	char _item_type[JSON_STREAM_MAX_TOKEN_LEN];		// "Type" of "Types", "RecordType" of "Ports"
+	char _item_direction[JSON_STREAM_MAX_TOKEN_LEN];
+	bool _item_is_remote;
+	char _output_aim_name[JSON_STREAM_MAX_TOKEN_LEN];
+	char _output_port_name[JSON_STREAM_MAX_TOKEN_LEN];
+	char _input_aim_name[JSON_STREAM_MAX_TOKEN_LEN];
+	char _input_port_name[JSON_STREAM_MAX_TOKEN_LEN];
+	bool _title_found;
+	bool _subaims_found;
+	bool _topology_done;
+	int _started_aims;								// AIMs of the model already passed to the callback
+	bool _aiw_ok;
+} mpai_aiw_stream_parser_t;
+
+/* Binary configuration (AIF, AIW and AIMs metadata) validated and read in place */
+typedef struct _mpai_metadata_binary_t
+{
+	const uint8_t* _blob;		// NULL if not available: it must outlive the parsing of the AIMs
+	size_t _size;
+} mpai_metadata_binary_t;
 
 /**
  * @brief Parse JSON coming from MPAI Store Config according with AIF specs
@@ -28,20 +72,125 @@ bool MPAI_Metadata_Parser_Parse_AIF_JSON(const char *aif_result);
  * 
  * @param aiw_result JSON string
  * @param aiw_id ID of AIW
+ * @param model filled with the metadata of the AIW (already initialized)
+ * @param aim_callback callback called after extracting each AIM
+ * @param topology_output_callback callback called after extracting the "Output" property of "Topology"
+ * @return true 
+ * @return false 
+ */
+bool MPAI_Metadata_Parser_Parse_AIW_JSON(const char *aiw_result, int aiw_id, mpai_aiw_model_t* model, aim_callback_t aim_callback, topology_output_callback_t topology_output_callback);
+
+/**
+ * @brief Initialize the parser of the AIW metadata for a document received in chunks
+ * (i.e. CoAP blocks). The callbacks are called as soon as each AIM and "Output"
+ * of "Topology" is complete; AIMs are started after the whole "Topology"
+ *
+ * @param me
+ * @param aiw_id ID of AIW
+ * @param model filled with the metadata of the AIW (already initialized): the AIMs are in the model
+ * when their callback is called
  * @param aim_callback callback called after extracting each AIM
  * @param topology_output_callback callback called after extracting the "Output" property of "Topology"
+ */
+void MPAI_Metadata_Parser_AIW_Stream_Init(mpai_aiw_stream_parser_t* me, int aiw_id, mpai_aiw_model_t* model, aim_callback_t aim_callback, topology_output_callback_t topology_output_callback);
+
+/**
+ * @brief Parse a chunk of the AIW metadata
+ * 
+ * @param me
+ * @param data
+ * @param len
  * @return true 
+ * @return false if the JSON is malformed
+ */
+bool MPAI_Metadata_Parser_AIW_Stream_Feed(mpai_aiw_stream_parser_t* me, const char* data, size_t len);
+
+/**
+ * @brief Complete the AIW metadata, starting the AIMs still waiting for the "Topology" and linking the model
+ * 
+ * @param me
+ * @return true if the AIW and all its AIMs are initialized
  * @return false 
  */
-bool MPAI_Metadata_Parser_Parse_AIW_JSON(const char *aiw_result, int aiw_id, aim_callback_t aim_callback, topology_output_callback_t topology_output_callback);
+bool MPAI_Metadata_Parser_AIW_Stream_End(mpai_aiw_stream_parser_t* me);
 
 /**
- * @brief Parse JSON coming from MPAI Store Config according with AIW specs
+ * @brief Parse JSON coming from MPAI Store Config according with AIM specs
  * 
  * @param aim_result 
+ * @param model model of the AIW of the AIM
+ * @param aim filled with the ports and the optional properties (defaults if missing)
  * @return true 
+ * @return false if the JSON is not valid or describes another AIM
+ */
+bool MPAI_Metadata_Parser_Parse_AIM_JSON(const char *aim_result, mpai_aiw_model_t* model, mpai_metadata_aim_t* aim);
+
+/**
+ * @brief Max bytes of the arena used parsing a JSON document, to size CONFIG_MPAI_METADATA_PARSER_ARENA_SIZE
+ * 
+ * @return size_t 
+ */
+size_t MPAI_Metadata_Parser_Get_Arena_Peak();
+
+/**
+ * @brief Validate a binary configuration compiled by tools/mpai_config_compiler.py
+ * (magic, version, size, crc and offsets). Nothing is copied: the blob is read in place
+ * 
+ * @param me
+ * @param blob
+ * @param size 
+ * @return true if the configuration can be used
  * @return false 
  */
-bool MPAI_Metadata_Parser_Parse_AIM_JSON(const char *aim_result);
+bool MPAI_Metadata_Parser_Binary_Open(mpai_metadata_binary_t* me, const uint8_t* blob, size_t size);
+
+/**
+ * @brief Check if a binary configuration has been opened
+ * 
+ * @param me 
+ * @return true 
+ * @return false 
+ */
+bool MPAI_Metadata_Parser_Binary_Is_Open(const mpai_metadata_binary_t* me);
+
+/**
+ * @brief Forget the binary configuration, i.e. to fall back to JSON
+ * 
+ * @param me 
+ */
+void MPAI_Metadata_Parser_Binary_Close(mpai_metadata_binary_t* me);
+
+/**
+ * @brief Read the AIF of a binary configuration
+ * 
+ * @param me 
+ * @return true 
+ * @return false 
+ */
+bool MPAI_Metadata_Parser_Binary_Parse_AIF(const mpai_metadata_binary_t* me);
+
+/**
+ * @brief Read the AIW of a binary configuration, using callbacks like MPAI_Metadata_Parser_Parse_AIW_JSON:
+ * all the "Output" of "Topology" are passed before the AIMs. Strings of the model are not copied
+ * 
+ * @param me 
+ * @param aiw_id ID of AIW
+ * @param model filled with the metadata of the AIW (already initialized)
+ * @param aim_callback callback called for each AIM
+ * @param topology_output_callback callback called for each "Output" property of "Topology"
+ * @return true if the AIW and all its AIMs are initialized
+ * @return false 
+ */
+bool MPAI_Metadata_Parser_Binary_Parse_AIW(const mpai_metadata_binary_t* me, int aiw_id, mpai_aiw_model_t* model, aim_callback_t aim_callback, topology_output_callback_t topology_output_callback);
+
+/**
+ * @brief Read the metadata of an AIM of a binary configuration
+ * 
+ * @param me 
+ * @param aim filled with the optional properties (defaults if missing)
+ * @return true 
+ * @return false if the AIM is not in the configuration
+ */
+bool MPAI_Metadata_Parser_Binary_Parse_AIM(const mpai_metadata_binary_t* me, mpai_metadata_aim_t* aim);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,251 @@
+/*
+ * @file
+ * @brief Implementation of the validator of the AIF/AIW/AIM metadata against their JSON schemas
+ *
+ * Copyright (c) 2022 University of Turin, Daniele Bortoluzzi <danieleb88@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "aif_metadata_schema.h"
+
+LOG_MODULE_REGISTER(MPAI_LIBS_AIF_METADATA_SCHEMA, LOG_LEVEL_INF);
+
+/************* PRIVATE HEADER *************/
+/* node of a value at a depth: the root, the value of the last key or an item */
+uint16_t _schema_value_node(mpai_metadata_schema_validator_t* me, int depth);
+/* check a value (scalar, or the start of an object/array) against its node */
+bool _schema_check_value(mpai_metadata_schema_validator_t* me, const mpai_metadata_schema_node_t* node, JSON_STREAM_EVENT event, const char* value);
+/* check the required properties and the items of a complete object/array */
+bool _schema_check_end(mpai_metadata_schema_validator_t* me, const mpai_metadata_schema_frame_t* frame);
+/* node of the value of a key of an object, marking it as found */
+uint16_t _schema_find_property(mpai_metadata_schema_validator_t* me, mpai_metadata_schema_frame_t* frame, const char* key);
+bool _schema_fail(mpai_metadata_schema_validator_t* me, const char* reason);
+bool _schema_document_event(JSON_STREAM_EVENT event, const char* value, int depth, void* user_data);
+
+/* used validating the documents parsed as a whole */
+static json_stream_parser_t document_parser;
+static mpai_metadata_schema_validator_t document_validator;
+
+K_MUTEX_DEFINE(document_mutex);
+
+/************* PUBLIC **************/
+void MPAI_Metadata_Schema_Validator_Init(mpai_metadata_schema_validator_t* me, const mpai_metadata_schema_t* schema)
+{
+	memset(me, 0, sizeof(mpai_metadata_schema_validator_t));
+	me->_schema = schema;
+	me->_valid = true;
+}
+
+bool MPAI_Metadata_Schema_Validator_Event(mpai_metadata_schema_validator_t* me, JSON_STREAM_EVENT event, const char* value, int depth)
+{
+	if (!me->_valid)
+	{
+		return false;
+	}
+
+	switch (event)
+	{
+	case JSON_STREAM_KEY:
+		// keys are members of the object one level up
+		strncpy(me->_key, value, sizeof(me->_key) - 1);
+		me->_frames[depth - 1]._child = _schema_find_property(me, &me->_frames[depth - 1], value);
+		return me->_valid;
+	case JSON_STREAM_OBJECT_END:
+	case JSON_STREAM_ARRAY_END:
+		me->_complete = depth == 0;
+		return _schema_check_end(me, &me->_frames[depth]);
+	default:
+		break;
+	}
+
+	uint16_t node_index = _schema_value_node(me, depth);
+	const mpai_metadata_schema_node_t* node = NULL;
+	if (node_index != MPAI_METADATA_SCHEMA_NODE_ANY)
+	{
+		node = &me->_schema->_nodes[node_index];
+		if (!_schema_check_value(me, node, event, value))
+		{
+			return false;
+		}
+	}
+
+	if (event == JSON_STREAM_OBJECT_START || event == JSON_STREAM_ARRAY_START)
+	{
+		mpai_metadata_schema_frame_t* frame = &me->_frames[depth];
+		memset(frame, 0, sizeof(mpai_metadata_schema_frame_t));
+		frame->_node = node_index;
+		// members of values not described are not described too
+		frame->_child = MPAI_METADATA_SCHEMA_NODE_ANY;
+		frame->_is_array = event == JSON_STREAM_ARRAY_START;
+	}
+	else
+	{
+		me->_complete = depth == 0;
+	}
+	return true;
+}
+
+bool MPAI_Metadata_Schema_Validator_Is_Valid(const mpai_metadata_schema_validator_t* me)
+{
+	return me->_valid && me->_complete;
+}
+
+bool MPAI_Metadata_Schema_Validate(const mpai_metadata_schema_t* schema, const char* document, size_t len)
+{
+	k_mutex_lock(&document_mutex, K_FOREVER);
+	MPAI_Metadata_Schema_Validator_Init(&document_validator, schema);
+	json_stream_init(&document_parser, _schema_document_event, &document_validator);
+	int ret = json_stream_feed(&document_parser, document, len);
+	if (ret == 0)
+	{
+		ret = json_stream_end(&document_parser);
+	}
+	bool valid = ret == 0 && MPAI_Metadata_Schema_Validator_Is_Valid(&document_validator);
+	k_mutex_unlock(&document_mutex);
+
+	if (ret == -EINVAL)
+	{
+		LOG_ERR("Metadata malformed (schema %s)", log_strdup(schema->_name));
+	}
+	return valid;
+}
+
+/************* PRIVATE IMPLEMENTATION *************/
+uint16_t _schema_value_node(mpai_metadata_schema_validator_t* me, int depth)
+{
+	if (depth == 0)
+	{
+		return me->_schema->_root;
+	}
+	mpai_metadata_schema_frame_t* parent = &me->_frames[depth - 1];
+	if (!parent->_is_array)
+	{
+		return parent->_child;
+	}
+	parent->_items++;
+	if (parent->_node == MPAI_METADATA_SCHEMA_NODE_ANY)
+	{
+		return MPAI_METADATA_SCHEMA_NODE_ANY;
+	}
+	return me->_schema->_nodes[parent->_node]._items;
+}
+
+bool _schema_check_value(mpai_metadata_schema_validator_t* me, const mpai_metadata_schema_node_t* node, JSON_STREAM_EVENT event, const char* value)
+{
+	uint8_t type;
+	switch (event)
+	{
+	case JSON_STREAM_OBJECT_START:
+		type = MPAI_METADATA_SCHEMA_TYPE_OBJECT;
+		break;
+	case JSON_STREAM_ARRAY_START:
+		type = MPAI_METADATA_SCHEMA_TYPE_ARRAY;
+		break;
+	case JSON_STREAM_STRING:
+		type = MPAI_METADATA_SCHEMA_TYPE_STRING;
+		break;
+	case JSON_STREAM_NUMBER:
+		// an integer is a number too
+		type = strpbrk(value, ".eE") == NULL ? (MPAI_METADATA_SCHEMA_TYPE_INTEGER | MPAI_METADATA_SCHEMA_TYPE_NUMBER) : MPAI_METADATA_SCHEMA_TYPE_NUMBER;
+		break;
+	case JSON_STREAM_TRUE:
+	case JSON_STREAM_FALSE:
+		type = MPAI_METADATA_SCHEMA_TYPE_BOOLEAN;
+		break;
+	default:
+		type = MPAI_METADATA_SCHEMA_TYPE_NULL;
+		break;
+	}
+	if ((node->_types & type) == 0)
+	{
+		return _schema_fail(me, "has a wrong type");
+	}
+
+	if (event == JSON_STREAM_STRING && node->_enum_count > 0)
+	{
+		for (uint8_t i = 0; i < node->_enum_count; i++)
+		{
+			if (strcmp(me->_schema->_enums[node->_enums + i], value) == 0)
+			{
+				return true;
+			}
+		}
+		return _schema_fail(me, "is not one of the allowed values");
+	}
+
+	if (event == JSON_STREAM_NUMBER && (node->_flags & (MPAI_METADATA_SCHEMA_FLAG_MINIMUM | MPAI_METADATA_SCHEMA_FLAG_MAXIMUM)))
+	{
+		long number = strtol(value, NULL, 10);
+		if ((node->_flags & MPAI_METADATA_SCHEMA_FLAG_MINIMUM) && number < node->_minimum)
+		{
+			return _schema_fail(me, "is below the minimum");
+		}
+		if ((node->_flags & MPAI_METADATA_SCHEMA_FLAG_MAXIMUM) && number > node->_maximum)
+		{
+			return _schema_fail(me, "is above the maximum");
+		}
+	}
+	return true;
+}
+
+bool _schema_check_end(mpai_metadata_schema_validator_t* me, const mpai_metadata_schema_frame_t* frame)
+{
+	if (frame->_node == MPAI_METADATA_SCHEMA_NODE_ANY)
+	{
+		return true;
+	}
+	const mpai_metadata_schema_node_t* node = &me->_schema->_nodes[frame->_node];
+	if (frame->_is_array)
+	{
+		return frame->_items >= node->_min_items || _schema_fail(me, "has too few items");
+	}
+
+	uint32_t missing = node->_required & ~frame->_found;
+	if (missing != 0)
+	{
+		// the first missing property locates the error
+		const char* name = me->_schema->_properties[node->_properties + __builtin_ctz(missing)]._name;
+		strncpy(me->_key, name, sizeof(me->_key) - 1);
+		return _schema_fail(me, "is required");
+	}
+	return true;
+}
+
+uint16_t _schema_find_property(mpai_metadata_schema_validator_t* me, mpai_metadata_schema_frame_t* frame, const char* key)
+{
+	if (frame->_node == MPAI_METADATA_SCHEMA_NODE_ANY)
+	{
+		return MPAI_METADATA_SCHEMA_NODE_ANY;
+	}
+	const mpai_metadata_schema_node_t* node = &me->_schema->_nodes[frame->_node];
+	for (uint8_t i = 0; i < node->_property_count; i++)
+	{
+		const mpai_metadata_schema_property_t* property = &me->_schema->_properties[node->_properties + i];
+		if (strcmp(property->_name, key) == 0)
+		{
+			frame->_found |= BIT(i);
+			return property->_node;
+		}
+	}
+	if (node->_flags & MPAI_METADATA_SCHEMA_FLAG_CLOSED)
+	{
+		_schema_fail(me, "is not allowed");
+	}
+	return MPAI_METADATA_SCHEMA_NODE_ANY;
+}
+
+bool _schema_fail(mpai_metadata_schema_validator_t* me, const char* reason)
+{
+	if (me->_valid)
+	{
+		LOG_ERR("Metadata not valid (schema %s): \"%s\" %s", log_strdup(me->_schema->_name), log_strdup(me->_key), reason);
+	}
+	me->_valid = false;
+	return false;
+}
+
+bool _schema_document_event(JSON_STREAM_EVENT event, const char* value, int depth, void* user_data)
+{
+	return MPAI_Metadata_Schema_Validator_Event((mpai_metadata_schema_validator_t*) user_data, event, value, depth);
+}
@@ -0,0 +1,133 @@
+/*
+ * @file
+ * @brief Headers of the validator of the AIF/AIW/AIM metadata against their JSON schemas
+ *
+ * The schemas (docs/schema) are compiled on the host by tools/mpai_schema_compiler.py into
+ * constant tables (aif_metadata_schema_tables.c). The validator is driven by the events of
+ * the streaming tokenizer, so a document is checked in the same single pass of its parsing,
+ * with no allocation. The subset of JSON schema supported is the one of the compiler.
+ *
+ * Copyright (c) 2022 University of Turin, Daniele Bortoluzzi <danieleb88@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef MPAI_AIF_METADATA_SCHEMA_H
+#define MPAI_AIF_METADATA_SCHEMA_H
+
+#include <core_common.h>
+#include <json_stream.h>
+
+/* JSON types allowed by a node */
+#define MPAI_METADATA_SCHEMA_TYPE_OBJECT BIT(0)
+#define MPAI_METADATA_SCHEMA_TYPE_ARRAY BIT(1)
+#define MPAI_METADATA_SCHEMA_TYPE_STRING BIT(2)
+#define MPAI_METADATA_SCHEMA_TYPE_INTEGER BIT(3)
+#define MPAI_METADATA_SCHEMA_TYPE_NUMBER BIT(4)
+#define MPAI_METADATA_SCHEMA_TYPE_BOOLEAN BIT(5)
+#define MPAI_METADATA_SCHEMA_TYPE_NULL BIT(6)
+#define MPAI_METADATA_SCHEMA_TYPE_ANY 0x7F
+
+/* flags of a node */
+#define MPAI_METADATA_SCHEMA_FLAG_CLOSED BIT(0)		// "additionalProperties": false
+#define MPAI_METADATA_SCHEMA_FLAG_MINIMUM BIT(1)
+#define MPAI_METADATA_SCHEMA_FLAG_MAXIMUM BIT(2)
+
+/* node of the values not described by the schema (i.e. additional properties) */
+#define MPAI_METADATA_SCHEMA_NODE_ANY 0xFFFF
+
+/* Constraints of a value */
+typedef struct _mpai_metadata_schema_node_t
+{
+	uint8_t _types;				// MPAI_METADATA_SCHEMA_TYPE_*
+	uint8_t _flags;				// MPAI_METADATA_SCHEMA_FLAG_*
+	uint8_t _property_count;
+	uint8_t _enum_count;		// 0 if any string is allowed
+	uint16_t _properties;		// first property of an object
+	uint16_t _enums;			// first allowed string
+	uint16_t _items;			// node of the items of an array
+	uint16_t _min_items;
+	uint32_t _required;			// bit i set if the property i is required
+	int32_t _minimum;
+	int32_t _maximum;
+} mpai_metadata_schema_node_t;
+
+typedef struct _mpai_metadata_schema_property_t
+{
+	const char* _name;
+	uint16_t _node;
+} mpai_metadata_schema_property_t;
+
+/* Compiled schema: the tables can be shared by several schemas */
+typedef struct _mpai_metadata_schema_t
+{
+	const char* _name;
+	const mpai_metadata_schema_node_t* _nodes;
+	const mpai_metadata_schema_property_t* _properties;
+	const char* const* _enums;
+	uint16_t _root;
+} mpai_metadata_schema_t;
+
+/* Validation state of an object or an array of the document */
+typedef struct _mpai_metadata_schema_frame_t
+{
+	uint16_t _node;
+	uint16_t _child;			// node of the value of the last key of an object
+	uint32_t _found;			// properties found in an object
+	uint16_t _items;			// items found in an array
+	bool _is_array;
+} mpai_metadata_schema_frame_t;
+
+typedef struct _mpai_metadata_schema_validator_t
+{
+	const mpai_metadata_schema_t* _schema;
+	mpai_metadata_schema_frame_t _frames[JSON_STREAM_MAX_DEPTH];
+	char _key[JSON_STREAM_MAX_TOKEN_LEN];	// last key, to locate the errors
+	bool _valid;
+	bool _complete;				// the root value is complete
+} mpai_metadata_schema_validator_t;
+
+extern const mpai_metadata_schema_t MPAI_METADATA_SCHEMA_AIF;
+extern const mpai_metadata_schema_t MPAI_METADATA_SCHEMA_AIW_AIM;
+
+/**
+ * @brief Initialize the validator for a new document
+ *
+ * @param me
+ * @param schema
+ */
+void MPAI_Metadata_Schema_Validator_Init(mpai_metadata_schema_validator_t* me, const mpai_metadata_schema_t* schema);
+
+/**
+ * @brief Check a token of the document (see json_stream_callback_t)
+ *
+ * @param me
+ * @param event
+ * @param value
+ * @param depth
+ * @return true
+ * @return false if the document is not valid: the error is logged once
+ */
+bool MPAI_Metadata_Schema_Validator_Event(mpai_metadata_schema_validator_t* me, JSON_STREAM_EVENT event, const char* value, int depth);
+
+/**
+ * @brief Check if the whole document has been validated
+ *
+ * @param me
+ * @return true
+ * @return false if not valid or not complete
+ */
+bool MPAI_Metadata_Schema_Validator_Is_Valid(const mpai_metadata_schema_validator_t* me);
+
+/**
+ * @brief Validate a whole document
+ *
+ * @param schema
+ * @param document
+ * @param len
+ * @return true
+ * @return false if malformed or not valid
+ */
+bool MPAI_Metadata_Schema_Validate(const mpai_metadata_schema_t* schema, const char* document, size_t len);
+
+#endif
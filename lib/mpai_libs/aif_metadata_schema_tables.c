@@ -0,0 +1,215 @@
+/*
+ * @file
+ * @brief Validation tables of the AIF/AIW/AIM metadata schemas
+ *
+ * Generated by tools/mpai_schema_compiler.py from docs/schema: do not edit.
+ *
+ * Copyright (c) 2022 University of Turin, Daniele Bortoluzzi <danieleb88@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "aif_metadata_schema.h"
+
+static const char* const schema_enums[] = {
+	"Basic",
+	"Main",
+	"Input",
+	"Output",
+	"InputOutput",
+	"Hardware",
+	"Software",
+};
+
+static const mpai_metadata_schema_property_t schema_properties[] = {
+	{ "title", 1 },
+	{ "ImplementerID", 2 },
+	{ "Version", 3 },
+	{ "APIProfile", 4 },
+	{ "ResourcePolicies", 5 },
+	{ "Authentication", 11 },
+	{ "TimeBase", 12 },
+	{ "Name", 7 },
+	{ "Minimum", 8 },
+	{ "Maximum", 9 },
+	{ "Request", 10 },
+	{ "title", 14 },
+	{ "Identifier", 15 },
+	{ "APIProfile", 23 },
+	{ "Description", 24 },
+	{ "Types", 25 },
+	{ "Ports", 29 },
+	{ "SubAIMs", 37 },
+	{ "Topology", 40 },
+	{ "DutyCycle", 45 },
+	{ "Scheduling", 49 },
+	{ "Supervision", 54 },
+	{ "Implementations", 58 },
+	{ "Documentation", 59 },
+	{ "ImplementerID", 16 },
+	{ "Specification", 17 },
+	{ "Standard", 18 },
+	{ "Name", 19 },
+	{ "AIW", 20 },
+	{ "AIM", 21 },
+	{ "Version", 22 },
+	{ "Name", 27 },
+	{ "Type", 28 },
+	{ "Name", 31 },
+	{ "Direction", 32 },
+	{ "RecordType", 33 },
+	{ "Technology", 34 },
+	{ "Protocol", 35 },
+	{ "IsRemote", 36 },
+	{ "Name", 39 },
+	{ "Identifier", 15 },
+	{ "Output", 42 },
+	{ "Input", 42 },
+	{ "AIMName", 43 },
+	{ "PortName", 44 },
+	{ "Period", 46 },
+	{ "ActiveWindow", 47 },
+	{ "Phase", 48 },
+	{ "Priority", 50 },
+	{ "StackSize", 51 },
+	{ "Deadline", 52 },
+	{ "Budget", 53 },
+	{ "HeartbeatTimeout", 55 },
+	{ "LatencySLA", 56 },
+	{ "MaxRestarts", 57 },
+	{ "Type", 61 },
+	{ "URI", 62 },
+};
+
+/* types, flags, property count, enum count, properties, enums, items, min items, required, minimum, maximum */
+static const mpai_metadata_schema_node_t schema_nodes[] = {
+	/* 0: mpai_aif.schema.json */
+	{ 0x01, 0x00, 7, 0, 0, 0, 0xffff, 0, 0x0000000f, 0, 0 },
+	/* 1: mpai_aif.schema.json/title */
+	{ 0x04, 0x00, 0, 0, 0, 0, 0xffff, 0, 0x00000000, 0, 0 },
+	/* 2: mpai_aif.schema.json/ImplementerID */
+	{ 0x08, 0x02, 0, 0, 0, 0, 0xffff, 0, 0x00000000, 0, 0 },
+	/* 3: mpai_aif.schema.json/Version */
+	{ 0x04, 0x00, 0, 0, 0, 0, 0xffff, 0, 0x00000000, 0, 0 },
+	/* 4: mpai_aif.schema.json/APIProfile */
+	{ 0x04, 0x00, 0, 2, 0, 0, 0xffff, 0, 0x00000000, 0, 0 },
+	/* 5: mpai_aif.schema.json/ResourcePolicies */
+	{ 0x02, 0x00, 0, 0, 0, 0, 0x0006, 0, 0x00000000, 0, 0 },
+	/* 6: mpai_aif.schema.json/ResourcePolicies/items */
+	{ 0x01, 0x00, 4, 0, 7, 0, 0xffff, 0, 0x00000001, 0, 0 },
+	/* 7: mpai_aif.schema.json/ResourcePolicies/items/Name */
+	{ 0x04, 0x00, 0, 0, 0, 0, 0xffff, 0, 0x00000000, 0, 0 },
+	/* 8: mpai_aif.schema.json/ResourcePolicies/items/Minimum */
+	{ 0x04, 0x00, 0, 0, 0, 0, 0xffff, 0, 0x00000000, 0, 0 },
+	/* 9: mpai_aif.schema.json/ResourcePolicies/items/Maximum */
+	{ 0x04, 0x00, 0, 0, 0, 0, 0xffff, 0, 0x00000000, 0, 0 },
+	/* 10: mpai_aif.schema.json/ResourcePolicies/items/Request */
+	{ 0x04, 0x00, 0, 0, 0, 0, 0xffff, 0, 0x00000000, 0, 0 },
+	/* 11: mpai_aif.schema.json/Authentication */
+	{ 0x04, 0x00, 0, 0, 0, 0, 0xffff, 0, 0x00000000, 0, 0 },
+	/* 12: mpai_aif.schema.json/TimeBase */
+	{ 0x04, 0x00, 0, 0, 0, 0, 0xffff, 0, 0x00000000, 0, 0 },
+	/* 13: mpai_aiw_aim.schema.json */
+	{ 0x01, 0x00, 13, 0, 11, 0, 0xffff, 0, 0x00000002, 0, 0 },
+	/* 14: mpai_aiw_aim.schema.json/title */
+	{ 0x04, 0x00, 0, 0, 0, 0, 0xffff, 0, 0x00000000, 0, 0 },
+	/* 15: #/$defs/Identifier */
+	{ 0x01, 0x00, 2, 0, 24, 0, 0xffff, 0, 0x00000003, 0, 0 },
+	/* 16: #/$defs/Identifier/ImplementerID */
+	{ 0x08, 0x02, 0, 0, 0, 0, 0xffff, 0, 0x00000000, 0, 0 },
+	/* 17: #/$defs/Identifier/Specification */
+	{ 0x01, 0x00, 5, 0, 26, 0, 0xffff, 0, 0x0000001c, 0, 0 },
+	/* 18: #/$defs/Identifier/Specification/Standard */
+	{ 0x04, 0x00, 0, 0, 0, 0, 0xffff, 0, 0x00000000, 0, 0 },
+	/* 19: #/$defs/Identifier/Specification/Name */
+	{ 0x04, 0x00, 0, 0, 0, 0, 0xffff, 0, 0x00000000, 0, 0 },
+	/* 20: #/$defs/Identifier/Specification/AIW */
+	{ 0x04, 0x00, 0, 0, 0, 0, 0xffff, 0, 0x00000000, 0, 0 },
+	/* 21: #/$defs/Identifier/Specification/AIM */
+	{ 0x04, 0x00, 0, 0, 0, 0, 0xffff, 0, 0x00000000, 0, 0 },
+	/* 22: #/$defs/Identifier/Specification/Version */
+	{ 0x04, 0x00, 0, 0, 0, 0, 0xffff, 0, 0x00000000, 0, 0 },
+	/* 23: mpai_aiw_aim.schema.json/APIProfile */
+	{ 0x04, 0x00, 0, 2, 0, 0, 0xffff, 0, 0x00000000, 0, 0 },
+	/* 24: mpai_aiw_aim.schema.json/Description */
+	{ 0x04, 0x00, 0, 0, 0, 0, 0xffff, 0, 0x00000000, 0, 0 },
+	/* 25: mpai_aiw_aim.schema.json/Types */
+	{ 0x02, 0x00, 0, 0, 0, 0, 0x001a, 0, 0x00000000, 0, 0 },
+	/* 26: mpai_aiw_aim.schema.json/Types/items */
+	{ 0x01, 0x00, 2, 0, 31, 0, 0xffff, 0, 0x00000003, 0, 0 },
+	/* 27: mpai_aiw_aim.schema.json/Types/items/Name */
+	{ 0x04, 0x00, 0, 0, 0, 0, 0xffff, 0, 0x00000000, 0, 0 },
+	/* 28: mpai_aiw_aim.schema.json/Types/items/Type */
+	{ 0x04, 0x00, 0, 0, 0, 0, 0xffff, 0, 0x00000000, 0, 0 },
+	/* 29: mpai_aiw_aim.schema.json/Ports */
+	{ 0x02, 0x00, 0, 0, 0, 0, 0x001e, 0, 0x00000000, 0, 0 },
+	/* 30: mpai_aiw_aim.schema.json/Ports/items */
+	{ 0x01, 0x00, 6, 0, 33, 0, 0xffff, 0, 0x00000007, 0, 0 },
+	/* 31: mpai_aiw_aim.schema.json/Ports/items/Name */
+	{ 0x04, 0x00, 0, 0, 0, 0, 0xffff, 0, 0x00000000, 0, 0 },
+	/* 32: mpai_aiw_aim.schema.json/Ports/items/Direction */
+	{ 0x04, 0x00, 0, 3, 0, 2, 0xffff, 0, 0x00000000, 0, 0 },
+	/* 33: mpai_aiw_aim.schema.json/Ports/items/RecordType */
+	{ 0x04, 0x00, 0, 0, 0, 0, 0xffff, 0, 0x00000000, 0, 0 },
+	/* 34: mpai_aiw_aim.schema.json/Ports/items/Technology */
+	{ 0x04, 0x00, 0, 2, 0, 5, 0xffff, 0, 0x00000000, 0, 0 },
+	/* 35: mpai_aiw_aim.schema.json/Ports/items/Protocol */
+	{ 0x04, 0x00, 0, 0, 0, 0, 0xffff, 0, 0x00000000, 0, 0 },
+	/* 36: mpai_aiw_aim.schema.json/Ports/items/IsRemote */
+	{ 0x20, 0x00, 0, 0, 0, 0, 0xffff, 0, 0x00000000, 0, 0 },
+	/* 37: mpai_aiw_aim.schema.json/SubAIMs */
+	{ 0x02, 0x00, 0, 0, 0, 0, 0x0026, 0, 0x00000000, 0, 0 },
+	/* 38: mpai_aiw_aim.schema.json/SubAIMs/items */
+	{ 0x01, 0x00, 2, 0, 39, 0, 0xffff, 0, 0x00000002, 0, 0 },
+	/* 39: mpai_aiw_aim.schema.json/SubAIMs/items/Name */
+	{ 0x04, 0x00, 0, 0, 0, 0, 0xffff, 0, 0x00000000, 0, 0 },
+	/* 40: mpai_aiw_aim.schema.json/Topology */
+	{ 0x02, 0x00, 0, 0, 0, 0, 0x0029, 0, 0x00000000, 0, 0 },
+	/* 41: mpai_aiw_aim.schema.json/Topology/items */
+	{ 0x01, 0x00, 2, 0, 41, 0, 0xffff, 0, 0x00000003, 0, 0 },
+	/* 42: #/$defs/Connection */
+	{ 0x01, 0x00, 2, 0, 43, 0, 0xffff, 0, 0x00000003, 0, 0 },
+	/* 43: #/$defs/Connection/AIMName */
+	{ 0x04, 0x00, 0, 0, 0, 0, 0xffff, 0, 0x00000000, 0, 0 },
+	/* 44: #/$defs/Connection/PortName */
+	{ 0x04, 0x00, 0, 0, 0, 0, 0xffff, 0, 0x00000000, 0, 0 },
+	/* 45: mpai_aiw_aim.schema.json/DutyCycle */
+	{ 0x01, 0x00, 3, 0, 45, 0, 0xffff, 0, 0x00000003, 0, 0 },
+	/* 46: mpai_aiw_aim.schema.json/DutyCycle/Period */
+	{ 0x08, 0x02, 0, 0, 0, 0, 0xffff, 0, 0x00000000, 0, 0 },
+	/* 47: mpai_aiw_aim.schema.json/DutyCycle/ActiveWindow */
+	{ 0x08, 0x02, 0, 0, 0, 0, 0xffff, 0, 0x00000000, 0, 0 },
+	/* 48: mpai_aiw_aim.schema.json/DutyCycle/Phase */
+	{ 0x08, 0x02, 0, 0, 0, 0, 0xffff, 0, 0x00000000, 0, 0 },
+	/* 49: mpai_aiw_aim.schema.json/Scheduling */
+	{ 0x01, 0x00, 4, 0, 48, 0, 0xffff, 0, 0x00000000, 0, 0 },
+	/* 50: mpai_aiw_aim.schema.json/Scheduling/Priority */
+	{ 0x08, 0x00, 0, 0, 0, 0, 0xffff, 0, 0x00000000, 0, 0 },
+	/* 51: mpai_aiw_aim.schema.json/Scheduling/StackSize */
+	{ 0x08, 0x02, 0, 0, 0, 0, 0xffff, 0, 0x00000000, 0, 0 },
+	/* 52: mpai_aiw_aim.schema.json/Scheduling/Deadline */
+	{ 0x08, 0x02, 0, 0, 0, 0, 0xffff, 0, 0x00000000, 0, 0 },
+	/* 53: mpai_aiw_aim.schema.json/Scheduling/Budget */
+	{ 0x08, 0x02, 0, 0, 0, 0, 0xffff, 0, 0x00000000, 0, 0 },
+	/* 54: mpai_aiw_aim.schema.json/Supervision */
+	{ 0x01, 0x00, 3, 0, 52, 0, 0xffff, 0, 0x00000000, 0, 0 },
+	/* 55: mpai_aiw_aim.schema.json/Supervision/HeartbeatTimeout */
+	{ 0x08, 0x02, 0, 0, 0, 0, 0xffff, 0, 0x00000000, 0, 0 },
+	/* 56: mpai_aiw_aim.schema.json/Supervision/LatencySLA */
+	{ 0x08, 0x02, 0, 0, 0, 0, 0xffff, 0, 0x00000000, 0, 0 },
+	/* 57: mpai_aiw_aim.schema.json/Supervision/MaxRestarts */
+	{ 0x08, 0x02, 0, 0, 0, 0, 0xffff, 0, 0x00000000, 0, 0 },
+	/* 58: mpai_aiw_aim.schema.json/Implementations */
+	{ 0x02, 0x00, 0, 0, 0, 0, 0xffff, 0, 0x00000000, 0, 0 },
+	/* 59: mpai_aiw_aim.schema.json/Documentation */
+	{ 0x02, 0x00, 0, 0, 0, 0, 0x003c, 0, 0x00000000, 0, 0 },
+	/* 60: mpai_aiw_aim.schema.json/Documentation/items */
+	{ 0x01, 0x00, 2, 0, 55, 0, 0xffff, 0, 0x00000003, 0, 0 },
+	/* 61: mpai_aiw_aim.schema.json/Documentation/items/Type */
+	{ 0x04, 0x00, 0, 0, 0, 0, 0xffff, 0, 0x00000000, 0, 0 },
+	/* 62: mpai_aiw_aim.schema.json/Documentation/items/URI */
+	{ 0x04, 0x00, 0, 0, 0, 0, 0xffff, 0, 0x00000000, 0, 0 },
+};
+
+const mpai_metadata_schema_t MPAI_METADATA_SCHEMA_AIF = { "mpai_aif.schema.json", schema_nodes, schema_properties, schema_enums, 0 };
+const mpai_metadata_schema_t MPAI_METADATA_SCHEMA_AIW_AIM = { "mpai_aiw_aim.schema.json", schema_nodes, schema_properties, schema_enums, 13 };
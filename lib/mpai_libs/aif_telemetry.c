@@ -0,0 +1,748 @@
+/*
+ * @file
+ * @brief Implementation of the telemetry of the MPAI AIF, served on CoAP
+ *
+ * Copyright (c) 2022 University of Turin, Daniele Bortoluzzi <danieleb88@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "aif_telemetry.h"
+
+#include <errno.h>
+#include <net/socket.h>
+#include <net/coap.h>
+#include <net/coap_link_format.h>
+
+#include <cbor_writer.h>
+#include <wifi_connect.h>
+#include <boot_trace.h>
+
+LOG_MODULE_REGISTER(MPAI_LIBS_AIF_TELEMETRY, LOG_LEVEL_INF);
+
+#ifdef CONFIG_MPAI_TELEMETRY_SERVER
+
+#define TELEMETRY_MAX_MSG_LEN 1024
+#define TELEMETRY_MAX_PAYLOAD_LEN 512
+/* the .well-known/core, the boot trace, the AIMs of each AIW, the stats and the latest message of each channel, the end of the list */
+#define TELEMETRY_MAX_RESOURCES (2 + MPAI_AIF_AIW_MAX + 2 * MPAI_AIF_CHANNEL_MAX + 1)
+/* blocks of the boot trace (RFC 7959): up to 512 bytes, as the payloads */
+#define TELEMETRY_MAX_BLOCK_SZX 5
+/* a notification out of TELEMETRY_CON_NOTIFY_EVERY is confirmable: an observer that didn't acknowledge the previous one is dropped */
+#define TELEMETRY_CON_NOTIFY_EVERY 16
+
+typedef enum
+{
+	TELEMETRY_RESOURCE_AIMS,
+	TELEMETRY_RESOURCE_CHANNEL_STATS,
+	TELEMETRY_RESOURCE_CHANNEL_LATEST
+} TELEMETRY_RESOURCE_TYPE;
+
+typedef struct _telemetry_resource_t
+{
+	struct coap_core_metadata _core;	// first: read as user data by coap_well_known_core_get
+	TELEMETRY_RESOURCE_TYPE _type;
+	int _aiw_id;
+	subscriber_channel_t _channel;
+	char _id[12];						// AIW id, as path segment
+	const char* _path[5];
+	uint32_t _notified;					// messages published at the latest notification
+} telemetry_resource_t;
+
+typedef struct _telemetry_observer_t
+{
+	struct coap_observer _observer;
+	struct coap_resource* _resource;	// NULL if the slot is free
+	uint16_t _last_id;					// of the latest notification
+	bool _unacked;						// the latest confirmable notification is not acknowledged
+	uint32_t _sent;
+} telemetry_observer_t;
+
+/************* PRIVATE HEADER *************/
+/* add the resources of the AIWs and channels created since the latest call */
+void _telemetry_sync_resources(void);
+/* encode the representation of a resource: length, negative if it doesn't fit */
+int _telemetry_encode(const telemetry_resource_t* resource, uint8_t* buffer, size_t size);
+int _telemetry_encode_aims(int aiw_id, cbor_writer_t* writer);
+int _telemetry_encode_channel(subscriber_channel_t channel, bool latest, cbor_writer_t* writer);
+/* statistics of a channel summed over the message stores: the latest values from the latest publisher */
+void _telemetry_channel_stats(subscriber_channel_t channel, mpai_message_store_channel_stats_t* stats, MPAI_AIM_MessageStore_t** latest_store);
+/* send a response (to a request or an observer) with the representation of a resource */
+int _telemetry_send(struct coap_resource* resource, uint8_t type, uint8_t code, uint16_t id, const uint8_t* token, uint8_t tkl,
+					bool observe, const struct sockaddr* addr, socklen_t addr_len);
+int _telemetry_send_empty(uint8_t type, uint8_t code, const struct coap_packet* request, const struct sockaddr* addr, socklen_t addr_len);
+/* register or deregister an observer of a resource */
+void _telemetry_observe(struct coap_resource* resource, const struct coap_packet* request, const struct sockaddr* addr, int observe);
+void _telemetry_remove_observer(telemetry_observer_t* observer);
+/* an empty ACK or RST to a notification */
+void _telemetry_handle_empty(const struct coap_packet* packet, const struct sockaddr* addr);
+/* sample the CPU of the AIMs and notify the observers of the resources changed */
+void _telemetry_tick(uint32_t elapsed_ms);
+int _telemetry_get(struct coap_resource* resource, struct coap_packet* request, struct sockaddr* addr, socklen_t addr_len);
+int _telemetry_well_known_core_get(struct coap_resource* resource, struct coap_packet* request, struct sockaddr* addr, socklen_t addr_len);
+#ifdef CONFIG_MPAI_BOOT_TRACE
+/* the Chrome trace of the boot, in blocks */
+int _telemetry_boot_trace_get(struct coap_resource* resource, struct coap_packet* request, struct sockaddr* addr, socklen_t addr_len);
+#endif
+void _telemetry_notify(struct coap_resource* resource, struct coap_observer* observer);
+void th_telemetry_server(void *dummy1, void *dummy2, void *dummy3);
+
+K_THREAD_STACK_DEFINE(thread_telemetry_server_stack_area, CONFIG_MPAI_TELEMETRY_SERVER_STACK_SIZE);
+static struct k_thread thread_telemetry_server;
+static atomic_t telemetry_server_started = ATOMIC_INIT(0);
+
+/* resources, observers and buffers are used only by the server thread */
+static const char * const telemetry_well_known_core_path[] = { COAP_WELL_KNOWN_CORE_PATH, NULL };
+static const char * const telemetry_attributes[] = { "ct=60", "obs", NULL };
+#ifdef CONFIG_MPAI_BOOT_TRACE
+static const char * const telemetry_boot_trace_path[] = { "boot", "trace", NULL };
+static const char * const telemetry_boot_trace_attributes[] = { "ct=50", NULL };
+static struct coap_core_metadata telemetry_boot_trace_core = { .attributes = telemetry_boot_trace_attributes };
+#endif
+static struct coap_resource telemetry_resources[TELEMETRY_MAX_RESOURCES];
+static telemetry_resource_t telemetry_resource_data[TELEMETRY_MAX_RESOURCES];
+static int telemetry_resource_count = 0;
+static int telemetry_aiw_synced = 0;
+static int telemetry_channel_synced = 0;
+
+static telemetry_observer_t telemetry_observers[CONFIG_MPAI_TELEMETRY_MAX_OBSERVERS];
+
+/* CPU of each AIM of MPAI_AIM_List, in per mille of the latest interval */
+static uint32_t telemetry_aim_execution_ms[MPAI_AIF_AIM_MAX];
+static uint16_t telemetry_aim_cpu[MPAI_AIF_AIM_MAX];
+
+static int telemetry_sock = -1;
+static uint8_t telemetry_rx_buffer[TELEMETRY_MAX_MSG_LEN];
+static uint8_t telemetry_tx_buffer[TELEMETRY_MAX_MSG_LEN];
+static uint8_t telemetry_payload[TELEMETRY_MAX_PAYLOAD_LEN];
+
+static const char* const telemetry_aim_states[] = { "idle", "running", "paused", "stopped", "failed" };
+
+#endif
+
+/************* PUBLIC **************/
+int MPAI_Telemetry_Server_Start(void)
+{
+#ifdef CONFIG_MPAI_TELEMETRY_SERVER
+	if (!atomic_cas(&telemetry_server_started, 0, 1))
+	{
+		return -EALREADY;
+	}
+	k_thread_create(&thread_telemetry_server, thread_telemetry_server_stack_area,
+					K_THREAD_STACK_SIZEOF(thread_telemetry_server_stack_area),
+					th_telemetry_server, NULL, NULL, NULL,
+					CONFIG_MPAI_TELEMETRY_SERVER_PRIORITY, 0, K_NO_WAIT);
+	k_thread_name_set(&thread_telemetry_server, "thread_telemetry_server");
+	return 0;
+#else
+	return -ENOTSUP;
+#endif
+}
+
+/************* PRIVATE **************/
+#ifdef CONFIG_MPAI_TELEMETRY_SERVER
+void _telemetry_sync_resources(void)
+{
+	if (telemetry_resource_count == 0)
+	{
+		telemetry_resources[0].get = _telemetry_well_known_core_get;
+		telemetry_resources[0].path = telemetry_well_known_core_path;
+		telemetry_resource_count = 1;
+#ifdef CONFIG_MPAI_BOOT_TRACE
+		telemetry_resources[1].get = _telemetry_boot_trace_get;
+		telemetry_resources[1].path = telemetry_boot_trace_path;
+		telemetry_resources[1].user_data = &telemetry_boot_trace_core;
+		telemetry_resource_count = 2;
+#endif
+	}
+
+	// the entries are appended by the controller: they are added once filled, the resources after the last stay zeroed
+	for (; telemetry_aiw_synced < MIN(mpai_message_store_count, MPAI_AIF_AIW_MAX); telemetry_aiw_synced++)
+	{
+		message_store_map_element_t* element = &message_store_list[telemetry_aiw_synced];
+		if (element->_message_store == NULL)
+		{
+			break;
+		}
+
+		telemetry_resource_t* data = &telemetry_resource_data[telemetry_resource_count];
+		data->_core.attributes = telemetry_attributes;
+		data->_type = TELEMETRY_RESOURCE_AIMS;
+		data->_aiw_id = element->_aiw_id;
+		snprintf(data->_id, sizeof(data->_id), "%d", element->_aiw_id);
+		data->_path[0] = "aif";
+		data->_path[1] = "aiw";
+		data->_path[2] = data->_id;
+		data->_path[3] = "aims";
+		data->_path[4] = NULL;
+
+		struct coap_resource* resource = &telemetry_resources[telemetry_resource_count++];
+		resource->get = _telemetry_get;
+		resource->notify = _telemetry_notify;
+		resource->path = data->_path;
+		resource->user_data = data;
+	}
+
+	for (; telemetry_channel_synced < MIN(mpai_message_store_channel_count, MPAI_AIF_CHANNEL_MAX); telemetry_channel_synced++)
+	{
+		channel_map_element_t* element = &message_store_channel_list[telemetry_channel_synced];
+		if (element->_channel_name == NULL)
+		{
+			break;
+		}
+
+		for (int latest = 0; latest < 2; latest++)
+		{
+			telemetry_resource_t* data = &telemetry_resource_data[telemetry_resource_count];
+			data->_core.attributes = telemetry_attributes;
+			data->_type = latest ? TELEMETRY_RESOURCE_CHANNEL_LATEST : TELEMETRY_RESOURCE_CHANNEL_STATS;
+			data->_channel = element->_channel;
+			data->_path[0] = "channels";
+			data->_path[1] = element->_channel_name;
+			data->_path[2] = latest ? "latest" : "stats";
+			data->_path[3] = NULL;
+
+			struct coap_resource* resource = &telemetry_resources[telemetry_resource_count++];
+			resource->get = _telemetry_get;
+			resource->notify = _telemetry_notify;
+			resource->path = data->_path;
+			resource->user_data = data;
+		}
+	}
+}
+
+int _telemetry_encode(const telemetry_resource_t* resource, uint8_t* buffer, size_t size)
+{
+	cbor_writer_t writer;
+	cbor_writer_init(&writer, buffer, size);
+
+	switch (resource->_type)
+	{
+	case TELEMETRY_RESOURCE_AIMS:
+		return _telemetry_encode_aims(resource->_aiw_id, &writer);
+	case TELEMETRY_RESOURCE_CHANNEL_STATS:
+		return _telemetry_encode_channel(resource->_channel, false, &writer);
+	case TELEMETRY_RESOURCE_CHANNEL_LATEST:
+		return _telemetry_encode_channel(resource->_channel, true, &writer);
+	}
+	return -EINVAL;
+}
+
+int _telemetry_encode_aims(int aiw_id, cbor_writer_t* writer)
+{
+	int count = 0;
+	for (int i = 0; i < MIN(mpai_controller_aim_count, MPAI_AIF_AIM_MAX); i++)
+	{
+		if (MPAI_AIM_List[i] != NULL && MPAI_AIM_List[i]->_aim != NULL && MPAI_AIM_Get_AIW_ID(MPAI_AIM_List[i]->_aim) == aiw_id)
+		{
+			count++;
+		}
+	}
+
+	// { <AIM name>: { "state", "alive", "cpu", "act", "avg_ms", "max_ms", "misses", "overruns"[, "restarts"] } }
+	cbor_put_map(writer, count);
+	for (int i = 0; i < MIN(mpai_controller_aim_count, MPAI_AIF_AIM_MAX); i++)
+	{
+		aim_initialization_cb_t* aim_init = MPAI_AIM_List[i];
+		if (aim_init == NULL || aim_init->_aim == NULL || MPAI_AIM_Get_AIW_ID(aim_init->_aim) != aiw_id)
+		{
+			continue;
+		}
+
+		mpai_aim_control_t* control = MPAI_AIM_Get_Control(aim_init->_aim);
+		mpai_aim_control_stats_t stats = {0};
+		MPAI_AIM_STATE state = MPAI_AIM_STATE_IDLE;
+		if (control != NULL)
+		{
+			MPAI_AIM_Control_Get_Stats(control, &stats);
+			state = (MPAI_AIM_STATE) atomic_get(&control->_state);
+		}
+
+		int entries = 8;
+#ifdef CONFIG_MPAI_AIM_SUPERVISOR
+		mpai_aim_supervisor_status_t supervisor_status;
+		bool supervised = MPAI_AIM_Supervisor_Get_Status(aim_init->_aim, &supervisor_status).code == MPAI_AIF_OK;
+		entries += supervised ? 1 : 0;
+#endif
+
+		cbor_put_text(writer, aim_init->_aim_name);
+		cbor_put_map(writer, entries);
+		cbor_put_text(writer, "state");
+		cbor_put_text(writer, state <= MPAI_AIM_STATE_FAILED ? telemetry_aim_states[state] : "unknown");
+		cbor_put_text(writer, "alive");
+		cbor_put_bool(writer, MPAI_AIM_Is_Alive(aim_init->_aim));
+		cbor_put_text(writer, "cpu");
+		cbor_put_uint(writer, telemetry_aim_cpu[i]);
+		cbor_put_text(writer, "act");
+		cbor_put_uint(writer, stats._activations);
+		cbor_put_text(writer, "avg_ms");
+		cbor_put_uint(writer, stats._activations > 0 ? stats._execution_ms / stats._activations : 0);
+		cbor_put_text(writer, "max_ms");
+		cbor_put_uint(writer, stats._max_response_ms);
+		cbor_put_text(writer, "misses");
+		cbor_put_uint(writer, stats._deadline_misses);
+		cbor_put_text(writer, "overruns");
+		cbor_put_uint(writer, stats._overruns);
+#ifdef CONFIG_MPAI_AIM_SUPERVISOR
+		if (supervised)
+		{
+			cbor_put_text(writer, "restarts");
+			cbor_put_uint(writer, supervisor_status._restarts);
+		}
+#endif
+	}
+	return cbor_writer_get_len(writer);
+}
+
+int _telemetry_encode_channel(subscriber_channel_t channel, bool latest, cbor_writer_t* writer)
+{
+	mpai_message_store_channel_stats_t stats;
+	MPAI_AIM_MessageStore_t* latest_store;
+	_telemetry_channel_stats(channel, &stats, &latest_store);
+
+	if (latest)
+	{
+		// { "ts": <uptime ms>, "value": <message encoded by the channel encoder> | null }
+		uint8_t value[CONFIG_MPAI_TELEMETRY_LATEST_MAX_SIZE];
+		int value_len = latest_store != NULL ? MPAI_MessageStore_Get_Latest_Encoded(latest_store, channel, value, sizeof(value)) : 0;
+
+		cbor_put_map(writer, 2);
+		cbor_put_text(writer, "ts");
+		cbor_put_int(writer, stats._last_timestamp);
+		cbor_put_text(writer, "value");
+		if (value_len > 0)
+		{
+			cbor_put_encoded(writer, value, value_len);
+		}
+		else
+		{
+			cbor_put_null(writer);
+		}
+		return cbor_writer_get_len(writer);
+	}
+
+	cbor_put_map(writer, 7);
+	cbor_put_text(writer, "pub");
+	cbor_put_uint(writer, stats._published);
+	cbor_put_text(writer, "read");
+	cbor_put_uint(writer, stats._copied);
+	cbor_put_text(writer, "subs");
+	cbor_put_uint(writer, stats._subscribers);
+	cbor_put_text(writer, "ts");
+	cbor_put_int(writer, stats._last_timestamp);
+	cbor_put_text(writer, "interval_ms");
+	cbor_put_uint(writer, stats._last_interval_ms);
+	cbor_put_text(writer, "latency_ms");
+	cbor_put_uint(writer, stats._last_latency_ms);
+	cbor_put_text(writer, "max_latency_ms");
+	cbor_put_uint(writer, stats._max_latency_ms);
+	return cbor_writer_get_len(writer);
+}
+
+void _telemetry_channel_stats(subscriber_channel_t channel, mpai_message_store_channel_stats_t* stats, MPAI_AIM_MessageStore_t** latest_store)
+{
+	memset(stats, 0, sizeof(*stats));
+	*latest_store = NULL;
+
+	for (int i = 0; i < MIN(mpai_message_store_count, MPAI_AIF_AIW_MAX); i++)
+	{
+		mpai_message_store_channel_stats_t store_stats;
+		if (message_store_list[i]._message_store == NULL ||
+			MPAI_MessageStore_Get_Channel_Stats(message_store_list[i]._message_store, channel, &store_stats).code != MPAI_AIF_OK)
+		{
+			continue;
+		}
+
+		stats->_published += store_stats._published;
+		stats->_copied += store_stats._copied;
+		stats->_subscribers += store_stats._subscribers;
+		stats->_max_latency_ms = MAX(stats->_max_latency_ms, store_stats._max_latency_ms);
+		if (store_stats._last_timestamp > stats->_last_timestamp)
+		{
+			stats->_last_timestamp = store_stats._last_timestamp;
+			stats->_last_interval_ms = store_stats._last_interval_ms;
+			stats->_last_latency_ms = store_stats._last_latency_ms;
+			*latest_store = message_store_list[i]._message_store;
+		}
+	}
+}
+
+int _telemetry_send(struct coap_resource* resource, uint8_t type, uint8_t code, uint16_t id, const uint8_t* token, uint8_t tkl,
+					bool observe, const struct sockaddr* addr, socklen_t addr_len)
+{
+	int payload_len = _telemetry_encode(resource->user_data, telemetry_payload, sizeof(telemetry_payload));
+	if (payload_len < 0)
+	{
+		LOG_WRN("Telemetry of /%s/%s does not fit (%d)", log_strdup(resource->path[0]), log_strdup(resource->path[1]), payload_len);
+		code = COAP_RESPONSE_CODE_INTERNAL_ERROR;
+	}
+
+	struct coap_packet response;
+	int r = coap_packet_init(&response, telemetry_tx_buffer, sizeof(telemetry_tx_buffer), COAP_VERSION_1, type, tkl, token, code, id);
+	if (r == 0 && payload_len >= 0)
+	{
+		if (observe)
+		{
+			r = coap_append_option_int(&response, COAP_OPTION_OBSERVE, resource->age);
+		}
+		if (r == 0)
+		{
+			r = coap_append_option_int(&response, COAP_OPTION_CONTENT_FORMAT, COAP_CONTENT_FORMAT_APP_CBOR);
+		}
+		if (r == 0)
+		{
+			r = coap_packet_append_payload_marker(&response);
+		}
+		if (r == 0)
+		{
+			r = coap_packet_append_payload(&response, telemetry_payload, payload_len);
+		}
+	}
+	if (r < 0)
+	{
+		return r;
+	}
+
+	return sendto(telemetry_sock, response.data, response.offset, 0, addr, addr_len) < 0 ? -errno : 0;
+}
+
+int _telemetry_send_empty(uint8_t type, uint8_t code, const struct coap_packet* request, const struct sockaddr* addr, socklen_t addr_len)
+{
+	uint8_t token[COAP_TOKEN_MAX_LEN];
+	uint8_t tkl = coap_header_get_token(request, token);
+	uint16_t id = coap_header_get_id(request);
+	if (coap_header_get_type(request) != COAP_TYPE_CON)
+	{
+		type = COAP_TYPE_NON_CON;
+		id = coap_next_id();
+	}
+
+	struct coap_packet response;
+	int r = coap_packet_init(&response, telemetry_tx_buffer, sizeof(telemetry_tx_buffer), COAP_VERSION_1, type, tkl, token, code, id);
+	if (r < 0)
+	{
+		return r;
+	}
+	return sendto(telemetry_sock, response.data, response.offset, 0, addr, addr_len) < 0 ? -errno : 0;
+}
+
+void _telemetry_observe(struct coap_resource* resource, const struct coap_packet* request, const struct sockaddr* addr, int observe)
+{
+	uint8_t token[COAP_TOKEN_MAX_LEN];
+	uint8_t tkl = coap_header_get_token(request, token);
+
+	// a client observes a resource once: a new registration replaces the previous one
+	for (int i = 0; i < CONFIG_MPAI_TELEMETRY_MAX_OBSERVERS; i++)
+	{
+		telemetry_observer_t* observer = &telemetry_observers[i];
+		if (observer->_resource == resource && memcmp(&observer->_observer.addr, addr, sizeof(struct sockaddr)) == 0 &&
+			(observe == 0 || (observer->_observer.tkl == tkl && memcmp(observer->_observer.token, token, tkl) == 0)))
+		{
+			_telemetry_remove_observer(observer);
+		}
+	}
+	if (observe != 0)
+	{
+		return;
+	}
+
+	for (int i = 0; i < CONFIG_MPAI_TELEMETRY_MAX_OBSERVERS; i++)
+	{
+		telemetry_observer_t* observer = &telemetry_observers[i];
+		if (observer->_resource == NULL)
+		{
+			memset(observer, 0, sizeof(*observer));
+			coap_observer_init(&observer->_observer, request, addr);
+			coap_register_observer(resource, &observer->_observer);
+			observer->_resource = resource;
+			return;
+		}
+	}
+	LOG_WRN("Too many observers: /%s/%s served once", log_strdup(resource->path[0]), log_strdup(resource->path[1]));
+}
+
+void _telemetry_remove_observer(telemetry_observer_t* observer)
+{
+	coap_remove_observer(observer->_resource, &observer->_observer);
+	memset(observer, 0, sizeof(*observer));
+}
+
+void _telemetry_handle_empty(const struct coap_packet* packet, const struct sockaddr* addr)
+{
+	uint8_t type = coap_header_get_type(packet);
+	uint16_t id = coap_header_get_id(packet);
+
+	for (int i = 0; i < CONFIG_MPAI_TELEMETRY_MAX_OBSERVERS; i++)
+	{
+		telemetry_observer_t* observer = &telemetry_observers[i];
+		if (observer->_resource == NULL || observer->_last_id != id ||
+			memcmp(&observer->_observer.addr, addr, sizeof(struct sockaddr)) != 0)
+		{
+			continue;
+		}
+
+		if (type == COAP_TYPE_RESET)
+		{
+			// the client forgot the observation
+			_telemetry_remove_observer(observer);
+		}
+		else if (type == COAP_TYPE_ACK)
+		{
+			observer->_unacked = false;
+		}
+	}
+}
+
+void _telemetry_tick(uint32_t elapsed_ms)
+{
+	for (int i = 0; i < MIN(mpai_controller_aim_count, MPAI_AIF_AIM_MAX); i++)
+	{
+		aim_initialization_cb_t* aim_init = MPAI_AIM_List[i];
+		mpai_aim_control_t* control = aim_init != NULL && aim_init->_aim != NULL ? MPAI_AIM_Get_Control(aim_init->_aim) : NULL;
+		if (control == NULL)
+		{
+			telemetry_aim_cpu[i] = 0;
+			continue;
+		}
+
+		mpai_aim_control_stats_t stats;
+		MPAI_AIM_Control_Get_Stats(control, &stats);
+		uint32_t execution_ms = stats._execution_ms - telemetry_aim_execution_ms[i];
+		telemetry_aim_execution_ms[i] = stats._execution_ms;
+		telemetry_aim_cpu[i] = elapsed_ms > 0 ? MIN(1000, (uint64_t) execution_ms * 1000 / elapsed_ms) : 0;
+	}
+
+	for (int i = 1; i < telemetry_resource_count; i++)
+	{
+		struct coap_resource* resource = &telemetry_resources[i];
+		telemetry_resource_t* data = resource->user_data;
+		if (sys_slist_is_empty(&resource->observers))
+		{
+			continue;
+		}
+
+		if (data->_type != TELEMETRY_RESOURCE_AIMS)
+		{
+			// the channels are notified only when a message is published
+			mpai_message_store_channel_stats_t stats;
+			MPAI_AIM_MessageStore_t* latest_store;
+			_telemetry_channel_stats(data->_channel, &stats, &latest_store);
+			if (stats._published == data->_notified)
+			{
+				continue;
+			}
+			data->_notified = stats._published;
+		}
+		coap_resource_notify(resource);
+	}
+}
+
+int _telemetry_get(struct coap_resource* resource, struct coap_packet* request, struct sockaddr* addr, socklen_t addr_len)
+{
+	uint8_t token[COAP_TOKEN_MAX_LEN];
+	uint8_t tkl = coap_header_get_token(request, token);
+	uint16_t id = coap_header_get_id(request);
+	uint8_t type = COAP_TYPE_ACK;
+	if (coap_header_get_type(request) != COAP_TYPE_CON)
+	{
+		type = COAP_TYPE_NON_CON;
+		id = coap_next_id();
+	}
+
+	int observe = coap_get_option_int(request, COAP_OPTION_OBSERVE);
+	if (observe == 0 || observe == 1)
+	{
+		_telemetry_observe(resource, request, addr, observe);
+	}
+
+	bool observed = false;
+	for (int i = 0; i < CONFIG_MPAI_TELEMETRY_MAX_OBSERVERS && observe == 0; i++)
+	{
+		observed |= telemetry_observers[i]._resource == resource &&
+					memcmp(&telemetry_observers[i]._observer.addr, addr, sizeof(struct sockaddr)) == 0;
+	}
+	return _telemetry_send(resource, type, COAP_RESPONSE_CODE_CONTENT, id, token, tkl, observed, addr, addr_len);
+}
+
+int _telemetry_well_known_core_get(struct coap_resource* resource, struct coap_packet* request, struct sockaddr* addr, socklen_t addr_len)
+{
+	struct coap_packet response;
+	int r = coap_well_known_core_get(resource, request, &response, telemetry_tx_buffer, sizeof(telemetry_tx_buffer));
+	if (r < 0)
+	{
+		return r;
+	}
+	return sendto(telemetry_sock, response.data, response.offset, 0, addr, addr_len) < 0 ? -errno : 0;
+}
+
+#ifdef CONFIG_MPAI_BOOT_TRACE
+int _telemetry_boot_trace_get(struct coap_resource* resource, struct coap_packet* request, struct sockaddr* addr, socklen_t addr_len)
+{
+	uint8_t token[COAP_TOKEN_MAX_LEN];
+	uint8_t tkl = coap_header_get_token(request, token);
+	uint16_t id = coap_header_get_id(request);
+	uint8_t type = COAP_TYPE_ACK;
+	if (coap_header_get_type(request) != COAP_TYPE_CON)
+	{
+		type = COAP_TYPE_NON_CON;
+		id = coap_next_id();
+	}
+
+	// the block asked by the client, if not larger than the payloads: the JSON is written again at each block
+	int block2 = coap_get_option_int(request, COAP_OPTION_BLOCK2);
+	uint32_t num = block2 >= 0 ? block2 >> 4 : 0;
+	uint8_t szx = block2 >= 0 ? MIN(block2 & 0x7, TELEMETRY_MAX_BLOCK_SZX) : TELEMETRY_MAX_BLOCK_SZX;
+	size_t block_size = 1 << (szx + 4);
+	size_t offset = num * block_size;
+	size_t len = boot_trace_json((char*)telemetry_payload, block_size, offset);
+	uint8_t code = offset < len || offset == 0 ? COAP_RESPONSE_CODE_CONTENT : COAP_RESPONSE_CODE_BAD_OPTION;
+	size_t payload_len = offset < len ? MIN(block_size, len - offset) : 0;
+
+	struct coap_packet response;
+	int r = coap_packet_init(&response, telemetry_tx_buffer, sizeof(telemetry_tx_buffer), COAP_VERSION_1, type, tkl, token, code, id);
+	if (r == 0 && code == COAP_RESPONSE_CODE_CONTENT)
+	{
+		r = coap_append_option_int(&response, COAP_OPTION_CONTENT_FORMAT, COAP_CONTENT_FORMAT_APP_JSON);
+		if (r == 0)
+		{
+			r = coap_append_option_int(&response, COAP_OPTION_BLOCK2, (num << 4) | ((offset + payload_len < len) << 3) | szx);
+		}
+		if (r == 0 && num == 0)
+		{
+			r = coap_append_option_int(&response, COAP_OPTION_SIZE2, len);
+		}
+		if (r == 0 && payload_len > 0)
+		{
+			r = coap_packet_append_payload_marker(&response);
+		}
+		if (r == 0 && payload_len > 0)
+		{
+			r = coap_packet_append_payload(&response, telemetry_payload, payload_len);
+		}
+	}
+	if (r < 0)
+	{
+		return r;
+	}
+	return sendto(telemetry_sock, response.data, response.offset, 0, addr, addr_len) < 0 ? -errno : 0;
+}
+#endif
+
+void _telemetry_notify(struct coap_resource* resource, struct coap_observer* coap_observer)
+{
+	telemetry_observer_t* observer = CONTAINER_OF(coap_observer, telemetry_observer_t, _observer);
+
+	uint8_t type = COAP_TYPE_NON_CON;
+	if (++observer->_sent % TELEMETRY_CON_NOTIFY_EVERY == 0)
+	{
+		if (observer->_unacked)
+		{
+			// the client is gone without a reset: the observer is freed after this round of notifications
+			LOG_INF("Observer of /%s/%s not responding", log_strdup(resource->path[0]), log_strdup(resource->path[1]));
+			observer->_sent = UINT32_MAX;
+			return;
+		}
+		type = COAP_TYPE_CON;
+		observer->_unacked = true;
+	}
+
+	observer->_last_id = coap_next_id();
+	int r = _telemetry_send(resource, type, COAP_RESPONSE_CODE_CONTENT, observer->_last_id, coap_observer->token, coap_observer->tkl,
+							true, &coap_observer->addr, sizeof(coap_observer->addr));
+	if (r < 0)
+	{
+		LOG_DBG("Notification not sent (%d)", r);
+	}
+}
+
+void th_telemetry_server(void *dummy1, void *dummy2, void *dummy3)
+{
+	ARG_UNUSED(dummy1);
+	ARG_UNUSED(dummy2);
+	ARG_UNUSED(dummy3);
+
+	wifi_connect();
+
+	telemetry_sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (telemetry_sock < 0)
+	{
+		LOG_ERR("Telemetry socket not created (%d)", errno);
+		atomic_set(&telemetry_server_started, 0);
+		return;
+	}
+
+	struct sockaddr_in addr = {0};
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = INADDR_ANY;
+	addr.sin_port = htons(CONFIG_MPAI_TELEMETRY_SERVER_PORT);
+	if (bind(telemetry_sock, (struct sockaddr *) &addr, sizeof(addr)) < 0)
+	{
+		LOG_ERR("Telemetry socket not bound to port %d (%d)", CONFIG_MPAI_TELEMETRY_SERVER_PORT, errno);
+		(void)close(telemetry_sock);
+		atomic_set(&telemetry_server_started, 0);
+		return;
+	}
+
+	_telemetry_sync_resources();
+	LOG_INF("Telemetry served on port %d", CONFIG_MPAI_TELEMETRY_SERVER_PORT);
+
+	struct pollfd fds = { .fd = telemetry_sock, .events = POLLIN };
+	int64_t tick_ts = k_uptime_get();
+	while (true)
+	{
+		int64_t now = k_uptime_get();
+		int timeout_ms = (int) CLAMP(tick_ts + CONFIG_MPAI_TELEMETRY_INTERVAL_MS - now, 0, CONFIG_MPAI_TELEMETRY_INTERVAL_MS);
+		if (poll(&fds, 1, timeout_ms) > 0 && (fds.revents & POLLIN))
+		{
+			struct sockaddr client_addr;
+			socklen_t client_addr_len = sizeof(client_addr);
+			memset(&client_addr, 0, sizeof(client_addr));
+			int received = recvfrom(telemetry_sock, telemetry_rx_buffer, sizeof(telemetry_rx_buffer), 0, &client_addr, &client_addr_len);
+
+			struct coap_packet request;
+			struct coap_option options[16];
+			if (received > 0 && coap_packet_parse(&request, telemetry_rx_buffer, received, options, ARRAY_SIZE(options)) == 0)
+			{
+				if (coap_header_get_code(&request) == COAP_CODE_EMPTY)
+				{
+					_telemetry_handle_empty(&request, &client_addr);
+				}
+				else
+				{
+					_telemetry_sync_resources();
+					int r = coap_handle_request(&request, telemetry_resources, options, ARRAY_SIZE(options), &client_addr, client_addr_len);
+					if (r == -ENOENT)
+					{
+						_telemetry_send_empty(COAP_TYPE_ACK, COAP_RESPONSE_CODE_NOT_FOUND, &request, &client_addr, client_addr_len);
+					}
+					else if (r == -EPERM || r == -ENOTSUP)
+					{
+						_telemetry_send_empty(COAP_TYPE_ACK, COAP_RESPONSE_CODE_NOT_ALLOWED, &request, &client_addr, client_addr_len);
+					}
+					else if (r < 0)
+					{
+						LOG_DBG("Telemetry request not served (%d)", r);
+					}
+				}
+			}
+		}
+
+		now = k_uptime_get();
+		if (now - tick_ts >= CONFIG_MPAI_TELEMETRY_INTERVAL_MS)
+		{
+			_telemetry_sync_resources();
+			_telemetry_tick((uint32_t) (now - tick_ts));
+			tick_ts = now;
+
+			// the observers not responding are removed out of the notifications
+			for (int i = 0; i < CONFIG_MPAI_TELEMETRY_MAX_OBSERVERS; i++)
+			{
+				if (telemetry_observers[i]._resource != NULL && telemetry_observers[i]._sent == UINT32_MAX)
+				{
+					_telemetry_remove_observer(&telemetry_observers[i]);
+				}
+			}
+		}
+	}
+}
+#endif
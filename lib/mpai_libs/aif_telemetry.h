@@ -0,0 +1,34 @@
+/*
+ * @file
+ * @brief Headers of the telemetry of the MPAI AIF, served on CoAP
+ *
+ * The node serves its live state as CBOR resources (content format 60), which can be
+ * observed (RFC 7641) to receive their changes:
+ *   /aif/aiw/<AIW id>/aims      for each AIM of the AIW: state, CPU, activations and response times
+ *   /channels/<name>/stats      publications, reads and latency of a channel of the message store
+ *   /channels/<name>/latest     the latest message of a channel, as encoded by its encoder
+ *   /boot/trace                 the timeline of the boot, as Chrome trace (JSON, block-wise), with
+ *                               CONFIG_MPAI_BOOT_TRACE
+ *   /.well-known/core           the list of the resources (link format)
+ * The observers are notified every CONFIG_MPAI_TELEMETRY_INTERVAL_MS: the AIMs at each
+ * interval, the channels only if new messages have been published.
+ *
+ * Copyright (c) 2022 University of Turin, Daniele Bortoluzzi <danieleb88@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef MPAI_LIBS_AIF_TELEMETRY_H
+#define MPAI_LIBS_AIF_TELEMETRY_H
+
+#include <aif_controller.h>
+
+/**
+ * @brief Start the telemetry server, with the resources of the AIWs and channels created so far
+ *
+ * @return int 0 if started, -EALREADY if running, -ENOTSUP without CONFIG_MPAI_TELEMETRY_SERVER,
+ * negative on other errors
+ */
+int MPAI_Telemetry_Server_Start(void);
+
+#endif
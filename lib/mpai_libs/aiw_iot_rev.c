@@ -22,37 +22,31 @@ subscriber_channel_t MIC_PEAK_DATA_CHANNEL;
 subscriber_channel_t MOTION_DATA_CHANNEL;
 subscriber_channel_t MYCOMP_DATA_CHANNEL;
 
-
-#ifdef CONFIG_MPAI_AIM_CONTROL_UNIT_SENSORS_PERIODIC
-
-/******** START PERIODIC MODE ***********/
-void aim_timer_switch_status(struct k_work *work)
-{
-	int* status = (int *)k_malloc(sizeof(int));
-	mpai_error_t err = MPAI_AIFU_AIM_GetStatus(AIW_IOT_REV, MPAI_LIBS_IOT_REV_AIM_SENSORS_NAME, status);
-	if (err.code == MPAI_AIF_OK)
-	{
-		if (MPAI_AIM_ALIVE == *status)
-		{
-			MPAI_AIM_Pause(aim_produce_sensors);
-		}
-		else
-		{
-			MPAI_AIM_Resume(aim_produce_sensors);
-		}
-	}
-	k_free(status);
-}
-
-K_WORK_DEFINE(my_work, aim_timer_switch_status);
-
-void aim_timer_handler(struct k_timer *dummy)
-{
-	k_work_submit(&my_work);
-}
-
-K_TIMER_DEFINE(aim_timer, aim_timer_handler, NULL);
-/******** END PERIODIC MODE ***********/
+/* SubAIMs of docs/mpai_aiw_iot_rev.json disabled in the firmware */
+static const char* const aiw_iot_rev_disabled_aims[] = {
+#ifndef CONFIG_MPAI_AIM_TELEMETRY_UPLINK
+	MPAI_LIBS_IOT_REV_AIM_TELEMETRY_UPLINK_NAME,
+#endif
+#ifndef CONFIG_MPAI_AIM_BLE_STREAM
+	MPAI_LIBS_IOT_REV_AIM_BLE_STREAM_NAME,
+#endif
+	NULL
+};
+
+#ifdef CONFIG_MPAI_TELEMETRY_SERVER
+/************* PRIVATE HEADER *************/
+/* encoders of the latest messages of the channels, served by the telemetry */
+int _encode_sensors_message(const mpai_message_t* message, uint8_t* buffer, size_t size);
+int _encode_mic_peak_message(const mpai_message_t* message, uint8_t* buffer, size_t size);
+int _encode_motion_message(const mpai_message_t* message, uint8_t* buffer, size_t size);
+int _encode_mycomp_message(const mpai_message_t* message, uint8_t* buffer, size_t size);
+#endif
+#if defined(CONFIG_MPAI_AIM_TELEMETRY_UPLINK) || defined(CONFIG_MPAI_AIM_BLE_STREAM)
+/* samplers of the messages of the channels, sent by the telemetry uplink and streamed over Bluetooth */
+int _sample_sensors_message(const mpai_message_t* message, int32_t* values, size_t max_count);
+int _sample_mic_peak_message(const mpai_message_t* message, int32_t* values, size_t max_count);
+int _sample_motion_message(const mpai_message_t* message, int32_t* values, size_t max_count);
+int _sample_mycomp_message(const mpai_message_t* message, int32_t* values, size_t max_count);
 #endif
 
 /************* PUBLIC HEADER *************/
@@ -70,6 +64,8 @@ int MPAI_AIW_IOT_REV_Init()
     message_store_rehabilitation_aim = message_store_test_case_aiw;
 	message_store_mycomp_aim = message_store_test_case_aiw;
 	message_store_mycompanalysis_aim = message_store_test_case_aiw;
+	message_store_telemetry_uplink_aim = message_store_test_case_aiw;
+	message_store_ble_stream_aim = message_store_test_case_aiw;
 
 
 
@@ -92,9 +88,32 @@ int MPAI_AIW_IOT_REV_Init()
 	channel_map_element_t mycomp_data_channel = {._channel_name = MPAI_LIBS_IOT_REV_MYCOMP_DATA_CHANNEL_NAME, ._channel = MYCOMP_DATA_CHANNEL};
 	message_store_channel_list[mpai_message_store_channel_count++] = mycomp_data_channel;
 
+#ifdef CONFIG_MPAI_TELEMETRY_SERVER
+	// the payloads hold pointers: the latest messages are kept encoded (the mic buffer is too large)
+	MPAI_MessageStore_Set_Channel_Encoder(message_store_test_case_aiw, SENSORS_DATA_CHANNEL, _encode_sensors_message);
+	MPAI_MessageStore_Set_Channel_Encoder(message_store_test_case_aiw, MIC_PEAK_DATA_CHANNEL, _encode_mic_peak_message);
+	MPAI_MessageStore_Set_Channel_Encoder(message_store_test_case_aiw, MOTION_DATA_CHANNEL, _encode_motion_message);
+	MPAI_MessageStore_Set_Channel_Encoder(message_store_test_case_aiw, MYCOMP_DATA_CHANNEL, _encode_mycomp_message);
+#endif
+#ifdef CONFIG_MPAI_AIM_TELEMETRY_UPLINK
+	// the channels sent are the ones connected to the uplink by the topology
+	telemetry_uplink_aim_set_sampler(SENSORS_DATA_CHANNEL, _sample_sensors_message);
+	telemetry_uplink_aim_set_sampler(MIC_PEAK_DATA_CHANNEL, _sample_mic_peak_message);
+	telemetry_uplink_aim_set_sampler(MOTION_DATA_CHANNEL, _sample_motion_message);
+	telemetry_uplink_aim_set_sampler(MYCOMP_DATA_CHANNEL, _sample_mycomp_message);
+#endif
+#ifdef CONFIG_MPAI_AIM_BLE_STREAM
+	// the channels streamed are the ones connected to the stream by the topology
+	ble_stream_aim_set_sampler(SENSORS_DATA_CHANNEL, _sample_sensors_message);
+	ble_stream_aim_set_sampler(MIC_PEAK_DATA_CHANNEL, _sample_mic_peak_message);
+	ble_stream_aim_set_sampler(MOTION_DATA_CHANNEL, _sample_motion_message);
+	ble_stream_aim_set_sampler(MYCOMP_DATA_CHANNEL, _sample_mycomp_message);
+#endif
+
 
-	// add aims to list with related callback
-	aim_initialization_cb_t* aim_data_mic_init_cb = (aim_initialization_cb_t *) k_malloc(sizeof(aim_initialization_cb_t));
+	// add aims to list with related callback (zeroed, so no field is left with garbage:
+	// MPAI_Controller_Find_AIM_Init_Config reads the AIM before it is created)
+	aim_initialization_cb_t* aim_data_mic_init_cb = (aim_initialization_cb_t *) k_calloc(1, sizeof(aim_initialization_cb_t));
 	aim_data_mic_init_cb->_aim_name = MPAI_LIBS_IOT_REV_AIM_DATA_MIC_NAME;
 	aim_data_mic_init_cb->_subscriber = data_mic_aim_subscriber;
 	aim_data_mic_init_cb->_start = data_mic_aim_start;
@@ -103,9 +122,12 @@ int MPAI_AIW_IOT_REV_Init()
 	aim_data_mic_init_cb->_pause = data_mic_aim_pause;
 	aim_data_mic_init_cb->_input_channels = NULL;
 	aim_data_mic_init_cb->_count_channels = 0;
+	aim_data_mic_init_cb->_control = &data_mic_aim_control;
+	aim_data_mic_init_cb->_metadata = NULL;
+	aim_data_mic_init_cb->_aim = NULL;
 	MPAI_AIM_List[mpai_controller_aim_count++] = aim_data_mic_init_cb;
 
-	aim_initialization_cb_t* aim_data_sensors_init_cb = (aim_initialization_cb_t *) k_malloc(sizeof(aim_initialization_cb_t));
+	aim_initialization_cb_t* aim_data_sensors_init_cb = (aim_initialization_cb_t *) k_calloc(1, sizeof(aim_initialization_cb_t));
 	aim_data_sensors_init_cb->_aim_name = MPAI_LIBS_IOT_REV_AIM_SENSORS_NAME;
 	aim_data_sensors_init_cb->_subscriber = sensors_aim_subscriber;
 	aim_data_sensors_init_cb->_start = sensors_aim_start;
@@ -114,9 +136,12 @@ int MPAI_AIW_IOT_REV_Init()
 	aim_data_sensors_init_cb->_pause = sensors_aim_pause;
 	aim_data_sensors_init_cb->_input_channels = NULL;
 	aim_data_sensors_init_cb->_count_channels = 0;
+	aim_data_sensors_init_cb->_control = &sensors_aim_control;
+	aim_data_sensors_init_cb->_metadata = NULL;
+	aim_data_sensors_init_cb->_aim = NULL;
 	MPAI_AIM_List[mpai_controller_aim_count++] = aim_data_sensors_init_cb;
 
-	aim_initialization_cb_t* aim_temp_limit_init_cb = (aim_initialization_cb_t *) k_malloc(sizeof(aim_initialization_cb_t));
+	aim_initialization_cb_t* aim_temp_limit_init_cb = (aim_initialization_cb_t *) k_calloc(1, sizeof(aim_initialization_cb_t));
 	aim_temp_limit_init_cb->_aim_name = MPAI_LIBS_IOT_REV_AIM_TEMP_LIMIT_NAME;
 	aim_temp_limit_init_cb->_subscriber = temp_limit_aim_subscriber;
 	aim_temp_limit_init_cb->_start = temp_limit_aim_start;
@@ -125,9 +150,12 @@ int MPAI_AIW_IOT_REV_Init()
 	aim_temp_limit_init_cb->_pause = temp_limit_aim_pause;
 	aim_temp_limit_init_cb->_input_channels = NULL;
 	aim_temp_limit_init_cb->_count_channels = 0;
+	aim_temp_limit_init_cb->_control = &temp_limit_aim_control;
+	aim_temp_limit_init_cb->_metadata = NULL;
+	aim_temp_limit_init_cb->_aim = NULL;
 	MPAI_AIM_List[mpai_controller_aim_count++] = aim_temp_limit_init_cb;
 
-	aim_initialization_cb_t* aim_motion_init_cb = (aim_initialization_cb_t *) k_malloc(sizeof(aim_initialization_cb_t));
+	aim_initialization_cb_t* aim_motion_init_cb = (aim_initialization_cb_t *) k_calloc(1, sizeof(aim_initialization_cb_t));
 	aim_motion_init_cb->_aim_name = MPAI_LIBS_IOT_REV_AIM_MOTION_NAME;
 	aim_motion_init_cb->_subscriber = motion_aim_subscriber;
 	aim_motion_init_cb->_start = motion_aim_start;
@@ -136,11 +164,14 @@ int MPAI_AIW_IOT_REV_Init()
 	aim_motion_init_cb->_pause = motion_aim_pause;
 	aim_motion_init_cb->_input_channels = NULL;
 	aim_motion_init_cb->_count_channels = 0;
+	aim_motion_init_cb->_control = &motion_aim_control;
+	aim_motion_init_cb->_metadata = NULL;
+	aim_motion_init_cb->_aim = NULL;
 	MPAI_AIM_List[mpai_controller_aim_count++] = aim_motion_init_cb;
 
 	////////////////////MYCOMP Initilization
  
-	aim_initialization_cb_t* aim_mycomp_init_cb = (aim_initialization_cb_t *) k_malloc(sizeof(aim_initialization_cb_t));
+	aim_initialization_cb_t* aim_mycomp_init_cb = (aim_initialization_cb_t *) k_calloc(1, sizeof(aim_initialization_cb_t));
 	aim_mycomp_init_cb->_aim_name = MPAI_LIBS_IOT_REV_MYCOMP_NAME;
 	aim_mycomp_init_cb->_subscriber = mycomp_aim_subscriber;
 	aim_mycomp_init_cb->_start =  mycomp_aim_start;
@@ -149,9 +180,12 @@ int MPAI_AIW_IOT_REV_Init()
 	aim_mycomp_init_cb->_pause = mycomp_aim_pause;
 	aim_mycomp_init_cb->_input_channels = NULL;
 	aim_mycomp_init_cb->_count_channels = 0;
+	aim_mycomp_init_cb->_control = &mycomp_aim_control;
+	aim_mycomp_init_cb->_metadata = NULL;
+	aim_mycomp_init_cb->_aim = NULL;
 	MPAI_AIM_List[mpai_controller_aim_count++] = aim_mycomp_init_cb;
 
-	aim_initialization_cb_t* aim_rehabilitation_init_cb = (aim_initialization_cb_t *) k_malloc(sizeof(aim_initialization_cb_t));
+	aim_initialization_cb_t* aim_rehabilitation_init_cb = (aim_initialization_cb_t *) k_calloc(1, sizeof(aim_initialization_cb_t));
 	aim_rehabilitation_init_cb->_aim_name = MPAI_LIBS_IOT_REV_AIM_REHABILITATION_NAME;
 	aim_rehabilitation_init_cb->_subscriber = rehabilitation_aim_subscriber;
 	aim_rehabilitation_init_cb->_start = rehabilitation_aim_start;
@@ -160,25 +194,70 @@ int MPAI_AIW_IOT_REV_Init()
 	aim_rehabilitation_init_cb->_pause = rehabilitation_aim_pause;
 	aim_rehabilitation_init_cb->_input_channels = NULL;
 	aim_rehabilitation_init_cb->_count_channels = 0;
+	aim_rehabilitation_init_cb->_control = &rehabilitation_aim_control;
+	aim_rehabilitation_init_cb->_metadata = NULL;
+	aim_rehabilitation_init_cb->_aim = NULL;
 	MPAI_AIM_List[mpai_controller_aim_count++] = aim_rehabilitation_init_cb;
 
 
 	/// @brief ///////////////////////mycompanalysis
 	/// @return 
-	aim_initialization_cb_t* aim_mycompanalysis_init_cb = (aim_initialization_cb_t *) k_malloc(sizeof(aim_initialization_cb_t));
-	aim_rehabilitation_init_cb->_aim_name = MPAI_LIBS_IOT_REV_AIM_REHABILITATION_NAME;
-	aim_rehabilitation_init_cb->_subscriber = mycompanalysis_aim_subscriber;
-	aim_rehabilitation_init_cb->_start = mycompanalysis_aim_start;
-	aim_rehabilitation_init_cb->_stop = mycompanalysis_aim_stop;
-	aim_rehabilitation_init_cb->_resume = mycompanalysis_aim_resume;
-	aim_rehabilitation_init_cb->_pause = mycompanalysis_aim_pause;
-	aim_rehabilitation_init_cb->_input_channels = NULL;
-	aim_rehabilitation_init_cb->_count_channels = 0;
+	aim_initialization_cb_t* aim_mycompanalysis_init_cb = (aim_initialization_cb_t *) k_calloc(1, sizeof(aim_initialization_cb_t));
+	aim_mycompanalysis_init_cb->_aim_name = MPAI_LIBS_IOT_REV_AIM_MYCOMPANALYSIS_NAME;
+	aim_mycompanalysis_init_cb->_subscriber = mycompanalysis_aim_subscriber;
+	aim_mycompanalysis_init_cb->_start = mycompanalysis_aim_start;
+	aim_mycompanalysis_init_cb->_stop = mycompanalysis_aim_stop;
+	aim_mycompanalysis_init_cb->_resume = mycompanalysis_aim_resume;
+	aim_mycompanalysis_init_cb->_pause = mycompanalysis_aim_pause;
+	aim_mycompanalysis_init_cb->_input_channels = NULL;
+	aim_mycompanalysis_init_cb->_count_channels = 0;
+	aim_mycompanalysis_init_cb->_control = &mycompanalysis_aim_control;
+	aim_mycompanalysis_init_cb->_metadata = NULL;
+	aim_mycompanalysis_init_cb->_aim = NULL;
 	MPAI_AIM_List[mpai_controller_aim_count++] = aim_mycompanalysis_init_cb;
 
-	#ifdef CONFIG_MPAI_AIM_CONTROL_UNIT_SENSORS_PERIODIC
-			/* start periodic timer to switch status */
-			k_timer_start(&aim_timer, K_SECONDS(5), K_SECONDS(5));
+#ifdef CONFIG_MPAI_AIM_TELEMETRY_UPLINK
+	aim_initialization_cb_t* aim_telemetry_uplink_init_cb = (aim_initialization_cb_t *) k_calloc(1, sizeof(aim_initialization_cb_t));
+	aim_telemetry_uplink_init_cb->_aim_name = MPAI_LIBS_IOT_REV_AIM_TELEMETRY_UPLINK_NAME;
+	aim_telemetry_uplink_init_cb->_subscriber = telemetry_uplink_aim_subscriber;
+	aim_telemetry_uplink_init_cb->_start = telemetry_uplink_aim_start;
+	aim_telemetry_uplink_init_cb->_stop = telemetry_uplink_aim_stop;
+	aim_telemetry_uplink_init_cb->_resume = telemetry_uplink_aim_resume;
+	aim_telemetry_uplink_init_cb->_pause = telemetry_uplink_aim_pause;
+	aim_telemetry_uplink_init_cb->_input_channels = NULL;
+	aim_telemetry_uplink_init_cb->_count_channels = 0;
+	aim_telemetry_uplink_init_cb->_control = &telemetry_uplink_aim_control;
+	aim_telemetry_uplink_init_cb->_metadata = NULL;
+	aim_telemetry_uplink_init_cb->_aim = NULL;
+	MPAI_AIM_List[mpai_controller_aim_count++] = aim_telemetry_uplink_init_cb;
+#endif
+#ifdef CONFIG_MPAI_AIM_BLE_STREAM
+	aim_initialization_cb_t* aim_ble_stream_init_cb = (aim_initialization_cb_t *) k_calloc(1, sizeof(aim_initialization_cb_t));
+	aim_ble_stream_init_cb->_aim_name = MPAI_LIBS_IOT_REV_AIM_BLE_STREAM_NAME;
+	aim_ble_stream_init_cb->_subscriber = ble_stream_aim_subscriber;
+	aim_ble_stream_init_cb->_start = ble_stream_aim_start;
+	aim_ble_stream_init_cb->_stop = ble_stream_aim_stop;
+	aim_ble_stream_init_cb->_resume = ble_stream_aim_resume;
+	aim_ble_stream_init_cb->_pause = ble_stream_aim_pause;
+	aim_ble_stream_init_cb->_input_channels = NULL;
+	aim_ble_stream_init_cb->_count_channels = 0;
+	aim_ble_stream_init_cb->_control = &ble_stream_aim_control;
+	aim_ble_stream_init_cb->_metadata = NULL;
+	aim_ble_stream_init_cb->_aim = NULL;
+	MPAI_AIM_List[mpai_controller_aim_count++] = aim_ble_stream_init_cb;
+#endif
+
+	#ifdef CONFIG_MPAI_AIM_RUNTIME
+			/* ported AIMs add their tasks when started */
+			MPAI_AIM_Runtime_Init();
+	#endif
+	#ifdef CONFIG_MPAI_AIM_SCHEDULER
+			/* AIMs are added with their duty cycles after being started */
+			MPAI_AIM_Scheduler_Init();
+	#endif
+	#ifdef CONFIG_MPAI_AIM_SUPERVISOR
+			/* AIMs are supervised after being started */
+			MPAI_AIM_Supervisor_Init();
 	#endif
 
 	return AIW_IOT_REV;
@@ -186,6 +265,12 @@ int MPAI_AIW_IOT_REV_Init()
 
 void MPAI_AIW_IOT_REV_Stop() 
 {
+	#ifdef CONFIG_MPAI_AIM_BLE_STREAM
+		MPAI_AIFM_AIM_Stop(MPAI_LIBS_IOT_REV_AIM_BLE_STREAM_NAME);
+	#endif
+	#ifdef CONFIG_MPAI_AIM_TELEMETRY_UPLINK
+		MPAI_AIFM_AIM_Stop(MPAI_LIBS_IOT_REV_AIM_TELEMETRY_UPLINK_NAME);
+	#endif
 	#ifdef CONFIG_MPAI_AIM_VALIDATION_MOVEMENT_WITH_AUDIO
 		MPAI_AIFM_AIM_Stop(MPAI_LIBS_IOT_REV_AIM_REHABILITATION_NAME);
 	#endif
@@ -232,10 +317,22 @@ void MPAI_AIW_IOT_REV_Resume()
 	#ifdef CONFIG_MPAI_AIM_MYCOMPANALYSIS_MOVEMENT_WITH_AUDIO
 		MPAI_AIFM_AIM_Stop(MPAI_LIBS_IOT_REV_AIM_MYCOMPANALYSIS_NAME);
 	#endif
+	#ifdef CONFIG_MPAI_AIM_TELEMETRY_UPLINK
+		MPAI_AIFM_AIM_Resume(MPAI_LIBS_IOT_REV_AIM_TELEMETRY_UPLINK_NAME);
+	#endif
+	#ifdef CONFIG_MPAI_AIM_BLE_STREAM
+		MPAI_AIFM_AIM_Resume(MPAI_LIBS_IOT_REV_AIM_BLE_STREAM_NAME);
+	#endif
 }
 
 void MPAI_AIW_IOT_REV_Pause()
 {
+	#ifdef CONFIG_MPAI_AIM_BLE_STREAM
+		MPAI_AIFM_AIM_Pause(MPAI_LIBS_IOT_REV_AIM_BLE_STREAM_NAME);
+	#endif
+	#ifdef CONFIG_MPAI_AIM_TELEMETRY_UPLINK
+		MPAI_AIFM_AIM_Pause(MPAI_LIBS_IOT_REV_AIM_TELEMETRY_UPLINK_NAME);
+	#endif
 	#ifdef CONFIG_MPAI_AIM_VALIDATION_MOVEMENT_WITH_AUDIO
 		MPAI_AIFM_AIM_Pause(MPAI_LIBS_IOT_REV_AIM_REHABILITATION_NAME);
 	#endif
@@ -309,4 +406,179 @@ void MPAI_AIW_IOT_REV_Destroy()
 			MPAI_AIM_Destructor(aim_init->_aim);
 		}
 	#endif
-}
\ No newline at end of file
+	#ifdef CONFIG_MPAI_AIM_TELEMETRY_UPLINK
+		{
+			aim_initialization_cb_t* aim_init = MPAI_Controller_Find_AIM_Init_Config(MPAI_LIBS_IOT_REV_AIM_TELEMETRY_UPLINK_NAME);
+			MPAI_AIM_Destructor(aim_init->_aim);
+		}
+	#endif
+	#ifdef CONFIG_MPAI_AIM_BLE_STREAM
+		{
+			aim_initialization_cb_t* aim_init = MPAI_Controller_Find_AIM_Init_Config(MPAI_LIBS_IOT_REV_AIM_BLE_STREAM_NAME);
+			MPAI_AIM_Destructor(aim_init->_aim);
+		}
+	#endif
+}
+
+bool MPAI_AIW_IOT_REV_Is_AIM_Disabled(const char* aim_name)
+{
+	for (size_t i = 0; aiw_iot_rev_disabled_aims[i] != NULL; i++)
+	{
+		if (strcmp(aiw_iot_rev_disabled_aims[i], aim_name) == 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+#ifdef CONFIG_MPAI_TELEMETRY_SERVER
+/************* PRIVATE **************/
+int _encode_sensors_message(const mpai_message_t* message, uint8_t* buffer, size_t size)
+{
+	const sensor_result_t* result = (const sensor_result_t*) message->data;
+	cbor_writer_t writer;
+	cbor_writer_init(&writer, buffer, size);
+
+	// { "t": temperature, "h": humidity, "p": pressure, "a": [x, y, z] }, with the sensors enabled
+	size_t count = 0;
+	#ifdef CONFIG_HTS221
+		count += 2;
+	#endif
+	#ifdef CONFIG_LPS22HB
+		count += 1;
+	#endif
+	#ifdef CONFIG_LSM6DSL
+		count += 1;
+	#endif
+	cbor_put_map(&writer, count);
+	#ifdef CONFIG_HTS221
+		cbor_put_text(&writer, "t");
+		cbor_put_float(&writer, sensor_value_to_double(result->hts221_temp));
+		cbor_put_text(&writer, "h");
+		cbor_put_float(&writer, sensor_value_to_double(result->hts221_hum));
+	#endif
+	#ifdef CONFIG_LPS22HB
+		cbor_put_text(&writer, "p");
+		cbor_put_float(&writer, sensor_value_to_double(result->lps22hb_press));
+	#endif
+	#ifdef CONFIG_LSM6DSL
+		cbor_put_text(&writer, "a");
+		cbor_put_array(&writer, 3);
+		for (int i = 0; i < 3; i++)
+		{
+			cbor_put_float(&writer, sensor_value_to_double(&result->lsm6dsl_accel[i]));
+		}
+	#endif
+	return cbor_writer_get_len(&writer);
+}
+
+int _encode_mic_peak_message(const mpai_message_t* message, uint8_t* buffer, size_t size)
+{
+	const mic_peak_t* peak = (const mic_peak_t*) message->data;
+	cbor_writer_t writer;
+	cbor_writer_init(&writer, buffer, size);
+
+	cbor_put_map(&writer, 1);
+	cbor_put_text(&writer, "peak");
+	cbor_put_int(&writer, *peak->data);
+	return cbor_writer_get_len(&writer);
+}
+
+int _encode_motion_message(const mpai_message_t* message, uint8_t* buffer, size_t size)
+{
+	const motion_data_t* motion = (const motion_data_t*) message->data;
+	cbor_writer_t writer;
+	cbor_writer_init(&writer, buffer, size);
+
+	cbor_put_map(&writer, 2);
+	cbor_put_text(&writer, "type");
+	cbor_put_uint(&writer, motion->motion_type);
+	cbor_put_text(&writer, "accel");
+	cbor_put_float(&writer, motion->accel_total);
+	return cbor_writer_get_len(&writer);
+}
+
+int _encode_mycomp_message(const mpai_message_t* message, uint8_t* buffer, size_t size)
+{
+	const mycomp_data_t* motion = (const mycomp_data_t*) message->data;
+	cbor_writer_t writer;
+	cbor_writer_init(&writer, buffer, size);
+
+	cbor_put_map(&writer, 2);
+	cbor_put_text(&writer, "type");
+	cbor_put_uint(&writer, motion->mycomp_type);
+	cbor_put_text(&writer, "accel");
+	cbor_put_float(&writer, motion->mycomp_accel_total);
+	return cbor_writer_get_len(&writer);
+}
+#endif
+
+#if defined(CONFIG_MPAI_AIM_TELEMETRY_UPLINK) || defined(CONFIG_MPAI_AIM_BLE_STREAM)
+/************* PRIVATE **************/
+/* in thousandths */
+#define SENSOR_VALUE_MILLI(value) ((value)->val1 * 1000 + (value)->val2 / 1000)
+
+int _sample_sensors_message(const mpai_message_t* message, int32_t* values, size_t max_count)
+{
+	const sensor_result_t* result = (const sensor_result_t*) message->data;
+	size_t count = 0;
+
+	// temperature, humidity, pressure, acceleration x, y, z: with the sensors enabled
+	#ifdef CONFIG_HTS221
+		if (count + 2 <= max_count)
+		{
+			values[count++] = SENSOR_VALUE_MILLI(result->hts221_temp);
+			values[count++] = SENSOR_VALUE_MILLI(result->hts221_hum);
+		}
+	#endif
+	#ifdef CONFIG_LPS22HB
+		if (count + 1 <= max_count)
+		{
+			values[count++] = SENSOR_VALUE_MILLI(result->lps22hb_press);
+		}
+	#endif
+	#ifdef CONFIG_LSM6DSL
+		for (int i = 0; i < 3 && count < max_count; i++)
+		{
+			values[count++] = SENSOR_VALUE_MILLI(&result->lsm6dsl_accel[i]);
+		}
+	#endif
+	return count;
+}
+
+int _sample_mic_peak_message(const mpai_message_t* message, int32_t* values, size_t max_count)
+{
+	const mic_peak_t* peak = (const mic_peak_t*) message->data;
+	if (max_count < 1)
+	{
+		return 0;
+	}
+	values[0] = *peak->data;
+	return 1;
+}
+
+int _sample_motion_message(const mpai_message_t* message, int32_t* values, size_t max_count)
+{
+	const motion_data_t* motion = (const motion_data_t*) message->data;
+	if (max_count < 2)
+	{
+		return 0;
+	}
+	values[0] = motion->motion_type;
+	values[1] = (int32_t) (motion->accel_total * 1000);
+	return 2;
+}
+
+int _sample_mycomp_message(const mpai_message_t* message, int32_t* values, size_t max_count)
+{
+	const mycomp_data_t* motion = (const mycomp_data_t*) message->data;
+	if (max_count < 2)
+	{
+		return 0;
+	}
+	values[0] = motion->mycomp_type;
+	values[1] = (int32_t) (motion->mycomp_accel_total * 1000);
+	return 2;
+}
+#endif
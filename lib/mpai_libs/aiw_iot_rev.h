@@ -21,10 +21,15 @@
 #include <aif_controller.h>
 #include <mycomp_aim.h>
 #include <mycompanalysis_aim.h>
+#include <telemetry_uplink_aim.h>
+#include <ble_stream_aim.h>
 
 #if defined(CONFIG_MPAI_CONFIG_STORE)
     #include <config_store.h>
 #endif
+#ifdef CONFIG_MPAI_TELEMETRY_SERVER
+    #include <cbor_writer.h>
+#endif
 
 // TODO: generate dinamically 
 static int AIW_IOT_REV = 1;
@@ -38,6 +43,8 @@ static int AIW_IOT_REV = 1;
 #define MPAI_LIBS_IOT_REV_AIM_REHABILITATION_NAME "MovementsWithAudioValidation"
 
 #define MPAI_LIBS_IOT_REV_AIM_MYCOMPANALYSIS_NAME "MycompMovementsWithAudioValidation"
+#define MPAI_LIBS_IOT_REV_AIM_TELEMETRY_UPLINK_NAME "TelemetryUplink"
+#define MPAI_LIBS_IOT_REV_AIM_BLE_STREAM_NAME "BluetoothStream"
 #define MPAI_LIBS_IOT_REV_SENSORS_DATA_CHANNEL_NAME "SensorsDataChannel"
 #define MPAI_LIBS_IOT_REV_MIC_BUFFER_DATA_CHANNEL_NAME "MicBufferDataChannel"
 #define MPAI_LIBS_IOT_REV_MIC_PEAK_DATA_CHANNEL_NAME "MicPeakDataChannel"
@@ -57,6 +64,8 @@ extern MPAI_AIM_MessageStore_t* message_store_rehabilitation_aim;
 
 extern MPAI_AIM_MessageStore_t* message_store_mycompanalysis_aim;
 extern MPAI_AIM_MessageStore_t* message_store_mycomm_aim;
+extern MPAI_AIM_MessageStore_t* message_store_telemetry_uplink_aim;
+extern MPAI_AIM_MessageStore_t* message_store_ble_stream_aim;
 
 /* AIW global channels used by message store */
 extern subscriber_channel_t SENSORS_DATA_CHANNEL;
@@ -95,4 +104,14 @@ void MPAI_AIW_IOT_REV_Pause();
  * 
  */
 void MPAI_AIW_IOT_REV_Destroy();
+
+/**
+ * @brief Check if a SubAIM of the AIW description is disabled in the firmware (by Kconfig):
+ * it is skipped, with its topology, when the AIW is loaded
+ * 
+ * @param aim_name 
+ * @return true 
+ * @return false if the AIM is built in, or not known
+ */
+bool MPAI_AIW_IOT_REV_Is_AIM_Disabled(const char* aim_name);
 #endif
\ No newline at end of file
@@ -0,0 +1,483 @@
+/*
+ * @file
+ * @brief Implementation of an AIM that streams the messages of its input channels over Bluetooth LE
+ *
+ * Copyright (c) 2022 University of Turin, Daniele Bortoluzzi <danieleb88@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "ble_stream_aim.h"
+
+#ifdef CONFIG_MPAI_AIM_BLE_STREAM
+
+#include <logging/log.h>
+#include <stdio.h>
+#include <sys/byteorder.h>
+#include <aif_controller.h>
+#include <aif_ble_service.h>
+#include <aiw_iot_rev.h>
+
+LOG_MODULE_REGISTER(MPAI_LIBS_BLE_STREAM_AIM, LOG_LEVEL_INF);
+
+/*************** DEFINE ***************/
+
+/* largest notification, with the ATT MTU of 247 bytes */
+#define BLE_STREAM_MAX_PAYLOAD 244
+/* seq, decimation, lost, t0 */
+#define BLE_STREAM_HEADER_LEN 8
+/* longest varint, of 64 bits */
+#define BLE_STREAM_MAX_VARINT_LEN 10
+#define BLE_STREAM_MAX_RECORD_LEN (1 + BLE_STREAM_MAX_VARINT_LEN * (1 + TELEMETRY_UPLINK_MAX_VALUES))
+#define BLE_STREAM_MAX_DECIMATION 64
+/* time (in ms) the decimation is halved after, while the link keeps up */
+#define BLE_STREAM_ADAPT_MS 1000
+
+/*************** STATIC ***************/
+typedef struct _ble_stream_packet_t
+{
+	uint8_t _data[BLE_STREAM_MAX_PAYLOAD];
+	uint16_t _len;
+	uint16_t _records;
+} ble_stream_packet_t;
+
+typedef struct _ble_stream_channel_t
+{
+	subscriber_channel_t _channel;
+	const char* _name;
+	telemetry_uplink_sampler_t* _sampler;
+	uint8_t _skipped;								// messages since the latest one streamed
+	int32_t _previous[TELEMETRY_UPLINK_MAX_VALUES];	// values of the latest record in the current packet
+} ble_stream_channel_t;
+
+/* set by the AIW, by channel */
+static telemetry_uplink_sampler_t* stream_samplers[MPAI_MESSAGE_STORE_CHANNEL_MAX];
+/* input channels of the AIM, from the topology of the AIW (the index takes 4 bits) */
+static ble_stream_channel_t stream_channels[MIN(MPAI_AIF_CHANNEL_MAX, 16)];
+static int stream_channel_count = 0;
+
+/* packet being filled, with the time of its first and latest records */
+static ble_stream_packet_t stream_current;
+static uint16_t stream_current_max_len;
+static int64_t stream_current_t0;
+static int64_t stream_current_last_ts;
+static int64_t stream_current_opened;			// uptime of its first record
+
+/* packets closed, waiting for the link */
+static ble_stream_packet_t stream_packets[CONFIG_MPAI_AIM_BLE_STREAM_MAX_PACKETS];
+static int stream_packet_first = 0;
+static int stream_packet_count = 0;
+
+static uint16_t stream_seq = 0;
+static uint32_t stream_lost = 0;				// records dropped since the latest notification
+static uint8_t stream_decimation = 1;
+static bool stream_overflow = false;			// since the latest adaptation
+static int64_t stream_adapted = 0;
+
+/* link of the subscribed client */
+static uint16_t stream_payload_len = 0;
+static uint32_t stream_interval_us = 0;
+
+static char stream_channel_names[MPAI_BLE_SERVICE_STREAM_CHANNELS_MAX_LEN + 1];
+
+/* given by the publishers of all the input channels */
+K_SEM_DEFINE(stream_data_ready, 0, 1);
+
+/*************** PRIVATE ***************/
+/* forget the packets and the rate of the previous subscription */
+void _stream_reset(void);
+/* read the messages published on the input channels since the latest read: number read, negative on errors */
+int _stream_read_channels(bool streaming);
+void _stream_add_record(uint8_t channel_index, const mpai_message_t* message);
+/* false if the record doesn't fit in the current packet */
+bool _stream_append(uint8_t channel_index, int64_t timestamp, const int32_t* values, int count);
+/* move the current packet to the ones waiting: the oldest is dropped if they are full */
+void _stream_close(void);
+/* notify the packets waiting, as long as the link takes them */
+void _stream_send(void);
+void _stream_adapt(int64_t now);
+/* uptime of the next close of the current packet, retry of the notifications or adaptation of the decimation */
+int64_t _stream_deadline(int64_t now, int64_t latency_ms);
+int _stream_put_varint(uint8_t* buffer, int64_t value);
+
+/**************** THREADS **********************/
+
+static k_tid_t subscriber_thread_id;
+mpai_aim_control_t ble_stream_aim_control;
+
+K_THREAD_STACK_DEFINE(thread_sub_ble_stream_stack_area, CONFIG_MPAI_AIM_STACK_SIZE_MAX);
+static struct k_thread thread_sub_ble_stream;
+
+/* SUBSCRIBER */
+
+void th_subscribe_ble_stream(void *dummy1, void *dummy2, void *dummy3)
+{
+	ARG_UNUSED(dummy1);
+	ARG_UNUSED(dummy2);
+	ARG_UNUSED(dummy3);
+
+	bool streaming = false;
+
+	LOG_DBG("START SUBSCRIBER");
+
+	while (MPAI_AIM_Control_Checkpoint(&ble_stream_aim_control))
+	{
+		uint16_t payload_len;
+		uint32_t interval_us;
+		bool subscribed = MPAI_BLE_Service_Stream_Get_Link(&payload_len, &interval_us);
+		if (subscribed != streaming)
+		{
+			streaming = subscribed;
+			_stream_reset();
+			LOG_INF("Stream %s", streaming ? "started" : "stopped");
+		}
+		stream_payload_len = MIN(payload_len, BLE_STREAM_MAX_PAYLOAD);
+		if (streaming && interval_us != stream_interval_us)
+		{
+			// a new link: the decimation is found again
+			LOG_INF("Stream on %d bytes every %d us", stream_payload_len, interval_us);
+			stream_interval_us = interval_us;
+			stream_decimation = 1;
+		}
+
+		// a single wait for all the channels, up to the next deadline of the stream:
+		// a new subscription is seen with the next message, or within BLE_STREAM_ADAPT_MS
+		int64_t now = k_uptime_get();
+		// a partial packet waits at least a connection interval: sooner, it would go in the same event
+		int64_t latency_ms = MAX(CONFIG_MPAI_AIM_BLE_STREAM_LATENCY_MS, stream_interval_us / USEC_PER_MSEC);
+		int64_t deadline = streaming ? _stream_deadline(now, latency_ms) : now + BLE_STREAM_ADAPT_MS;
+		int ret = MPAI_AIM_Control_Wait(&ble_stream_aim_control, &stream_data_ready, MAX(deadline - now, 0));
+		if (ret > 0)
+		{
+			ret = _stream_read_channels(streaming);
+		}
+
+		if (ret == -EINTR)
+		{
+			// back to the checkpoint to handle pause or stop
+			continue;
+		}
+		else if (ret < 0)
+		{
+			printk("ERROR: error while polling: %d\n", ret);
+			MPAI_AIM_Control_Fail(&ble_stream_aim_control);
+			break;
+		}
+
+		if (streaming)
+		{
+			now = k_uptime_get();
+			if (stream_current._records > 0 && now - stream_current_opened >= latency_ms)
+			{
+				_stream_close();
+			}
+			_stream_send();
+			_stream_adapt(now);
+		}
+	}
+}
+
+void _stream_reset(void)
+{
+	stream_current._records = 0;
+	stream_packet_first = 0;
+	stream_packet_count = 0;
+	stream_seq = 0;
+	stream_lost = 0;
+	stream_decimation = 1;
+	stream_overflow = false;
+	stream_adapted = k_uptime_get();
+	stream_interval_us = 0;
+	for (int i = 0; i < stream_channel_count; i++)
+	{
+		stream_channels[i]._skipped = 0;
+	}
+}
+
+int _stream_read_channels(bool streaming)
+{
+	mpai_message_t aim_message;
+	int count = 0;
+	for (int i = 0; i < stream_channel_count; i++)
+	{
+		int ret = MPAI_MessageStore_poll(message_store_ble_stream_aim, ble_stream_aim_subscriber, K_NO_WAIT, stream_channels[i]._channel);
+		if (ret > 0)
+		{
+			// read even if not streamed, not to keep the channel pending
+			MPAI_MessageStore_copy(message_store_ble_stream_aim, ble_stream_aim_subscriber, stream_channels[i]._channel, &aim_message);
+			if (streaming)
+			{
+				_stream_add_record(i, &aim_message);
+			}
+			count++;
+		}
+		else if (ret < 0 && ret != -EAGAIN)
+		{
+			return ret;
+		}
+	}
+	return count;
+}
+
+void _stream_add_record(uint8_t channel_index, const mpai_message_t* message)
+{
+	ble_stream_channel_t* channel = &stream_channels[channel_index];
+	if (++channel->_skipped < stream_decimation)
+	{
+		return;
+	}
+	channel->_skipped = 0;
+
+	int32_t values[TELEMETRY_UPLINK_MAX_VALUES];
+	int count = channel->_sampler != NULL ? channel->_sampler(message, values, TELEMETRY_UPLINK_MAX_VALUES) : 0;
+	count = CLAMP(count, 0, TELEMETRY_UPLINK_MAX_VALUES);
+
+	if (_stream_append(channel_index, message->timestamp, values, count))
+	{
+		return;
+	}
+	_stream_close();
+	if (!_stream_append(channel_index, message->timestamp, values, count))
+	{
+		// larger than a notification of the link
+		stream_lost++;
+	}
+}
+
+bool _stream_append(uint8_t channel_index, int64_t timestamp, const int32_t* values, int count)
+{
+	ble_stream_channel_t* channel = &stream_channels[channel_index];
+	bool first = stream_current._records == 0;
+	if (first)
+	{
+		// the values of the first record of each channel are deltas from zero
+		stream_current._len = BLE_STREAM_HEADER_LEN;
+		stream_current_max_len = stream_payload_len;
+		for (int i = 0; i < stream_channel_count; i++)
+		{
+			memset(stream_channels[i]._previous, 0, sizeof(stream_channels[i]._previous));
+		}
+	}
+
+	uint8_t record[BLE_STREAM_MAX_RECORD_LEN];
+	int len = 0;
+	record[len++] = channel_index << 4 | count;
+	len += _stream_put_varint(&record[len], first ? 0 : timestamp - stream_current_last_ts);
+	for (int v = 0; v < count; v++)
+	{
+		len += _stream_put_varint(&record[len], (int64_t) values[v] - channel->_previous[v]);
+	}
+	if (stream_current._len + len > stream_current_max_len)
+	{
+		return false;
+	}
+
+	memcpy(&stream_current._data[stream_current._len], record, len);
+	stream_current._len += len;
+	stream_current._records++;
+	memcpy(channel->_previous, values, count * sizeof(int32_t));
+	if (first)
+	{
+		stream_current_t0 = timestamp;
+		stream_current_opened = k_uptime_get();
+	}
+	stream_current_last_ts = timestamp;
+	return true;
+}
+
+void _stream_close(void)
+{
+	if (stream_current._records == 0)
+	{
+		return;
+	}
+	if (stream_packet_count == CONFIG_MPAI_AIM_BLE_STREAM_MAX_PACKETS)
+	{
+		// the link doesn't keep up: fewer messages of each channel are streamed
+		stream_lost += stream_packets[stream_packet_first]._records;
+		stream_packet_first = (stream_packet_first + 1) % CONFIG_MPAI_AIM_BLE_STREAM_MAX_PACKETS;
+		stream_packet_count--;
+		stream_overflow = true;
+		if (stream_decimation < BLE_STREAM_MAX_DECIMATION)
+		{
+			stream_decimation *= 2;
+			LOG_DBG("Stream decimation %d", stream_decimation);
+		}
+	}
+
+	// seq and lost are set when notified
+	sys_put_le32((uint32_t) stream_current_t0, &stream_current._data[4]);
+	stream_current._data[2] = stream_decimation;
+	ble_stream_packet_t* packet = &stream_packets[(stream_packet_first + stream_packet_count) % CONFIG_MPAI_AIM_BLE_STREAM_MAX_PACKETS];
+	memcpy(packet->_data, stream_current._data, stream_current._len);
+	packet->_len = stream_current._len;
+	packet->_records = stream_current._records;
+	stream_packet_count++;
+	stream_current._records = 0;
+}
+
+void _stream_send(void)
+{
+	while (stream_packet_count > 0)
+	{
+		ble_stream_packet_t* packet = &stream_packets[stream_packet_first];
+		sys_put_le16(stream_seq, &packet->_data[0]);
+		packet->_data[3] = MIN(stream_lost, UINT8_MAX);
+		int ret = MPAI_BLE_Service_Stream_Notify(packet->_data, packet->_len);
+		if (ret < 0)
+		{
+			// -EAGAIN: sent in the next connection events
+			if (ret != -EAGAIN)
+			{
+				LOG_DBG("Stream notification %d not sent (%d)", stream_seq, ret);
+			}
+			return;
+		}
+		stream_seq++;
+		stream_lost = 0;
+		stream_packet_first = (stream_packet_first + 1) % CONFIG_MPAI_AIM_BLE_STREAM_MAX_PACKETS;
+		stream_packet_count--;
+	}
+}
+
+void _stream_adapt(int64_t now)
+{
+	if (now - stream_adapted < BLE_STREAM_ADAPT_MS)
+	{
+		return;
+	}
+	// the link kept up with the messages streamed: more are tried
+	if (!stream_overflow && stream_packet_count <= 1 && stream_decimation > 1)
+	{
+		stream_decimation /= 2;
+		LOG_DBG("Stream decimation %d", stream_decimation);
+	}
+	stream_overflow = false;
+	stream_adapted = now;
+}
+
+int64_t _stream_deadline(int64_t now, int64_t latency_ms)
+{
+	int64_t deadline = stream_adapted + BLE_STREAM_ADAPT_MS;
+	if (stream_current._records > 0)
+	{
+		deadline = MIN(deadline, stream_current_opened + latency_ms);
+	}
+	if (stream_packet_count > 0)
+	{
+		// not taken by the link: tried again at the next connection event
+		deadline = MIN(deadline, now + MAX(stream_interval_us / USEC_PER_MSEC, 1));
+	}
+	return deadline;
+}
+
+int _stream_put_varint(uint8_t* buffer, int64_t value)
+{
+	// zigzag: small negative values take a byte as well
+	uint64_t zigzag = ((uint64_t) value << 1) ^ (uint64_t) (value >> 63);
+	int len = 0;
+	do
+	{
+		buffer[len] = zigzag & 0x7F;
+		zigzag >>= 7;
+		buffer[len++] |= zigzag != 0 ? 0x80 : 0;
+	} while (zigzag != 0);
+	return len;
+}
+
+/************** EXECUTIONS ***************/
+void ble_stream_aim_set_sampler(subscriber_channel_t channel, telemetry_uplink_sampler_t* sampler)
+{
+	if (channel < MPAI_MESSAGE_STORE_CHANNEL_MAX)
+	{
+		stream_samplers[channel] = sampler;
+	}
+}
+
+mpai_error_t* ble_stream_aim_subscriber()
+{
+	MPAI_ERR_INIT(err, MPAI_AIF_OK);
+	return &err;
+}
+
+mpai_error_t *ble_stream_aim_start(const mpai_aim_thread_config_t* thread_config)
+{
+	// the input channels are the ones connected to the AIM by the topology
+	stream_channel_count = 0;
+	stream_channel_names[0] = '\0';
+	aim_initialization_cb_t* aim_init = MPAI_Controller_Find_AIM_Init_Config(MPAI_LIBS_IOT_REV_AIM_BLE_STREAM_NAME);
+	for (int i = 0; aim_init != NULL && i < aim_init->_count_channels && stream_channel_count < ARRAY_SIZE(stream_channels); i++)
+	{
+		ble_stream_channel_t* channel = &stream_channels[stream_channel_count++];
+		channel->_channel = aim_init->_input_channels[i];
+		channel->_name = NULL;
+		channel->_sampler = channel->_channel < MPAI_MESSAGE_STORE_CHANNEL_MAX ? stream_samplers[channel->_channel] : NULL;
+		for (int j = 0; j < mpai_message_store_channel_count; j++)
+		{
+			if (message_store_channel_list[j]._channel == channel->_channel)
+			{
+				channel->_name = message_store_channel_list[j]._channel_name;
+			}
+		}
+
+		// the names, read by the clients, give the index of the channels
+		size_t names_len = strlen(stream_channel_names);
+		snprintf(&stream_channel_names[names_len], sizeof(stream_channel_names) - names_len, "%s%s",
+				 names_len > 0 ? "," : "", channel->_name != NULL ? channel->_name : "?");
+		LOG_INF("Stream of channel %s", log_strdup(channel->_name != NULL ? channel->_name : "?"));
+	}
+	MPAI_BLE_Service_Stream_Set_Channels(stream_channel_names);
+
+	// the channels are registered by the controller before the start
+	MPAI_MessageStore_Set_Wakeup(message_store_ble_stream_aim, ble_stream_aim_subscriber, &stream_data_ready);
+	k_sem_reset(&stream_data_ready);
+
+	MPAI_AIM_Control_Init(&ble_stream_aim_control, thread_config);
+
+	// CREATE SUBSCRIBER
+	subscriber_thread_id = k_thread_create(&thread_sub_ble_stream, thread_sub_ble_stream_stack_area,
+										 MPAI_AIM_Control_Get_Stack_Size(&ble_stream_aim_control, K_THREAD_STACK_SIZEOF(thread_sub_ble_stream_stack_area)),
+										 th_subscribe_ble_stream, NULL, NULL, NULL,
+										 MPAI_AIM_Control_Get_Priority(&ble_stream_aim_control), 0, K_NO_WAIT);
+	k_thread_name_set(&thread_sub_ble_stream, "thread_sub_ble_stream");
+
+	// START THREAD
+	k_thread_start(subscriber_thread_id);
+
+	MPAI_ERR_INIT(err, MPAI_AIF_OK);
+	return &err;
+}
+
+mpai_error_t *ble_stream_aim_stop()
+{
+	// wait the thread to leave its loop, then join it; abort only if it doesn't answer
+	if (MPAI_AIM_Control_Stop(&ble_stream_aim_control) != 0 || k_thread_join(subscriber_thread_id, K_MSEC(CONFIG_MPAI_AIM_CONTROL_ACK_TIMEOUT_MS)) != 0)
+	{
+		LOG_WRN("Thread not stopped cooperatively, aborting it");
+		k_thread_abort(subscriber_thread_id);
+	}
+	LOG_INF("Execution stopped");
+
+	MPAI_ERR_INIT(err, MPAI_AIF_OK);
+	return &err;
+}
+
+mpai_error_t *ble_stream_aim_resume()
+{
+	MPAI_AIM_Control_Resume(&ble_stream_aim_control);
+	LOG_INF("Execution resumed");
+
+	MPAI_ERR_INIT(err, MPAI_AIF_OK);
+	return &err;
+}
+
+mpai_error_t *ble_stream_aim_pause()
+{
+	MPAI_AIM_Control_Pause(&ble_stream_aim_control);
+	LOG_INF("Execution paused");
+
+	MPAI_ERR_INIT(err, MPAI_AIF_OK);
+	return &err;
+}
+
+#endif
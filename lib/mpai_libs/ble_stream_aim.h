@@ -0,0 +1,60 @@
+/*
+ * @file
+ * @brief Headers of an AIM that streams the messages of its input channels over Bluetooth LE
+ *
+ * The messages of the channels connected to the AIM by the AIW topology are sampled into
+ * records (as by the telemetry uplink) while a phone is subscribed to the stream characteristic
+ * of the MPAI BLE service, and packed into notifications as large as the ATT MTU allows.
+ * A notification (little endian):
+ *   u16 seq, u8 decimation, u8 lost, u32 t0 (uptime ms of the first record), then the records:
+ *   u8 channel index << 4 | values, then zigzag varints: dt (ms from the previous record, 0 for
+ *   the first) and the values (each the delta from the previous record of the channel in the
+ *   notification, the first absolute)
+ * The channel index is the position of its name in the value read from the characteristic.
+ *
+ * The notifications in flight are bounded, so the stream follows what the link takes: a partial
+ * notification is sent at most once per connection interval, and when the notifications waiting
+ * overflow, only one message every decimation (doubled, then halved again as the link keeps up)
+ * of each channel is kept; the records dropped are counted in lost.
+ *
+ * Copyright (c) 2022 University of Turin, Daniele Bortoluzzi <danieleb88@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef MPAI_LIBS_BLE_STREAM_AIM_H
+#define MPAI_LIBS_BLE_STREAM_AIM_H
+
+#include <core_common.h>
+#include <core_aim.h>
+#include <aim_control.h>
+#include <message_store.h>
+#include <telemetry_uplink_aim.h>
+
+// The implementation will be added in AIW configuration
+__weak MPAI_AIM_MessageStore_t* message_store_ble_stream_aim;
+
+// AIM lifecycle control (used by the supervisor)
+extern mpai_aim_control_t ble_stream_aim_control;
+
+/**
+ * @brief Set the sampler of a channel: without it, only the timestamps of its messages are streamed
+ *
+ * @param channel
+ * @param sampler
+ */
+void ble_stream_aim_set_sampler(subscriber_channel_t channel, telemetry_uplink_sampler_t* sampler);
+
+// AIM subscriber
+mpai_error_t* ble_stream_aim_subscriber();
+
+// AIM high priorities commands
+mpai_error_t* ble_stream_aim_start(const mpai_aim_thread_config_t* thread_config);
+
+mpai_error_t* ble_stream_aim_stop();
+
+mpai_error_t* ble_stream_aim_resume();
+
+mpai_error_t* ble_stream_aim_pause();
+
+#endif
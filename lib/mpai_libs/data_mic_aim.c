@@ -15,12 +15,6 @@ LOG_MODULE_REGISTER(MPAI_LIBS_DATA_MIC_AIM, LOG_LEVEL_INF);
 
 /*************** DEFINE ***************/
 
-/* size of stack area used by each thread */
-#define STACKSIZE 1024
-
-/* scheduling priority used by each thread */
-#define PRIORITY 7
-
 /* Define The transmission interval [mSec] for Microphones dB Values */
 #define MICS_DB_UPDATE_MS 50
 
@@ -66,6 +60,8 @@ static size_t transfer_complete_events = 0;
 static bool flag_peak_recognized = false;
 /* Data structure of a volume peak to send to the message store */
 static mic_peak_t mic_peak = {};
+/* lifecycle control of the AIM */
+mpai_aim_control_t data_mic_aim_control;
 
 /**
  * @brief Start recording audio using stm32 drivers
@@ -79,6 +75,7 @@ void static start_recording() {
     ret = BSP_AUDIO_IN_GetState(AUDIO_INSTANCE, &state);
     if (ret != BSP_ERROR_NONE) {
         printk("Cannot start recording: Error getting audio state (%d)\n", ret);
+        MPAI_AIM_Control_Fail(&data_mic_aim_control);
         return;
     }
     if (state == AUDIO_IN_STATE_RECORDING) {
@@ -94,6 +91,7 @@ void static start_recording() {
     ret = BSP_AUDIO_IN_Record(AUDIO_INSTANCE, (uint8_t *) PCM_Buffer, PCM_BUFFER_LEN);
     if (ret != BSP_ERROR_NONE) {
         printk("Error Audio Record (%ld)\n", ret);
+        MPAI_AIM_Control_Fail(&data_mic_aim_control);
         return;
     }
     else {
@@ -161,7 +159,7 @@ void static print_stats() {
 
 static k_tid_t producer_mic_thread_id;
 
-K_THREAD_STACK_DEFINE(thread_prod_mic_stack_area, STACKSIZE);
+K_THREAD_STACK_DEFINE(thread_prod_mic_stack_area, CONFIG_MPAI_AIM_STACK_SIZE_MAX);
 static struct k_thread thread_prod_mic_data;
 
 volatile float RMS_Ch[AUDIO_CHANNELS];
@@ -262,6 +260,8 @@ void AudioProcess_DB_Noise(void)
 */
 void BSP_AUDIO_IN_HalfTransfer_CallBack(uint32_t Instance) {
     half_transfer_events++;
+    // the work of this AIM is done by DMA callbacks: they are its signs of life
+    MPAI_AIM_Control_Heartbeat(&data_mic_aim_control);
     if (half_transfer_events < SKIP_FIRST_EVENTS) return;
 
     uint32_t buffer_size = PCM_BUFFER_LEN / 2; /* Half Transfer */
@@ -300,6 +300,7 @@ void BSP_AUDIO_IN_HalfTransfer_CallBack(uint32_t Instance) {
 */
 void BSP_AUDIO_IN_TransferComplete_CallBack(uint32_t Instance) {
     transfer_complete_events++;
+    MPAI_AIM_Control_Heartbeat(&data_mic_aim_control);
     if (transfer_complete_events < SKIP_FIRST_EVENTS) return;
 
     uint32_t buffer_size = PCM_BUFFER_LEN / 2; /* Half Transfer */
@@ -340,6 +341,7 @@ void BSP_AUDIO_IN_TransferComplete_CallBack(uint32_t Instance) {
   */
 void BSP_AUDIO_IN_Error_CallBack(uint32_t Instance) {
     printk("BSP_AUDIO_IN_Error_CallBack\n");
+    MPAI_AIM_Control_Fail(&data_mic_aim_control);
 }
 
 /* PRODUCER */
@@ -411,6 +413,8 @@ void th_produce_data_mic_data(void *dummy1, void *dummy2, void *dummy3)
 
     if (ret != BSP_ERROR_NONE) {
         printk("Error Audio Init (%ld)\r\n", ret);
+        MPAI_AIM_Control_Fail(&data_mic_aim_control);
+        return;
     } else {
         printk("OK Audio Init\t(Audio Freq=%ld)\r\n", AUDIO_SAMPLING_FREQUENCY);
     }
@@ -433,13 +437,16 @@ mpai_error_t* data_mic_aim_subscriber()
 	return &err;
 }
 
-mpai_error_t* data_mic_aim_start()
+mpai_error_t* data_mic_aim_start(const mpai_aim_thread_config_t* thread_config)
 {
+	// the thread only configures the mic, the control block gives its scheduling parameters
+	MPAI_AIM_Control_Init(&data_mic_aim_control, thread_config);
+
 	// CREATE PRODUCER
 	producer_mic_thread_id = k_thread_create(&thread_prod_mic_data, thread_prod_mic_stack_area,
-			K_THREAD_STACK_SIZEOF(thread_prod_mic_stack_area),
+			MPAI_AIM_Control_Get_Stack_Size(&data_mic_aim_control, K_THREAD_STACK_SIZEOF(thread_prod_mic_stack_area)),
 			th_produce_data_mic_data, NULL, NULL, NULL,
-			PRIORITY, 0, K_NO_WAIT);
+			MPAI_AIM_Control_Get_Priority(&data_mic_aim_control), 0, K_NO_WAIT);
 	k_thread_name_set(&thread_prod_mic_data, "thread_prod_sensors_data");
 	
 	// START THREAD
@@ -451,7 +458,23 @@ mpai_error_t* data_mic_aim_start()
 
 mpai_error_t* data_mic_aim_stop() 
 {
-	k_thread_abort(producer_mic_thread_id);
+	// the producer only configures the mic and then ends: the work is done by DMA callbacks
+	if (k_thread_join(producer_mic_thread_id, K_MSEC(CONFIG_MPAI_AIM_CONTROL_ACK_TIMEOUT_MS)) != 0)
+	{
+		LOG_WRN("Producer not ended, aborting it");
+		k_thread_abort(producer_mic_thread_id);
+	}
+
+	// stop DMA transfers and release DFSDM peripheral
+	int32_t ret = BSP_AUDIO_IN_Stop(AUDIO_INSTANCE);
+	if (ret != BSP_ERROR_NONE) {
+		LOG_ERR("Error Audio Stop (%d)", ret);
+	}
+	ret = BSP_AUDIO_IN_DeInit(AUDIO_INSTANCE);
+	if (ret != BSP_ERROR_NONE) {
+		LOG_ERR("Error Audio DeInit (%d)", ret);
+	}
+	flag_peak_recognized = false;
 	LOG_INF("Execution stopped");
 
 	MPAI_ERR_INIT(err, MPAI_AIF_OK);
@@ -460,7 +483,12 @@ mpai_error_t* data_mic_aim_stop()
 
 mpai_error_t* data_mic_aim_resume() 
 {
-	k_thread_resume(producer_mic_thread_id);
+	// the pause doesn't count as silence
+	MPAI_AIM_Control_Heartbeat(&data_mic_aim_control);
+	int32_t ret = BSP_AUDIO_IN_Resume(AUDIO_INSTANCE);
+	if (ret != BSP_ERROR_NONE) {
+		LOG_ERR("Error Audio Resume (%d)", ret);
+	}
 	LOG_INF("Execution resumed");
 
 	MPAI_ERR_INIT(err, MPAI_AIF_OK);
@@ -469,7 +497,15 @@ mpai_error_t* data_mic_aim_resume()
 
 mpai_error_t* data_mic_aim_pause() 
 {
-	k_thread_suspend(producer_mic_thread_id);
+	// wait the end of the configuration before touching the mic
+	k_thread_join(producer_mic_thread_id, K_MSEC(CONFIG_MPAI_AIM_CONTROL_ACK_TIMEOUT_MS));
+
+	// stop DMA transfers: no more callbacks until resume, so the cpu can sleep
+	int32_t ret = BSP_AUDIO_IN_Pause(AUDIO_INSTANCE);
+	if (ret != BSP_ERROR_NONE) {
+		LOG_ERR("Error Audio Pause (%d)", ret);
+	}
+	flag_peak_recognized = false;
 	LOG_INF("Execution paused");
 
 	MPAI_ERR_INIT(err, MPAI_AIF_OK);
@@ -14,6 +14,7 @@
 #include <drivers/uart.h>
 #include <core_common.h>
 #include <core_aim.h>
+#include <aim_control.h>
 #include <mic_common.h>
 #include <stm32l475e_iot01_audio.h>
 #include <drivers/gpio.h>
@@ -24,11 +25,14 @@ __weak MPAI_AIM_MessageStore_t* message_store_data_mic_aim;
 __weak subscriber_channel_t MIC_BUFFER_DATA_CHANNEL;
 __weak subscriber_channel_t MIC_PEAK_DATA_CHANNEL;
 
+// AIM lifecycle control (used by the supervisor)
+extern mpai_aim_control_t data_mic_aim_control;
+
 // AIM subscriber
 mpai_error_t* data_mic_aim_subscriber();
 
 // AIM high priorities commands
-mpai_error_t* data_mic_aim_start();
+mpai_error_t* data_mic_aim_start(const mpai_aim_thread_config_t* thread_config);
 
 mpai_error_t* data_mic_aim_stop();
 
@@ -14,12 +14,6 @@ LOG_MODULE_REGISTER(MPAI_LIBS_MOTION_AIM, LOG_LEVEL_INF);
 
 /*************** DEFINE ***************/
 
-/* size of stack area used by each thread */
-#define STACKSIZE 1024
-
-/* scheduling priority used by each thread */
-#define PRIORITY 7
-
 /* min delay used to detect when mcu is stopped */
 #define MCU_MIN_DETECTED_STOP_DELAY_MS 100
 
@@ -52,11 +46,93 @@ static void publish_motion_to_message_store(MOTION_TYPE motion_type, float accel
 	LOG_DBG("Message motion published");
 }
 
+static void process_sensors_data(mpai_message_t* aim_message)
+{
+	LOG_DBG("Received from timestamp %lld\n", aim_message->timestamp);
+
+	sensor_result_t *sensor_data = (sensor_result_t *)aim_message->data;
+
+	#ifdef CONFIG_LSM6DSL
+		float accel_x = sensor_value_to_double(&(sensor_data->lsm6dsl_accel[0]));
+		float accel_y = sensor_value_to_double(&(sensor_data->lsm6dsl_accel[1]));
+		float accel_z = sensor_value_to_double(&(sensor_data->lsm6dsl_accel[2]));
+		// compute vectorial product to get the total acceleration
+		float accel_tot = sqrt(accel_x*accel_x + accel_y*accel_y + accel_z*accel_z);
+
+		// algorithm to check if mcu is stopped or not
+		// 1. check if the total acceleration is between the MIN and the MAX threshold
+		if (accel_tot >= ACCEL_TOT_THRESHOLD_MIN && accel_tot <= ACCEL_TOT_THRESHOLD_MAX)
+		{
+			if (mcu_has_stopped_ts != 0 && aim_message->timestamp - mcu_has_stopped_ts >=  MCU_MIN_DETECTED_STOP_DELAY_MS)
+			{
+				// MCU is stopped but it doesn't publish event, because it was already stopped
+			}
+			// 2. check if mcu was moving previously
+			else if (mcu_has_stopped_ts == 0)
+			{
+				mcu_has_stopped_ts = aim_message->timestamp;	
+
+				printk("MCU Motion stopped: Accel (m.s-2): tot: %.5f\n", accel_tot);
+
+				publish_motion_to_message_store(STOPPED, accel_tot);
+			}
+		} else 
+		{	
+			if (mcu_has_stopped_ts > 0) 
+			{
+				printk("MCU Motion started: Accel (m.s-2): tot: %.5f\n", accel_tot);
+
+				// at the moment is commented
+				// publish_motion_to_message_store(STARTED, accel_tot);
+			}
+			// reset last time that mcu is stopped
+			mcu_has_stopped_ts = 0;
+		}
+	#endif
+}
+
 /**************** THREADS **********************/
 
+mpai_aim_control_t motion_aim_control;
+
+#ifdef CONFIG_MPAI_AIM_RUNTIME
+
+static mpai_aim_task_t motion_aim_task;
+
+/* SUBSCRIBER (task multiplexed on the runtime) */
+
+int task_subscribe_motion_data(mpai_aim_task_t *task)
+{
+	// kept across waits
+	static mpai_message_t aim_message;
+
+	MPAI_AIM_TASK_BEGIN(task);
+
+	MPAI_AIM_TASK_AWAIT_MESSAGE(task, message_store_motion_aim, motion_aim_subscriber, SENSORS_DATA_CHANNEL, SENSORS_DATA_POLLING_MS);
+
+	if (MPAI_AIM_TASK_RESULT(task) > 0)
+	{
+		MPAI_MessageStore_copy(message_store_motion_aim, motion_aim_subscriber, SENSORS_DATA_CHANNEL, &aim_message);
+		process_sensors_data(&aim_message);
+	}
+	else if (MPAI_AIM_TASK_RESULT(task) == 0)
+	{
+		printk("WARNING: Did not receive new data for %dms. Continuing poll.\n", SENSORS_DATA_POLLING_MS);
+	}
+	else
+	{
+		printk("ERROR: error while polling: %d\n", MPAI_AIM_TASK_RESULT(task));
+		MPAI_AIM_TASK_FAIL(task);
+	}
+
+	MPAI_AIM_TASK_END(task);
+}
+
+#else
+
 static k_tid_t subscriber_motion_thread_id;
 
-K_THREAD_STACK_DEFINE(thread_sub_motion_stack_area, STACKSIZE);
+K_THREAD_STACK_DEFINE(thread_sub_motion_stack_area, CONFIG_MPAI_AIM_STACK_SIZE_MAX);
 static struct k_thread thread_sub_motion_sens_data;
 
 void th_subscribe_motion_data(void *dummy1, void *dummy2, void *dummy3)
@@ -69,73 +145,42 @@ void th_subscribe_motion_data(void *dummy1, void *dummy2, void *dummy3)
 
 	LOG_DBG("START SUBSCRIBER");
 
-	while (1)
+	while (MPAI_AIM_Control_Checkpoint(&motion_aim_control))
 	{
 		/* this function will return once new data has arrived, or upon timeout (1000ms in this case). */
-		int ret = MPAI_MessageStore_poll(message_store_motion_aim, motion_aim_subscriber, K_MSEC(SENSORS_DATA_POLLING_MS), SENSORS_DATA_CHANNEL);
+		int ret = MPAI_AIM_Control_Poll(&motion_aim_control, message_store_motion_aim, motion_aim_subscriber, SENSORS_DATA_POLLING_MS, SENSORS_DATA_CHANNEL);
 
 		/* ret returns:
 		 * a positive value if new data was successfully returned
 		 * 0 if the poll timed out
+		 * -EINTR if pause or stop has been requested
 		 * negative if an error occured while polling
 		 */
 		if (ret > 0)
 		{
 			MPAI_MessageStore_copy(message_store_motion_aim, motion_aim_subscriber, SENSORS_DATA_CHANNEL, &aim_message);
-			LOG_DBG("Received from timestamp %lld\n", aim_message.timestamp);
-
-			sensor_result_t *sensor_data = (sensor_result_t *)aim_message.data;
-
-			#ifdef CONFIG_LSM6DSL
-				float accel_x = sensor_value_to_double(&(sensor_data->lsm6dsl_accel[0]));
-				float accel_y = sensor_value_to_double(&(sensor_data->lsm6dsl_accel[1]));
-				float accel_z = sensor_value_to_double(&(sensor_data->lsm6dsl_accel[2]));
-				// compute vectorial product to get the total acceleration
-				float accel_tot = sqrt(accel_x*accel_x + accel_y*accel_y + accel_z*accel_z);
-
-				// algorithm to check if mcu is stopped or not
-				// 1. check if the total acceleration is between the MIN and the MAX threshold
-				if (accel_tot >= ACCEL_TOT_THRESHOLD_MIN && accel_tot <= ACCEL_TOT_THRESHOLD_MAX)
-				{
-					if (mcu_has_stopped_ts != 0 && aim_message.timestamp - mcu_has_stopped_ts >=  MCU_MIN_DETECTED_STOP_DELAY_MS)
-					{
-						// MCU is stopped but it doesn't publish event, because it was already stopped
-					}
-					// 2. check if mcu was moving previously
-					else if (mcu_has_stopped_ts == 0)
-					{
-						mcu_has_stopped_ts = aim_message.timestamp;	
-
-						printk("MCU Motion stopped: Accel (m.s-2): tot: %.5f\n", accel_tot);
-
-						publish_motion_to_message_store(STOPPED, accel_tot);
-					}
-				} else 
-				{	
-					if (mcu_has_stopped_ts > 0) 
-					{
-						printk("MCU Motion started: Accel (m.s-2): tot: %.5f\n", accel_tot);
-
-						// at the moment is commented
-						// publish_motion_to_message_store(STARTED, accel_tot);
-					}
-					// reset last time that mcu is stopped
-					mcu_has_stopped_ts = 0;
-				}
-			#endif
+			process_sensors_data(&aim_message);
 		}
 		else if (ret == 0)
 		{
 			printk("WARNING: Did not receive new data for %dms. Continuing poll.\n", SENSORS_DATA_POLLING_MS);
 		}
+		else if (ret == -EINTR)
+		{
+			// back to the checkpoint to handle pause or stop
+			continue;
+		}
 		else
 		{
 			printk("ERROR: error while polling: %d\n", ret);
+			MPAI_AIM_Control_Fail(&motion_aim_control);
 			return;
 		}
 	}
 }
 
+#endif
+
 /************** EXECUTIONS ***************/
 mpai_error_t* motion_aim_subscriber()
 {
@@ -143,19 +188,27 @@ mpai_error_t* motion_aim_subscriber()
 	return &err;
 }
 
-mpai_error_t *motion_aim_start()
+mpai_error_t *motion_aim_start(const mpai_aim_thread_config_t* thread_config)
 {
 	mcu_has_stopped_ts = k_uptime_get();
 
+	MPAI_AIM_Control_Init(&motion_aim_control, thread_config);
+
+#ifdef CONFIG_MPAI_AIM_RUNTIME
+	// ADD SUBSCRIBER TO THE RUNTIME
+	MPAI_AIM_Task_Init(&motion_aim_task, task_subscribe_motion_data, &motion_aim_control, NULL);
+	MPAI_AIM_Runtime_Add(&motion_aim_task);
+#else
 	// CREATE SUBSCRIBER
 	subscriber_motion_thread_id = k_thread_create(&thread_sub_motion_sens_data, thread_sub_motion_stack_area,
-										 K_THREAD_STACK_SIZEOF(thread_sub_motion_stack_area),
+										 MPAI_AIM_Control_Get_Stack_Size(&motion_aim_control, K_THREAD_STACK_SIZEOF(thread_sub_motion_stack_area)),
 										 th_subscribe_motion_data, NULL, NULL, NULL,
-										 PRIORITY, 0, K_NO_WAIT);
+										 MPAI_AIM_Control_Get_Priority(&motion_aim_control), 0, K_NO_WAIT);
 	k_thread_name_set(&thread_sub_motion_sens_data, "thread_sub_motion");
 
 	// START THREAD
 	k_thread_start(subscriber_motion_thread_id);
+#endif
 
 	MPAI_ERR_INIT(err, MPAI_AIF_OK);
 	return &err;
@@ -163,7 +216,18 @@ mpai_error_t *motion_aim_start()
 
 mpai_error_t *motion_aim_stop()
 {
-	k_thread_abort(subscriber_motion_thread_id);
+#ifdef CONFIG_MPAI_AIM_RUNTIME
+	// the runtime drops the stopped task at its next round: remove it now, after its current step
+	MPAI_AIM_Control_Stop(&motion_aim_control);
+	MPAI_AIM_Runtime_Remove(&motion_aim_task);
+#else
+	// wait the thread to leave its loop, then join it; abort only if it doesn't answer
+	if (MPAI_AIM_Control_Stop(&motion_aim_control) != 0 || k_thread_join(subscriber_motion_thread_id, K_MSEC(CONFIG_MPAI_AIM_CONTROL_ACK_TIMEOUT_MS)) != 0)
+	{
+		LOG_WRN("Thread not stopped cooperatively, aborting it");
+		k_thread_abort(subscriber_motion_thread_id);
+	}
+#endif
 	LOG_INF("Execution stopped");
 
 	MPAI_ERR_INIT(err, MPAI_AIF_OK);
@@ -172,7 +236,7 @@ mpai_error_t *motion_aim_stop()
 
 mpai_error_t *motion_aim_resume()
 {
-	k_thread_resume(subscriber_motion_thread_id);
+	MPAI_AIM_Control_Resume(&motion_aim_control);
 	LOG_INF("Execution resumed");
 
 	MPAI_ERR_INIT(err, MPAI_AIF_OK);
@@ -181,7 +245,7 @@ mpai_error_t *motion_aim_resume()
 
 mpai_error_t *motion_aim_pause()
 {
-	k_thread_suspend(subscriber_motion_thread_id);
+	MPAI_AIM_Control_Pause(&motion_aim_control);
 	LOG_INF("Execution paused");
 
 	MPAI_ERR_INIT(err, MPAI_AIF_OK);
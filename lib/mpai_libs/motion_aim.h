@@ -15,6 +15,8 @@
 #include <core_common.h>
 #include <sensors_common.h>
 #include <core_aim.h>
+#include <aim_control.h>
+#include <aim_runtime.h>
 #include <motion_common.h>
 #include <math.h>
 
@@ -26,11 +28,14 @@ __weak subscriber_channel_t SENSORS_DATA_CHANNEL;
 
 
 
+// AIM lifecycle control (used by the supervisor)
+extern mpai_aim_control_t motion_aim_control;
+
 // AIM subscriber
 mpai_error_t* motion_aim_subscriber();
 
 // AIM high priorities commands
-mpai_error_t* motion_aim_start();
+mpai_error_t* motion_aim_start(const mpai_aim_thread_config_t* thread_config);
 
 mpai_error_t* motion_aim_stop();
 
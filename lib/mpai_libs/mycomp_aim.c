@@ -14,12 +14,6 @@ LOG_MODULE_REGISTER(MPAI_LIBS_MYCOMPMOTION_AIM, LOG_LEVEL_INF);
 
 /*************** DEFINE ***************/
 
-/* size of stack area used by each thread */
-#define STACKSIZE 1024
-
-/* scheduling priority used by each thread */
-#define PRIORITY 7
-
 /* min delay used to detect when mcu is stopped */
 #define MCU_MIN_DETECTED_STOP_DELAY_MS 100
 
@@ -55,8 +49,9 @@ static void publish_mycomp_to_message_store(MYCOMP_TYPE mycomp_motion_type, floa
 /**************** THREADS **********************/
 
 static k_tid_t subscriber_mycomp_thread_id;
+mpai_aim_control_t mycomp_aim_control;
 
-K_THREAD_STACK_DEFINE(thread_sub_mycomp_stack_area, STACKSIZE);
+K_THREAD_STACK_DEFINE(thread_sub_mycomp_stack_area, CONFIG_MPAI_AIM_STACK_SIZE_MAX);
 static struct k_thread thread_sub_mycomp_sens_data;
 
 void th_subscribe_mycomp_data(void *dummy1, void *dummy2, void *dummy3)
@@ -69,14 +64,15 @@ void th_subscribe_mycomp_data(void *dummy1, void *dummy2, void *dummy3)
 
 	LOG_DBG("START SUBSCRIBER");
 
-	while (1)
+	while (MPAI_AIM_Control_Checkpoint(&mycomp_aim_control))
 	{
 		/* this function will return once new data has arrived, or upon timeout (1000ms in this case). */
-		int ret = MPAI_MessageStore_poll(message_store_mycomp_aim, mycomp_aim_subscriber, K_MSEC(SENSORS_DATA_POLLING_MS), SENSORS_DATA_CHANNEL);
+		int ret = MPAI_AIM_Control_Poll(&mycomp_aim_control, message_store_mycomp_aim, mycomp_aim_subscriber, SENSORS_DATA_POLLING_MS, SENSORS_DATA_CHANNEL);
 
 		/* ret returns:
 		 * a positive value if new data was successfully returned
 		 * 0 if the poll timed out
+		 * -EINTR if pause or stop has been requested
 		 * negative if an error occured while polling
 		 */
 		if (ret > 0)
@@ -128,9 +124,15 @@ void th_subscribe_mycomp_data(void *dummy1, void *dummy2, void *dummy3)
 		{
 			printk("WARNING: Did not receive new data for %dms. Continuing poll.\n", SENSORS_DATA_POLLING_MS);
 		}
+		else if (ret == -EINTR)
+		{
+			// back to the checkpoint to handle pause or stop
+			continue;
+		}
 		else
 		{
 			printk("ERROR: error while polling: %d\n", ret);
+			MPAI_AIM_Control_Fail(&mycomp_aim_control);
 			return;
 		}
 	}
@@ -143,15 +145,17 @@ mpai_error_t* mycomp_aim_subscriber()
 	return &err;
 }
 
-mpai_error_t *mycomp_aim_start()
+mpai_error_t *mycomp_aim_start(const mpai_aim_thread_config_t* thread_config)
 {
 	mcu_has_stopped_ts = k_uptime_get();
 
+	MPAI_AIM_Control_Init(&mycomp_aim_control, thread_config);
+
 	// CREATE SUBSCRIBER
 	subscriber_mycomp_thread_id = k_thread_create(&thread_sub_mycomp_sens_data, thread_sub_mycomp_stack_area,
-										 K_THREAD_STACK_SIZEOF(thread_sub_mycomp_stack_area),
+										 MPAI_AIM_Control_Get_Stack_Size(&mycomp_aim_control, K_THREAD_STACK_SIZEOF(thread_sub_mycomp_stack_area)),
 										 th_subscribe_mycomp_data, NULL, NULL, NULL,
-										 PRIORITY, 0, K_NO_WAIT);
+										 MPAI_AIM_Control_Get_Priority(&mycomp_aim_control), 0, K_NO_WAIT);
 	k_thread_name_set(&thread_sub_mycomp_sens_data, "thread_sub_motion");
 
 	// START THREAD
@@ -163,7 +167,12 @@ mpai_error_t *mycomp_aim_start()
 
 mpai_error_t *mycomp_aim_stop()
 {
-	k_thread_abort(subscriber_mycomp_thread_id);
+	// wait the thread to leave its loop, then join it; abort only if it doesn't answer
+	if (MPAI_AIM_Control_Stop(&mycomp_aim_control) != 0 || k_thread_join(subscriber_mycomp_thread_id, K_MSEC(CONFIG_MPAI_AIM_CONTROL_ACK_TIMEOUT_MS)) != 0)
+	{
+		LOG_WRN("Thread not stopped cooperatively, aborting it");
+		k_thread_abort(subscriber_mycomp_thread_id);
+	}
 	LOG_INF("Execution stopped");
 
 	MPAI_ERR_INIT(err, MPAI_AIF_OK);
@@ -172,7 +181,7 @@ mpai_error_t *mycomp_aim_stop()
 
 mpai_error_t *mycomp_aim_resume()
 {
-	k_thread_resume(subscriber_mycomp_thread_id);
+	MPAI_AIM_Control_Resume(&mycomp_aim_control);
 	LOG_INF("Execution resumed");
 
 	MPAI_ERR_INIT(err, MPAI_AIF_OK);
@@ -181,7 +190,7 @@ mpai_error_t *mycomp_aim_resume()
 
 mpai_error_t *mycomp_aim_pause()
 {
-	k_thread_suspend(subscriber_mycomp_thread_id);
+	MPAI_AIM_Control_Pause(&mycomp_aim_control);
 	LOG_INF("Execution paused");
 
 	MPAI_ERR_INIT(err, MPAI_AIF_OK);
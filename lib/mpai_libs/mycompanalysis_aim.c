@@ -16,12 +16,6 @@ LOG_MODULE_REGISTER(MPAI_LIBS_MYCOMPANALYSIS_AIM, LOG_LEVEL_INF);
 
 /*************** DEFINE ***************/
 
-/* size of stack area used by each thread */
-#define STACKSIZE 1024
-
-/* scheduling priority used by each thread */
-#define PRIORITY 7
-
 /* polling every XXX(ms) to check new MYCOMP messages */
 #define CONFIG_MYCOMPANALYSIS_MYCOMP_TIMEOUT_MS 3000
 /* polling every XXX(ms) to check new volume peak messages */
@@ -29,6 +23,7 @@ LOG_MODULE_REGISTER(MPAI_LIBS_MYCOMPANALYSIS_AIM, LOG_LEVEL_INF);
 
 /*************** STATIC ***************/
 static const struct device *led0, *led1;
+mpai_aim_control_t mycompanalysis_aim_control;
 
 static void show_movement_error()
 {
@@ -38,16 +33,23 @@ static void show_movement_error()
 	{
 		gpio_pin_set(led0, DT_GPIO_PIN(DT_ALIAS(led0), gpios), on);
 		gpio_pin_set(led1, DT_GPIO_PIN(DT_ALIAS(led1), gpios), !on);
-		k_sleep(K_MSEC(100));
+		// stop blinking as soon as pause or stop is requested
+		if (MPAI_AIM_Control_Sleep(&mycompanalysis_aim_control, K_MSEC(100)) == -EINTR)
+		{
+			break;
+		}
 		on = (on == 1) ? 0 : 1;
 	}
+	// leave the leds in the idle state
+	gpio_pin_set(led0, DT_GPIO_PIN(DT_ALIAS(led0), gpios), 0);
+	gpio_pin_set(led1, DT_GPIO_PIN(DT_ALIAS(led1), gpios), 1);
 }
 
 /**************** THREADS **********************/
 
 static k_tid_t subscriber_mycompanalysis_thread_id;
 
-K_THREAD_STACK_DEFINE(thread_sub_mycompanalysis_stack_area, STACKSIZE);
+K_THREAD_STACK_DEFINE(thread_sub_mycompanalysis_stack_area, CONFIG_MPAI_AIM_STACK_SIZE_MAX);
 static struct k_thread thread_sub_mycompanalysis_sens_data;
 
 /* SUBSCRIBER */
@@ -64,10 +66,10 @@ void th_subscribe_mycompanalysis_data(void *dummy1, void *dummy2, void *dummy3)
 
 	LOG_DBG("START SUBSCRIBER");
 
-	while (1)
+	while (MPAI_AIM_Control_Checkpoint(&mycompanalysis_aim_control))
 	{
 		// poll updates from MYCOMP_DATA_CHANNEL
-		int ret_mycomp = MPAI_MessageStore_poll(message_store_mycompanalysis_aim, mycompanalysis_aim_subscriber, K_MSEC(CONFIG_MYCOMPANALYSIS_MYCOMP_TIMEOUT_MS), MYCOMP_DATA_CHANNEL);
+		int ret_mycomp = MPAI_AIM_Control_Poll(&mycompanalysis_aim_control, message_store_mycompanalysis_aim, mycompanalysis_aim_subscriber, CONFIG_MYCOMPANALYSIS_MYCOMP_TIMEOUT_MS, MYCOMP_DATA_CHANNEL);
 
 		if (ret_mycomp > 0)
 		{
@@ -86,7 +88,7 @@ void th_subscribe_mycompanalysis_data(void *dummy1, void *dummy2, void *dummy3)
 					LOG_INF("MYCOMP STOPPED: Waiting for Audio Peak");
 					k_sleep(K_MSEC(10));
 
-					int ret_mic = MPAI_MessageStore_poll(message_store_mycompanalysis_aim, mycompanalysis_aim_subscriber, K_MSEC(CONFIG_MYCOMPANALYSIS_MIC_PEAK_TIMEOUT_MS), MIC_PEAK_DATA_CHANNEL);
+					int ret_mic = MPAI_AIM_Control_Poll(&mycompanalysis_aim_control, message_store_mycompanalysis_aim, mycompanalysis_aim_subscriber, CONFIG_MYCOMPANALYSIS_MIC_PEAK_TIMEOUT_MS, MIC_PEAK_DATA_CHANNEL);
 				
 					if (ret_mic > 0)
 					{
@@ -103,10 +105,16 @@ void th_subscribe_mycompanalysis_data(void *dummy1, void *dummy2, void *dummy3)
 
 						show_movement_error();
 					}
+					else if (ret_mic == -EINTR)
+					{
+						// back to the checkpoint to handle pause or stop
+						continue;
+					}
 					else
 					{
 						last_event_peak_audio = 0;
 						printk("ERROR: error while polling: %d\n", ret_mic);
+						MPAI_AIM_Control_Fail(&mycompanalysis_aim_control);
 						return;
 					}
 				} else if (mycomp_data->mycomp_type == MYCOMP_STARTED)
@@ -124,9 +132,15 @@ void th_subscribe_mycompanalysis_data(void *dummy1, void *dummy2, void *dummy3)
 			LOG_WRN("MOVEMENT NOT RECOGNIZED");
 			show_movement_error();
 		}
+		else if (ret_mycomp == -EINTR)
+		{
+			// back to the checkpoint to handle pause or stop
+			continue;
+		}
 		else
 		{
 			printk("ERROR: error while polling: %d\n", ret_mycomp);
+			MPAI_AIM_Control_Fail(&mycompanalysis_aim_control);
 			return;
 		}
 	}
@@ -139,7 +153,7 @@ mpai_error_t* mycompanalysis_aim_subscriber()
 	return &err;
 }
 
-mpai_error_t *mycompanalysis_aim_start()
+mpai_error_t *mycompanalysis_aim_start(const mpai_aim_thread_config_t* thread_config)
 {
 	// LED
 	led0 = device_get_binding(DT_GPIO_LABEL(DT_ALIAS(led0), gpios));
@@ -152,11 +166,13 @@ mpai_error_t *mycompanalysis_aim_start()
 					   GPIO_OUTPUT_INACTIVE |
 						   DT_GPIO_FLAGS(DT_ALIAS(led1), gpios));
 
+	MPAI_AIM_Control_Init(&mycompanalysis_aim_control, thread_config);
+
 	// CREATE SUBSCRIBER
 	subscriber_mycompanalysis_thread_id = k_thread_create(&thread_sub_mycompanalysis_sens_data, thread_sub_mycompanalysis_stack_area,
-										 K_THREAD_STACK_SIZEOF(thread_sub_mycompanalysis_stack_area),
+										 MPAI_AIM_Control_Get_Stack_Size(&mycompanalysis_aim_control, K_THREAD_STACK_SIZEOF(thread_sub_mycompanalysis_stack_area)),
 										 th_subscribe_mycompanalysis_data, NULL, NULL, NULL,
-										 PRIORITY, 0, K_NO_WAIT);
+										 MPAI_AIM_Control_Get_Priority(&mycompanalysis_aim_control), 0, K_NO_WAIT);
 	k_thread_name_set(&thread_sub_mycompanalysis_sens_data, "thread_sub_mycompanalysis");
 
 	// START THREAD
@@ -168,7 +184,12 @@ mpai_error_t *mycompanalysis_aim_start()
 
 mpai_error_t *mycompanalysis_aim_stop()
 {
-	k_thread_abort(subscriber_mycompanalysis_thread_id);
+	// wait the thread to leave its loop, then join it; abort only if it doesn't answer
+	if (MPAI_AIM_Control_Stop(&mycompanalysis_aim_control) != 0 || k_thread_join(subscriber_mycompanalysis_thread_id, K_MSEC(CONFIG_MPAI_AIM_CONTROL_ACK_TIMEOUT_MS)) != 0)
+	{
+		LOG_WRN("Thread not stopped cooperatively, aborting it");
+		k_thread_abort(subscriber_mycompanalysis_thread_id);
+	}
 	LOG_INF("Execution stopped");
 
 	MPAI_ERR_INIT(err, MPAI_AIF_OK);
@@ -177,7 +198,7 @@ mpai_error_t *mycompanalysis_aim_stop()
 
 mpai_error_t *mycompanalysis_aim_resume()
 {
-	k_thread_resume(subscriber_mycompanalysis_thread_id);
+	MPAI_AIM_Control_Resume(&mycompanalysis_aim_control);
 	LOG_INF("Execution resumed");
 
 	MPAI_ERR_INIT(err, MPAI_AIF_OK);
@@ -186,7 +207,7 @@ mpai_error_t *mycompanalysis_aim_resume()
 
 mpai_error_t *mycompanalysis_aim_pause()
 {
-	k_thread_suspend(subscriber_mycompanalysis_thread_id);
+	MPAI_AIM_Control_Pause(&mycompanalysis_aim_control);
 	LOG_INF("Execution paused");
 
 	MPAI_ERR_INIT(err, MPAI_AIF_OK);
@@ -14,6 +14,7 @@
 #include <core_common.h>
 #include <sensors_common.h>
 #include <core_aim.h>
+#include <aim_control.h>
 #include <mycomp_common.h>
 #include <math.h>
 
@@ -22,11 +23,14 @@ __weak MPAI_AIM_MessageStore_t* message_store_mycompanalysis_aim;
 __weak subscriber_channel_t MYCOMP_DATA_CHANNEL;
 __weak subscriber_channel_t MIC_PEAK_DATA_CHANNEL;
 
+// AIM lifecycle control (used by the supervisor)
+extern mpai_aim_control_t mycompanalysis_aim_control;
+
 // AIM subscriber
 mpai_error_t* mycompanalysis_aim_subscriber();
 
 // AIM high priorities commands
-mpai_error_t* mycompanalysis_aim_start();
+mpai_error_t* mycompanalysis_aim_start(const mpai_aim_thread_config_t* thread_config);
 
 mpai_error_t* mycompanalysis_aim_stop();
 
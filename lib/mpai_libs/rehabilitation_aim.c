@@ -16,12 +16,6 @@ LOG_MODULE_REGISTER(MPAI_LIBS_REHABILITATION_AIM, LOG_LEVEL_INF);
 
 /*************** DEFINE ***************/
 
-/* size of stack area used by each thread */
-#define STACKSIZE 1024
-
-/* scheduling priority used by each thread */
-#define PRIORITY 7
-
 /* polling every XXX(ms) to check new motion messages */
 #define CONFIG_REHABILITATION_MOTION_TIMEOUT_MS 3000
 /* polling every XXX(ms) to check new volume peak messages */
@@ -29,6 +23,109 @@ LOG_MODULE_REGISTER(MPAI_LIBS_REHABILITATION_AIM, LOG_LEVEL_INF);
 
 /*************** STATIC ***************/
 static const struct device *led0, *led1;
+mpai_aim_control_t rehabilitation_aim_control;
+
+static void set_error_leds(int on)
+{
+	gpio_pin_set(led0, DT_GPIO_PIN(DT_ALIAS(led0), gpios), on);
+	gpio_pin_set(led1, DT_GPIO_PIN(DT_ALIAS(led1), gpios), !on);
+}
+
+/**************** THREADS **********************/
+
+#ifdef CONFIG_MPAI_AIM_RUNTIME
+
+static mpai_aim_task_t rehabilitation_aim_task;
+
+/* SUBSCRIBER (task multiplexed on the runtime) */
+
+int task_subscribe_rehabilitation_data(mpai_aim_task_t *task)
+{
+	// kept across waits
+	static mpai_message_t aim_motion_message;
+	static mpai_message_t aim_peak_audio_message;
+	static int64_t last_event_peak_audio = 0;
+	static bool movement_error;
+	static int blink;
+
+	MPAI_AIM_TASK_BEGIN(task);
+
+	movement_error = false;
+
+	// wait updates from MOTION_DATA_CHANNEL
+	MPAI_AIM_TASK_AWAIT_MESSAGE(task, message_store_rehabilitation_aim, rehabilitation_aim_subscriber, MOTION_DATA_CHANNEL, CONFIG_REHABILITATION_MOTION_TIMEOUT_MS);
+
+	if (MPAI_AIM_TASK_RESULT(task) > 0)
+	{
+		// get the message from MOTION_DATA_CHANNEL
+		MPAI_MessageStore_copy(message_store_rehabilitation_aim, rehabilitation_aim_subscriber, MOTION_DATA_CHANNEL, &aim_motion_message);
+		LOG_DBG("Received from timestamp %lld\n", aim_motion_message.timestamp);
+
+		// discard old messages
+		if (aim_motion_message.timestamp > last_event_peak_audio || last_event_peak_audio == 0)
+		{
+			if (((motion_data_t *)aim_motion_message.data)->motion_type == STOPPED)
+			{
+				// if the event is STOPPED, the device waits for Audio Peak for a delay (CONFIG_REHABILITATION_MIC_PEAK_TIMEOUT_MS)
+				LOG_INF("MOTION STOPPED: Waiting for Audio Peak");
+				MPAI_AIM_TASK_SLEEP(task, 10);
+
+				MPAI_AIM_TASK_AWAIT_MESSAGE(task, message_store_rehabilitation_aim, rehabilitation_aim_subscriber, MIC_PEAK_DATA_CHANNEL, CONFIG_REHABILITATION_MIC_PEAK_TIMEOUT_MS);
+
+				if (MPAI_AIM_TASK_RESULT(task) > 0)
+				{
+					MPAI_MessageStore_copy(message_store_rehabilitation_aim, rehabilitation_aim_subscriber, MIC_PEAK_DATA_CHANNEL, &aim_peak_audio_message);
+					last_event_peak_audio = aim_peak_audio_message.timestamp;
+					// if the Audio Peak is recognized, the movement it's done in a correct way
+					LOG_INF("MOVEMENT CORRECT!");
+				}
+				else if (MPAI_AIM_TASK_RESULT(task) == 0)
+				{
+					last_event_peak_audio = 0;
+					// if the Audio Peak is not recognized, the movement it's done in a wrong way
+					LOG_ERR("MOVEMENT NOT CORRECT! Audio Peak NOT FOUND");
+					movement_error = true;
+				}
+				else
+				{
+					last_event_peak_audio = 0;
+					printk("ERROR: error while polling: %d\n", MPAI_AIM_TASK_RESULT(task));
+					MPAI_AIM_TASK_FAIL(task);
+				}
+			}
+		} else 
+		{
+			LOG_WRN("Discard old motion event");
+		}
+	}
+	else if (MPAI_AIM_TASK_RESULT(task) == 0)
+	{
+		printk("WARNING: Did not receive new motion data for %d. Continuing poll.\n", CONFIG_REHABILITATION_MOTION_TIMEOUT_MS);
+		LOG_WRN("MOVEMENT NOT RECOGNIZED");
+		movement_error = true;
+	}
+	else
+	{
+		printk("ERROR: error while polling: %d\n", MPAI_AIM_TASK_RESULT(task));
+		MPAI_AIM_TASK_FAIL(task);
+	}
+
+	if (movement_error)
+	{
+		// Show error blinking leds, giving the cpu to the other tasks between the blinks
+		for (blink = 0; blink < 6; blink++)
+		{
+			set_error_leds(blink % 2 == 0);
+			MPAI_AIM_TASK_SLEEP(task, 100);
+		}
+		// leave the leds in the idle state
+		set_error_leds(0);
+	}
+
+	MPAI_AIM_TASK_END(task);
+}
+
+#else
 
 static void show_movement_error()
 {
@@ -36,18 +133,21 @@ static void show_movement_error()
 	int i, on = 1;
 	for (i = 0; i < 6; i++)
 	{
-		gpio_pin_set(led0, DT_GPIO_PIN(DT_ALIAS(led0), gpios), on);
-		gpio_pin_set(led1, DT_GPIO_PIN(DT_ALIAS(led1), gpios), !on);
-		k_sleep(K_MSEC(100));
+		set_error_leds(on);
+		// stop blinking as soon as pause or stop is requested
+		if (MPAI_AIM_Control_Sleep(&rehabilitation_aim_control, K_MSEC(100)) == -EINTR)
+		{
+			break;
+		}
 		on = (on == 1) ? 0 : 1;
 	}
+	// leave the leds in the idle state
+	set_error_leds(0);
 }
 
-/**************** THREADS **********************/
-
 static k_tid_t subscriber_rehabilitation_thread_id;
 
-K_THREAD_STACK_DEFINE(thread_sub_rehabilitation_stack_area, STACKSIZE);
+K_THREAD_STACK_DEFINE(thread_sub_rehabilitation_stack_area, CONFIG_MPAI_AIM_STACK_SIZE_MAX);
 static struct k_thread thread_sub_rehabilitation_sens_data;
 
 /* SUBSCRIBER */
@@ -64,10 +164,10 @@ void th_subscribe_rehabilitation_data(void *dummy1, void *dummy2, void *dummy3)
 
 	LOG_DBG("START SUBSCRIBER");
 
-	while (1)
+	while (MPAI_AIM_Control_Checkpoint(&rehabilitation_aim_control))
 	{
 		// poll updates from MOTION_DATA_CHANNEL
-		int ret_motion = MPAI_MessageStore_poll(message_store_rehabilitation_aim, rehabilitation_aim_subscriber, K_MSEC(CONFIG_REHABILITATION_MOTION_TIMEOUT_MS), MOTION_DATA_CHANNEL);
+		int ret_motion = MPAI_AIM_Control_Poll(&rehabilitation_aim_control, message_store_rehabilitation_aim, rehabilitation_aim_subscriber, CONFIG_REHABILITATION_MOTION_TIMEOUT_MS, MOTION_DATA_CHANNEL);
 
 		if (ret_motion > 0)
 		{
@@ -86,7 +186,7 @@ void th_subscribe_rehabilitation_data(void *dummy1, void *dummy2, void *dummy3)
 					LOG_INF("MOTION STOPPED: Waiting for Audio Peak");
 					k_sleep(K_MSEC(10));
 
-					int ret_mic = MPAI_MessageStore_poll(message_store_rehabilitation_aim, rehabilitation_aim_subscriber, K_MSEC(CONFIG_REHABILITATION_MIC_PEAK_TIMEOUT_MS), MIC_PEAK_DATA_CHANNEL);
+					int ret_mic = MPAI_AIM_Control_Poll(&rehabilitation_aim_control, message_store_rehabilitation_aim, rehabilitation_aim_subscriber, CONFIG_REHABILITATION_MIC_PEAK_TIMEOUT_MS, MIC_PEAK_DATA_CHANNEL);
 				
 					if (ret_mic > 0)
 					{
@@ -103,10 +203,16 @@ void th_subscribe_rehabilitation_data(void *dummy1, void *dummy2, void *dummy3)
 
 						show_movement_error();
 					}
+					else if (ret_mic == -EINTR)
+					{
+						// back to the checkpoint to handle pause or stop
+						continue;
+					}
 					else
 					{
 						last_event_peak_audio = 0;
 						printk("ERROR: error while polling: %d\n", ret_mic);
+						MPAI_AIM_Control_Fail(&rehabilitation_aim_control);
 						return;
 					}
 				} else if (motion_data->motion_type == STARTED)
@@ -124,14 +230,22 @@ void th_subscribe_rehabilitation_data(void *dummy1, void *dummy2, void *dummy3)
 			LOG_WRN("MOVEMENT NOT RECOGNIZED");
 			show_movement_error();
 		}
+		else if (ret_motion == -EINTR)
+		{
+			// back to the checkpoint to handle pause or stop
+			continue;
+		}
 		else
 		{
 			printk("ERROR: error while polling: %d\n", ret_motion);
+			MPAI_AIM_Control_Fail(&rehabilitation_aim_control);
 			return;
 		}
 	}
 }
 
+#endif
+
 /************** EXECUTIONS ***************/
 mpai_error_t* rehabilitation_aim_subscriber()
 {
@@ -139,7 +253,7 @@ mpai_error_t* rehabilitation_aim_subscriber()
 	return &err;
 }
 
-mpai_error_t *rehabilitation_aim_start()
+mpai_error_t *rehabilitation_aim_start(const mpai_aim_thread_config_t* thread_config)
 {
 	// LED
 	led0 = device_get_binding(DT_GPIO_LABEL(DT_ALIAS(led0), gpios));
@@ -152,15 +266,23 @@ mpai_error_t *rehabilitation_aim_start()
 					   GPIO_OUTPUT_INACTIVE |
 						   DT_GPIO_FLAGS(DT_ALIAS(led1), gpios));
 
+	MPAI_AIM_Control_Init(&rehabilitation_aim_control, thread_config);
+
+#ifdef CONFIG_MPAI_AIM_RUNTIME
+	// ADD SUBSCRIBER TO THE RUNTIME
+	MPAI_AIM_Task_Init(&rehabilitation_aim_task, task_subscribe_rehabilitation_data, &rehabilitation_aim_control, NULL);
+	MPAI_AIM_Runtime_Add(&rehabilitation_aim_task);
+#else
 	// CREATE SUBSCRIBER
 	subscriber_rehabilitation_thread_id = k_thread_create(&thread_sub_rehabilitation_sens_data, thread_sub_rehabilitation_stack_area,
-										 K_THREAD_STACK_SIZEOF(thread_sub_rehabilitation_stack_area),
+										 MPAI_AIM_Control_Get_Stack_Size(&rehabilitation_aim_control, K_THREAD_STACK_SIZEOF(thread_sub_rehabilitation_stack_area)),
 										 th_subscribe_rehabilitation_data, NULL, NULL, NULL,
-										 PRIORITY, 0, K_NO_WAIT);
+										 MPAI_AIM_Control_Get_Priority(&rehabilitation_aim_control), 0, K_NO_WAIT);
 	k_thread_name_set(&thread_sub_rehabilitation_sens_data, "thread_sub_rehabilitation");
 
 	// START THREAD
 	k_thread_start(subscriber_rehabilitation_thread_id);
+#endif
 
 	MPAI_ERR_INIT(err, MPAI_AIF_OK);
 	return &err;
@@ -168,7 +290,19 @@ mpai_error_t *rehabilitation_aim_start()
 
 mpai_error_t *rehabilitation_aim_stop()
 {
-	k_thread_abort(subscriber_rehabilitation_thread_id);
+#ifdef CONFIG_MPAI_AIM_RUNTIME
+	// the runtime drops the stopped task at its next round: remove it now, after its current step
+	MPAI_AIM_Control_Stop(&rehabilitation_aim_control);
+	MPAI_AIM_Runtime_Remove(&rehabilitation_aim_task);
+	set_error_leds(0);
+#else
+	// wait the thread to leave its loop, then join it; abort only if it doesn't answer
+	if (MPAI_AIM_Control_Stop(&rehabilitation_aim_control) != 0 || k_thread_join(subscriber_rehabilitation_thread_id, K_MSEC(CONFIG_MPAI_AIM_CONTROL_ACK_TIMEOUT_MS)) != 0)
+	{
+		LOG_WRN("Thread not stopped cooperatively, aborting it");
+		k_thread_abort(subscriber_rehabilitation_thread_id);
+	}
+#endif
 	LOG_INF("Execution stopped");
 
 	MPAI_ERR_INIT(err, MPAI_AIF_OK);
@@ -177,7 +311,7 @@ mpai_error_t *rehabilitation_aim_stop()
 
 mpai_error_t *rehabilitation_aim_resume()
 {
-	k_thread_resume(subscriber_rehabilitation_thread_id);
+	MPAI_AIM_Control_Resume(&rehabilitation_aim_control);
 	LOG_INF("Execution resumed");
 
 	MPAI_ERR_INIT(err, MPAI_AIF_OK);
@@ -186,7 +320,7 @@ mpai_error_t *rehabilitation_aim_resume()
 
 mpai_error_t *rehabilitation_aim_pause()
 {
-	k_thread_suspend(subscriber_rehabilitation_thread_id);
+	MPAI_AIM_Control_Pause(&rehabilitation_aim_control);
 	LOG_INF("Execution paused");
 
 	MPAI_ERR_INIT(err, MPAI_AIF_OK);
@@ -15,12 +15,6 @@ LOG_MODULE_REGISTER(MPAI_LIBS_SENSORS_AIM, LOG_LEVEL_INF);
 
 /*************** DEFINE ***************/
 
-/* size of stack area used by each thread */
-#define STACKSIZE 1024
-
-/* scheduling priority used by each thread */
-#define PRIORITY 7
-
 /* delay between reads from sensors (in ms) */
 #define CONFIG_SENSORS_RATE_MS 100
 
@@ -391,8 +385,9 @@ static void iis3dhhc_config(const struct device *iis3dhhc)
 /**************** THREADS **********************/
 
 static k_tid_t producer_mic_thread_id;
+mpai_aim_control_t sensors_aim_control;
 
-K_THREAD_STACK_DEFINE(thread_prod_stack_area, STACKSIZE);
+K_THREAD_STACK_DEFINE(thread_prod_stack_area, CONFIG_MPAI_AIM_STACK_SIZE_MAX);
 static struct k_thread thread_prod_mic_data;
 
 /* PRODUCER */
@@ -594,6 +589,7 @@ void th_produce_sensors_data(void *arg1, void *dummy2, void *dummy3)
 		if (!sensor_devices_ptr->hts221) {
 			LOG_ERR("Could not get pointer to %s sensor\n",
 				DT_LABEL(DT_INST(0, st_hts221)));
+			MPAI_AIM_Control_Fail(&sensors_aim_control);
 			return;
 		}
 	#endif
@@ -601,6 +597,7 @@ void th_produce_sensors_data(void *arg1, void *dummy2, void *dummy3)
 	#ifdef CONFIG_LIS2DW12
 		if (!sensor_devices_ptr->lis2dw12) {
 			LOG_ERR("Could not get LIS2DW12 device\n");
+			MPAI_AIM_Control_Fail(&sensors_aim_control);
 			return;
 		}
 		lis2dw12_config(sensor_devices_ptr->lis2dw12);
@@ -609,6 +606,7 @@ void th_produce_sensors_data(void *arg1, void *dummy2, void *dummy3)
 	#ifdef CONFIG_LPS22HH
 		if (sensor_devices_ptr->lps22hh == NULL) {
 			LOG_ERR("Could not get LPS22HH device\n");
+			MPAI_AIM_Control_Fail(&sensors_aim_control);
 			return;
 		}
 		lps22hh_config(sensor_devices_ptr->lps22hh);
@@ -617,6 +615,7 @@ void th_produce_sensors_data(void *arg1, void *dummy2, void *dummy3)
 	#ifdef CONFIG_LPS22HB
 		if (sensor_devices_ptr->lps22hb == NULL) {
 			LOG_ERR("Could not get LPS22HB device\n");
+			MPAI_AIM_Control_Fail(&sensors_aim_control);
 			return;
 		}
 	#endif
@@ -624,6 +623,7 @@ void th_produce_sensors_data(void *arg1, void *dummy2, void *dummy3)
 	#ifdef CONFIG_LSM6DSO
 		if (sensor_devices_ptr->lsm6dso == NULL) {
 			LOG_ERR("Could not get LSM6DSO device\n");
+			MPAI_AIM_Control_Fail(&sensors_aim_control);
 			return;
 		}
 		lsm6dso_config(sensor_devices_ptr->lsm6dso);
@@ -632,6 +632,7 @@ void th_produce_sensors_data(void *arg1, void *dummy2, void *dummy3)
 	#ifdef CONFIG_LSM6DSL
 		if (sensor_devices_ptr->lsm6dsl == NULL) {
 			LOG_ERR("Could not get LSM6DSL device\n");
+			MPAI_AIM_Control_Fail(&sensors_aim_control);
 			return;
 		}
 		lsm6dsl_config(sensor_devices_ptr->lsm6dsl);
@@ -640,6 +641,7 @@ void th_produce_sensors_data(void *arg1, void *dummy2, void *dummy3)
 	#ifdef CONFIG_STTS751
 		if (sensor_devices_ptr->stts751 == NULL) {
 			LOG_ERR("Could not get STTS751 device\n");
+			MPAI_AIM_Control_Fail(&sensors_aim_control);
 			return;
 		}
 		stts751_config(sensor_devices_ptr->stts751);
@@ -648,6 +650,7 @@ void th_produce_sensors_data(void *arg1, void *dummy2, void *dummy3)
 	#ifdef CONFIG_IIS3DHHC
 		if (sensor_devices_ptr->iis3dhhc == NULL) {
 			LOG_ERR("Could not get IIS3DHHC device\n");
+			MPAI_AIM_Control_Fail(&sensors_aim_control);
 			return;
 		}
 		iis3dhhc_config(sensor_devices_ptr->iis3dhhc);
@@ -656,20 +659,26 @@ void th_produce_sensors_data(void *arg1, void *dummy2, void *dummy3)
 	#ifdef CONFIG_LIS2MDL
 		if (sensor_devices_ptr->lis2mdl == NULL) {
 			LOG_ERR("Could not get LIS2MDL device\n");
+			MPAI_AIM_Control_Fail(&sensors_aim_control);
 			return;
 		}
 	#endif
 	#ifdef CONFIG_LIS3MDL
 		if (sensor_devices_ptr->lis3mdl == NULL) {
 			LOG_ERR("Could not get LIS3MDL device\n");
+			MPAI_AIM_Control_Fail(&sensors_aim_control);
 			return;
 		}
 	#endif
 
-	while(1) {
+	while (MPAI_AIM_Control_Checkpoint(&sensors_aim_control)) {
 
+		// interrupted by pause/stop requests, so they are handled at the next checkpoint
+		if (MPAI_AIM_Control_Sleep(&sensors_aim_control, K_MSEC(CONFIG_SENSORS_RATE_MS)) == -EINTR) {
+			continue;
+		}
+		// each period is an activation, ended by the checkpoint
 		produce_sensors_data((void*) sensor_result_ptr, (void*) sensor_devices_ptr);
-		k_sleep(K_MSEC(CONFIG_SENSORS_RATE_MS));
 		
 	}
 }
@@ -681,13 +690,15 @@ mpai_error_t* sensors_aim_subscriber()
 	return &err;
 }
 
-mpai_error_t* sensors_aim_start()
+mpai_error_t* sensors_aim_start(const mpai_aim_thread_config_t* thread_config)
 {
+	MPAI_AIM_Control_Init(&sensors_aim_control, thread_config);
+
 	// CREATE PRODUCER
 	producer_mic_thread_id = k_thread_create(&thread_prod_mic_data, thread_prod_stack_area,
-			K_THREAD_STACK_SIZEOF(thread_prod_stack_area),
+			MPAI_AIM_Control_Get_Stack_Size(&sensors_aim_control, K_THREAD_STACK_SIZEOF(thread_prod_stack_area)),
 			th_produce_sensors_data, (void*) &sensor_result, NULL, NULL,
-			PRIORITY, 0, K_NO_WAIT);
+			MPAI_AIM_Control_Get_Priority(&sensors_aim_control), 0, K_NO_WAIT);
 	k_thread_name_set(&thread_prod_mic_data, "thread_prod");
 	
 	// START THREAD
@@ -699,7 +710,12 @@ mpai_error_t* sensors_aim_start()
 
 mpai_error_t* sensors_aim_stop() 
 {
-	k_thread_abort(producer_mic_thread_id);
+	// wait the thread to leave its loop, then join it; abort only if it doesn't answer
+	if (MPAI_AIM_Control_Stop(&sensors_aim_control) != 0 || k_thread_join(producer_mic_thread_id, K_MSEC(CONFIG_MPAI_AIM_CONTROL_ACK_TIMEOUT_MS)) != 0)
+	{
+		LOG_WRN("Thread not stopped cooperatively, aborting it");
+		k_thread_abort(producer_mic_thread_id);
+	}
 	LOG_INF("Execution stopped");
 
 	MPAI_ERR_INIT(err, MPAI_AIF_OK);
@@ -708,7 +724,7 @@ mpai_error_t* sensors_aim_stop()
 
 mpai_error_t* sensors_aim_resume() 
 {
-	k_thread_resume(producer_mic_thread_id);
+	MPAI_AIM_Control_Resume(&sensors_aim_control);
 	LOG_INF("Execution resumed");
 
 	MPAI_ERR_INIT(err, MPAI_AIF_OK);
@@ -717,7 +733,7 @@ mpai_error_t* sensors_aim_resume()
 
 mpai_error_t* sensors_aim_pause() 
 {
-	k_thread_suspend(producer_mic_thread_id);
+	MPAI_AIM_Control_Pause(&sensors_aim_control);
 	LOG_INF("Execution paused");
 
 	MPAI_ERR_INIT(err, MPAI_AIF_OK);
@@ -12,6 +12,7 @@
 
 #include <core_common.h>
 #include <core_aim.h>
+#include <aim_control.h>
 #include <sensors_common.h>
 #include <drivers/i2c.h>
 #include <drivers/spi.h>
@@ -24,11 +25,14 @@
 __weak MPAI_AIM_MessageStore_t* message_store_sensors_aim;
 __weak subscriber_channel_t SENSORS_DATA_CHANNEL;
 
+// AIM lifecycle control (used by the supervisor)
+extern mpai_aim_control_t sensors_aim_control;
+
 // AIM subscriber
 mpai_error_t* sensors_aim_subscriber();
 
 // AIM high priorities commands
-mpai_error_t* sensors_aim_start();
+mpai_error_t* sensors_aim_start(const mpai_aim_thread_config_t* thread_config);
 
 mpai_error_t* sensors_aim_stop();
 
@@ -0,0 +1,368 @@
+/*
+ * @file
+ * @brief Implementation of an AIM that sends the messages of its input channels to the MPAI Store, in batches
+ *
+ * Copyright (c) 2022 University of Turin, Daniele Bortoluzzi <danieleb88@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "telemetry_uplink_aim.h"
+
+#ifdef CONFIG_MPAI_AIM_TELEMETRY_UPLINK
+
+#include <logging/log.h>
+#include <aif_controller.h>
+#include <aiw_iot_rev.h>
+#include <cbor_writer.h>
+#include <coap_connect.h>
+#include <wifi_connect.h>
+
+LOG_MODULE_REGISTER(MPAI_LIBS_TELEMETRY_UPLINK_AIM, LOG_LEVEL_INF);
+
+/*************** STATIC ***************/
+typedef struct _telemetry_uplink_record_t
+{
+	int64_t _timestamp;
+	int32_t _values[TELEMETRY_UPLINK_MAX_VALUES];
+	uint8_t _channel;				// index in uplink_channels
+	uint8_t _count;					// values
+} telemetry_uplink_record_t;
+
+typedef struct _telemetry_uplink_channel_t
+{
+	subscriber_channel_t _channel;
+	const char* _name;
+	telemetry_uplink_sampler_t* _sampler;
+} telemetry_uplink_channel_t;
+
+/* set by the AIW, by channel */
+static telemetry_uplink_sampler_t* uplink_samplers[MPAI_MESSAGE_STORE_CHANNEL_MAX];
+/* input channels of the AIM, from the topology of the AIW */
+static telemetry_uplink_channel_t uplink_channels[MPAI_AIF_CHANNEL_MAX];
+static int uplink_channel_count = 0;
+
+/* records of the current window, in order of time: kept while the network is down */
+static telemetry_uplink_record_t uplink_records[CONFIG_MPAI_AIM_TELEMETRY_UPLINK_MAX_RECORDS];
+static int uplink_record_count = 0;
+static uint32_t uplink_lost = 0;		// records dropped since the latest batch sent
+static uint32_t uplink_seq = 0;
+
+static int uplink_sock = -1;
+static uint8_t uplink_payload[CONFIG_MPAI_AIM_TELEMETRY_UPLINK_MAX_PAYLOAD_SIZE];
+static const char * const uplink_path[] = { "telemetry", MPAI_LIBS_IOT_REV_AIW_NAME, NULL };
+/* given by the publishers of all the input channels */
+K_SEM_DEFINE(uplink_data_ready, 0, 1);
+
+/*************** PRIVATE ***************/
+/* read the messages published on the input channels since the latest read: number read, negative on errors */
+int _uplink_read_channels(void);
+void _uplink_add_record(uint8_t channel_index, const mpai_message_t* message);
+/* encode the first count records: length, negative if they don't fit */
+int _uplink_encode(int count, uint8_t* buffer, size_t size);
+/* send the records in batches up to the payload size, as long as the network is up */
+void _uplink_flush(void);
+void _uplink_remove_records(int count);
+
+/**************** THREADS **********************/
+
+static k_tid_t subscriber_thread_id;
+mpai_aim_control_t telemetry_uplink_aim_control;
+
+K_THREAD_STACK_DEFINE(thread_sub_telemetry_uplink_stack_area, CONFIG_MPAI_AIM_STACK_SIZE_MAX);
+static struct k_thread thread_sub_telemetry_uplink;
+
+/* SUBSCRIBER */
+
+void th_subscribe_telemetry_uplink(void *dummy1, void *dummy2, void *dummy3)
+{
+	ARG_UNUSED(dummy1);
+	ARG_UNUSED(dummy2);
+	ARG_UNUSED(dummy3);
+
+	int64_t window_ts = k_uptime_get();
+
+	LOG_DBG("START SUBSCRIBER");
+
+	while (MPAI_AIM_Control_Checkpoint(&telemetry_uplink_aim_control))
+	{
+		// a single wait for all the channels, up to the end of the window
+		int64_t remaining_ms = window_ts + CONFIG_MPAI_AIM_TELEMETRY_UPLINK_FLUSH_MS - k_uptime_get();
+		int ret = MPAI_AIM_Control_Wait(&telemetry_uplink_aim_control, &uplink_data_ready, MAX(remaining_ms, 0));
+		if (ret > 0)
+		{
+			ret = _uplink_read_channels();
+		}
+
+		if (ret == -EINTR)
+		{
+			// back to the checkpoint to handle pause or stop
+			continue;
+		}
+		else if (ret < 0)
+		{
+			printk("ERROR: error while polling: %d\n", ret);
+			MPAI_AIM_Control_Fail(&telemetry_uplink_aim_control);
+			break;
+		}
+
+		int64_t now = k_uptime_get();
+		if (now - window_ts >= CONFIG_MPAI_AIM_TELEMETRY_UPLINK_FLUSH_MS || uplink_record_count == CONFIG_MPAI_AIM_TELEMETRY_UPLINK_MAX_RECORDS)
+		{
+			_uplink_flush();
+			window_ts = now;
+		}
+	}
+
+	// the records of the last window are not lost
+	_uplink_flush();
+	if (uplink_sock >= 0)
+	{
+		(void)close(uplink_sock);
+		uplink_sock = -1;
+	}
+}
+
+int _uplink_read_channels(void)
+{
+	mpai_message_t aim_message;
+	int count = 0;
+	for (int i = 0; i < uplink_channel_count; i++)
+	{
+		int ret = MPAI_MessageStore_poll(message_store_telemetry_uplink_aim, telemetry_uplink_aim_subscriber, K_NO_WAIT, uplink_channels[i]._channel);
+		if (ret > 0)
+		{
+			MPAI_MessageStore_copy(message_store_telemetry_uplink_aim, telemetry_uplink_aim_subscriber, uplink_channels[i]._channel, &aim_message);
+			_uplink_add_record(i, &aim_message);
+			count++;
+		}
+		else if (ret < 0 && ret != -EAGAIN)
+		{
+			return ret;
+		}
+	}
+	return count;
+}
+
+void _uplink_add_record(uint8_t channel_index, const mpai_message_t* message)
+{
+	if (uplink_record_count == CONFIG_MPAI_AIM_TELEMETRY_UPLINK_MAX_RECORDS)
+	{
+		// the network is down: the oldest record is dropped
+		_uplink_remove_records(1);
+		uplink_lost++;
+	}
+
+	telemetry_uplink_record_t* record = &uplink_records[uplink_record_count++];
+	telemetry_uplink_sampler_t* sampler = uplink_channels[channel_index]._sampler;
+	int count = sampler != NULL ? sampler(message, record->_values, TELEMETRY_UPLINK_MAX_VALUES) : 0;
+
+	record->_timestamp = message->timestamp;
+	record->_channel = channel_index;
+	record->_count = CLAMP(count, 0, TELEMETRY_UPLINK_MAX_VALUES);
+}
+
+void _uplink_remove_records(int count)
+{
+	memmove(uplink_records, &uplink_records[count], (uplink_record_count - count) * sizeof(telemetry_uplink_record_t));
+	uplink_record_count -= count;
+}
+
+int _uplink_encode(int count, uint8_t* buffer, size_t size)
+{
+	cbor_writer_t writer;
+	cbor_writer_init(&writer, buffer, size);
+
+	int channel_records[MPAI_AIF_CHANNEL_MAX] = {0};
+	int channel_count = 0;
+	for (int i = 0; i < count; i++)
+	{
+		channel_count += channel_records[uplink_records[i]._channel]++ == 0 ? 1 : 0;
+	}
+
+	int64_t t0 = uplink_records[0]._timestamp;
+	cbor_put_map(&writer, 4);
+	cbor_put_text(&writer, "seq");
+	cbor_put_uint(&writer, uplink_seq);
+	cbor_put_text(&writer, "t0");
+	cbor_put_int(&writer, t0);
+	cbor_put_text(&writer, "lost");
+	cbor_put_uint(&writer, uplink_lost);
+	cbor_put_text(&writer, "ch");
+	cbor_put_map(&writer, channel_count);
+	for (int c = 0; c < uplink_channel_count; c++)
+	{
+		if (channel_records[c] == 0)
+		{
+			continue;
+		}
+
+		// each record is delta encoded on the previous one of the channel, the first on t0 and zero
+		int64_t previous_ts = t0;
+		int32_t previous_values[TELEMETRY_UPLINK_MAX_VALUES] = {0};
+		cbor_put_text(&writer, uplink_channels[c]._name != NULL ? uplink_channels[c]._name : "");
+		cbor_put_array(&writer, channel_records[c]);
+		for (int i = 0; i < count; i++)
+		{
+			const telemetry_uplink_record_t* record = &uplink_records[i];
+			if (record->_channel != c)
+			{
+				continue;
+			}
+
+			cbor_put_array(&writer, 1 + record->_count);
+			cbor_put_int(&writer, record->_timestamp - previous_ts);
+			for (int v = 0; v < record->_count; v++)
+			{
+				cbor_put_int(&writer, (int64_t) record->_values[v] - previous_values[v]);
+				previous_values[v] = record->_values[v];
+			}
+			previous_ts = record->_timestamp;
+		}
+	}
+	return cbor_writer_get_len(&writer);
+}
+
+void _uplink_flush(void)
+{
+	if (uplink_record_count == 0 || !wifi_is_connected())
+	{
+		return;
+	}
+	if (uplink_sock < 0)
+	{
+		uplink_sock = open_coap_server_socket();
+		if (uplink_sock < 0)
+		{
+			return;
+		}
+	}
+
+	while (uplink_record_count > 0)
+	{
+		// as many records as fit in a payload
+		int count = uplink_record_count;
+		int len = _uplink_encode(count, uplink_payload, sizeof(uplink_payload));
+		while (len < 0 && count > 1)
+		{
+			count /= 2;
+			len = _uplink_encode(count, uplink_payload, sizeof(uplink_payload));
+		}
+		if (len < 0)
+		{
+			LOG_WRN("Record of %lld too large, dropped", (long long) uplink_records[0]._timestamp);
+			_uplink_remove_records(1);
+			uplink_lost++;
+			continue;
+		}
+
+		int r = send_non_con_coap_request(uplink_sock, COAP_METHOD_POST, uplink_path, COAP_CONTENT_FORMAT_APP_CBOR, uplink_payload, len);
+		if (r < 0)
+		{
+			// kept for the next window
+			LOG_WRN("Telemetry batch %u not sent (%d)", (unsigned int) uplink_seq, r);
+			break;
+		}
+		LOG_DBG("Telemetry batch %u sent: %d records in %d bytes", (unsigned int) uplink_seq, count, len);
+		_uplink_remove_records(count);
+		uplink_seq++;
+		uplink_lost = 0;
+	}
+
+	// only the errors are answered: they are logged and discarded, not to fill the socket
+	uint8_t reply[16];
+	while (recv(uplink_sock, reply, sizeof(reply), MSG_DONTWAIT) > 0)
+	{
+		LOG_WRN("Telemetry refused by the MPAI Store: %d.%02d", reply[1] >> 5, reply[1] & 0x1F);
+	}
+}
+
+/************** EXECUTIONS ***************/
+void telemetry_uplink_aim_set_sampler(subscriber_channel_t channel, telemetry_uplink_sampler_t* sampler)
+{
+	if (channel < MPAI_MESSAGE_STORE_CHANNEL_MAX)
+	{
+		uplink_samplers[channel] = sampler;
+	}
+}
+
+mpai_error_t* telemetry_uplink_aim_subscriber()
+{
+	MPAI_ERR_INIT(err, MPAI_AIF_OK);
+	return &err;
+}
+
+mpai_error_t *telemetry_uplink_aim_start(const mpai_aim_thread_config_t* thread_config)
+{
+	// the input channels are the ones connected to the AIM by the topology
+	uplink_channel_count = 0;
+	aim_initialization_cb_t* aim_init = MPAI_Controller_Find_AIM_Init_Config(MPAI_LIBS_IOT_REV_AIM_TELEMETRY_UPLINK_NAME);
+	for (int i = 0; aim_init != NULL && i < aim_init->_count_channels && uplink_channel_count < MPAI_AIF_CHANNEL_MAX; i++)
+	{
+		telemetry_uplink_channel_t* channel = &uplink_channels[uplink_channel_count++];
+		channel->_channel = aim_init->_input_channels[i];
+		channel->_name = NULL;
+		channel->_sampler = channel->_channel < MPAI_MESSAGE_STORE_CHANNEL_MAX ? uplink_samplers[channel->_channel] : NULL;
+		for (int j = 0; j < mpai_message_store_channel_count; j++)
+		{
+			if (message_store_channel_list[j]._channel == channel->_channel)
+			{
+				channel->_name = message_store_channel_list[j]._channel_name;
+			}
+		}
+		LOG_INF("Uplink of channel %s", log_strdup(channel->_name != NULL ? channel->_name : "?"));
+	}
+
+	// the channels are registered by the controller before the start
+	MPAI_MessageStore_Set_Wakeup(message_store_telemetry_uplink_aim, telemetry_uplink_aim_subscriber, &uplink_data_ready);
+	k_sem_reset(&uplink_data_ready);
+
+	MPAI_AIM_Control_Init(&telemetry_uplink_aim_control, thread_config);
+
+	// CREATE SUBSCRIBER
+	subscriber_thread_id = k_thread_create(&thread_sub_telemetry_uplink, thread_sub_telemetry_uplink_stack_area,
+										 MPAI_AIM_Control_Get_Stack_Size(&telemetry_uplink_aim_control, K_THREAD_STACK_SIZEOF(thread_sub_telemetry_uplink_stack_area)),
+										 th_subscribe_telemetry_uplink, NULL, NULL, NULL,
+										 MPAI_AIM_Control_Get_Priority(&telemetry_uplink_aim_control), 0, K_NO_WAIT);
+	k_thread_name_set(&thread_sub_telemetry_uplink, "thread_sub_telemetry_uplink");
+
+	// START THREAD
+	k_thread_start(subscriber_thread_id);
+
+	MPAI_ERR_INIT(err, MPAI_AIF_OK);
+	return &err;
+}
+
+mpai_error_t *telemetry_uplink_aim_stop()
+{
+	// wait the thread to leave its loop, then join it; abort only if it doesn't answer
+	if (MPAI_AIM_Control_Stop(&telemetry_uplink_aim_control) != 0 || k_thread_join(subscriber_thread_id, K_MSEC(CONFIG_MPAI_AIM_CONTROL_ACK_TIMEOUT_MS)) != 0)
+	{
+		LOG_WRN("Thread not stopped cooperatively, aborting it");
+		k_thread_abort(subscriber_thread_id);
+	}
+	LOG_INF("Execution stopped");
+
+	MPAI_ERR_INIT(err, MPAI_AIF_OK);
+	return &err;
+}
+
+mpai_error_t *telemetry_uplink_aim_resume()
+{
+	MPAI_AIM_Control_Resume(&telemetry_uplink_aim_control);
+	LOG_INF("Execution resumed");
+
+	MPAI_ERR_INIT(err, MPAI_AIF_OK);
+	return &err;
+}
+
+mpai_error_t *telemetry_uplink_aim_pause()
+{
+	MPAI_AIM_Control_Pause(&telemetry_uplink_aim_control);
+	LOG_INF("Execution paused");
+
+	MPAI_ERR_INIT(err, MPAI_AIF_OK);
+	return &err;
+}
+
+#endif
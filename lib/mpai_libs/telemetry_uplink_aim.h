@@ -0,0 +1,62 @@
+/*
+ * @file
+ * @brief Headers of an AIM that sends the messages of its input channels to the MPAI Store, in batches
+ *
+ * The messages of the channels connected to the AIM by the AIW topology are sampled into
+ * records (timestamp and fixed point values) and kept for a time window: then they are sent
+ * in a single non-confirmable CoAP POST (telemetry/<AIW name>), in CBOR:
+ *   { "seq": <batch>, "t0": <uptime ms of the first record>, "lost": <records dropped>,
+ *     "ch": { <channel name>: [ [dt, dv0, dv1, ...], ... ] } }
+ * For each channel, the first record has the time from t0 and the values, each next one the
+ * deltas from the previous record of the channel: slow changing values take a byte each.
+ *
+ * Copyright (c) 2022 University of Turin, Daniele Bortoluzzi <danieleb88@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef MPAI_LIBS_TELEMETRY_UPLINK_AIM_H
+#define MPAI_LIBS_TELEMETRY_UPLINK_AIM_H
+
+#include <core_common.h>
+#include <core_aim.h>
+#include <aim_control.h>
+#include <message_store.h>
+
+/* values of a record */
+#define TELEMETRY_UPLINK_MAX_VALUES 8
+
+/**
+ * @brief Sample the payload of a message of a channel, as fixed point values (i.e. in thousandths)
+ *
+ * @return int number of values, up to max_count
+ */
+typedef int (telemetry_uplink_sampler_t)(const mpai_message_t* message, int32_t* values, size_t max_count);
+
+// The implementation will be added in AIW configuration
+__weak MPAI_AIM_MessageStore_t* message_store_telemetry_uplink_aim;
+
+// AIM lifecycle control (used by the supervisor)
+extern mpai_aim_control_t telemetry_uplink_aim_control;
+
+/**
+ * @brief Set the sampler of a channel: without it, only the timestamps of its messages are sent
+ *
+ * @param channel
+ * @param sampler
+ */
+void telemetry_uplink_aim_set_sampler(subscriber_channel_t channel, telemetry_uplink_sampler_t* sampler);
+
+// AIM subscriber
+mpai_error_t* telemetry_uplink_aim_subscriber();
+
+// AIM high priorities commands
+mpai_error_t* telemetry_uplink_aim_start(const mpai_aim_thread_config_t* thread_config);
+
+mpai_error_t* telemetry_uplink_aim_stop();
+
+mpai_error_t* telemetry_uplink_aim_resume();
+
+mpai_error_t* telemetry_uplink_aim_pause();
+
+#endif
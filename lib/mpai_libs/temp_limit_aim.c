@@ -14,12 +14,6 @@ LOG_MODULE_REGISTER(MPAI_LIBS_TEMP_LIMIT_AIM, LOG_LEVEL_INF);
 
 /*************** DEFINE ***************/
 
-/* size of stack area used by each thread */
-#define STACKSIZE 1024
-
-/* scheduling priority used by each thread */
-#define PRIORITY 7
-
 /* delay between sensors (in ms) */
 #define CONFIG_SENSORS_RATE_MS 100
 
@@ -32,8 +26,9 @@ static const struct device *led0;
 /**************** THREADS **********************/
 
 static k_tid_t subscriber_thread_id;
+mpai_aim_control_t temp_limit_aim_control;
 
-K_THREAD_STACK_DEFINE(thread_sub_stack_area, STACKSIZE);
+K_THREAD_STACK_DEFINE(thread_sub_stack_area, CONFIG_MPAI_AIM_STACK_SIZE_MAX);
 static struct k_thread thread_sub_sens_data;
 
 /* SUBSCRIBER */
@@ -48,14 +43,15 @@ void th_subscribe_sensors_data(void *dummy1, void *dummy2, void *dummy3)
 
 	LOG_DBG("START SUBSCRIBER");
 
-	while (1)
+	while (MPAI_AIM_Control_Checkpoint(&temp_limit_aim_control))
 	{
 		/* this function will return once new data has arrived, or upon timeout (1000ms in this case). */
-		int ret = MPAI_MessageStore_poll(message_store_temp_limit_aim, temp_limit_aim_subscriber, K_MSEC(CONFIG_SENSORS_RATE_MS), SENSORS_DATA_CHANNEL);
+		int ret = MPAI_AIM_Control_Poll(&temp_limit_aim_control, message_store_temp_limit_aim, temp_limit_aim_subscriber, CONFIG_SENSORS_RATE_MS, SENSORS_DATA_CHANNEL);
 
 		/* ret returns:
 		 * a positive value if new data was successfully returned
 		 * 0 if the poll timed out
+		 * -EINTR if pause or stop has been requested
 		 * negative if an error occured while polling
 		 */
 		if (ret > 0)
@@ -178,9 +174,15 @@ void th_subscribe_sensors_data(void *dummy1, void *dummy2, void *dummy3)
 		{
 			printk("WARNING: Did not receive new data for 1000ms. Continuing poll.\n");
 		}
+		else if (ret == -EINTR)
+		{
+			// back to the checkpoint to handle pause or stop
+			continue;
+		}
 		else
 		{
 			printk("ERROR: error while polling: %d\n", ret);
+			MPAI_AIM_Control_Fail(&temp_limit_aim_control);
 			return;
 		}
 	}
@@ -193,7 +195,7 @@ mpai_error_t* temp_limit_aim_subscriber()
 	return &err;
 }
 
-mpai_error_t *temp_limit_aim_start()
+mpai_error_t *temp_limit_aim_start(const mpai_aim_thread_config_t* thread_config)
 {
 	// LED
 	led0 = device_get_binding(DT_GPIO_LABEL(DT_ALIAS(led0), gpios));
@@ -201,11 +203,13 @@ mpai_error_t *temp_limit_aim_start()
 					   GPIO_OUTPUT_ACTIVE |
 						   DT_GPIO_FLAGS(DT_ALIAS(led0), gpios));
 
+	MPAI_AIM_Control_Init(&temp_limit_aim_control, thread_config);
+
 	// CREATE SUBSCRIBER
 	subscriber_thread_id = k_thread_create(&thread_sub_sens_data, thread_sub_stack_area,
-										 K_THREAD_STACK_SIZEOF(thread_sub_stack_area),
+										 MPAI_AIM_Control_Get_Stack_Size(&temp_limit_aim_control, K_THREAD_STACK_SIZEOF(thread_sub_stack_area)),
 										 th_subscribe_sensors_data, NULL, NULL, NULL,
-										 PRIORITY, 0, K_NO_WAIT);
+										 MPAI_AIM_Control_Get_Priority(&temp_limit_aim_control), 0, K_NO_WAIT);
 	k_thread_name_set(&thread_sub_sens_data, "thread_sub_temperature");
 
 	// START THREAD
@@ -217,7 +221,12 @@ mpai_error_t *temp_limit_aim_start()
 
 mpai_error_t *temp_limit_aim_stop()
 {
-	k_thread_abort(subscriber_thread_id);
+	// wait the thread to leave its loop, then join it; abort only if it doesn't answer
+	if (MPAI_AIM_Control_Stop(&temp_limit_aim_control) != 0 || k_thread_join(subscriber_thread_id, K_MSEC(CONFIG_MPAI_AIM_CONTROL_ACK_TIMEOUT_MS)) != 0)
+	{
+		LOG_WRN("Thread not stopped cooperatively, aborting it");
+		k_thread_abort(subscriber_thread_id);
+	}
 	LOG_INF("Execution stopped");
 
 	MPAI_ERR_INIT(err, MPAI_AIF_OK);
@@ -226,7 +235,7 @@ mpai_error_t *temp_limit_aim_stop()
 
 mpai_error_t *temp_limit_aim_resume()
 {
-	k_thread_resume(subscriber_thread_id);
+	MPAI_AIM_Control_Resume(&temp_limit_aim_control);
 	LOG_INF("Execution resumed");
 
 	MPAI_ERR_INIT(err, MPAI_AIF_OK);
@@ -235,7 +244,7 @@ mpai_error_t *temp_limit_aim_resume()
 
 mpai_error_t *temp_limit_aim_pause()
 {
-	k_thread_suspend(subscriber_thread_id);
+	MPAI_AIM_Control_Pause(&temp_limit_aim_control);
 	LOG_INF("Execution paused");
 
 	MPAI_ERR_INIT(err, MPAI_AIF_OK);
@@ -16,17 +16,21 @@
 #include <core_common.h>
 #include <sensors_common.h>
 #include <core_aim.h>
+#include <aim_control.h>
 #include <math.h>
 
 // The implementation will be added in AIW configuration
 __weak MPAI_AIM_MessageStore_t* message_store_temp_limit_aim;
 __weak subscriber_channel_t SENSORS_DATA_CHANNEL;
 
+// AIM lifecycle control (used by the supervisor)
+extern mpai_aim_control_t temp_limit_aim_control;
+
 // AIM subscriber
 mpai_error_t* temp_limit_aim_subscriber();
 
 // AIM high priorities commands
-mpai_error_t* temp_limit_aim_start();
+mpai_error_t* temp_limit_aim_start(const mpai_aim_thread_config_t* thread_config);
 
 mpai_error_t* temp_limit_aim_stop();
 
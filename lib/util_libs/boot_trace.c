@@ -0,0 +1,259 @@
+/*
+ * @file
+ * @brief Implementation of the boot trace: a timeline of named milestones, from the cycle counter
+ *
+ * Copyright (c) 2022 University of Turin, Daniele Bortoluzzi <danieleb88@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <boot_trace.h>
+
+#include <init.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/printk.h>
+
+#ifdef CONFIG_MPAI_BOOT_TRACE
+
+/* threads told apart in the table and in the Chrome trace */
+#define BOOT_TRACE_MAX_THREADS 16
+/* longest JSON object of the Chrome trace */
+#define BOOT_TRACE_JSON_CHUNK (128 + CONFIG_MPAI_BOOT_TRACE_NAME_LEN)
+/* characters of the thread names */
+#define BOOT_TRACE_THREAD_NAME_LEN 32
+/* bytes of JSON printed at once on the console */
+#define BOOT_TRACE_PRINT_CHUNK 128
+
+typedef struct {
+	uint64_t cycles;	/* from reset */
+	k_tid_t thread;
+	char name[CONFIG_MPAI_BOOT_TRACE_NAME_LEN + 1];
+	char phase;		/* written last: 0 while the event is recorded */
+} boot_trace_event_t;
+
+/* the part of the JSON from offset, up to size, is copied in buffer */
+typedef struct {
+	char *buffer;
+	size_t size;
+	size_t offset;
+	size_t len;
+} boot_trace_writer_t;
+
+static boot_trace_event_t boot_trace_events[CONFIG_MPAI_BOOT_TRACE_MAX_EVENTS];
+static atomic_t boot_trace_count = ATOMIC_INIT(0);
+
+#if CONFIG_MPAI_BOOT_TRACE_PRINT_MS > 0
+static void print_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(boot_trace_print_work, print_work_handler);
+#endif
+
+/*** PRIVATE ***/
+static uint64_t cycles_from_reset(void)
+{
+	uint32_t cycles = k_cycle_get_32();
+	// the 32 bits counter wraps in tens of seconds: the wraps are the ones expected from the uptime
+	uint64_t expected = (uint64_t)k_uptime_get() * (sys_clock_hw_cycles_per_sec() / MSEC_PER_SEC);
+	uint64_t full = (expected & ~(uint64_t)UINT32_MAX) | cycles;
+
+	if (full > expected + BIT64(31) && full >= BIT64(32)) {
+		full -= BIT64(32);
+	} else if (full + BIT64(31) < expected) {
+		full += BIT64(32);
+	}
+	return full;
+}
+
+static size_t recorded_events(void)
+{
+	return MIN((size_t)atomic_get(&boot_trace_count), CONFIG_MPAI_BOOT_TRACE_MAX_EVENTS);
+}
+
+static int thread_index(k_tid_t *threads, size_t *count, k_tid_t thread)
+{
+	for (size_t i = 0; i < *count; i++) {
+		if (threads[i] == thread) {
+			return i;
+		}
+	}
+	if (*count == BOOT_TRACE_MAX_THREADS) {
+		// the last one stands for the threads in excess
+		return BOOT_TRACE_MAX_THREADS - 1;
+	}
+	threads[*count] = thread;
+	return (*count)++;
+}
+
+static const char *thread_name(k_tid_t thread, char *buffer, size_t size)
+{
+	const char *name = k_thread_name_get(thread);
+
+	if (name == NULL || name[0] == '\0') {
+		snprintf(buffer, size, "%p", thread);
+		return buffer;
+	}
+	return name;
+}
+
+/* the end of a span, or -1 if it's still open */
+static int span_end(size_t begin, size_t count)
+{
+	const boot_trace_event_t *event = &boot_trace_events[begin];
+	int nested = 0;
+
+	for (size_t i = begin + 1; i < count; i++) {
+		const boot_trace_event_t *next = &boot_trace_events[i];
+		if (next->phase == 0 || next->thread != event->thread || strcmp(next->name, event->name) != 0) {
+			continue;
+		}
+		if (next->phase == BOOT_TRACE_PHASE_BEGIN) {
+			nested++;
+		} else if (next->phase == BOOT_TRACE_PHASE_END && nested-- == 0) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+static void json_printf(boot_trace_writer_t *writer, const char *format, ...)
+{
+	char chunk[BOOT_TRACE_JSON_CHUNK];
+	va_list args;
+
+	va_start(args, format);
+	int len = vsnprintf(chunk, sizeof(chunk), format, args);
+	va_end(args);
+	if (len < 0) {
+		return;
+	}
+	len = MIN(len, sizeof(chunk) - 1);
+
+	size_t from = MAX(writer->len, writer->offset);
+	size_t to = MIN(writer->len + len, writer->offset + writer->size);
+	if (from < to) {
+		memcpy(writer->buffer + (from - writer->offset), chunk + (from - writer->len), to - from);
+	}
+	writer->len += len;
+}
+
+#if CONFIG_MPAI_BOOT_TRACE_PRINT_MS > 0
+static void print_work_handler(struct k_work *work)
+{
+	ARG_UNUSED(work);
+	boot_trace_print();
+}
+
+static int boot_trace_init(const struct device *dev)
+{
+	ARG_UNUSED(dev);
+	k_work_schedule(&boot_trace_print_work, K_MSEC(CONFIG_MPAI_BOOT_TRACE_PRINT_MS));
+	return 0;
+}
+
+SYS_INIT(boot_trace_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
+#endif
+
+/*** PUBLIC ***/
+void boot_trace_record(const char *name, char phase)
+{
+	uint64_t cycles = cycles_from_reset();
+	atomic_val_t i = atomic_inc(&boot_trace_count);
+
+	if (i >= CONFIG_MPAI_BOOT_TRACE_MAX_EVENTS) {
+		return;
+	}
+
+	boot_trace_event_t *event = &boot_trace_events[i];
+	event->cycles = cycles;
+	event->thread = k_current_get();
+	strncpy(event->name, name, CONFIG_MPAI_BOOT_TRACE_NAME_LEN);
+	compiler_barrier();
+	event->phase = phase;
+}
+
+size_t boot_trace_json(char *buffer, size_t size, size_t offset)
+{
+	boot_trace_writer_t writer = { .buffer = buffer, .size = size, .offset = offset };
+	k_tid_t threads[BOOT_TRACE_MAX_THREADS];
+	size_t thread_count = 0;
+	size_t count = recorded_events();
+	char name_buffer[16];
+
+	json_printf(&writer, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+	for (size_t i = 0; i < count; i++) {
+		const boot_trace_event_t *event = &boot_trace_events[i];
+		if (event->phase == 0) {
+			continue;
+		}
+
+		size_t known = thread_count;
+		int tid = thread_index(threads, &thread_count, event->thread);
+		if (thread_count > known) {
+			json_printf(&writer, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%.*s\"}},",
+				    tid, BOOT_TRACE_THREAD_NAME_LEN, thread_name(event->thread, name_buffer, sizeof(name_buffer)));
+		}
+		json_printf(&writer, "{\"name\":\"%s\",\"ph\":\"%c\",%s\"ts\":%llu,\"pid\":1,\"tid\":%d},",
+			    event->name, event->phase, event->phase == BOOT_TRACE_PHASE_INSTANT ? "\"s\":\"t\"," : "",
+			    (unsigned long long)k_cyc_to_us_floor64(event->cycles), tid);
+	}
+	// the dropped events are counted in the metadata: the last object has no trailing comma
+	json_printf(&writer, "{\"name\":\"dropped\",\"ph\":\"M\",\"pid\":1,\"args\":{\"events\":%u}}]}",
+		    (unsigned int)(atomic_get(&boot_trace_count) - count));
+
+	return writer.len;
+}
+
+void boot_trace_print(void)
+{
+	k_tid_t threads[BOOT_TRACE_MAX_THREADS];
+	size_t thread_count = 0;
+	uint8_t depth[BOOT_TRACE_MAX_THREADS] = { 0 };
+	size_t count = recorded_events();
+	char name_buffer[16];
+
+	printk("Boot trace: %u milestones, %u dropped (ms from reset)\n", (unsigned int)count,
+	       (unsigned int)(atomic_get(&boot_trace_count) - count));
+	printk("%10s %10s  %-20s %s\n", "start", "duration", "thread", "milestone");
+	for (size_t i = 0; i < count; i++) {
+		const boot_trace_event_t *event = &boot_trace_events[i];
+		if (event->phase == 0) {
+			continue;
+		}
+
+		int tid = thread_index(threads, &thread_count, event->thread);
+		if (event->phase == BOOT_TRACE_PHASE_END) {
+			depth[tid] -= depth[tid] > 0;
+			continue;
+		}
+
+		uint32_t start_us = k_cyc_to_us_floor64(event->cycles);
+		char duration[16] = "-";
+		if (event->phase == BOOT_TRACE_PHASE_BEGIN) {
+			int end = span_end(i, count);
+			if (end < 0) {
+				strcpy(duration, "running");
+			} else {
+				uint32_t duration_us = k_cyc_to_us_floor64(boot_trace_events[end].cycles - event->cycles);
+				snprintf(duration, sizeof(duration), "%u.%03u", duration_us / USEC_PER_MSEC, duration_us % USEC_PER_MSEC);
+			}
+		}
+		printk("%6u.%03u %10s  %-20s %*s%s\n", start_us / USEC_PER_MSEC, start_us % USEC_PER_MSEC, duration,
+		       thread_name(event->thread, name_buffer, sizeof(name_buffer)), 2 * depth[tid], "", event->name);
+		if (event->phase == BOOT_TRACE_PHASE_BEGIN) {
+			depth[tid]++;
+		}
+	}
+
+	// the Chrome trace, to be copied in a file
+	char chunk[BOOT_TRACE_PRINT_CHUNK];
+	size_t len = boot_trace_json(chunk, sizeof(chunk), 0);
+	printk("Boot trace (Chrome trace JSON):\n");
+	for (size_t offset = 0; offset < len; offset += sizeof(chunk)) {
+		size_t written = boot_trace_json(chunk, sizeof(chunk), offset);
+		printk("%.*s", (int)MIN(sizeof(chunk), written - offset), chunk);
+	}
+	printk("\n");
+}
+
+#endif /* CONFIG_MPAI_BOOT_TRACE */
@@ -0,0 +1,60 @@
+/*
+ * @file
+ * @brief Headers of the boot trace: a timeline of named milestones, from the cycle counter
+ *
+ * The milestones are spans (BOOT_TRACE_BEGIN and BOOT_TRACE_END with the same name, on the
+ * same thread) or instants (BOOT_TRACE_MARK), recorded with the time from reset and the
+ * thread. The timeline is printed on the console as a table and as a Chrome trace (JSON,
+ * to be loaded in chrome://tracing or https://ui.perfetto.dev), and served by the telemetry
+ * server (/boot/trace). Without CONFIG_MPAI_BOOT_TRACE the macros are empty.
+ *
+ * Copyright (c) 2022 University of Turin, Daniele Bortoluzzi <danieleb88@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef BOOT_TRACE_H_
+#define BOOT_TRACE_H_
+
+#include <zephyr.h>
+#include <stddef.h>
+
+/* Chrome trace phases */
+#define BOOT_TRACE_PHASE_BEGIN 'B'
+#define BOOT_TRACE_PHASE_END 'E'
+#define BOOT_TRACE_PHASE_INSTANT 'i'
+
+#ifdef CONFIG_MPAI_BOOT_TRACE
+#define BOOT_TRACE_BEGIN(name) boot_trace_record(name, BOOT_TRACE_PHASE_BEGIN)
+#define BOOT_TRACE_END(name) boot_trace_record(name, BOOT_TRACE_PHASE_END)
+#define BOOT_TRACE_MARK(name) boot_trace_record(name, BOOT_TRACE_PHASE_INSTANT)
+#else
+#define BOOT_TRACE_BEGIN(name) do { } while (0)
+#define BOOT_TRACE_END(name) do { } while (0)
+#define BOOT_TRACE_MARK(name) do { } while (0)
+#endif
+
+/**
+ * @brief Record a milestone of the current thread (once the trace is full, it's dropped)
+ *
+ * @param name copied, up to CONFIG_MPAI_BOOT_TRACE_NAME_LEN characters
+ * @param phase BOOT_TRACE_PHASE_*
+ */
+void boot_trace_record(const char *name, char phase);
+
+/**
+ * @brief Write a part of the Chrome trace (JSON) of the milestones recorded so far
+ *
+ * @param buffer filled with the bytes of the JSON from offset, up to size
+ * @param size
+ * @param offset
+ * @return size_t total length of the JSON: the bytes written are MIN(size, total - offset)
+ */
+size_t boot_trace_json(char *buffer, size_t size, size_t offset);
+
+/**
+ * @brief Print on the console the milestones recorded so far: the table and the Chrome trace
+ */
+void boot_trace_print(void);
+
+#endif /* BOOT_TRACE_H_ */
@@ -0,0 +1,134 @@
+/*
+ * @file
+ * @brief Implementation of a minimal CBOR (RFC 8949) encoder
+ *
+ * Copyright (c) 2022 University of Turin, Daniele Bortoluzzi <danieleb88@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "cbor_writer.h"
+
+#include <errno.h>
+#include <string.h>
+
+#define CBOR_MAJOR_UINT 0
+#define CBOR_MAJOR_NEGATIVE_INT 1
+#define CBOR_MAJOR_TEXT 3
+#define CBOR_MAJOR_ARRAY 4
+#define CBOR_MAJOR_MAP 5
+#define CBOR_MAJOR_SIMPLE 7
+
+#define CBOR_FALSE 20
+#define CBOR_TRUE 21
+#define CBOR_NULL 22
+#define CBOR_FLOAT32 26
+
+/*** PRIVATE ***/
+static void put_bytes(cbor_writer_t* me, const void* data, size_t len)
+{
+	if (me->_overflow || len > me->_size - me->_len)
+	{
+		me->_overflow = true;
+		return;
+	}
+	memcpy(&me->_buffer[me->_len], data, len);
+	me->_len += len;
+}
+
+/* initial byte and argument, in the shortest form */
+static void put_head(cbor_writer_t* me, uint8_t major, uint64_t argument)
+{
+	uint8_t head[9];
+	size_t len;
+
+	if (argument < 24)
+	{
+		head[0] = (major << 5) | argument;
+		len = 1;
+	}
+	else
+	{
+		// 1, 2, 4 or 8 bytes, big endian
+		size_t bytes = argument <= UINT8_MAX ? 1 : argument <= UINT16_MAX ? 2 : argument <= UINT32_MAX ? 4 : 8;
+		head[0] = (major << 5) | (bytes == 1 ? 24 : bytes == 2 ? 25 : bytes == 4 ? 26 : 27);
+		for (size_t i = 0; i < bytes; i++)
+		{
+			head[bytes - i] = (uint8_t) (argument >> (8 * i));
+		}
+		len = bytes + 1;
+	}
+	put_bytes(me, head, len);
+}
+
+/*** PUBLIC ***/
+void cbor_writer_init(cbor_writer_t* me, uint8_t* buffer, size_t size)
+{
+	me->_buffer = buffer;
+	me->_size = size;
+	me->_len = 0;
+	me->_overflow = false;
+}
+
+void cbor_put_uint(cbor_writer_t* me, uint64_t value)
+{
+	put_head(me, CBOR_MAJOR_UINT, value);
+}
+
+void cbor_put_int(cbor_writer_t* me, int64_t value)
+{
+	if (value < 0)
+	{
+		// -1 - n
+		put_head(me, CBOR_MAJOR_NEGATIVE_INT, (uint64_t) (-1 - value));
+	}
+	else
+	{
+		put_head(me, CBOR_MAJOR_UINT, (uint64_t) value);
+	}
+}
+
+void cbor_put_float(cbor_writer_t* me, float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	uint8_t item[5] = { (CBOR_MAJOR_SIMPLE << 5) | CBOR_FLOAT32, bits >> 24, bits >> 16, bits >> 8, bits };
+	put_bytes(me, item, sizeof(item));
+}
+
+void cbor_put_bool(cbor_writer_t* me, bool value)
+{
+	put_head(me, CBOR_MAJOR_SIMPLE, value ? CBOR_TRUE : CBOR_FALSE);
+}
+
+void cbor_put_null(cbor_writer_t* me)
+{
+	put_head(me, CBOR_MAJOR_SIMPLE, CBOR_NULL);
+}
+
+void cbor_put_text(cbor_writer_t* me, const char* text)
+{
+	size_t len = strlen(text);
+	put_head(me, CBOR_MAJOR_TEXT, len);
+	put_bytes(me, text, len);
+}
+
+void cbor_put_map(cbor_writer_t* me, size_t count)
+{
+	put_head(me, CBOR_MAJOR_MAP, count);
+}
+
+void cbor_put_array(cbor_writer_t* me, size_t count)
+{
+	put_head(me, CBOR_MAJOR_ARRAY, count);
+}
+
+void cbor_put_encoded(cbor_writer_t* me, const uint8_t* data, size_t len)
+{
+	put_bytes(me, data, len);
+}
+
+int cbor_writer_get_len(const cbor_writer_t* me)
+{
+	return me->_overflow ? -ENOMEM : (int) me->_len;
+}
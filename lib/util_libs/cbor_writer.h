@@ -0,0 +1,80 @@
+/*
+ * @file
+ * @brief Headers of a minimal CBOR (RFC 8949) encoder
+ *
+ * Items are appended one after the other to a buffer, with definite lengths only:
+ * maps and arrays are opened with the number of their entries, followed by them.
+ * An item that doesn't fit marks the writer as overflowed, and the following ones
+ * are discarded, so the result is checked once at the end.
+ *
+ * Copyright (c) 2022 University of Turin, Daniele Bortoluzzi <danieleb88@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef CBOR_WRITER_H
+#define CBOR_WRITER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct _cbor_writer_t
+{
+	uint8_t* _buffer;
+	size_t _size;
+	size_t _len;
+	bool _overflow;				// an item didn't fit
+} cbor_writer_t;
+
+/**
+ * @brief Initialize a writer on a buffer
+ *
+ * @param me
+ * @param buffer
+ * @param size
+ */
+void cbor_writer_init(cbor_writer_t* me, uint8_t* buffer, size_t size);
+
+void cbor_put_uint(cbor_writer_t* me, uint64_t value);
+
+void cbor_put_int(cbor_writer_t* me, int64_t value);
+
+/**
+ * @brief Append a float, as single precision
+ */
+void cbor_put_float(cbor_writer_t* me, float value);
+
+void cbor_put_bool(cbor_writer_t* me, bool value);
+
+void cbor_put_null(cbor_writer_t* me);
+
+/**
+ * @brief Append a NUL terminated string, as text string
+ */
+void cbor_put_text(cbor_writer_t* me, const char* text);
+
+/**
+ * @brief Open a map of count pairs: the keys and values follow
+ */
+void cbor_put_map(cbor_writer_t* me, size_t count);
+
+/**
+ * @brief Open an array of count items: the items follow
+ */
+void cbor_put_array(cbor_writer_t* me, size_t count);
+
+/**
+ * @brief Append an item already encoded
+ */
+void cbor_put_encoded(cbor_writer_t* me, const uint8_t* data, size_t len);
+
+/**
+ * @brief Length of the items appended
+ *
+ * @param me
+ * @return int bytes, -ENOMEM if some of them didn't fit
+ */
+int cbor_writer_get_len(const cbor_writer_t* me);
+
+#endif
@@ -19,6 +19,7 @@
 LOG_MODULE_REGISTER(COAP_CONNECT, LOG_LEVEL_INF);
 
 #include <net_private.h>
+#include <boot_trace.h>
 
 /* CoAP socket fd */
 struct pollfd fds[1];
@@ -27,9 +28,324 @@ int coap_sock;
 
 struct coap_block_context blk_ctx;
 
+/* negotiated when the client starts */
+static enum coap_block_size coap_block_size = COAP_BLOCK_64;
+
+/* the server is the only peer: its RTT estimates are kept across connections */
+static coap_rtt_peer_t coap_peer;
+
+/* registered by coap_observe */
+static coap_observation_t *observations[CONFIG_COAP_CLIENT_MAX_OBSERVATIONS];
+
 /*** PRIVATE ***/
+/* IPv4 and UDP headers, besides the ones of CoAP */
+#define COAP_UDP_IPV4_OVERHEAD (NET_IPV4H_LEN + NET_UDPH_LEN + COAP_MSG_OVERHEAD)
+
+static enum coap_block_size negotiate_block_size(void)
+{
+	struct net_if *iface = net_if_get_default();
+	enum coap_block_size size = COAP_BLOCK_1024;
+	size_t max_payload = COAP_BLOCK_MAX_SIZE;
+	uint16_t mtu;
+
+	// offloaded interfaces (i.e. the Wi-Fi module) may not know their MTU
+	mtu = iface != NULL ? net_if_get_mtu(iface) : 0;
+	if (mtu > COAP_UDP_IPV4_OVERHEAD) {
+		max_payload = MIN(max_payload, mtu - COAP_UDP_IPV4_OVERHEAD);
+	}
+
+	while (size > COAP_BLOCK_16 && coap_block_size_to_bytes(size) > max_payload) {
+		size--;
+	}
+
+	LOG_INF("COAP block size: %d (MTU %d)", coap_block_size_to_bytes(size), mtu);
+
+	return size;
+}
+
+/* Large msg rebuilt in a single buffer */
+struct large_msg_reassembly {
+	struct coap_block_context *blk_ctx;
+	coap_msg_buffer_t buffer;
+};
+
+static int send_block_request(const char * const * large_path, struct coap_block_context *blk_ctx,
+			      const coap_etag_t *etag, const uint8_t *token, uint16_t id);
+static int process_block_reply(struct coap_packet *reply, struct coap_block_context *blk_ctx, coap_etag_t *etag,
+			       coap_block_callback_t *block_callback, void *user_data);
+
+/* the request of the current block, or its retransmission (same message id) after a timeout */
+static int send_transfer_request(coap_transfer_t *transfer, bool retransmission)
+{
+	int64_t now = k_uptime_get();
+
+	if (retransmission) {
+		transfer->retransmissions++;
+		transfer->timeout_ms = coap_rtt_backoff(transfer->initial_timeout_ms, transfer->timeout_ms);
+		coap_peer.retransmissions++;
+		LOG_WRN("Retransmitting COAP request (%d): %s", transfer->retransmissions, log_strdup(transfer->path[0]));
+	} else {
+		transfer->id = coap_next_id();
+		transfer->sent_at = now;
+		transfer->retransmissions = 0;
+		transfer->acked = false;
+		transfer->initial_timeout_ms = coap_rtt_initial_timeout(&coap_peer, now);
+		transfer->timeout_ms = transfer->initial_timeout_ms;
+		coap_peer.requests++;
+		LOG_INF("Calling COAP (block %zd): %s",
+			transfer->blk_ctx.current / coap_block_size_to_bytes(transfer->blk_ctx.block_size),
+			log_strdup(transfer->path[0]));
+	}
+	transfer->deadline = now + transfer->timeout_ms;
+
+	return send_block_request(transfer->path, &transfer->blk_ctx, transfer->etag, transfer->token, transfer->id);
+}
+
+/* the outstanding transfer the reply is for: piggybacked replies and empty ACKs have the message id
+ * of the request, separate replies only its token */
+static coap_transfer_t *find_transfer(coap_transfer_t *transfers, size_t count, const struct coap_packet *reply)
+{
+	uint8_t token[COAP_TOKEN_MAX_LEN];
+	uint8_t type;
+	uint16_t id;
+	uint8_t tkl;
+
+	tkl = coap_header_get_token(reply, token);
+	type = coap_header_get_type(reply);
+	id = coap_header_get_id(reply);
+
+	for (size_t i = 0; i < count; i++) {
+		if (transfers[i].result != -EINPROGRESS) {
+			continue;
+		}
+		if (type == COAP_TYPE_ACK && transfers[i].id != id) {
+			continue;
+		}
+		if ((type == COAP_TYPE_ACK && tkl == 0) ||
+		    (tkl == COAP_TOKEN_MAX_LEN && memcmp(transfers[i].token, token, tkl) == 0)) {
+			return &transfers[i];
+		}
+	}
+
+	return NULL;
+}
+
+/* all the blocks of a transfer share its token: a separate reply retransmitted by the server (our
+ * ACK lost) can be the one of a block already received, so its Block2 must be the outstanding one */
+static bool is_outstanding_block(const struct coap_packet *reply, const struct coap_block_context *blk_ctx)
+{
+	int block2 = coap_get_option_int(reply, COAP_OPTION_BLOCK2);
+
+	// without Block2 (i.e. errors) the reply is for the outstanding request
+	if (block2 < 0) {
+		return true;
+	}
+
+	return (block2 >> 4) * coap_block_size_to_bytes(block2 & 0x07) == blk_ctx->current;
+}
+
+static void end_transfer(coap_transfer_t *transfer, int result, size_t *running)
+{
+	transfer->result = result;
+	(*running)--;
+}
+
+static int send_empty_ack(uint16_t id)
+{
+	struct coap_packet ack;
+	uint8_t data[4];
+	int r;
+
+	r = coap_packet_init(&ack, data, sizeof(data), COAP_VERSION_1, COAP_TYPE_ACK,
+			     0, NULL, COAP_CODE_EMPTY, id);
+	if (r < 0) {
+		return r;
+	}
+
+	return send(coap_sock, ack.data, ack.offset, 0);
+}
+
+/* RFC 7641, 3.4: a notification older than the last one is dropped */
+static bool is_fresh_notification(uint32_t last_seq, uint32_t seq, int64_t elapsed_ms)
+{
+	return (last_seq < seq && seq - last_seq < BIT(23)) ||
+	       (last_seq > seq && last_seq - seq > BIT(23)) ||
+	       elapsed_ms > 128 * MSEC_PER_SEC;
+}
+
+/* pass a msg to the observation with its token: false if it isn't a notification */
+static bool dispatch_notification(const struct coap_packet *reply)
+{
+	uint8_t token[COAP_TOKEN_MAX_LEN];
+	struct coap_option etag_option;
+	coap_observation_t *observation = NULL;
+	coap_etag_t etag = { .len = 0 };
+	int64_t now = k_uptime_get();
+	uint8_t code;
+	uint8_t tkl;
+	int seq;
+
+	tkl = coap_header_get_token(reply, token);
+	for (size_t i = 0; i < ARRAY_SIZE(observations) && tkl == COAP_TOKEN_MAX_LEN; i++) {
+		if (observations[i] != NULL && memcmp(observations[i]->token, token, tkl) == 0) {
+			observation = observations[i];
+			break;
+		}
+	}
+	if (observation == NULL) {
+		return false;
+	}
+
+	if (coap_header_get_type(reply) == COAP_TYPE_CON) {
+		(void)send_empty_ack(coap_header_get_id(reply));
+	}
+
+	code = coap_header_get_code(reply);
+	if (code == COAP_CODE_EMPTY) {
+		return true;
+	}
+	// 4.xx and 5.xx
+	if ((code >> 5) >= 4) {
+		LOG_WRN("COAP observation of %s ended (%d.%02d)", log_strdup(observation->path[0]), code >> 5, code & 0x1f);
+		observation->registered = false;
+		return true;
+	}
+
+	// without Observe option, the server has ended the observation: this is the last notification
+	seq = coap_get_option_int(reply, COAP_OPTION_OBSERVE);
+	if (seq < 0) {
+		LOG_WRN("COAP observation of %s ended", log_strdup(observation->path[0]));
+		observation->registered = false;
+	} else if (observation->notified &&
+		   !is_fresh_notification(observation->seq, seq, now - observation->notified_at)) {
+		return true;
+	} else {
+		observation->seq = seq;
+	}
+	observation->notified_at = now;
+	observation->notified = true;
+
+	if (coap_find_options(reply, COAP_OPTION_ETAG, &etag_option, 1) == 1 && etag_option.len <= COAP_ETAG_MAX_LEN) {
+		memcpy(etag.value, etag_option.value, etag_option.len);
+		etag.len = etag_option.len;
+	}
+	observation->callback(observation->path, &etag, observation->user_data);
+
+	return true;
+}
+
+/* GET with Observe 0 (register) or 1 (deregister) */
+static int send_observe_request(coap_observation_t *observation, uint32_t observe)
+{
+	struct coap_packet request;
+	const char * const *p;
+	uint8_t *data;
+	int r;
+
+	data = (uint8_t *)k_malloc(MAX_COAP_MSG_LEN);
+	if (!data) {
+		return -ENOMEM;
+	}
+
+	r = coap_packet_init(&request, data, MAX_COAP_MSG_LEN,
+			     COAP_VERSION_1, COAP_TYPE_CON,
+			     COAP_TOKEN_MAX_LEN, observation->token,
+			     COAP_METHOD_GET, coap_next_id());
+	if (r < 0) {
+		LOG_ERR("Failed to init CoAP message");
+		goto end;
+	}
+
+	// options in increasing order: Observe, Uri-Path, Block2
+	r = coap_append_option_int(&request, COAP_OPTION_OBSERVE, observe);
+	if (r < 0) {
+		LOG_ERR("Failed to append Observe option");
+		goto end;
+	}
+
+	for (p = observation->path; p && *p; p++) {
+		r = coap_packet_append_option(&request, COAP_OPTION_URI_PATH,
+					      *p, strlen(*p));
+		if (r < 0) {
+			LOG_ERR("Unable add option to request");
+			goto end;
+		}
+	}
+
+	// the notifications are only triggers: the smallest first block (NUM 0, SZX 0) is enough
+	r = coap_append_option_int(&request, COAP_OPTION_BLOCK2, 0);
+	if (r < 0) {
+		LOG_ERR("Unable to add block2 option.");
+		goto end;
+	}
+
+	r = send(coap_sock, request.data, request.offset, 0);
+
+end:
+	k_free(data);
+
+	return r < 0 ? r : 0;
+}
+
+/* retransmit the requests timed out, failing the ones retransmitted COAP_RTT_MAX_RETRANSMIT times:
+ * the nearest deadline is returned */
+static int64_t check_deadlines(coap_transfer_t *transfers, size_t count, size_t *running)
+{
+	int64_t now = k_uptime_get();
+	int64_t next_deadline = now + COAP_REPLY_TIMEOUT_MS;
+	int r;
+
+	for (size_t i = 0; i < count; i++) {
+		coap_transfer_t *transfer = &transfers[i];
+
+		if (transfer->result != -EINPROGRESS) {
+			continue;
+		}
+		if (transfer->deadline <= now) {
+			if (transfer->acked || transfer->retransmissions >= COAP_RTT_MAX_RETRANSMIT) {
+				LOG_ERR("COAP request timed out: %s", log_strdup(transfer->path[0]));
+				coap_peer.timeouts++;
+				end_transfer(transfer, -ETIMEDOUT, running);
+				continue;
+			}
+			r = send_transfer_request(transfer, true);
+			if (r < 0) {
+				end_transfer(transfer, r, running);
+				continue;
+			}
+		}
+		next_deadline = MIN(next_deadline, transfer->deadline);
+	}
+
+	return next_deadline;
+}
+
+static bool large_msg_reassembly_callback(const uint8_t *payload, size_t len, void *user_data)
+{
+	struct large_msg_reassembly *reassembly = user_data;
+
+	// the Size2 of the first block allows a single allocation
+	if (reassembly->buffer.data == NULL && reassembly->blk_ctx->total_size > 0 &&
+	    coap_msg_buffer_reserve(&reassembly->buffer, reassembly->blk_ctx->total_size + 1) < 0) {
+		return false;
+	}
+
+	return coap_msg_buffer_append(payload, len, &reassembly->buffer);
+}
+
+int get_large_coap_msgs_with_callback(const char * const * large_path, coap_block_callback_t* block_callback, void* user_data)
+{
+	return get_large_coap_msgs_if_modified(large_path, NULL, block_callback, user_data);
+}
+
+int get_large_coap_msgs_if_modified(const char * const * large_path, coap_etag_t* etag, coap_block_callback_t* block_callback, void* user_data)
+{
+	coap_transfer_t transfer = { .path = large_path, .etag = etag, .block_callback = block_callback, .user_data = user_data };
+
+	return get_large_coap_msgs_parallel(&transfer, 1);
+}
+
 void extract_data_result(struct coap_packet packet, uint8_t* data_result, bool add_termination);
-int send_obs_reply_ack(uint16_t id, uint8_t *token, uint8_t tkl, const char * const * obs_path);
 
 /*** PUBLIC ***/
 int get_coap_sock(void)
@@ -47,6 +363,16 @@ struct coap_block_context* get_block_context_ptr(void)
 	return &blk_ctx;
 }
 
+enum coap_block_size get_coap_block_size(void)
+{
+	return coap_block_size;
+}
+
+void get_coap_rtt_stats(coap_rtt_peer_t *stats)
+{
+	*stats = coap_peer;
+}
+
 void wait(void)
 {
 	if (poll(fds, nfds, -1) < 0) {
@@ -61,9 +387,9 @@ void prepare_fds(void)
 	nfds++;
 }
 
-int start_coap_client(void)
+int open_coap_server_socket(void)
 {
-	int ret = 0;
+	int sock;
 	struct sockaddr_in addr;
 
 	addr.sin_family = AF_INET;
@@ -72,20 +398,43 @@ int start_coap_client(void)
 	inet_pton(AF_INET, IP_ADDRESS_COAP_SERVER,
 		  &addr.sin_addr);
 
-	coap_sock = socket(addr.sin_family, SOCK_DGRAM, IPPROTO_UDP);
-	if (coap_sock < 0) {
+	sock = socket(addr.sin_family, SOCK_DGRAM, IPPROTO_UDP);
+	if (sock < 0) {
 		LOG_ERR("Failed to create UDP socket %d", errno);
 		return -errno;
 	}
 
-	ret = connect(coap_sock, (struct sockaddr *)&addr, sizeof(addr));
-	if (ret < 0) {
+	if (connect(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+		int ret = -errno;
+
 		LOG_ERR("Cannot connect to UDP remote : %d", errno);
-		return -errno;
+		(void)close(sock);
+		return ret;
 	}
 
+	return sock;
+}
+
+int start_coap_client(void)
+{
+	BOOT_TRACE_BEGIN("coap_client_start");
+	coap_sock = open_coap_server_socket();
+	if (coap_sock < 0) {
+		BOOT_TRACE_END("coap_client_start");
+		return coap_sock;
+	}
+
+	// a new socket replaces the one of a previous client
+	nfds = 0;
 	prepare_fds();
 
+	coap_block_size = negotiate_block_size();
+
+	if (coap_peer.rto_ms == 0) {
+		coap_rtt_init(&coap_peer);
+	}
+	BOOT_TRACE_END("coap_client_start");
+
 	return 0;
 }
 
@@ -180,7 +529,7 @@ int process_large_coap_reply(uint8_t * data_result)
 	}
 
 	extract_data_result(reply, data_result, false);
-	// printk("Response block %zd: %s\n", get_block_context().current / 64, data_result);
+	// printk("Response block %zd: %s\n", get_block_context().current / coap_block_size_to_bytes(get_block_context().block_size), data_result);
 
 	last_block = coap_next_block(&reply, &blk_ctx);
 	if (!last_block) {
@@ -196,14 +545,15 @@ end:
 	return ret;
 }
 
-int process_obs_coap_reply(const char * const *  obs_path)
+int process_large_coap_reply_with_callback(struct coap_block_context* blk_ctx, coap_block_callback_t* block_callback, void* user_data)
 {
-	struct coap_packet reply;
-	uint16_t id;
-	uint8_t token[COAP_TOKEN_MAX_LEN];
+	return process_large_coap_reply_with_etag(blk_ctx, NULL, block_callback, user_data);
+}
+
+int process_large_coap_reply_with_etag(struct coap_block_context* blk_ctx, coap_etag_t* etag, coap_block_callback_t* block_callback, void* user_data)
+{
+	struct coap_packet reply = {};
 	uint8_t *data;
-	uint8_t type;
-	uint8_t tkl;
 	int rcvd;
 	int ret;
 
@@ -230,29 +580,117 @@ int process_obs_coap_reply(const char * const *  obs_path)
 		goto end;
 	}
 
-	// net_hexdump("Response", data, rcvd);
-
 	ret = coap_packet_parse(&reply, data, rcvd, NULL, 0);
 	if (ret < 0) {
 		LOG_ERR("Invalid data received");
 		goto end;
 	}
 
-	tkl = coap_header_get_token(&reply, token);
-	id = coap_header_get_id(&reply);
+	ret = process_block_reply(&reply, blk_ctx, etag, block_callback, user_data);
 
-	type = coap_header_get_type(&reply);
-	if (type == COAP_TYPE_ACK) {
-		ret = 0;
-	} else if (type == COAP_TYPE_CON) {
-		ret = send_obs_reply_ack(id, token, tkl, obs_path);
-	}
 end:
 	k_free(data);
 
 	return ret;
 }
 
+static int process_block_reply(struct coap_packet *reply, struct coap_block_context *blk_ctx, coap_etag_t *etag,
+			       coap_block_callback_t *block_callback, void *user_data)
+{
+	struct coap_option etag_option;
+	uint8_t *payload;
+	uint16_t payload_len = 0;
+	uint8_t code;
+	int ret;
+
+	code = coap_header_get_code(reply);
+	if (code == COAP_RESPONSE_CODE_VALID) {
+		return COAP_REPLY_NOT_MODIFIED;
+	}
+	// 4.xx and 5.xx
+	if ((code >> 5) >= 4) {
+		LOG_WRN("COAP error response %d.%02d", code >> 5, code & 0x1f);
+		return -ENOENT;
+	}
+
+	// the version is the one of the first block
+	if (etag != NULL && blk_ctx->current == 0) {
+		etag->len = 0;
+		if (coap_find_options(reply, COAP_OPTION_ETAG, &etag_option, 1) == 1 && etag_option.len <= COAP_ETAG_MAX_LEN) {
+			memcpy(etag->value, etag_option.value, etag_option.len);
+			etag->len = etag_option.len;
+		}
+	}
+
+	ret = coap_update_from_block(reply, blk_ctx);
+	if (ret < 0) {
+		return ret;
+	}
+
+	// the payload is consumed before the next block overwrites the buffer
+	payload = coap_packet_get_payload(reply, &payload_len);
+	if (payload != NULL && !block_callback(payload, payload_len, user_data)) {
+		return -ECANCELED;
+	}
+
+	return coap_next_block(reply, blk_ctx) == 0 ? 1 : 0;
+}
+
+int send_non_con_coap_request(int sock, uint8_t method, const char * const * path,
+			      uint16_t content_format, const uint8_t *payload, size_t len)
+{
+	struct coap_packet request;
+	const char * const *p;
+	uint8_t *data;
+	int r;
+
+	data = (uint8_t *)k_malloc(MAX_COAP_MSG_LEN);
+	if (!data) {
+		return -ENOMEM;
+	}
+
+	r = coap_packet_init(&request, data, MAX_COAP_MSG_LEN,
+			     COAP_VERSION_1, COAP_TYPE_NON_CON,
+			     COAP_TOKEN_MAX_LEN, coap_next_token(),
+			     method, coap_next_id());
+	if (r < 0) {
+		goto end;
+	}
+
+	for (p = path; p && *p && r == 0; p++) {
+		r = coap_packet_append_option(&request, COAP_OPTION_URI_PATH,
+					      *p, strlen(*p));
+	}
+	if (r == 0) {
+		r = coap_append_option_int(&request, COAP_OPTION_CONTENT_FORMAT,
+					   content_format);
+	}
+	if (r == 0) {
+		/* the success is not answered: the errors are, and read by the caller */
+		r = coap_append_option_int(&request, COAP_OPTION_NO_RESPONSE,
+					   COAP_NO_RESPONSE_SUCCESS);
+	}
+	if (r == 0 && len > 0) {
+		r = coap_packet_append_payload_marker(&request);
+		if (r == 0) {
+			r = coap_packet_append_payload(&request, payload, len);
+		}
+	}
+	if (r < 0) {
+		LOG_ERR("Unable to build the request (%d)", r);
+		goto end;
+	}
+
+	if (send(sock, request.data, request.offset, 0) < 0) {
+		r = -errno;
+	}
+
+end:
+	k_free(data);
+
+	return r;
+}
+
 int send_simple_coap_request(uint8_t method, const char * const *  simple_path)
 {
 	uint8_t payload[] = "payload";
@@ -321,17 +759,33 @@ end:
 }
 
 int send_large_coap_request(const char * const * large_path)
+{
+	if (get_block_context().total_size == 0) {
+		coap_block_transfer_init(get_block_context_ptr(), coap_block_size,
+					 BLOCK_WISE_TRANSFER_SIZE_GET);
+	}
+
+	return send_large_coap_request_with_context(large_path, get_block_context_ptr());
+}
+
+int send_large_coap_request_with_context(const char * const * large_path, struct coap_block_context* blk_ctx)
+{
+	return send_large_coap_request_with_etag(large_path, blk_ctx, NULL);
+}
+
+int send_large_coap_request_with_etag(const char * const * large_path, struct coap_block_context* blk_ctx, const coap_etag_t* etag)
+{
+	return send_block_request(large_path, blk_ctx, etag, coap_next_token(), coap_next_id());
+}
+
+static int send_block_request(const char * const * large_path, struct coap_block_context *blk_ctx,
+			      const coap_etag_t *etag, const uint8_t *token, uint16_t id)
 {
 	struct coap_packet request;
 	const char * const *p;
 	uint8_t *data;
 	int r;
 
-	if (get_block_context().total_size == 0) {
-		coap_block_transfer_init(get_block_context_ptr(), COAP_BLOCK_64,
-					 BLOCK_WISE_TRANSFER_SIZE_GET);
-	}
-
 	data = (uint8_t *)k_malloc(MAX_COAP_MSG_LEN);
 	if (!data) {
 		return -ENOMEM;
@@ -339,13 +793,23 @@ int send_large_coap_request(const char * const * large_path)
 
 	r = coap_packet_init(&request, data, MAX_COAP_MSG_LEN,
 			     COAP_VERSION_1, COAP_TYPE_CON,
-			     COAP_TOKEN_MAX_LEN, coap_next_token(),
-			     COAP_METHOD_GET, coap_next_id());
+			     COAP_TOKEN_MAX_LEN, token,
+			     COAP_METHOD_GET, id);
 	if (r < 0) {
 		LOG_ERR("Failed to init CoAP message");
 		goto end;
 	}
 
+	// options in increasing order: ETag, Uri-Path, Block2
+	if (etag != NULL && etag->len > 0 && blk_ctx->current == 0) {
+		r = coap_packet_append_option(&request, COAP_OPTION_ETAG,
+					      etag->value, etag->len);
+		if (r < 0) {
+			LOG_ERR("Unable to add ETag option");
+			goto end;
+		}
+	}
+
 	for (p = large_path; p && *p; p++) {
 		r = coap_packet_append_option(&request, COAP_OPTION_URI_PATH,
 					      *p, strlen(*p));
@@ -355,12 +819,21 @@ int send_large_coap_request(const char * const * large_path)
 		}
 	}
 
-	r = coap_append_block2_option(&request, get_block_context_ptr());
+	r = coap_append_block2_option(&request, blk_ctx);
 	if (r < 0) {
 		LOG_ERR("Unable to add block2 option.");
 		goto end;
 	}
 
+	// Size2 0 asks the server for the total size (RFC 7959, 4)
+	if (blk_ctx->current == 0 && blk_ctx->total_size == 0) {
+		r = coap_append_option_int(&request, COAP_OPTION_SIZE2, 0);
+		if (r < 0) {
+			LOG_ERR("Unable to add size2 option.");
+			goto end;
+		}
+	}
+
 	net_hexdump("Request", request.data, request.offset);
 
 	r = send(get_coap_sock(), request.data, request.offset, 0);
@@ -373,51 +846,280 @@ end:
 
 char* get_large_coap_msgs(const char * const * large_path)
 {
+	struct large_msg_reassembly reassembly = {};
+	coap_transfer_t transfer = { .path = large_path, .block_callback = large_msg_reassembly_callback, .user_data = &reassembly };
 	int r;
-	uint8_t data_single_result[MAX_COAP_MSG_LEN];
-	char * data_large_result_tmp = NULL;
 
-	// loop until there are blocks
-	while (1) {
-		LOG_DBG("\nCoAP client Large GET (block %zd)\n",
-		       get_block_context().current / 64 /*COAP_BLOCK_64*/);
-		LOG_INF("Calling COAP (block %zd): %s", get_block_context().current / 64 /*COAP_BLOCK_64*/, log_strdup(large_path[0]));
-		r = send_large_coap_request(large_path);
-		if (r < 0) {
-			return NULL;
+	reassembly.blk_ctx = &transfer.blk_ctx;
+	r = get_large_coap_msgs_parallel(&transfer, 1);
+	if (r < 0 || coap_msg_buffer_reserve(&reassembly.buffer, 1) < 0) {
+		k_free(reassembly.buffer.data);
+		return NULL;
+	}
+
+	return (char *)reassembly.buffer.data;
+}
+
+int get_large_coap_msgs_parallel(coap_transfer_t *transfers, size_t count)
+{
+	struct coap_packet reply;
+	coap_transfer_t *transfer;
+	int64_t next_deadline;
+	size_t started = 0;
+	size_t running = 0;
+	uint8_t *data;
+	int rcvd;
+	int r;
+
+	data = (uint8_t *)k_malloc(MAX_COAP_MSG_LEN);
+	if (!data) {
+		return -ENOMEM;
+	}
+
+	BOOT_TRACE_BEGIN("coap_block_transfers");
+	while (started < count || running > 0) {
+		// keep up to CONFIG_COAP_CLIENT_MAX_REQUESTS transfers outstanding
+		while (started < count && running < CONFIG_COAP_CLIENT_MAX_REQUESTS) {
+			transfer = &transfers[started++];
+			// the total size is unknown until the server sends Size2
+			coap_block_transfer_init(&transfer->blk_ctx, coap_block_size, 0);
+			// all the blocks of a transfer share its token
+			memcpy(transfer->token, coap_next_token(), COAP_TOKEN_MAX_LEN);
+			transfer->result = -EINPROGRESS;
+			running++;
+
+			r = send_transfer_request(transfer, false);
+			if (r < 0) {
+				end_transfer(transfer, r, &running);
+			}
 		}
-		
-		// reset old single result
-		memset(data_single_result, 0, MAX_COAP_MSG_LEN);
-		r = process_large_coap_reply(data_single_result);
-		if (r < 0) {
-			return NULL;
+
+		next_deadline = check_deadlines(transfers, started, &running);
+		if (running == 0) {
+			continue;
 		}
 
-		if (data_large_result_tmp != NULL) 
-		{
-			// concat results
-			char * data_large_result_concat = append_strings(data_large_result_tmp, (char*)data_single_result);
-			k_free(data_large_result_tmp);
-			data_large_result_tmp = k_malloc(strlen(data_large_result_concat-1));
-			strcpy(data_large_result_tmp, data_large_result_concat);
-			k_free(data_large_result_concat);
+		r = poll(fds, nfds, MAX(next_deadline - k_uptime_get(), 0));
+		if (r == 0) {
+			continue;
+		}
+		if (r > 0) {
+			rcvd = recv(coap_sock, data, MAX_COAP_MSG_LEN, MSG_DONTWAIT);
+			if (rcvd < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+				continue;
+			}
+			r = rcvd > 0 ? rcvd : (rcvd == 0 ? -EIO : -errno);
 		} else {
-			// first execution, so concat to empty string
-			data_large_result_tmp = append_strings("", (char*)data_single_result);
+			r = -errno;
+		}
+		if (r < 0) {
+			LOG_ERR("COAP transfers failed: %d", r);
+			for (size_t i = 0; i < started; i++) {
+				if (transfers[i].result == -EINPROGRESS) {
+					end_transfer(&transfers[i], r, &running);
+				}
+			}
+			continue;
+		}
+
+		if (coap_packet_parse(&reply, data, rcvd, NULL, 0) < 0) {
+			LOG_ERR("Invalid data received");
+			continue;
+		}
+
+		// replies to requests of previous transfers (i.e. duplicates) are dropped
+		transfer = find_transfer(transfers, started, &reply);
+		if (transfer == NULL) {
+			(void)dispatch_notification(&reply);
+			continue;
+		}
+
+		if (coap_header_get_code(&reply) == COAP_CODE_EMPTY) {
+			// the reply will be separate: no more retransmissions
+			transfer->acked = true;
+			transfer->deadline = k_uptime_get() + COAP_REPLY_TIMEOUT_MS;
+			continue;
 		}
-		
-		/* Received last block */
-		if (r == 1) {
-			memset(get_block_context_ptr(), 0, sizeof(get_block_context()));
 
-			// concat full result and return
-			char * data_large_result_concat = append_strings(data_large_result_tmp, "");
-			k_free(data_large_result_tmp);
-			return data_large_result_concat;
+		if (coap_header_get_type(&reply) == COAP_TYPE_CON) {
+			(void)send_empty_ack(coap_header_get_id(&reply));
+		}
+		if (!is_outstanding_block(&reply, &transfer->blk_ctx)) {
+			LOG_WRN("Duplicate COAP reply dropped: %s", log_strdup(transfer->path[0]));
+			continue;
 		}
+		if (coap_header_get_type(&reply) != COAP_TYPE_CON && !transfer->acked) {
+			// the time of a separate reply is up to the server
+			coap_rtt_update(&coap_peer, k_uptime_get() - transfer->sent_at,
+					transfer->retransmissions, k_uptime_get());
+		}
+
+		r = process_block_reply(&reply, &transfer->blk_ctx, transfer->etag,
+					transfer->block_callback, transfer->user_data);
+		if (r == 0) {
+			r = send_transfer_request(transfer, false);
+			if (r >= 0) {
+				continue;
+			}
+		}
+
+		end_transfer(transfer, r == 1 ? 0 : r, &running);
 	}
-	return NULL;
+
+	BOOT_TRACE_END("coap_block_transfers");
+	k_free(data);
+
+	for (size_t i = 0; i < count; i++) {
+		if (transfers[i].result < 0) {
+			return transfers[i].result;
+		}
+	}
+
+	return 0;
+}
+
+int coap_observe(coap_observation_t *observation)
+{
+	int slot = -1;
+	int r;
+
+	for (int i = 0; i < ARRAY_SIZE(observations); i++) {
+		if (observations[i] == observation) {
+			slot = i;
+			break;
+		}
+		if (observations[i] == NULL && slot < 0) {
+			slot = i;
+		}
+	}
+	if (slot < 0) {
+		return -ENOMEM;
+	}
+
+	// a renewal keeps the token, so the server replaces the observation (RFC 7641, 3.3.1)
+	if (observations[slot] != observation) {
+		memcpy(observation->token, coap_next_token(), COAP_TOKEN_MAX_LEN);
+		observation->notified = false;
+	}
+
+	r = send_observe_request(observation, 0);
+	if (r < 0) {
+		return r;
+	}
+
+	LOG_INF("Observing COAP resource %s", log_strdup(observation->path[0]));
+	observations[slot] = observation;
+	observation->registered = true;
+	observation->registered_at = k_uptime_get();
+
+	return 0;
+}
+
+int coap_observe_cancel(coap_observation_t *observation)
+{
+	for (int i = 0; i < ARRAY_SIZE(observations); i++) {
+		if (observations[i] == observation) {
+			observations[i] = NULL;
+		}
+	}
+	observation->registered = false;
+
+	return send_observe_request(observation, 1);
+}
+
+int coap_wait_notifications(int timeout_ms)
+{
+	int r = poll(fds, nfds, timeout_ms);
+
+	return r < 0 ? -errno : r;
+}
+
+int coap_process_notifications(int timeout_ms)
+{
+	struct coap_packet reply;
+	int processed = 0;
+	uint8_t *data;
+	int rcvd;
+	int r;
+
+	data = (uint8_t *)k_malloc(MAX_COAP_MSG_LEN);
+	if (!data) {
+		return -ENOMEM;
+	}
+
+	while (1) {
+		r = poll(fds, nfds, timeout_ms);
+		if (r <= 0) {
+			r = r < 0 ? -errno : 0;
+			break;
+		}
+
+		rcvd = recv(coap_sock, data, MAX_COAP_MSG_LEN, MSG_DONTWAIT);
+		if (rcvd < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+			continue;
+		}
+		if (rcvd <= 0) {
+			r = rcvd == 0 ? -EIO : -errno;
+			break;
+		}
+
+		if (coap_packet_parse(&reply, data, rcvd, NULL, 0) < 0) {
+			LOG_ERR("Invalid data received");
+		} else if (dispatch_notification(&reply)) {
+			processed++;
+		}
+
+		// the msgs already arrived are processed without waiting again
+		timeout_ms = 0;
+	}
+
+	k_free(data);
+
+	return r < 0 ? r : processed;
+}
+
+int coap_msg_buffer_reserve(coap_msg_buffer_t *buffer, size_t size)
+{
+	uint8_t *data;
+
+	if (size <= buffer->size) {
+		return 0;
+	}
+
+	data = (uint8_t *)k_malloc(size);
+	if (!data) {
+		LOG_ERR("Not enough memory for a msg of %zu bytes", size);
+		return -ENOMEM;
+	}
+
+	if (buffer->data != NULL) {
+		memcpy(data, buffer->data, buffer->len);
+		k_free(buffer->data);
+	} else {
+		data[0] = '\0';
+	}
+	buffer->data = data;
+	buffer->size = size;
+
+	return 0;
+}
+
+bool coap_msg_buffer_append(const uint8_t *payload, size_t len, void *user_data)
+{
+	coap_msg_buffer_t *buffer = user_data;
+	size_t needed = buffer->len + len + 1;
+
+	// doubled, so that the copies are linear in the size of the msg
+	if (needed > buffer->size &&
+	    coap_msg_buffer_reserve(buffer, MAX(buffer->size * 2, needed)) < 0) {
+		return false;
+	}
+
+	memcpy(&buffer->data[buffer->len], payload, len);
+	buffer->len += len;
+	buffer->data[buffer->len] = '\0';
+
+	return true;
 }
 
 void extract_data_result(struct coap_packet packet, uint8_t* data_result, bool add_termination)
@@ -495,160 +1197,3 @@ int send_simple_coap_msgs_and_wait_for_reply(uint8_t * data_result, const char *
 
     return 0;
 }
-
-int send_obs_reply_ack(uint16_t id, uint8_t *token, uint8_t tkl, const char * const * obs_path)
-{
-    struct coap_packet request;
-    uint8_t *data;
-    int r;
-
-    data = (uint8_t *)k_malloc(MAX_COAP_MSG_LEN);
-    if (!data) {
-        return -ENOMEM;
-    }
-
-    r = coap_packet_init(&request, data, MAX_COAP_MSG_LEN,
-                COAP_VERSION_1, COAP_TYPE_ACK, tkl, token, 0, id);
-    if (r < 0) {
-        LOG_ERR("Failed to init CoAP message");
-        goto end;
-    }
-
-    net_hexdump("Request", request.data, request.offset);
-
-    r = send(get_coap_sock(), request.data, request.offset, 0);
-end:
-    k_free(data);
-
-    return r;
-}
-
-int send_obs_coap_request(const char * const * obs_path)
-{
-    struct coap_packet request;
-    const char * const *p;
-    uint8_t *data;
-    int r;
-
-    data = (uint8_t *)k_malloc(MAX_COAP_MSG_LEN);
-    if (!data) {
-        return -ENOMEM;
-    }
-
-    r = coap_packet_init(&request, data, MAX_COAP_MSG_LEN,
-                COAP_VERSION_1, COAP_TYPE_CON,
-                COAP_TOKEN_MAX_LEN, coap_next_token(),
-                COAP_METHOD_GET, coap_next_id());
-    if (r < 0) {
-        LOG_ERR("Failed to init CoAP message");
-        goto end;
-    }
-
-    r = coap_append_option_int(&request, COAP_OPTION_OBSERVE, 0);
-    if (r < 0) {
-        LOG_ERR("Failed to append Observe option");
-        goto end;
-    }
-
-    for (p = obs_path; p && *p; p++) {
-        r = coap_packet_append_option(&request, COAP_OPTION_URI_PATH,
-                        *p, strlen(*p));
-        if (r < 0) {
-            LOG_ERR("Unable add option to request");
-            goto end;
-        }
-    }
-
-    net_hexdump("Request", request.data, request.offset);
-
-    r = send(get_coap_sock(), request.data, request.offset, 0);
-
-end:
-    k_free(data);
-
-    return r;
-}
-
-int send_obs_reset_coap_request(const char * const * obs_path)
-{
-    struct coap_packet request;
-    const char * const *p;
-    uint8_t *data;
-    int r;
-
-    data = (uint8_t *)k_malloc(MAX_COAP_MSG_LEN);
-    if (!data) {
-        return -ENOMEM;
-    }
-
-    r = coap_packet_init(&request, data, MAX_COAP_MSG_LEN,
-                COAP_VERSION_1, COAP_TYPE_RESET,
-                COAP_TOKEN_MAX_LEN, coap_next_token(),
-                0, coap_next_id());
-    if (r < 0) {
-        LOG_ERR("Failed to init CoAP message");
-        goto end;
-    }
-
-    r = coap_append_option_int(&request, COAP_OPTION_OBSERVE, 0);
-    if (r < 0) {
-        LOG_ERR("Failed to append Observe option");
-        goto end;
-    }
-
-    for (p = obs_path; p && *p; p++) {
-        r = coap_packet_append_option(&request, COAP_OPTION_URI_PATH,
-                        *p, strlen(*p));
-        if (r < 0) {
-            LOG_ERR("Unable add option to request");
-            goto end;
-        }
-    }
-
-    net_hexdump("Request", request.data, request.offset);
-
-    r = send(get_coap_sock(), request.data, request.offset, 0);
-
-end:
-    k_free(data);
-
-    return r;
-}
-
-int register_observer(const char * const * obs_path)
-{
-    uint8_t counter = 0U;
-    int r;
-
-    while (1) {
-        /* Test CoAP OBS GET method */
-        if (!counter) {
-            printk("\nCoAP client OBS GET\n");
-            r = send_obs_coap_request(obs_path);
-            if (r < 0) {
-                return r;
-            }
-        } else {
-            printk("\nCoAP OBS Notification\n");
-        }
-
-        r = process_obs_coap_reply(obs_path);
-        if (r < 0) {
-            return r;
-        }
-
-        counter++;
-
-        /* Unregister */
-        if (counter == 5U) {
-            /* TODO: Functionality can be verified byt waiting for
-            * some time and make sure client shouldn't receive
-            * any notifications. If client still receives
-            * notifications means, Observer is not removed.
-            */
-            return send_obs_reset_coap_request(obs_path);
-        }
-    }
-
-    return 0;
-}
\ No newline at end of file
@@ -19,13 +19,103 @@
 #include <net/net_core.h>
 #include <net/net_if.h>
 
+#include <coap_rtt.h>
+
 /* COAP Port used */
 #define PEER_PORT CONFIG_COAP_SERVER_PORT
-#define MAX_COAP_MSG_LEN 256
+
+/* max payload of a block, lowered to fit the MTU of the interface */
+#define COAP_BLOCK_MAX_SIZE CONFIG_COAP_SERVER_BLOCK_SIZE
+/* header, token and options of a msg carrying a block */
+#define COAP_MSG_OVERHEAD 64
+#define MAX_COAP_MSG_LEN (COAP_BLOCK_MAX_SIZE + COAP_MSG_OVERHEAD)
 
 #define BLOCK_WISE_TRANSFER_SIZE_GET 4096
 #define IP_ADDRESS_COAP_SERVER CONFIG_COAP_SERVER_IPV4_ADDR
 
+/* max length of the ETag option (RFC 7252, 5.10.6) */
+#define COAP_ETAG_MAX_LEN 8
+
+/* returned when the resource has not changed since the ETag sent (2.03 Valid) */
+#define COAP_REPLY_NOT_MODIFIED 2
+
+/* max wait of a separate reply, once the request has been acknowledged */
+#define COAP_REPLY_TIMEOUT_MS 5000
+
+/* No-Response option (RFC 7967), not defined by Zephyr */
+#ifndef COAP_OPTION_NO_RESPONSE
+#define COAP_OPTION_NO_RESPONSE 258
+#endif
+/* not interested in the 2.xx responses */
+#define COAP_NO_RESPONSE_SUCCESS 2
+
+/**
+ * @brief ETag of a resource: its version, as sent by the server
+ */
+typedef struct {
+	uint8_t value[COAP_ETAG_MAX_LEN];
+	uint8_t len;
+} coap_etag_t;
+
+/**
+ * @brief Called with the payload of each block of a large coap msg, in order
+ * 
+ * @return false to stop the transfer
+ */
+typedef bool (coap_block_callback_t)(const uint8_t* payload, size_t len, void* user_data);
+
+/**
+ * @brief Buffer a large coap msg is rebuilt in, NUL terminated
+ */
+typedef struct {
+	uint8_t *data;
+	size_t size;
+	size_t len;
+} coap_msg_buffer_t;
+
+/**
+ * @brief Transfer of a large coap msg, run with others by get_large_coap_msgs_parallel
+ */
+typedef struct {
+	const char * const *path;
+	coap_etag_t *etag;			/* NULL for an unconditional request, see get_large_coap_msgs_if_modified */
+	coap_block_callback_t *block_callback;
+	void *user_data;
+	int result;				/* 0, COAP_REPLY_NOT_MODIFIED or negative, once ended */
+	/* set by the client */
+	struct coap_block_context blk_ctx;
+	uint8_t token[COAP_TOKEN_MAX_LEN];	/* the replies are matched by token */
+	uint16_t id;				/* of the request of the current block */
+	int64_t sent_at;			/* first transmission of the request */
+	int64_t deadline;			/* of the retransmission */
+	uint32_t initial_timeout_ms;
+	uint32_t timeout_ms;
+	uint8_t retransmissions;
+	bool acked;				/* by an empty ACK: the reply will be separate */
+} coap_transfer_t;
+
+/**
+ * @brief Called when an observed resource has changed, with its new ETag (empty if the server doesn't send it).
+ * It runs while the socket is being read: it must not send coap msgs
+ */
+typedef void (coap_notification_callback_t)(const char * const * path, const coap_etag_t *etag, void *user_data);
+
+/**
+ * @brief Observation of a resource (RFC 7641): the server notifies its changes
+ */
+typedef struct {
+	const char * const *path;
+	coap_notification_callback_t *callback;
+	void *user_data;
+	/* set by the client */
+	uint8_t token[COAP_TOKEN_MAX_LEN];	/* the same for the whole observation */
+	uint32_t seq;				/* Observe option of the last notification */
+	int64_t notified_at;
+	int64_t registered_at;
+	bool notified;
+	bool registered;			/* false once the server has ended it */
+} coap_observation_t;
+
 /**
  * @brief Get the coap sock object
  * 
@@ -49,6 +139,29 @@ struct coap_block_context* get_block_context_ptr(void);
 
 void wait(void);
 
+/**
+ * @brief Get the size of the blocks requested: the largest one fitting both COAP_BLOCK_MAX_SIZE
+ * and the MTU of the interface, chosen when the client starts. The server can still answer with
+ * smaller blocks (RFC 7959, 2.4)
+ * 
+ * @return enum coap_block_size 
+ */
+enum coap_block_size get_coap_block_size(void);
+
+/**
+ * @brief Get the counters (requests, retransmissions, timeouts) and the RTT estimates of the server
+ * 
+ * @param stats 
+ */
+void get_coap_rtt_stats(coap_rtt_peer_t *stats);
+
+/**
+ * @brief Open a UDP socket connected to the COAP server, apart from the one of the client
+ * 
+ * @return int the socket, negative on errors
+ */
+int open_coap_server_socket(void);
+
 /**
  * @brief Initialize coap client
  * 
@@ -56,6 +169,21 @@ void wait(void);
  */
 int start_coap_client(void);
 
+/**
+ * @brief Send a non-confirmable COAP request with a payload, asking the server to answer
+ * only the errors (No-Response, RFC 7967): nothing is waited
+ * 
+ * @param sock socket connected to the server
+ * @param method COAP METHOD (POST, PUT)
+ * @param path COAP URL
+ * @param content_format 
+ * @param payload 
+ * @param len 
+ * @return int 0 if sent, negative on errors
+ */
+int send_non_con_coap_request(int sock, uint8_t method, const char * const * path,
+			      uint16_t content_format, const uint8_t *payload, size_t len);
+
 /**
  * @brief Send a COAP request with the specified method and path
  * 
@@ -91,14 +219,147 @@ int process_large_coap_reply(uint8_t * data_result);
 
 
 /**
- * @brief Rebuild entire large coap msgs
+ * @brief Send a COAP request for a block of a large msg, using the specified block context
+ * 
+ * @param large_path 
+ * @param blk_ctx 
+ * @return int 
+ */
+int send_large_coap_request_with_context(const char * const * large_path, struct coap_block_context* blk_ctx);
+
+/**
+ * @brief Send a COAP request for a block of a large msg, using the specified block context.
+ * The first block is conditional: the server answers 2.03 Valid if the resource still has the ETag
+ * 
+ * @param large_path 
+ * @param blk_ctx 
+ * @param etag NULL or empty for an unconditional request
+ * @return int 
+ */
+int send_large_coap_request_with_etag(const char * const * large_path, struct coap_block_context* blk_ctx, const coap_etag_t* etag);
+
+/**
+ * @brief Process a block of a large result from coap server, passing its payload to a callback
+ * 
+ * @param blk_ctx 
+ * @param block_callback 
+ * @param user_data 
+ * @return int 1 if it was the last block, 0 if there are other blocks, negative on errors
+ */
+int process_large_coap_reply_with_callback(struct coap_block_context* blk_ctx, coap_block_callback_t* block_callback, void* user_data);
+
+/**
+ * @brief Process a block of a large result from coap server, passing its payload to a callback.
+ * The ETag of the first block is saved before its payload is passed
+ * 
+ * @param blk_ctx 
+ * @param etag NULL if not needed
+ * @param block_callback 
+ * @param user_data 
+ * @return int 1 if it was the last block, 0 if there are other blocks, COAP_REPLY_NOT_MODIFIED,
+ * -ENOENT if the server answered with an error, negative on other errors
+ */
+int process_large_coap_reply_with_etag(struct coap_block_context* blk_ctx, coap_etag_t* etag, coap_block_callback_t* block_callback, void* user_data);
+
+/**
+ * @brief Get a large coap msg block by block, without rebuilding it: each payload is passed to the callback
+ * as soon as it arrives. The transfer has its own block context, so the callback can get other msgs
  * 
- * @return char* 
+ * @param large_path 
+ * @param block_callback 
+ * @param user_data 
+ * @return int 0 on success, negative on errors
+ */
+int get_large_coap_msgs_with_callback(const char * const * large_path, coap_block_callback_t* block_callback, void* user_data);
+
+/**
+ * @brief Get a large coap msg block by block (see get_large_coap_msgs_with_callback), only if
+ * it has changed since the ETag
+ * 
+ * @param large_path 
+ * @param etag in: ETag of the version already known (empty if none), out: ETag of the version received
+ * @param block_callback 
+ * @param user_data 
+ * @return int 0 on success, COAP_REPLY_NOT_MODIFIED if not changed, negative on errors
+ */
+int get_large_coap_msgs_if_modified(const char * const * large_path, coap_etag_t* etag, coap_block_callback_t* block_callback, void* user_data);
+
+/**
+ * @brief Get several large coap msgs at once, on the same socket: up to CONFIG_COAP_CLIENT_MAX_REQUESTS
+ * transfers are outstanding, each with its own token and block context, and the next block of a transfer
+ * is requested as soon as its reply arrives. The callbacks of different transfers are interleaved.
+ * The requests without reply are retransmitted with exponential backoff, from a RTO estimated on the RTT
+ * of the server (see coap_rtt.h)
+ * 
+ * @param transfers path, etag, block_callback and user_data filled: the result of each is set at the end
+ * @param count 
+ * @return int 0 if all the transfers succeeded, otherwise the first error
+ */
+int get_large_coap_msgs_parallel(coap_transfer_t *transfers, size_t count);
+
+/**
+ * @brief Rebuild entire large coap msgs in a single buffer, allocated once when the server
+ * sends its total size (Size2), otherwise grown geometrically
+ * 
+ * @return char* NUL terminated (to be freed), NULL on errors
  */
 char* get_large_coap_msgs(const char * const * large_path);
 
-// TODO: to test observer
-int register_observer(const char * const * obs_path);
-int process_obs_coap_reply(const char * const * obs_path);
+/**
+ * @brief Make room for at least size bytes in a msg buffer
+ * 
+ * @param buffer 
+ * @param size 
+ * @return int 0 on success, -ENOMEM
+ */
+int coap_msg_buffer_reserve(coap_msg_buffer_t *buffer, size_t size);
+
+/**
+ * @brief Append a block to a msg buffer, doubling it when full (a coap_block_callback_t)
+ * 
+ * @param payload 
+ * @param len 
+ * @param user_data coap_msg_buffer_t*
+ * @return true
+ * @return false if out of memory
+ */
+bool coap_msg_buffer_append(const uint8_t *payload, size_t len, void *user_data);
+
+/**
+ * @brief Register an observation of a resource, or renew it (keeping its token): renewing it
+ * periodically keeps it alive on the server (and the NAT bindings on the path).
+ * The notifications, the first one included, are processed by coap_process_notifications
+ * or while getting large coap msgs.
+ * Only the first block of the resource is notified: the changes are to be got with a new request
+ * 
+ * @param observation path, callback and user_data filled: it must stay valid until cancelled
+ * @return int 0 on success, negative on errors (-ENOMEM if there are already CONFIG_COAP_CLIENT_MAX_OBSERVATIONS)
+ */
+int coap_observe(coap_observation_t *observation);
+
+/**
+ * @brief Cancel an observation (the server is asked to remove it)
+ * 
+ * @param observation 
+ * @return int 0 on success, negative on errors
+ */
+int coap_observe_cancel(coap_observation_t *observation);
+
+/**
+ * @brief Wait for msgs on the socket without reading them, so that the caller can wait
+ * without holding the users of the connection off
+ * 
+ * @param timeout_ms max wait
+ * @return int > 0 if msgs are ready to be processed, 0 on timeout, negative on errors
+ */
+int coap_wait_notifications(int timeout_ms);
+
+/**
+ * @brief Wait for notifications of the observations, passing them to their callbacks
+ * 
+ * @param timeout_ms max wait of the first msg
+ * @return int number of notifications processed, negative on errors
+ */
+int coap_process_notifications(int timeout_ms);
 
 #endif /* COAP_CONNECT_H_ */
\ No newline at end of file
@@ -0,0 +1,94 @@
+/*
+ * @file
+ * @brief Implementation of the retransmission timeout of a COAP peer, estimated from its RTT
+ *
+ * Copyright (c) 2022 University of Turin, Daniele Bortoluzzi <danieleb88@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <coap_rtt.h>
+
+#include <random/rand32.h>
+#include <string.h>
+
+/*** PRIVATE ***/
+/* RFC 6298, with K = 4 for the strong estimator and K = 1 for the weak one */
+static void estimate(uint32_t *srtt_ms, uint32_t *rttvar_ms, bool *valid, uint32_t rtt_ms)
+{
+	if (!*valid) {
+		*srtt_ms = rtt_ms;
+		*rttvar_ms = rtt_ms / 2;
+		*valid = true;
+		return;
+	}
+
+	// beta = 1/4, alpha = 1/8
+	*rttvar_ms = (3 * *rttvar_ms + (*srtt_ms > rtt_ms ? *srtt_ms - rtt_ms : rtt_ms - *srtt_ms)) / 4;
+	*srtt_ms = (7 * *srtt_ms + rtt_ms) / 8;
+}
+
+static uint32_t clamp_rto(uint32_t rto_ms)
+{
+	return CLAMP(rto_ms, COAP_RTT_MIN_RTO_MS, COAP_RTT_MAX_RTO_MS);
+}
+
+/*** PUBLIC ***/
+void coap_rtt_init(coap_rtt_peer_t *peer)
+{
+	memset(peer, 0, sizeof(coap_rtt_peer_t));
+	peer->rto_ms = COAP_RTT_INITIAL_RTO_MS;
+}
+
+uint32_t coap_rtt_initial_timeout(coap_rtt_peer_t *peer, int64_t now)
+{
+	int64_t unchanged_ms = now - peer->rto_updated_at;
+
+	// a small RTO is doubled after 16 RTOs without updates, a large one goes back towards the default after 4
+	if (peer->rto_ms < 1000 && unchanged_ms > 16 * (int64_t)peer->rto_ms) {
+		peer->rto_ms = clamp_rto(2 * peer->rto_ms);
+		peer->rto_updated_at = now;
+	} else if (peer->rto_ms > 3000 && unchanged_ms > 4 * (int64_t)peer->rto_ms) {
+		peer->rto_ms = (COAP_RTT_INITIAL_RTO_MS + peer->rto_ms) / 2;
+		peer->rto_updated_at = now;
+	}
+
+	// ACK_RANDOM_FACTOR 1.5
+	return peer->rto_ms + sys_rand32_get() % (peer->rto_ms / 2 + 1);
+}
+
+uint32_t coap_rtt_backoff(uint32_t initial_timeout_ms, uint32_t timeout_ms)
+{
+	uint32_t backoff_ms;
+
+	if (initial_timeout_ms < 1000) {
+		backoff_ms = 3 * timeout_ms;
+	} else if (initial_timeout_ms > 3000) {
+		backoff_ms = timeout_ms + timeout_ms / 2;
+	} else {
+		backoff_ms = 2 * timeout_ms;
+	}
+
+	return MIN(backoff_ms, COAP_RTT_MAX_RTO_MS);
+}
+
+void coap_rtt_update(coap_rtt_peer_t *peer, uint32_t rtt_ms, uint8_t retransmissions, int64_t now)
+{
+	uint32_t rto_ms;
+
+	peer->rtt_last_ms = rtt_ms;
+
+	if (retransmissions == 0) {
+		estimate(&peer->strong_srtt_ms, &peer->strong_rttvar_ms, &peer->strong_valid, rtt_ms);
+		rto_ms = peer->strong_srtt_ms + 4 * peer->strong_rttvar_ms;
+		peer->rto_ms = clamp_rto((rto_ms + peer->rto_ms) / 2);
+	} else if (retransmissions <= 2) {
+		estimate(&peer->weak_srtt_ms, &peer->weak_rttvar_ms, &peer->weak_valid, rtt_ms);
+		rto_ms = peer->weak_srtt_ms + peer->weak_rttvar_ms;
+		peer->rto_ms = clamp_rto((rto_ms + 3 * peer->rto_ms) / 4);
+	} else {
+		return;
+	}
+
+	peer->rto_updated_at = now;
+}
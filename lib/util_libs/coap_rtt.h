@@ -0,0 +1,85 @@
+/*
+ * @file
+ * @brief Headers of the retransmission timeout of a COAP peer, estimated from its RTT
+ *
+ * Confirmable requests are retransmitted with exponential backoff (RFC 7252, 4.2), starting
+ * from a RTO estimated as in CoCoA (draft-ietf-core-cocoa): a strong estimator for the replies
+ * to requests never retransmitted, a weak one for the replies after 1 or 2 retransmissions,
+ * a backoff factor depending on the RTO and the aging of the RTO not updated for long.
+ *
+ * Copyright (c) 2022 University of Turin, Daniele Bortoluzzi <danieleb88@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef COAP_RTT_H_
+#define COAP_RTT_H_
+
+#include <zephyr.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* RFC 7252, 4.8 */
+#define COAP_RTT_INITIAL_RTO_MS 2000
+#define COAP_RTT_MAX_RETRANSMIT 4
+
+#define COAP_RTT_MIN_RTO_MS 100
+#define COAP_RTT_MAX_RTO_MS 60000
+
+/**
+ * @brief RTT estimators and counters of a peer
+ */
+typedef struct {
+	uint32_t rto_ms;		/* overall RTO */
+	int64_t rto_updated_at;		/* uptime of the last update of the RTO, for its aging */
+	uint32_t strong_srtt_ms;
+	uint32_t strong_rttvar_ms;
+	uint32_t weak_srtt_ms;
+	uint32_t weak_rttvar_ms;
+	bool strong_valid;
+	bool weak_valid;
+	/* counters */
+	uint32_t requests;		/* first transmissions */
+	uint32_t retransmissions;
+	uint32_t timeouts;		/* requests without reply after COAP_RTT_MAX_RETRANSMIT */
+	uint32_t rtt_last_ms;
+} coap_rtt_peer_t;
+
+/**
+ * @brief Initialize the estimators of a peer, with the default RTO
+ *
+ * @param peer
+ */
+void coap_rtt_init(coap_rtt_peer_t *peer);
+
+/**
+ * @brief Timeout of the first transmission of a request: the RTO (aged if not updated for long)
+ * randomized up to 1.5 times (ACK_RANDOM_FACTOR)
+ *
+ * @param peer
+ * @param now uptime (ms)
+ * @return uint32_t ms
+ */
+uint32_t coap_rtt_initial_timeout(coap_rtt_peer_t *peer, int64_t now);
+
+/**
+ * @brief Timeout of the next retransmission of a request: the previous one times a backoff factor
+ * depending on the initial timeout (3 below 1 s, 1.5 above 3 s, otherwise 2)
+ *
+ * @param initial_timeout_ms of the first transmission
+ * @param timeout_ms of the previous transmission
+ * @return uint32_t ms
+ */
+uint32_t coap_rtt_backoff(uint32_t initial_timeout_ms, uint32_t timeout_ms);
+
+/**
+ * @brief Update the RTO with the RTT of a reply
+ *
+ * @param peer
+ * @param rtt_ms from the first transmission of the request
+ * @param retransmissions of the request: the RTT is ambiguous after more than 2 and it's not used
+ * @param now uptime (ms)
+ */
+void coap_rtt_update(coap_rtt_peer_t *peer, uint32_t rtt_ms, uint8_t retransmissions, int64_t now);
+
+#endif /* COAP_RTT_H_ */
@@ -0,0 +1,264 @@
+/*
+ * @file
+ * @brief Implementation of a streaming (SAX-like) JSON tokenizer
+ *
+ * Copyright (c) 2022 University of Turin, Daniele Bortoluzzi <danieleb88@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "json_stream.h"
+
+#include <errno.h>
+#include <string.h>
+
+enum
+{
+	JSON_STREAM_STATE_VALUE,		// between tokens
+	JSON_STREAM_STATE_STRING,
+	JSON_STREAM_STATE_ESCAPE,
+	JSON_STREAM_STATE_UNICODE,
+	JSON_STREAM_STATE_NUMBER,
+	JSON_STREAM_STATE_LITERAL
+};
+
+/*** PRIVATE ***/
+bool _json_stream_emit(json_stream_parser_t* me, JSON_STREAM_EVENT event, const char* value);
+void _json_stream_token_append(json_stream_parser_t* me, char c);
+/* end of a number or a literal: false on error */
+bool _json_stream_flush_scalar(json_stream_parser_t* me);
+/* handle a char outside strings, numbers and literals: false on error */
+bool _json_stream_value_char(json_stream_parser_t* me, char c);
+
+/*** PUBLIC ***/
+void json_stream_init(json_stream_parser_t* me, json_stream_callback_t* callback, void* user_data)
+{
+	memset(me, 0, sizeof(json_stream_parser_t));
+	me->_callback = callback;
+	me->_user_data = user_data;
+	me->_state = JSON_STREAM_STATE_VALUE;
+}
+
+int json_stream_feed(json_stream_parser_t* me, const char* data, size_t len)
+{
+	for (size_t i = 0; i < len && me->_error == 0; i++)
+	{
+		char c = data[i];
+		switch (me->_state)
+		{
+		case JSON_STREAM_STATE_STRING:
+			if (c == '"')
+			{
+				me->_state = JSON_STREAM_STATE_VALUE;
+				me->_token[me->_token_len] = '\0';
+				if (me->_expect_key)
+				{
+					me->_expect_key = false;
+					// a truncated key could match another member
+					if (me->_truncated)
+					{
+						me->_error = -E2BIG;
+						break;
+					}
+					_json_stream_emit(me, JSON_STREAM_KEY, me->_token);
+				}
+				else
+				{
+					_json_stream_emit(me, JSON_STREAM_STRING, me->_token);
+				}
+			}
+			else if (c == '\\')
+			{
+				me->_state = JSON_STREAM_STATE_ESCAPE;
+			}
+			else
+			{
+				_json_stream_token_append(me, c);
+			}
+			break;
+		case JSON_STREAM_STATE_ESCAPE:
+			me->_state = JSON_STREAM_STATE_STRING;
+			switch (c)
+			{
+			case 'n': _json_stream_token_append(me, '\n'); break;
+			case 't': _json_stream_token_append(me, '\t'); break;
+			case 'r': _json_stream_token_append(me, '\r'); break;
+			case 'b': _json_stream_token_append(me, '\b'); break;
+			case 'f': _json_stream_token_append(me, '\f'); break;
+			case 'u':
+				// metadata are ASCII: other code points are replaced
+				me->_state = JSON_STREAM_STATE_UNICODE;
+				me->_unicode_digits = 4;
+				_json_stream_token_append(me, '?');
+				break;
+			default: _json_stream_token_append(me, c); break;
+			}
+			break;
+		case JSON_STREAM_STATE_UNICODE:
+			if (--me->_unicode_digits == 0)
+			{
+				me->_state = JSON_STREAM_STATE_STRING;
+			}
+			break;
+		case JSON_STREAM_STATE_NUMBER:
+		case JSON_STREAM_STATE_LITERAL:
+			if ((me->_state == JSON_STREAM_STATE_NUMBER && (strchr("0123456789+-.eE", c) != NULL))
+				|| (me->_state == JSON_STREAM_STATE_LITERAL && c >= 'a' && c <= 'z'))
+			{
+				_json_stream_token_append(me, c);
+				break;
+			}
+			// the char after the scalar is handled as usual
+			if (!_json_stream_flush_scalar(me) || !_json_stream_value_char(me, c))
+			{
+				me->_error = me->_error != 0 ? me->_error : -EINVAL;
+			}
+			break;
+		default:
+			if (!_json_stream_value_char(me, c))
+			{
+				me->_error = me->_error != 0 ? me->_error : -EINVAL;
+			}
+			break;
+		}
+	}
+	return me->_error;
+}
+
+int json_stream_end(json_stream_parser_t* me)
+{
+	// a number can be the whole document
+	if (me->_error == 0 && (me->_state == JSON_STREAM_STATE_NUMBER || me->_state == JSON_STREAM_STATE_LITERAL))
+	{
+		if (!_json_stream_flush_scalar(me) && me->_error == 0)
+		{
+			me->_error = -EINVAL;
+		}
+	}
+	if (me->_error == 0 && (me->_state != JSON_STREAM_STATE_VALUE || me->_depth != 0))
+	{
+		// truncated document
+		me->_error = -EINVAL;
+	}
+	return me->_error;
+}
+
+bool json_stream_token_truncated(const json_stream_parser_t* me)
+{
+	return me->_truncated;
+}
+
+/*** PRIVATE IMPLEMENTATION ***/
+bool _json_stream_emit(json_stream_parser_t* me, JSON_STREAM_EVENT event, const char* value)
+{
+	if (!me->_callback(event, value, me->_depth, me->_user_data))
+	{
+		me->_error = -ECANCELED;
+		return false;
+	}
+	return true;
+}
+
+void _json_stream_token_append(json_stream_parser_t* me, char c)
+{
+	// keep room for the termination
+	if (me->_token_len < JSON_STREAM_MAX_TOKEN_LEN - 1)
+	{
+		me->_token[me->_token_len++] = c;
+	}
+	else
+	{
+		me->_truncated = true;
+	}
+}
+
+bool _json_stream_flush_scalar(json_stream_parser_t* me)
+{
+	uint8_t state = me->_state;
+	me->_state = JSON_STREAM_STATE_VALUE;
+	me->_token[me->_token_len] = '\0';
+
+	if (state == JSON_STREAM_STATE_NUMBER)
+	{
+		if (me->_truncated)
+		{
+			me->_error = -E2BIG;
+			return false;
+		}
+		return _json_stream_emit(me, JSON_STREAM_NUMBER, me->_token);
+	}
+	if (strcmp(me->_token, "true") == 0)
+	{
+		return _json_stream_emit(me, JSON_STREAM_TRUE, NULL);
+	}
+	if (strcmp(me->_token, "false") == 0)
+	{
+		return _json_stream_emit(me, JSON_STREAM_FALSE, NULL);
+	}
+	if (strcmp(me->_token, "null") == 0)
+	{
+		return _json_stream_emit(me, JSON_STREAM_NULL, NULL);
+	}
+	return false;
+}
+
+bool _json_stream_value_char(json_stream_parser_t* me, char c)
+{
+	switch (c)
+	{
+	case ' ':
+	case '\t':
+	case '\r':
+	case '\n':
+	case ':':
+		return true;
+	case ',':
+		me->_expect_key = me->_depth > 0 && me->_containers[me->_depth - 1] == '{';
+		return true;
+	case '{':
+	case '[':
+		if (me->_depth >= JSON_STREAM_MAX_DEPTH)
+		{
+			return false;
+		}
+		// the start event has the depth of the container, its members are one level deeper
+		if (!_json_stream_emit(me, c == '{' ? JSON_STREAM_OBJECT_START : JSON_STREAM_ARRAY_START, NULL))
+		{
+			return false;
+		}
+		me->_containers[me->_depth++] = c;
+		me->_expect_key = c == '{';
+		return true;
+	case '}':
+	case ']':
+		if (me->_depth == 0 || me->_containers[me->_depth - 1] != (c == '}' ? '{' : '['))
+		{
+			return false;
+		}
+		me->_depth--;
+		me->_expect_key = false;
+		return _json_stream_emit(me, c == '}' ? JSON_STREAM_OBJECT_END : JSON_STREAM_ARRAY_END, NULL);
+	case '"':
+		me->_state = JSON_STREAM_STATE_STRING;
+		me->_token_len = 0;
+		me->_truncated = false;
+		return true;
+	default:
+		if (c == '-' || (c >= '0' && c <= '9'))
+		{
+			me->_state = JSON_STREAM_STATE_NUMBER;
+		}
+		else if (c >= 'a' && c <= 'z')
+		{
+			me->_state = JSON_STREAM_STATE_LITERAL;
+		}
+		else
+		{
+			return false;
+		}
+		me->_token_len = 0;
+		me->_truncated = false;
+		_json_stream_token_append(me, c);
+		return true;
+	}
+}
@@ -0,0 +1,106 @@
+/*
+ * @file
+ * @brief Headers of a streaming (SAX-like) JSON tokenizer
+ *
+ * The document is fed in chunks of any size (i.e. CoAP blocks), and an event is
+ * fired for each token as soon as it is complete. Nothing is allocated: the only
+ * buffer is the one of the current string/number. Keys and numbers longer than it
+ * fail the parsing (-E2BIG); longer strings are passed truncated, and flagged (see
+ * json_stream_token_truncated), so the callback decides whether the value matters.
+ *
+ * Copyright (c) 2022 University of Turin, Daniele Bortoluzzi <danieleb88@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef JSON_STREAM_H
+#define JSON_STREAM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* size of the buffer of a key or a value, with the termination */
+#define JSON_STREAM_MAX_TOKEN_LEN 64
+/* max nesting of objects and arrays */
+#define JSON_STREAM_MAX_DEPTH 16
+
+typedef enum
+{
+	JSON_STREAM_OBJECT_START,
+	JSON_STREAM_OBJECT_END,
+	JSON_STREAM_ARRAY_START,
+	JSON_STREAM_ARRAY_END,
+	JSON_STREAM_KEY,
+	JSON_STREAM_STRING,
+	JSON_STREAM_NUMBER,
+	JSON_STREAM_TRUE,
+	JSON_STREAM_FALSE,
+	JSON_STREAM_NULL
+} JSON_STREAM_EVENT;
+
+/**
+ * @brief Called for each token
+ *
+ * @param event
+ * @param value text of keys, strings and numbers, NULL otherwise
+ * @param depth nesting level of the token (1 for the members of the root object)
+ * @param user_data
+ * @return false to stop the parsing
+ */
+typedef bool (json_stream_callback_t)(JSON_STREAM_EVENT event, const char* value, int depth, void* user_data);
+
+typedef struct _json_stream_parser_t
+{
+	json_stream_callback_t* _callback;
+	void* _user_data;
+	uint8_t _state;
+	bool _expect_key;					// next string inside an object is a key
+	int _depth;
+	char _containers[JSON_STREAM_MAX_DEPTH];	// '{' or '[' for each level
+	char _token[JSON_STREAM_MAX_TOKEN_LEN];
+	size_t _token_len;
+	bool _truncated;					// the current token didn't fit the buffer
+	uint8_t _unicode_digits;			// hex digits still to read in a \uXXXX escape
+	int _error;
+} json_stream_parser_t;
+
+/**
+ * @brief Initialize the parser for a new document
+ *
+ * @param me
+ * @param callback
+ * @param user_data
+ */
+void json_stream_init(json_stream_parser_t* me, json_stream_callback_t* callback, void* user_data);
+
+/**
+ * @brief Parse a chunk of the document
+ *
+ * @param me
+ * @param data
+ * @param len
+ * @return int 0 on success, -EINVAL on malformed JSON, -E2BIG if a key or a number is longer
+ * than JSON_STREAM_MAX_TOKEN_LEN - 1 chars, -ECANCELED if stopped by the callback
+ */
+int json_stream_feed(json_stream_parser_t* me, const char* data, size_t len);
+
+/**
+ * @brief Check, from the callback, whether the value of the current string was truncated
+ * to JSON_STREAM_MAX_TOKEN_LEN - 1 chars
+ *
+ * @param me
+ * @return true
+ * @return false if the value is whole
+ */
+bool json_stream_token_truncated(const json_stream_parser_t* me);
+
+/**
+ * @brief Complete the document
+ *
+ * @param me
+ * @return int 0 if the document is complete, a negative value otherwise
+ */
+int json_stream_end(json_stream_parser_t* me);
+
+#endif
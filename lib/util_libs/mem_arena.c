@@ -0,0 +1,58 @@
+/*
+ * @file
+ * @brief Implementation of a bump (arena) allocator
+ *
+ * Copyright (c) 2022 University of Turin, Daniele Bortoluzzi <danieleb88@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "mem_arena.h"
+
+/*** PUBLIC ***/
+void mem_arena_init(mem_arena_t* me, void* buffer, size_t size)
+{
+	me->_buffer = (uint8_t*) buffer;
+	me->_size = size;
+	me->_used = 0;
+	me->_peak = 0;
+	me->_exhausted = false;
+}
+
+void* mem_arena_alloc(mem_arena_t* me, size_t size)
+{
+	size_t aligned_size = (size + MEM_ARENA_ALIGN - 1) & ~((size_t) MEM_ARENA_ALIGN - 1);
+	if (aligned_size < size || aligned_size > me->_size - me->_used)
+	{
+		me->_exhausted = true;
+		return NULL;
+	}
+	void* block = &me->_buffer[me->_used];
+	me->_used += aligned_size;
+	if (me->_used > me->_peak)
+	{
+		me->_peak = me->_used;
+	}
+	return block;
+}
+
+void mem_arena_reset(mem_arena_t* me)
+{
+	me->_used = 0;
+	me->_exhausted = false;
+}
+
+size_t mem_arena_get_used(const mem_arena_t* me)
+{
+	return me->_used;
+}
+
+size_t mem_arena_get_peak(const mem_arena_t* me)
+{
+	return me->_peak;
+}
+
+bool mem_arena_is_exhausted(const mem_arena_t* me)
+{
+	return me->_exhausted;
+}
@@ -0,0 +1,86 @@
+/*
+ * @file
+ * @brief Headers of a bump (arena) allocator
+ *
+ * Allocations are carved one after the other from a buffer and are never freed
+ * one by one: the whole arena is released at once, so the heap is not fragmented
+ * by the many small blocks of a short-lived structure (i.e. a JSON document).
+ *
+ * Copyright (c) 2022 University of Turin, Daniele Bortoluzzi <danieleb88@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef MEM_ARENA_H
+#define MEM_ARENA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* alignment of the allocations (enough for doubles and pointers) */
+#define MEM_ARENA_ALIGN 8
+
+typedef struct _mem_arena_t
+{
+	uint8_t* _buffer;
+	size_t _size;
+	size_t _used;
+	size_t _peak;				// max used since the initialization
+	bool _exhausted;			// an allocation failed since the last reset
+} mem_arena_t;
+
+/* static initializer, equivalent to mem_arena_init */
+#define MEM_ARENA_INITIALIZER(buffer, size) { ._buffer = (uint8_t*) (buffer), ._size = (size), ._used = 0, ._peak = 0, ._exhausted = false }
+
+/**
+ * @brief Initialize an arena on a buffer (aligned to MEM_ARENA_ALIGN)
+ *
+ * @param me
+ * @param buffer
+ * @param size
+ */
+void mem_arena_init(mem_arena_t* me, void* buffer, size_t size);
+
+/**
+ * @brief Allocate a block from the arena
+ *
+ * @param me
+ * @param size
+ * @return void* NULL if the arena is exhausted
+ */
+void* mem_arena_alloc(mem_arena_t* me, size_t size);
+
+/**
+ * @brief Release all the blocks of the arena, in O(1)
+ *
+ * @param me
+ */
+void mem_arena_reset(mem_arena_t* me);
+
+/**
+ * @brief Bytes allocated since the last reset
+ *
+ * @param me
+ * @return size_t
+ */
+size_t mem_arena_get_used(const mem_arena_t* me);
+
+/**
+ * @brief Max bytes allocated since the initialization
+ *
+ * @param me
+ * @return size_t
+ */
+size_t mem_arena_get_peak(const mem_arena_t* me);
+
+/**
+ * @brief Check if an allocation failed since the last reset
+ *
+ * @param me
+ * @return true
+ * @return false
+ */
+bool mem_arena_is_exhausted(const mem_arena_t* me);
+
+#endif
@@ -13,8 +13,12 @@
 #ifndef SRC_WIFI_CONFIG_H_
 #define SRC_WIFI_CONFIG_H_
 
-// Auto join 0 - Disabled, 1 - Enable
+// Auto join 0 - Disabled, 1 - Enable (i.e. disabled on native_posix, using Ethernet)
+#ifdef CONFIG_WIFI
 #define AUTO_CONNECT  		1
+#else
+#define AUTO_CONNECT  		0
+#endif
 
 // SSID
 extern char* AUTO_CONNECT_SSID;
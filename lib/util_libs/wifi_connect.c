@@ -26,6 +26,7 @@
 #include <string.h>
 
 #include <wifi_config.h>
+#include <boot_trace.h>
 
 #if AUTO_CONNECT
 #ifndef DT_N_NODELABEL_wifi0
@@ -95,11 +96,35 @@ int Wifi_autoconnect() {
 }
 #endif
 
+#if AUTO_CONNECT
+/* the MPAI Config Store and the telemetry server connect on their own: only the first one does it */
+K_MUTEX_DEFINE(wifi_connect_mutex);
+static bool wifi_connected = false;
+#endif
+
 void wifi_connect(void)
 {
 
 #if AUTO_CONNECT
-	Wifi_autoconnect();
+	k_mutex_lock(&wifi_connect_mutex, K_FOREVER);
+	if (!wifi_connected) {
+		BOOT_TRACE_BEGIN("wifi_connect");
+		wifi_connected = Wifi_autoconnect() == 0;
+		BOOT_TRACE_END("wifi_connect");
+	}
+	k_mutex_unlock(&wifi_connect_mutex);
+#endif
+
+}
+
+bool wifi_is_connected(void)
+{
+
+#if AUTO_CONNECT
+	return wifi_connected;
+#else
+	// the network is brought up by the configuration of Zephyr
+	return true;
 #endif
 
 }
\ No newline at end of file
@@ -24,6 +24,13 @@ LOG_MODULE_REGISTER(MAIN, LOG_LEVEL_INF);
 #include "button_svc.h"
 #include "led_svc.h"
 #include <aif_controller.h>
+#include <boot_trace.h>
+#ifdef CONFIG_MPAI_BLE_SERVICE
+#include <aif_ble_service.h>
+#endif
+#ifdef CONFIG_MPAI_KV_STORE
+#include <kv_store.h>
+#endif
 #include<stdlib.h>
 
 /*** START BT ***/
@@ -73,6 +80,13 @@ static const struct bt_data ad[] = {
 	BT_DATA(BT_DATA_MANUFACTURER_DATA, manuf_data, ADV_LEN)
 };
 
+#ifdef CONFIG_MPAI_BLE_SERVICE
+/* Scan response data: the MPAI service, found by the apps without connecting */
+static const struct bt_data sd[] = {
+	BT_DATA_BYTES(BT_DATA_UUID128_ALL, MPAI_BLE_SERVICE_UUID_VAL),
+};
+#endif
+
 /* BLE connection */
 struct bt_conn *conn;
 /* Notification state */
@@ -140,9 +154,14 @@ static void bt_ready(int err)
 		LOG_ERR("Bluetooth init failed (err %d)", err);
 		return;
 	}
+	BOOT_TRACE_MARK("bt_ready");
 	LOG_INF("Bluetooth initialized");
 	/* Start advertising */
+#ifdef CONFIG_MPAI_BLE_SERVICE
+	err = bt_le_adv_start(BT_LE_ADV_CONN, ad, ARRAY_SIZE(ad), sd, ARRAY_SIZE(sd));
+#else
 	err = bt_le_adv_start(BT_LE_ADV_CONN, ad, ARRAY_SIZE(ad), NULL, 0);
+#endif
 	if (err) {
 		LOG_ERR("Advertising failed to start (err %d)", err);
 		return;
@@ -181,6 +200,48 @@ BT_CONN_CB_DEFINE(conn_callbacks) = {
 
 /*** END BT ***/
 
+#ifdef CONFIG_MPAI_KV_STORE
+/* key of the boots counter in the key-value store */
+#define BOOT_COUNT_KEY "sys/boots"
+
+static void count_boot(void)
+{
+	// the store is mounted here, before the AIMs read their parameters
+	BOOT_TRACE_BEGIN("kv_store");
+	uint32_t boots = 0;
+	int err = MPAI_KV_Store_Init();
+	if (!err) {
+		if (MPAI_KV_Store_Get(BOOT_COUNT_KEY, &boots, sizeof(boots)) != sizeof(boots)) {
+			boots = 0;
+		}
+		boots++;
+		err = MPAI_KV_Store_Set(BOOT_COUNT_KEY, &boots, sizeof(boots));
+	}
+	BOOT_TRACE_END("kv_store");
+
+	if (err) {
+		LOG_ERR("Boot not counted (err %d)", err);
+		return;
+	}
+	LOG_INF("Boot #%u", boots);
+}
+#endif
+
+static int start_mpai_controller(void)
+{
+	// Initialize MPAI Controller
+	BOOT_TRACE_BEGIN("mpai_controller");
+	mpai_error_t err_mpai_controller = MPAI_AIFU_Controller_Initialize();
+	BOOT_TRACE_END("mpai_controller");
+
+	if (err_mpai_controller.code != MPAI_AIF_OK) 
+	{
+		LOG_ERR("Error starting MPAI Controller: %s", log_strdup(MPAI_ERR_STR(err_mpai_controller.code)));
+		return -1;
+	}
+	return 0;
+}
+
 void main(void)
 {
 	// const struct device *dev = DEVICE_DT_GET(DT_CHOSEN(zephyr_console));
@@ -189,6 +250,11 @@ void main(void)
 	int i, on = 1;
 	int cnt = 1;
 	
+	BOOT_TRACE_MARK("main");
+
+#ifdef CONFIG_MPAI_KV_STORE
+	count_boot();
+#endif
 
 	// LEDs
 	led0 = device_get_binding(DT_GPIO_LABEL(DT_ALIAS(led0), gpios));
@@ -201,7 +267,16 @@ void main(void)
 					   GPIO_OUTPUT_INACTIVE |
 						   DT_GPIO_FLAGS(DT_ALIAS(led1), gpios));
 
+#ifdef CONFIG_MPAI_ASYNC_BOOT
+	// the AIMs start first, from the local configurations: LEDs and Bluetooth don't delay them
+	if (start_mpai_controller() < 0)
+	{
+		return;
+	}
+#endif
+
 	// Test leds
+	BOOT_TRACE_BEGIN("led_test");
 	for (i = 0; i < 6; i++)
 	{
 		gpio_pin_set(led0, DT_GPIO_PIN(DT_ALIAS(led0), gpios), on);
@@ -212,12 +287,14 @@ void main(void)
 
 	gpio_pin_set(led0, DT_GPIO_PIN(DT_ALIAS(led0), gpios), 0);
 	gpio_pin_set(led1, DT_GPIO_PIN(DT_ALIAS(led1), gpios), 1);
+	BOOT_TRACE_END("led_test");
 
 	printk("IoT node INITIALIZING...\n");
 
 	/** START BLUETOOTH **/
 	int err;
 
+	BOOT_TRACE_BEGIN("bt_init");
 	err = button_init(button_callback);
 	if (err) {
 		return;
@@ -233,15 +310,17 @@ void main(void)
 	if (err) {
 		LOG_ERR("Bluetooth init failed (err %d)", err);
 	}
+#ifdef CONFIG_MPAI_BLE_SERVICE
+	/* configuration and control of the AIMs over Bluetooth */
+	if (!err) {
+		MPAI_BLE_Service_Start();
+	}
+#endif
+	BOOT_TRACE_END("bt_init");
 
 	/** END BLUETOOTH **/
 
-	// Initialize MPAI Controller
-	mpai_error_t err_mpai_controller = MPAI_AIFU_Controller_Initialize();
-
-	if (err_mpai_controller.code != MPAI_AIF_OK) 
-	{
-		LOG_ERR("Error starting MPAI Controller: %s", log_strdup(MPAI_ERR_STR(err_mpai_controller.code)));
-		return;
-	}
+#ifndef CONFIG_MPAI_ASYNC_BOOT
+	(void)start_mpai_controller();
+#endif
 }
@@ -0,0 +1,484 @@
+/*
+ * @file
+ * @brief Power loss tests of the key-value store, on the flash of the board
+ *
+ * A power loss while a block is opened, a record is written or a block is collected is
+ * reproduced writing in the flash what the interrupted write leaves there: the store must
+ * mount without losing the values committed before, and the sequence and the erases of its
+ * blocks must stay sane. Deletes, aborted writes and a full store are checked too. The store
+ * region is erased by the tests.
+ *
+ *   pio test -e disco_l475vg_iot01a -f test_kv_store
+ *
+ * Copyright (c) 2022 University of Turin, Daniele Bortoluzzi <danieleb88@gmail.com>
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr.h>
+#include <unity.h>
+#include <sys/printk.h>
+#include <sys/byteorder.h>
+#include <sys/crc.h>
+#include <kv_store.h>
+
+/* layout of the block header and of the records (see kv_store.h) */
+#define TEST_BLOCK_MAGIC 0x564B504D
+#define TEST_BLOCK_HEADER_SIZE 16
+#define TEST_RECORD_MAGIC 0x524B504D
+#define TEST_RECORD_HEADER_SIZE 20
+#define TEST_RECORD_STATE_COMMITTED 0x00C0FFEE
+#define TEST_ERASED 0xFFFFFFFF
+#define TEST_KEYS 8
+/* two values of the full store fill a block (keys "full/NN") */
+#define TEST_FULL_KEY_LEN 7
+#define TEST_FULL_VALUE_LEN ROUND_DOWN((CONFIG_MPAI_KV_STORE_BLOCK_SIZE - TEST_BLOCK_HEADER_SIZE) / 2 - TEST_RECORD_HEADER_SIZE - TEST_FULL_KEY_LEN, 4)
+#define TEST_FULL_VALUES (2 * (CONFIG_MPAI_KV_STORE_BLOCKS - 1))
+/* sequence of a block after TEST_CHURN_ROUNDS rounds of the blocks, at most */
+#define TEST_CHURN_ROUNDS 2
+#define TEST_SEQ_SANE 0x10000
+#define TEST_ERASES_SANE 0x10000
+
+static const struct device* test_flash = NULL;
+
+/************* PRIVATE HEADER *************/
+/* erase the region of the store and mount it */
+void _test_format(void);
+void _test_remount(void);
+void _test_set_keys(uint32_t round);
+void _test_check_key(uint32_t i, uint32_t round);
+void _test_check_keys(uint32_t round);
+/* write values until the blocks have been collected TEST_CHURN_ROUNDS times */
+void _test_churn(uint32_t round);
+/* check the headers of the blocks in use */
+void _test_check_headers(void);
+/* interrupt the write of the header of the spare block after len bytes (written in the order given) */
+void _test_torn_header(const uint8_t* header, const uint8_t* order, size_t len);
+/* block with the newest sequence */
+int _test_head_block(void);
+/* offset of the end of the records of a block, from its start */
+uint32_t _test_block_end(int block);
+/* copy the bytes of a record (from the region offset src) as written by the store: header without
+ * length, crc and state, then key and the first value_len bytes of the value, and the rest if whole */
+void _test_copy_record(uint32_t src, uint32_t dst, uint8_t key_len, uint32_t value_len, bool whole);
+/* interrupt the collection of the oldest block after copies values (and a half of the next, if torn) */
+void _test_interrupted_collection(int copies, bool torn, bool collected);
+
+/************* TESTS **************/
+void setUp(void)
+{
+	test_flash = init_flash();
+	TEST_ASSERT_NOT_NULL(test_flash);
+}
+
+void tearDown(void)
+{
+}
+
+/* interrupted at each byte, as written by the store: sequence, erases and crc, then the magic */
+void test_header_interrupted_at_each_byte(void)
+{
+	const uint8_t order[TEST_BLOCK_HEADER_SIZE] = { 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3 };
+	uint8_t header[TEST_BLOCK_HEADER_SIZE];
+	sys_put_le32(TEST_BLOCK_MAGIC, &header[0]);
+	sys_put_le32(2, &header[4]);
+	sys_put_le32(1, &header[8]);
+	sys_put_le32(crc32_ieee(&header[4], 8), &header[12]);
+	for (size_t len = 1; len < TEST_BLOCK_HEADER_SIZE; len++)
+	{
+		_test_torn_header(header, order, len);
+	}
+}
+
+/* the magic written first, the sequence torn: a header not checked took it as the newest block */
+void test_header_torn_sequence(void)
+{
+	const uint8_t order[TEST_BLOCK_HEADER_SIZE] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 };
+	uint8_t header[TEST_BLOCK_HEADER_SIZE];
+	sys_put_le32(TEST_BLOCK_MAGIC, &header[0]);
+	sys_put_le32(0xFFFFFF09, &header[4]);
+	memset(&header[8], 0xFF, 8);
+	_test_torn_header(header, order, 5);
+}
+
+/* the bits of the erases not all programmed: the crc doesn't match */
+void test_header_torn_erases(void)
+{
+	const uint8_t order[TEST_BLOCK_HEADER_SIZE] = { 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3 };
+	uint8_t header[TEST_BLOCK_HEADER_SIZE];
+	sys_put_le32(TEST_BLOCK_MAGIC, &header[0]);
+	sys_put_le32(2, &header[4]);
+	sys_put_le32(0x00000101, &header[8]);
+	sys_put_le32(crc32_ieee(&header[4], 8), &header[12]);
+	header[9] = 0xFF;
+	_test_torn_header(header, order, TEST_BLOCK_HEADER_SIZE);
+}
+
+/* a new value of test/0 interrupted at each byte, as written by the store: header, key, value, then
+ * length, crc and state: the record is dropped, and the previous value kept */
+void test_record_interrupted_at_each_byte(void)
+{
+	const char key[] = "test/0";
+	uint32_t value[2] = { 0, 9 };
+	uint8_t record[TEST_RECORD_HEADER_SIZE + sizeof(key) - 1 + sizeof(value)];
+	uint8_t order[sizeof(record)];
+	size_t key_len = sizeof(key) - 1;
+	sys_put_le32(TEST_RECORD_MAGIC, &record[0]);
+	record[4] = (uint8_t) key_len;
+	memset(&record[5], 0xFF, 3);
+	sys_put_le32(sizeof(value), &record[8]);
+	sys_put_le32(crc32_ieee((const uint8_t*) value, sizeof(value)), &record[12]);
+	sys_put_le32(TEST_RECORD_STATE_COMMITTED, &record[16]);
+	memcpy(&record[TEST_RECORD_HEADER_SIZE], key, key_len);
+	memcpy(&record[TEST_RECORD_HEADER_SIZE + key_len], value, sizeof(value));
+	size_t n = 0;
+	for (size_t i = 0; i < 8; i++)
+	{
+		order[n++] = i;
+	}
+	for (size_t i = TEST_RECORD_HEADER_SIZE; i < sizeof(record); i++)
+	{
+		order[n++] = i;
+	}
+	for (size_t i = 8; i < TEST_RECORD_HEADER_SIZE; i++)
+	{
+		order[n++] = i;
+	}
+
+	// the whole record is committed: not a power loss
+	for (size_t len = 1; len < sizeof(record); len++)
+	{
+		_test_format();
+		_test_set_keys(1);
+		uint32_t end = _test_block_end(0);
+		for (size_t i = 0; i < len; i++)
+		{
+			TEST_ASSERT_EQUAL_INT(0, write_flash(test_flash, CONFIG_MPAI_KV_STORE_OFFSET + end + order[i], 1, &record[order[i]]));
+		}
+
+		_test_remount();
+		_test_check_keys(1);
+
+		// the records are appended after the torn one, in the next block
+		_test_set_keys(2);
+		_test_remount();
+		_test_check_keys(2);
+		_test_check_headers();
+	}
+}
+
+/* the collection of the oldest block interrupted before, during and after the copy of each value */
+void test_collection_interrupted_at_each_step(void)
+{
+	for (int copies = 0; copies <= TEST_KEYS; copies++)
+	{
+		_test_interrupted_collection(copies, false, false);
+		if (copies < TEST_KEYS)
+		{
+			_test_interrupted_collection(copies, true, false);
+		}
+	}
+	// the oldest block erased from its header: the collection is done
+	_test_interrupted_collection(TEST_KEYS, false, true);
+}
+
+/* a deleted key stays deleted after a remount, and once its records are collected */
+void test_delete_survives_remount(void)
+{
+	_test_format();
+	_test_set_keys(1);
+	uint32_t value[2];
+	TEST_ASSERT_EQUAL_INT(0, MPAI_KV_Store_Delete("test/3"));
+	TEST_ASSERT_EQUAL_INT(-ENOENT, MPAI_KV_Store_Get("test/3", value, sizeof(value)));
+	TEST_ASSERT_EQUAL_INT(-ENOENT, MPAI_KV_Store_Delete("test/3"));
+
+	_test_remount();
+	TEST_ASSERT_EQUAL_INT(-ENOENT, MPAI_KV_Store_Get("test/3", value, sizeof(value)));
+	TEST_ASSERT_EQUAL_INT(TEST_KEYS - 1, MPAI_KV_Store_Count());
+
+	_test_churn(1);
+	_test_remount();
+	TEST_ASSERT_EQUAL_INT(-ENOENT, MPAI_KV_Store_Get("test/3", value, sizeof(value)));
+	for (uint32_t i = 0; i < TEST_KEYS; i++)
+	{
+		if (i != 3)
+		{
+			_test_check_key(i, 1);
+		}
+	}
+	_test_check_headers();
+}
+
+/* a value not committed (or larger than reserved) leaves the previous one, and unlocks the store */
+void test_write_aborted(void)
+{
+	_test_format();
+	_test_set_keys(1);
+	mpai_kv_store_writer_t writer;
+	uint32_t value[2] = { 0, 2 };
+	TEST_ASSERT_EQUAL_INT(0, MPAI_KV_Store_Write_Begin(&writer, "test/0", sizeof(value)));
+	TEST_ASSERT_EQUAL_INT(0, MPAI_KV_Store_Write(&writer, value, sizeof(value)));
+	TEST_ASSERT_EQUAL_INT(-ECANCELED, MPAI_KV_Store_Write_End(&writer, false));
+	_test_check_keys(1);
+
+	TEST_ASSERT_EQUAL_INT(0, MPAI_KV_Store_Write_Begin(&writer, "test/1", sizeof(value) / 2));
+	TEST_ASSERT_LESS_THAN_INT(0, MPAI_KV_Store_Write(&writer, value, sizeof(value)));
+	TEST_ASSERT_LESS_THAN_INT(0, MPAI_KV_Store_Write_End(&writer, true));
+	_test_check_keys(1);
+
+	_test_remount();
+	_test_check_keys(1);
+	_test_set_keys(2);
+	_test_remount();
+	_test_check_keys(2);
+}
+
+/* values filling the blocks but the spare: the next one fails without collecting the blocks */
+void test_full_store(void)
+{
+	static uint8_t value[TEST_FULL_VALUE_LEN];
+	char key[MPAI_KV_STORE_KEY_MAX_LEN + 1];
+	_test_format();
+	for (uint32_t i = 0; i < TEST_FULL_VALUES; i++)
+	{
+		snprintk(key, sizeof(key), "full/%02u", i);
+		memset(value, (uint8_t) i, sizeof(value));
+		TEST_ASSERT_EQUAL_INT(0, MPAI_KV_Store_Set(key, value, sizeof(value)));
+	}
+
+	mpai_kv_store_stats_t stats;
+	TEST_ASSERT_EQUAL_INT(0, MPAI_KV_Store_Get_Stats(&stats));
+	uint32_t max_erases = stats._max_erases;
+	snprintk(key, sizeof(key), "full/%02u", TEST_FULL_VALUES);
+	TEST_ASSERT_EQUAL_INT(-ENOSPC, MPAI_KV_Store_Set(key, value, sizeof(value)));
+	TEST_ASSERT_EQUAL_INT(0, MPAI_KV_Store_Get_Stats(&stats));
+	TEST_ASSERT_EQUAL_UINT32(max_erases, stats._max_erases);
+
+	_test_remount();
+	for (uint32_t i = 0; i < TEST_FULL_VALUES; i++)
+	{
+		snprintk(key, sizeof(key), "full/%02u", i);
+		TEST_ASSERT_EQUAL_INT(sizeof(value), MPAI_KV_Store_Get(key, value, sizeof(value)));
+		TEST_ASSERT_EQUAL_UINT8((uint8_t) i, value[sizeof(value) - 1]);
+	}
+}
+
+void main(void)
+{
+	k_sleep(K_MSEC(2000));
+	UNITY_BEGIN();
+	RUN_TEST(test_header_interrupted_at_each_byte);
+	RUN_TEST(test_header_torn_sequence);
+	RUN_TEST(test_header_torn_erases);
+	RUN_TEST(test_record_interrupted_at_each_byte);
+	RUN_TEST(test_collection_interrupted_at_each_step);
+	RUN_TEST(test_delete_survives_remount);
+	RUN_TEST(test_write_aborted);
+	RUN_TEST(test_full_store);
+	UNITY_END();
+}
+
+/************* PRIVATE IMPLEMENTATION *************/
+void _test_format(void)
+{
+	TEST_ASSERT_EQUAL_INT(0, MPAI_KV_Store_Unmount());
+	TEST_ASSERT_EQUAL_INT(0, erase_flash(test_flash, CONFIG_MPAI_KV_STORE_OFFSET,
+		CONFIG_MPAI_KV_STORE_BLOCKS * CONFIG_MPAI_KV_STORE_BLOCK_SIZE));
+	TEST_ASSERT_EQUAL_INT(0, MPAI_KV_Store_Init());
+}
+
+void _test_remount(void)
+{
+	TEST_ASSERT_EQUAL_INT(0, MPAI_KV_Store_Unmount());
+	TEST_ASSERT_EQUAL_INT(0, MPAI_KV_Store_Init());
+}
+
+void _test_set_keys(uint32_t round)
+{
+	for (uint32_t i = 0; i < TEST_KEYS; i++)
+	{
+		char key[MPAI_KV_STORE_KEY_MAX_LEN + 1];
+		snprintk(key, sizeof(key), "test/%u", i);
+		uint32_t value[2] = { i, round };
+		TEST_ASSERT_EQUAL_INT(0, MPAI_KV_Store_Set(key, value, sizeof(value)));
+	}
+}
+
+void _test_check_key(uint32_t i, uint32_t round)
+{
+	char key[MPAI_KV_STORE_KEY_MAX_LEN + 1];
+	snprintk(key, sizeof(key), "test/%u", i);
+	uint32_t value[2];
+	TEST_ASSERT_EQUAL_INT(sizeof(value), MPAI_KV_Store_Get(key, value, sizeof(value)));
+	TEST_ASSERT_EQUAL_UINT32(i, value[0]);
+	TEST_ASSERT_EQUAL_UINT32(round, value[1]);
+}
+
+void _test_check_keys(uint32_t round)
+{
+	for (uint32_t i = 0; i < TEST_KEYS; i++)
+	{
+		_test_check_key(i, round);
+	}
+}
+
+void _test_churn(uint32_t round)
+{
+	static uint8_t value[1024];
+	memset(value, (uint8_t) round, sizeof(value));
+	size_t writes = TEST_CHURN_ROUNDS * CONFIG_MPAI_KV_STORE_BLOCKS * (CONFIG_MPAI_KV_STORE_BLOCK_SIZE / sizeof(value));
+	for (size_t i = 0; i < writes; i++)
+	{
+		TEST_ASSERT_EQUAL_INT(0, MPAI_KV_Store_Set("test/churn", value, sizeof(value)));
+	}
+}
+
+void _test_check_headers(void)
+{
+	for (int b = 0; b < CONFIG_MPAI_KV_STORE_BLOCKS; b++)
+	{
+		uint8_t header[TEST_BLOCK_HEADER_SIZE];
+		TEST_ASSERT_EQUAL_INT(0, read_flash(test_flash, CONFIG_MPAI_KV_STORE_OFFSET + b * CONFIG_MPAI_KV_STORE_BLOCK_SIZE,
+			sizeof(header), header));
+		if (sys_get_le32(&header[0]) == TEST_BLOCK_MAGIC)
+		{
+			TEST_ASSERT_EQUAL_UINT32(crc32_ieee(&header[4], 8), sys_get_le32(&header[12]));
+			TEST_ASSERT_LESS_THAN_UINT32(TEST_SEQ_SANE, sys_get_le32(&header[4]));
+		}
+	}
+	mpai_kv_store_stats_t stats;
+	TEST_ASSERT_EQUAL_INT(0, MPAI_KV_Store_Get_Stats(&stats));
+	TEST_ASSERT_LESS_THAN_UINT32(TEST_ERASES_SANE, stats._max_erases);
+}
+
+void _test_torn_header(const uint8_t* header, const uint8_t* order, size_t len)
+{
+	// a new store writes in the first block: the second one is the spare
+	_test_format();
+	_test_set_keys(1);
+	for (size_t i = 0; i < len; i++)
+	{
+		TEST_ASSERT_EQUAL_INT(0, write_flash(test_flash, CONFIG_MPAI_KV_STORE_OFFSET + CONFIG_MPAI_KV_STORE_BLOCK_SIZE + order[i],
+			1, &header[order[i]]));
+	}
+
+	_test_remount();
+	_test_check_keys(1);
+	_test_check_headers();
+
+	// the spare is opened and collected as any other block
+	_test_churn(len);
+	_test_set_keys(2);
+	_test_remount();
+	_test_check_keys(2);
+	_test_check_headers();
+}
+
+int _test_head_block(void)
+{
+	int head = -1;
+	uint32_t head_seq = 0;
+	for (int b = 0; b < CONFIG_MPAI_KV_STORE_BLOCKS; b++)
+	{
+		uint8_t header[TEST_BLOCK_HEADER_SIZE];
+		TEST_ASSERT_EQUAL_INT(0, read_flash(test_flash, CONFIG_MPAI_KV_STORE_OFFSET + b * CONFIG_MPAI_KV_STORE_BLOCK_SIZE,
+			sizeof(header), header));
+		if (sys_get_le32(&header[0]) == TEST_BLOCK_MAGIC && sys_get_le32(&header[4]) > head_seq)
+		{
+			head = b;
+			head_seq = sys_get_le32(&header[4]);
+		}
+	}
+	TEST_ASSERT_GREATER_OR_EQUAL_INT(0, head);
+	return head;
+}
+
+uint32_t _test_block_end(int block)
+{
+	uint32_t start = CONFIG_MPAI_KV_STORE_OFFSET + block * CONFIG_MPAI_KV_STORE_BLOCK_SIZE;
+	uint32_t offset = TEST_BLOCK_HEADER_SIZE;
+	while (offset + TEST_RECORD_HEADER_SIZE <= CONFIG_MPAI_KV_STORE_BLOCK_SIZE)
+	{
+		uint8_t header[TEST_RECORD_HEADER_SIZE];
+		TEST_ASSERT_EQUAL_INT(0, read_flash(test_flash, start + offset, sizeof(header), header));
+		if (sys_get_le32(&header[0]) != TEST_RECORD_MAGIC)
+		{
+			break;
+		}
+		offset += ROUND_UP(TEST_RECORD_HEADER_SIZE + header[4] + sys_get_le32(&header[8]), 4);
+	}
+	return block * CONFIG_MPAI_KV_STORE_BLOCK_SIZE + offset;
+}
+
+void _test_copy_record(uint32_t src, uint32_t dst, uint8_t key_len, uint32_t value_len, bool whole)
+{
+	uint8_t buf[64];
+	uint32_t len = TEST_RECORD_HEADER_SIZE + key_len + (whole ? value_len : value_len / 2);
+	for (uint32_t offset = 0; offset < len; offset += sizeof(buf))
+	{
+		size_t chunk = MIN(sizeof(buf), len - offset);
+		TEST_ASSERT_EQUAL_INT(0, read_flash(test_flash, CONFIG_MPAI_KV_STORE_OFFSET + src + offset, chunk, buf));
+		// length, crc and state are written last
+		if (offset == 0 && !whole)
+		{
+			memset(&buf[8], 0xFF, TEST_RECORD_HEADER_SIZE - 8);
+		}
+		TEST_ASSERT_EQUAL_INT(0, write_flash(test_flash, CONFIG_MPAI_KV_STORE_OFFSET + dst + offset, chunk, buf));
+	}
+}
+
+void _test_interrupted_collection(int copies, bool torn, bool collected)
+{
+	// the keys in the first block, then values until it is the oldest one: the head is the block
+	// before the spare, the last one
+	_test_format();
+	_test_set_keys(1);
+	uint8_t churn[512];
+	memset(churn, 0x5A, sizeof(churn));
+	while (_test_head_block() != CONFIG_MPAI_KV_STORE_BLOCKS - 2)
+	{
+		TEST_ASSERT_EQUAL_INT(0, MPAI_KV_Store_Set("test/churn", churn, sizeof(churn)));
+	}
+	int head = CONFIG_MPAI_KV_STORE_BLOCKS - 2;
+	int spare = CONFIG_MPAI_KV_STORE_BLOCKS - 1;
+	TEST_ASSERT_EQUAL_INT(0, MPAI_KV_Store_Unmount());
+
+	// the spare opened as the store does
+	uint8_t header[TEST_BLOCK_HEADER_SIZE];
+	TEST_ASSERT_EQUAL_INT(0, read_flash(test_flash, CONFIG_MPAI_KV_STORE_OFFSET + head * CONFIG_MPAI_KV_STORE_BLOCK_SIZE,
+		sizeof(header), header));
+	sys_put_le32(sys_get_le32(&header[4]) + 1, &header[4]);
+	sys_put_le32(crc32_ieee(&header[4], 8), &header[12]);
+	uint32_t spare_start = spare * CONFIG_MPAI_KV_STORE_BLOCK_SIZE;
+	TEST_ASSERT_EQUAL_INT(0, write_flash(test_flash, CONFIG_MPAI_KV_STORE_OFFSET + spare_start + 4, sizeof(header) - 4, &header[4]));
+	TEST_ASSERT_EQUAL_INT(0, write_flash(test_flash, CONFIG_MPAI_KV_STORE_OFFSET + spare_start, 4, header));
+
+	// the live values of the oldest block (only the keys) copied in their order
+	uint32_t src = TEST_BLOCK_HEADER_SIZE;
+	uint32_t dst = spare_start + TEST_BLOCK_HEADER_SIZE;
+	for (int i = 0; i < copies + (torn ? 1 : 0); i++)
+	{
+		uint8_t record[TEST_RECORD_HEADER_SIZE];
+		TEST_ASSERT_EQUAL_INT(0, read_flash(test_flash, CONFIG_MPAI_KV_STORE_OFFSET + src, sizeof(record), record));
+		TEST_ASSERT_EQUAL_UINT32(TEST_RECORD_MAGIC, sys_get_le32(&record[0]));
+		uint32_t size = ROUND_UP(TEST_RECORD_HEADER_SIZE + record[4] + sys_get_le32(&record[8]), 4);
+		_test_copy_record(src, dst, record[4], sys_get_le32(&record[8]), i < copies);
+		src += size;
+		dst += size;
+	}
+	if (collected)
+	{
+		TEST_ASSERT_EQUAL_INT(0, erase_flash(test_flash, CONFIG_MPAI_KV_STORE_OFFSET, FLASH_SECTOR_SIZE));
+	}
+
+	// rolled back (or completed): the values are the same, and the store goes on
+	TEST_ASSERT_EQUAL_INT(0, MPAI_KV_Store_Init());
+	_test_check_keys(1);
+	TEST_ASSERT_EQUAL_INT(sizeof(churn), MPAI_KV_Store_Get("test/churn", churn, sizeof(churn)));
+	_test_check_headers();
+	_test_churn(2);
+	_test_set_keys(2);
+	_test_remount();
+	_test_check_keys(2);
+	_test_check_headers();
+}
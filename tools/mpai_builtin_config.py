@@ -0,0 +1,132 @@
+#!/usr/bin/env python3
+#
+# Generator of the configurations built in the firmware (see mpai_config_builtin in
+# lib/mpai_core/config_store.h): the AIF/AIW/AIM metadata (json) the board boots with
+# before reaching the MPAI Config Store, when they are not cached yet
+#
+# Copyright (c) 2022 University of Turin, Daniele Bortoluzzi <danieleb88@gmail.com>
+#
+# SPDX-License-Identifier: Apache-2.0
+#
+# The files are kept byte by byte, with the ETag given by mpai_store_server.py (first 8 bytes
+# of their sha256): the store answers 2.03 Valid while they don't change, and a different
+# version is found by the board comparing size and crc.
+#
+# Usage:
+#   python3 tools/mpai_builtin_config.py --aif docs/mpai_aif.json --aiw docs/mpai_aiw_iot_rev.json \
+#       --aim docs/mpai_aim_*.json -o lib/mpai_libs/aif_builtin_config.c
+
+import argparse
+import hashlib
+import json
+import sys
+
+# characters of a line of the C strings
+LINE_LENGTH = 100
+
+
+def fail(message):
+    sys.exit("mpai_builtin_config: " + message)
+
+
+def load(path):
+    try:
+        with open(path, "rb") as f:
+            data = f.read()
+        return data, json.loads(data)
+    except (OSError, ValueError) as e:
+        fail("%s: %s" % (path, e))
+
+
+def c_string_lines(data):
+    """The bytes as C string literals, a line each (octal escapes out of printable ASCII)"""
+    lines, line = [], ""
+    for byte in data:
+        if byte == 0x0A:
+            lines.append(line + "\\n")
+            line = ""
+            continue
+        if byte in (0x22, 0x5C):
+            line += "\\" + chr(byte)
+        elif 0x20 <= byte < 0x7F and not (byte == 0x3F and line.endswith("?")):
+            line += chr(byte)
+        else:
+            # 3 digits: the next characters are never part of the escape
+            line += "\\%03o" % byte
+        if len(line) >= LINE_LENGTH:
+            lines.append(line)
+            line = ""
+    if line or not lines:
+        lines.append(line)
+    return ["\t\"%s\"" % line for line in lines]
+
+
+def generate(configs):
+    lines = [
+        "/*",
+        " * @file",
+        " * @brief Configurations built in the firmware, read at boot when not cached",
+        " *",
+        " * Generated by tools/mpai_builtin_config.py from docs: do not edit.",
+        " *",
+        " * Copyright (c) 2022 University of Turin, Daniele Bortoluzzi <danieleb88@gmail.com>",
+        " *",
+        " * SPDX-License-Identifier: Apache-2.0",
+        " */",
+        "",
+        "#include <config_store.h>",
+        "",
+        "#ifdef CONFIG_MPAI_CONFIG_BUILTIN",
+    ]
+    for i, (name, path, data) in enumerate(configs):
+        etag = hashlib.sha256(data).digest()[:8]
+        lines += [
+            "",
+            "/* %s */" % path,
+            "static const uint8_t config_builtin_etag_%d[] = { %s };" % (i, ", ".join("0x%02x" % byte for byte in etag)),
+            "static const char config_builtin_data_%d[] =" % i,
+        ]
+        lines += c_string_lines(data)
+        lines[-1] += ";"
+    lines += ["", "const mpai_config_builtin_t mpai_config_builtin[] = {"]
+    for i, (name, path, data) in enumerate(configs):
+        lines.append("\t{ \"%s\", config_builtin_etag_%d, sizeof(config_builtin_etag_%d), config_builtin_data_%d, sizeof(config_builtin_data_%d) - 1 },"
+                     % (name, i, i, i, i))
+    lines += [
+        "};",
+        "",
+        "const size_t mpai_config_builtin_count = ARRAY_SIZE(mpai_config_builtin);",
+        "#endif",
+    ]
+    return "\n".join(lines) + "\n"
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Generate the MPAI configurations built in the firmware")
+    parser.add_argument("--aif", help="AIF metadata (json)")
+    parser.add_argument("--aif-name", default="demo", help="name the AIF is read with (MPAI_LIBS_AIF_NAME)")
+    parser.add_argument("--aiw", nargs="*", default=[], help="AIW metadata (json)")
+    parser.add_argument("--aim", nargs="*", default=[], help="AIM metadata (json)")
+    parser.add_argument("-o", "--output", required=True, help="generated C file")
+    args = parser.parse_args()
+
+    # named as the resources of the MPAI Config Store (see mpai_store_server.py)
+    configs = []
+    if args.aif:
+        configs.append(("config/aif/" + args.aif_name, args.aif, load(args.aif)[0]))
+    for path in args.aiw:
+        data, aiw = load(path)
+        configs.append(("config/aiw/" + aiw["Identifier"]["Specification"]["AIW"], path, data))
+    for path in args.aim:
+        data, aim = load(path)
+        configs.append(("config/aim/" + aim["Identifier"]["Specification"]["AIM"], path, data))
+    if not configs:
+        parser.error("nothing to build in: --aif, --aiw or --aim are required")
+
+    with open(args.output, "w", encoding="utf-8") as f:
+        f.write(generate(configs))
+    print("%s: %d configurations, %d bytes" % (args.output, len(configs), sum(len(data) for _, _, data in configs)))
+
+
+if __name__ == "__main__":
+    main()
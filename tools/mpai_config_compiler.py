@@ -0,0 +1,233 @@
+#!/usr/bin/env python3
+#
+# Compiler of the AIF/AIW/AIM metadata (json) into the binary configuration read in place
+# by the board (see MPAI_Metadata_Parser_Binary_* in lib/mpai_libs/aif_metadata_parser.h)
+#
+# Copyright (c) 2022 University of Turin, Daniele Bortoluzzi <danieleb88@gmail.com>
+#
+# SPDX-License-Identifier: Apache-2.0
+#
+# Layout (little endian, offsets from the start of the blob):
+#
+#   header (40 bytes)
+#     char[4] magic "MPAI"
+#     u16 version, u16 header size, u32 total size
+#     u32 crc32 (IEEE) of the bytes after this field
+#     u16 AIF title, u16 AIW title (string offsets)
+#     u16 offset, u16 count of the type entries
+#     u16 offset, u16 count of the port entries
+#     u16 offset, u16 count of the topology entries
+#     u16 offset, u16 count of the AIM entries
+#     u16 offset of the string table, u16 reserved
+#   type entries (4 bytes): u16 name, u16 type
+#   port entries (6 bytes): u16 name, u16 record type, u8 direction (0 input, 1 output, 2 both), u8 is remote
+#   topology entries (8 bytes): u16 output AIM name, u16 output port name, u16 input AIM name, u16 input port name
+#   AIM entries (44 bytes), in the order of "SubAIMs":
+#     u16 name, u16 flags (properties found in the json)
+#     u32 period, u32 active window, u32 phase (ms)
+#     i32 priority, u32 stack size, u32 deadline, u32 budget
+#     u32 heartbeat timeout, u32 latency SLA, u32 max restarts
+#   string table: NUL terminated strings, the last byte of the blob is NUL
+#
+# Usage:
+#   python3 tools/mpai_config_compiler.py --aif docs/mpai_aif.json --aiw docs/mpai_aiw_iot_rev.json \
+#       --aim docs/mpai_aim_*.json -o mpai_config.bin
+#   python3 tools/mpai_config_compiler.py --dump mpai_config.bin
+
+import argparse
+import json
+import struct
+import sys
+import zlib
+
+MAGIC = b"MPAI"
+VERSION = 2
+
+HEADER = struct.Struct("<4sHHII12H")
+TYPE_ENTRY = struct.Struct("<HH")
+PORT_ENTRY = struct.Struct("<HHBB")
+TOPOLOGY_ENTRY = struct.Struct("<HHHH")
+AIM_ENTRY = struct.Struct("<HHIIIiIIIIII")
+
+# flags of the AIM entries: the board uses its defaults for the missing properties
+FLAG_DUTY_CYCLE = 1 << 0
+FLAG_PRIORITY = 1 << 1
+FLAG_STACK_SIZE = 1 << 2
+FLAG_DEADLINE = 1 << 3
+FLAG_BUDGET = 1 << 4
+FLAG_HEARTBEAT_TIMEOUT = 1 << 5
+FLAG_LATENCY_SLA = 1 << 6
+FLAG_MAX_RESTARTS = 1 << 7
+
+DIRECTIONS = {"Input": 0, "Output": 1, "InputOutput": 2}
+
+# (flag, json object, json property) of the optional numeric properties, in the order of the entry
+AIM_PROPERTIES = [
+    (FLAG_PRIORITY, "Scheduling", "Priority"),
+    (FLAG_STACK_SIZE, "Scheduling", "StackSize"),
+    (FLAG_DEADLINE, "Scheduling", "Deadline"),
+    (FLAG_BUDGET, "Scheduling", "Budget"),
+    (FLAG_HEARTBEAT_TIMEOUT, "Supervision", "HeartbeatTimeout"),
+    (FLAG_LATENCY_SLA, "Supervision", "LatencySLA"),
+    (FLAG_MAX_RESTARTS, "Supervision", "MaxRestarts"),
+]
+
+
+class StringTable:
+    def __init__(self):
+        self.data = bytearray()
+        self.offsets = {}
+
+    def add(self, value):
+        if value not in self.offsets:
+            self.offsets[value] = len(self.data)
+            self.data += value.encode("ascii") + b"\0"
+        return self.offsets[value]
+
+
+def fail(message):
+    sys.exit("mpai_config_compiler: " + message)
+
+
+def load_json(path):
+    with open(path, encoding="utf-8") as f:
+        return json.load(f)
+
+
+def aim_entry(name, aim, strings):
+    flags = 0
+    period = active = phase = 0
+    duty_cycle = aim.get("DutyCycle")
+    if duty_cycle is not None:
+        if isinstance(duty_cycle.get("Period"), int) and isinstance(duty_cycle.get("ActiveWindow"), int):
+            flags |= FLAG_DUTY_CYCLE
+            period = duty_cycle["Period"]
+            active = duty_cycle["ActiveWindow"]
+            phase = duty_cycle.get("Phase", 0)
+        else:
+            print("warning: AIM %s: DutyCycle without Period or ActiveWindow, ignored" % name, file=sys.stderr)
+
+    values = []
+    for flag, group, prop in AIM_PROPERTIES:
+        value = aim.get(group, {}).get(prop)
+        if isinstance(value, int):
+            flags |= flag
+            values.append(value)
+        else:
+            values.append(0)
+    return (strings.add(name), flags, period, active, phase, *values)
+
+
+def compile_config(aif, aiw, aims):
+    strings = StringTable()
+    aif_title = strings.add(aif.get("title") or fail("AIF without title"))
+    aiw_title = strings.add(aiw.get("title") or fail("AIW without title"))
+
+    types = []
+    for record_type in aiw.get("Types", []):
+        types.append((strings.add(record_type["Name"]), strings.add(record_type["Type"])))
+
+    ports = []
+    for port in aiw.get("Ports", []):
+        if port.get("Direction") not in DIRECTIONS:
+            fail("port %s: direction %s not valid" % (port.get("Name"), port.get("Direction")))
+        ports.append((strings.add(port["Name"]), strings.add(port.get("RecordType", "")),
+                      DIRECTIONS[port["Direction"]], 1 if port.get("IsRemote") else 0))
+
+    topology = []
+    for connection in aiw.get("Topology", []):
+        output = connection.get("Output", {})
+        input = connection.get("Input", {})
+        topology.append((strings.add(output.get("AIMName", "")), strings.add(output.get("PortName", "")),
+                         strings.add(input.get("AIMName", "")), strings.add(input.get("PortName", ""))))
+
+    entries = []
+    for sub_aim in aiw.get("SubAIMs", []):
+        name = sub_aim["Identifier"]["Specification"]["AIM"]
+        if name not in aims:
+            fail("metadata of AIM %s not found (use --aim)" % name)
+        entries.append(aim_entry(name, aims[name], strings))
+
+    types_offset = HEADER.size
+    ports_offset = types_offset + len(types) * TYPE_ENTRY.size
+    topology_offset = ports_offset + len(ports) * PORT_ENTRY.size
+    aims_offset = topology_offset + len(topology) * TOPOLOGY_ENTRY.size
+    strings_offset = aims_offset + len(entries) * AIM_ENTRY.size
+    # string offsets are absolute
+    rebase = lambda offset: strings_offset + offset
+    size = strings_offset + len(strings.data)
+    if size > 0xFFFF:
+        fail("configuration too large (%d bytes)" % size)
+
+    body = bytearray()
+    for name, record_type in types:
+        body += TYPE_ENTRY.pack(rebase(name), rebase(record_type))
+    for name, record_type, direction, is_remote in ports:
+        body += PORT_ENTRY.pack(rebase(name), rebase(record_type), direction, is_remote)
+    for names in topology:
+        body += TOPOLOGY_ENTRY.pack(*[rebase(name) for name in names])
+    for entry in entries:
+        body += AIM_ENTRY.pack(rebase(entry[0]), *entry[1:])
+    body += strings.data
+
+    # the crc covers the header after its own field
+    tail = struct.pack("<12H", rebase(aif_title), rebase(aiw_title), types_offset, len(types), ports_offset, len(ports),
+                       topology_offset, len(topology), aims_offset, len(entries), strings_offset, 0) + body
+    crc = zlib.crc32(tail) & 0xFFFFFFFF
+    return struct.pack("<4sHHII", MAGIC, VERSION, HEADER.size, size, crc) + tail
+
+
+def string_at(blob, offset):
+    return blob[offset:blob.index(b"\0", offset)].decode("ascii")
+
+
+def dump(blob):
+    magic, version, header_size, size, crc, aif_title, aiw_title, types_offset, types_count, ports_offset, ports_count, \
+        topology_offset, topology_count, aims_offset, aims_count, strings_offset, _ = HEADER.unpack_from(blob)
+    if magic != MAGIC or version != VERSION or size != len(blob) or crc != zlib.crc32(blob[16:]) & 0xFFFFFFFF:
+        fail("invalid configuration")
+    print("version %d, %d bytes, crc32 0x%08x" % (version, size, crc))
+    print("AIF \"%s\", AIW \"%s\"" % (string_at(blob, aif_title), string_at(blob, aiw_title)))
+    for i in range(types_count):
+        name, record_type = TYPE_ENTRY.unpack_from(blob, types_offset + i * TYPE_ENTRY.size)
+        print("type %s: %s" % (string_at(blob, name), string_at(blob, record_type)))
+    for i in range(ports_count):
+        name, record_type, direction, is_remote = PORT_ENTRY.unpack_from(blob, ports_offset + i * PORT_ENTRY.size)
+        print("port %s: %s, direction %d%s" % (string_at(blob, name), string_at(blob, record_type), direction, ", remote" if is_remote else ""))
+    for i in range(topology_count):
+        names = [string_at(blob, name) or "-" for name in TOPOLOGY_ENTRY.unpack_from(blob, topology_offset + i * TOPOLOGY_ENTRY.size)]
+        print("output %s.%s <- input %s.%s" % tuple(names))
+    for i in range(aims_count):
+        name, flags, *values = AIM_ENTRY.unpack_from(blob, aims_offset + i * AIM_ENTRY.size)
+        print("AIM %s flags 0x%02x %s" % (string_at(blob, name), flags, values))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compile the MPAI metadata into a binary configuration")
+    parser.add_argument("--aif", help="AIF metadata (json)")
+    parser.add_argument("--aiw", help="AIW metadata (json)")
+    parser.add_argument("--aim", nargs="*", default=[], help="AIM metadata (json)")
+    parser.add_argument("-o", "--output", help="binary configuration")
+    parser.add_argument("--dump", help="print a binary configuration")
+    args = parser.parse_args()
+
+    if args.dump:
+        with open(args.dump, "rb") as f:
+            dump(f.read())
+        return
+    if not args.aif or not args.aiw or not args.output:
+        parser.error("--aif, --aiw and --output are required")
+
+    aims = {}
+    for path in args.aim:
+        aim = load_json(path)
+        aims[aim["Identifier"]["Specification"]["AIM"]] = aim
+
+    blob = compile_config(load_json(args.aif), load_json(args.aiw), aims)
+    with open(args.output, "wb") as f:
+        f.write(blob)
+    print("%s: %d bytes" % (args.output, len(blob)))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,210 @@
+#!/usr/bin/env python3
+#
+# Compiler of the JSON schemas of the AIF/AIW/AIM metadata into the validation tables
+# of the board (see lib/mpai_libs/aif_metadata_schema.h)
+#
+# Copyright (c) 2022 University of Turin, Daniele Bortoluzzi <danieleb88@gmail.com>
+#
+# SPDX-License-Identifier: Apache-2.0
+#
+# Supported keywords: type, properties, required, additionalProperties (boolean), items,
+# enum (of strings), minimum, maximum (integers), minItems and local $ref ("#/$defs/...").
+# Annotations ($schema, $id, title, description, $defs) are ignored; any other keyword
+# is an error, so that a schema is never checked only in part.
+#
+# Usage:
+#   python3 tools/mpai_schema_compiler.py --schema AIF=docs/schema/mpai_aif.schema.json \
+#       --schema AIW_AIM=docs/schema/mpai_aiw_aim.schema.json -o lib/mpai_libs/aif_metadata_schema_tables.c
+
+import argparse
+import json
+import sys
+
+TYPES = {
+    "object": 1 << 0,
+    "array": 1 << 1,
+    "string": 1 << 2,
+    "integer": 1 << 3,
+    "number": 1 << 4,
+    "boolean": 1 << 5,
+    "null": 1 << 6,
+}
+TYPE_ANY = 0x7F
+
+FLAG_CLOSED = 1 << 0
+FLAG_MINIMUM = 1 << 1
+FLAG_MAXIMUM = 1 << 2
+
+ANNOTATIONS = {"$schema", "$id", "title", "description", "$defs", "$comment"}
+KEYWORDS = {"type", "properties", "required", "additionalProperties", "items", "enum", "minimum", "maximum", "minItems", "$ref"}
+
+# properties of an object are a bitmask of the board
+MAX_PROPERTIES = 32
+NODE_ANY = 0xFFFF
+
+
+def fail(message):
+    sys.exit("mpai_schema_compiler: " + message)
+
+
+class Tables:
+    def __init__(self):
+        self.nodes = []
+        self.properties = []
+        self.enums = []
+        self.refs = {}
+
+    def resolve(self, document, ref):
+        if not ref.startswith("#/"):
+            fail("only local references are supported: %s" % ref)
+        schema = document
+        for part in ref[2:].split("/"):
+            if part not in schema:
+                fail("reference %s not found" % ref)
+            schema = schema[part]
+        return schema
+
+    def add_enum(self, values):
+        # the same values are shared (i.e. the same enum in several schemas)
+        for first in range(len(self.enums) - len(values) + 1):
+            if self.enums[first:first + len(values)] == values:
+                return first
+        first = len(self.enums)
+        self.enums += values
+        return first
+
+    def compile(self, document, schema, path):
+        if "$ref" in schema:
+            # shared by all its references
+            key = (id(document), schema["$ref"])
+            if key not in self.refs:
+                self.refs[key] = len(self.nodes)
+                self.nodes.append(None)
+                self.nodes[self.refs[key]] = self.build(document, self.resolve(document, schema["$ref"]), schema["$ref"])
+            return self.refs[key]
+        index = len(self.nodes)
+        self.nodes.append(None)
+        self.nodes[index] = self.build(document, schema, path)
+        return index
+
+    def build(self, document, schema, path):
+        unknown = set(schema) - KEYWORDS - ANNOTATIONS
+        if unknown:
+            fail("%s: keywords not supported: %s" % (path, ", ".join(sorted(unknown))))
+
+        node = {"path": path, "types": TYPE_ANY, "flags": 0, "properties": 0, "property_count": 0, "enums": 0,
+                "enum_count": 0, "items": NODE_ANY, "min_items": 0, "required": 0, "minimum": 0, "maximum": 0}
+        if "type" in schema:
+            names = schema["type"] if isinstance(schema["type"], list) else [schema["type"]]
+            node["types"] = 0
+            for name in names:
+                if name not in TYPES:
+                    fail("%s: type %s not supported" % (path, name))
+                node["types"] |= TYPES[name]
+            # an integer is a number too
+            if node["types"] & TYPES["number"]:
+                node["types"] |= TYPES["integer"]
+        if "enum" in schema:
+            if not all(isinstance(value, str) for value in schema["enum"]):
+                fail("%s: only enums of strings are supported" % path)
+            node["types"] &= TYPES["string"]
+            node["enums"] = self.add_enum(schema["enum"])
+            node["enum_count"] = len(schema["enum"])
+        for keyword, flag in (("minimum", FLAG_MINIMUM), ("maximum", FLAG_MAXIMUM)):
+            if keyword in schema:
+                if not isinstance(schema[keyword], int):
+                    fail("%s: only integer %s is supported" % (path, keyword))
+                node["flags"] |= flag
+                node[keyword] = schema[keyword]
+        if schema.get("additionalProperties") is False:
+            node["flags"] |= FLAG_CLOSED
+        elif not isinstance(schema.get("additionalProperties", True), bool):
+            fail("%s: only a boolean additionalProperties is supported" % path)
+        node["min_items"] = schema.get("minItems", 0)
+
+        properties = schema.get("properties", {})
+        if len(properties) > MAX_PROPERTIES:
+            fail("%s: more than %d properties" % (path, MAX_PROPERTIES))
+        for name in schema.get("required", []):
+            if name not in properties:
+                fail("%s: required property %s not described" % (path, name))
+        # the properties of an object are contiguous: their nodes are compiled after
+        first = len(self.properties)
+        if properties:
+            node["properties"] = first
+            node["property_count"] = len(properties)
+        self.properties += [[name, NODE_ANY] for name in properties]
+        for i, (name, child) in enumerate(properties.items()):
+            self.properties[first + i][1] = self.compile(document, child, path + "/" + name)
+            if name in schema.get("required", []):
+                node["required"] |= 1 << i
+        if "items" in schema:
+            node["items"] = self.compile(document, schema["items"], path + "/items")
+        return node
+
+
+def c_string(value):
+    return json.dumps(value)
+
+
+def generate(tables, roots):
+    lines = [
+        "/*",
+        " * @file",
+        " * @brief Validation tables of the AIF/AIW/AIM metadata schemas",
+        " *",
+        " * Generated by tools/mpai_schema_compiler.py from docs/schema: do not edit.",
+        " *",
+        " * Copyright (c) 2022 University of Turin, Daniele Bortoluzzi <danieleb88@gmail.com>",
+        " *",
+        " * SPDX-License-Identifier: Apache-2.0",
+        " */",
+        "",
+        "#include \"aif_metadata_schema.h\"",
+        "",
+        "static const char* const schema_enums[] = {",
+    ]
+    lines += ["\t%s," % c_string(value) for value in tables.enums] or ["\tNULL,"]
+    lines += ["};", "", "static const mpai_metadata_schema_property_t schema_properties[] = {"]
+    lines += ["\t{ %s, %d }," % (c_string(name), node) for name, node in tables.properties] or ["\t{ NULL, 0 },"]
+    lines += [
+        "};",
+        "",
+        "/* types, flags, property count, enum count, properties, enums, items, min items, required, minimum, maximum */",
+        "static const mpai_metadata_schema_node_t schema_nodes[] = {",
+    ]
+    for i, node in enumerate(tables.nodes):
+        lines.append("\t/* %d: %s */" % (i, node["path"]))
+        lines.append("\t{ 0x%02x, 0x%02x, %d, %d, %d, %d, 0x%04x, %d, 0x%08x, %d, %d }," % (
+            node["types"], node["flags"], node["property_count"], node["enum_count"], node["properties"], node["enums"],
+            node["items"], node["min_items"], node["required"], node["minimum"], node["maximum"]))
+    lines += ["};", ""]
+    for name, (path, root) in roots.items():
+        lines.append("const mpai_metadata_schema_t MPAI_METADATA_SCHEMA_%s = { %s, schema_nodes, schema_properties, schema_enums, %d };"
+                     % (name, c_string(path.rsplit("/", 1)[-1]), root))
+    return "\n".join(lines) + "\n"
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compile the JSON schemas of the MPAI metadata into validation tables")
+    parser.add_argument("--schema", action="append", required=True, help="NAME=schema.json (MPAI_METADATA_SCHEMA_NAME)")
+    parser.add_argument("-o", "--output", required=True, help="generated C file")
+    args = parser.parse_args()
+
+    tables = Tables()
+    roots = {}
+    for argument in args.schema:
+        name, _, path = argument.partition("=")
+        if not path:
+            parser.error("--schema must be NAME=schema.json")
+        with open(path, encoding="utf-8") as f:
+            document = json.load(f)
+        roots[name] = (path, tables.compile(document, document, path.rsplit("/", 1)[-1]))
+
+    with open(args.output, "w", encoding="utf-8") as f:
+        f.write(generate(tables, roots))
+    print("%s: %d nodes, %d properties, %d enum values" % (args.output, len(tables.nodes), len(tables.properties), len(tables.enums)))
+
+
+if __name__ == "__main__":
+    main()
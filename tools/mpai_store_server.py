@@ -0,0 +1,542 @@
+#!/usr/bin/env python3
+#
+# Local stand-in of the MPAI Config Store: a CoAP server (RFC 7252) serving the AIF/AIW/AIM
+# metadata (json) to the board, so that the boot can be tested and benchmarked offline
+#
+# Copyright (c) 2022 University of Turin, Daniele Bortoluzzi <danieleb88@gmail.com>
+#
+# SPDX-License-Identifier: Apache-2.0
+#
+# Resources:
+#   config/aif/<AIF name>      --aif, served as --aif-name
+#   config/aiw/<AIW name>      --aiw, named by Identifier.Specification.AIW
+#   config/aim/<AIM name>      --aim, named by Identifier.Specification.AIM
+#   config/bin/<AIF name>      --bin, binary configuration (see mpai_config_compiler.py)
+#   config/bundle/<AIW name>   the AIW and its SubAIMs in a single resource (see config_store.c):
+#                              u32 magic "MPCB", a record per configuration (u8 name length,
+#                              u8 etag length, u32 data length, full name, etag, data), u8 0
+#   telemetry/<AIW name>       POST only: the batches of the telemetry uplink (CBOR, see
+#                              telemetry_uplink_aim.h), logged and counted
+#
+# Each resource has an ETag (first 8 bytes of its sha256): a request with the current ETag is
+# answered 2.03 Valid. The large ones are sent block-wise (RFC 7959), with the block size of the
+# request up to --block-size. A GET with Observe 0 registers an observation (RFC 7641): the files
+# are checked every second, and a notification with the new ETag is sent on each change.
+#
+# The No-Response option (RFC 7967) of the requests is honoured.
+#
+# Latency (--delay, --jitter) and loss (--loss, for both directions) are injected to emulate the
+# network of the board.
+#
+# Usage:
+#   python3 tools/mpai_store_server.py --aif docs/mpai_aif.json --aiw docs/mpai_aiw_iot_rev.json \
+#       --aim docs/mpai_aim_*.json [--delay 50 --jitter 20 --loss 0.05] [-v]
+
+import argparse
+import asyncio
+import hashlib
+import json
+import os
+import random
+import signal
+import struct
+import sys
+import time
+
+COAP_VERSION = 1
+
+TYPE_CON = 0
+TYPE_NON = 1
+TYPE_ACK = 2
+TYPE_RST = 3
+
+CODE_EMPTY = 0x00
+CODE_GET = 0x01
+CODE_POST = 0x02
+CODE_CHANGED = 0x44           # 2.04
+CODE_CONTENT = 0x45           # 2.05
+CODE_VALID = 0x43             # 2.03
+CODE_BAD_REQUEST = 0x80       # 4.00
+CODE_NOT_FOUND = 0x84         # 4.04
+CODE_METHOD_NOT_ALLOWED = 0x85  # 4.05
+
+OPTION_ETAG = 4
+OPTION_OBSERVE = 6
+OPTION_URI_PATH = 11
+OPTION_CONTENT_FORMAT = 12
+OPTION_BLOCK2 = 23
+OPTION_SIZE2 = 28
+OPTION_NO_RESPONSE = 258
+
+FORMAT_OCTET_STREAM = 42
+FORMAT_JSON = 50
+
+BUNDLE_MAGIC = b"MPCB"
+BUNDLE_RECORD = struct.Struct("<BBI")
+
+# RFC 7252, 4.8.2: the replies to the duplicated requests are sent again
+EXCHANGE_LIFETIME = 247
+WATCH_INTERVAL = 1.0
+
+
+def fail(message):
+    sys.exit("mpai_store_server: " + message)
+
+
+def load_json(path):
+    with open(path, encoding="utf-8") as f:
+        return json.load(f)
+
+
+def encode_uint(value):
+    data = b""
+    while value:
+        data = bytes([value & 0xFF]) + data
+        value >>= 8
+    return data
+
+
+def decode_uint(data):
+    value = 0
+    for byte in data:
+        value = (value << 8) | byte
+    return value
+
+
+def encode_option_field(value):
+    if value < 13:
+        return value, b""
+    if value < 269:
+        return 13, bytes([value - 13])
+    return 14, struct.pack(">H", value - 269)
+
+
+def decode_cbor(data, offset=0):
+    """Decode the CBOR item at offset (the subset written by cbor_writer.c): (item, next offset)"""
+    major, info = data[offset] >> 5, data[offset] & 0x1F
+    offset += 1
+    if major == 7:
+        if info == 26:
+            return struct.unpack(">f", data[offset:offset + 4])[0], offset + 4
+        if info in (20, 21, 22):
+            return {20: False, 21: True, 22: None}[info], offset
+        raise ValueError("unsupported simple value %d" % info)
+    if info < 24:
+        value = info
+    elif info <= 27:
+        size = 1 << (info - 24)
+        value = int.from_bytes(data[offset:offset + size], "big")
+        offset += size
+    else:
+        raise ValueError("unsupported length %d" % info)
+    if major == 0:
+        return value, offset
+    if major == 1:
+        return -1 - value, offset
+    if major in (2, 3):
+        item = data[offset:offset + value]
+        return (item.decode(errors="replace") if major == 3 else bytes(item)), offset + value
+    if major == 4:
+        items = []
+        for _ in range(value):
+            item, offset = decode_cbor(data, offset)
+            items.append(item)
+        return items, offset
+    if major == 5:
+        items = {}
+        for _ in range(value):
+            key, offset = decode_cbor(data, offset)
+            items[key], offset = decode_cbor(data, offset)
+        return items, offset
+    raise ValueError("unsupported major type %d" % major)
+
+
+class Message:
+    def __init__(self, msg_type, code, mid, token=b"", options=None, payload=b""):
+        self.type = msg_type
+        self.code = code
+        self.mid = mid
+        self.token = token
+        self.options = options or []   # (number, bytes)
+        self.payload = payload
+
+    def option(self, number):
+        for option_number, value in self.options:
+            if option_number == number:
+                return value
+        return None
+
+    def encode(self):
+        data = bytearray([(COAP_VERSION << 6) | (self.type << 4) | len(self.token), self.code])
+        data += struct.pack(">H", self.mid) + self.token
+        previous = 0
+        for number, value in sorted(self.options, key=lambda option: option[0]):
+            delta, delta_ext = encode_option_field(number - previous)
+            length, length_ext = encode_option_field(len(value))
+            data += bytes([(delta << 4) | length]) + delta_ext + length_ext + value
+            previous = number
+        if self.payload:
+            data += b"\xff" + self.payload
+        return bytes(data)
+
+    @staticmethod
+    def decode(data):
+        if len(data) < 4 or data[0] >> 6 != COAP_VERSION:
+            raise ValueError("not a CoAP message")
+        token_len = data[0] & 0x0F
+        if token_len > 8:
+            raise ValueError("token too long")
+        msg = Message((data[0] >> 4) & 0x03, data[1], struct.unpack(">H", data[2:4])[0], data[4:4 + token_len])
+        offset = 4 + token_len
+        number = 0
+        while offset < len(data):
+            if data[offset] == 0xFF:
+                msg.payload = data[offset + 1:]
+                if not msg.payload:
+                    raise ValueError("empty payload")
+                break
+            delta, length = data[offset] >> 4, data[offset] & 0x0F
+            offset += 1
+            fields = []
+            for field in (delta, length):
+                if field == 13:
+                    field = data[offset] + 13
+                    offset += 1
+                elif field == 14:
+                    field = struct.unpack(">H", data[offset:offset + 2])[0] + 269
+                    offset += 2
+                elif field == 15:
+                    raise ValueError("reserved option field")
+                fields.append(field)
+            number += fields[0]
+            msg.options.append((number, data[offset:offset + fields[1]]))
+            offset += fields[1]
+        return msg
+
+
+class Resource:
+    def __init__(self, path, load, content_format, sources):
+        self.path = path
+        self._load = load
+        self.content_format = content_format
+        self.sources = sources       # files it is built from
+        self.data = b""
+        self.etag = b""
+        self.mtimes = None
+
+    def refresh(self):
+        """Reload the resource if its files have changed"""
+        mtimes = [os.stat(source).st_mtime_ns for source in self.sources]
+        if mtimes != self.mtimes:
+            self.mtimes = mtimes
+            self.data = self._load()
+            self.etag = hashlib.sha256(self.data).digest()[:8]
+
+
+class Store:
+    """Resources of the MPAI Config Store, by Uri-Path"""
+
+    def __init__(self, args):
+        self.resources = {}
+        if args.aif:
+            self._add_file("config/aif/" + args.aif_name, args.aif, FORMAT_JSON)
+        if args.bin:
+            self._add_file("config/bin/" + args.aif_name, args.bin, FORMAT_OCTET_STREAM)
+        aims = {}
+        for path in args.aim:
+            name = load_json(path)["Identifier"]["Specification"]["AIM"]
+            aims[name] = self._add_file("config/aim/" + name, path, FORMAT_JSON)
+        for path in args.aiw:
+            aiw = load_json(path)
+            name = aiw["Identifier"]["Specification"]["AIW"]
+            self._add_file("config/aiw/" + name, path, FORMAT_JSON)
+            if not args.no_bundle:
+                self._add_bundle(name, path, [aims[sub["Name"]] for sub in aiw.get("SubAIMs", []) if sub["Name"] in aims])
+        for resource in self.resources.values():
+            resource.refresh()
+
+    def _add_file(self, path, source, content_format):
+        def load():
+            with open(source, "rb") as f:
+                return f.read()
+        self.resources[path] = Resource(path, load, content_format, [source])
+        return self.resources[path]
+
+    def _add_bundle(self, aiw_name, aiw_source, aims):
+        aiw = self.resources["config/aiw/" + aiw_name]
+
+        def load():
+            data = bytearray(BUNDLE_MAGIC)
+            for resource in [aiw] + aims:
+                resource.refresh()
+                name = resource.path.encode()
+                data += BUNDLE_RECORD.pack(len(name), len(resource.etag), len(resource.data)) + name + resource.etag + resource.data
+            data += b"\x00"
+            return bytes(data)
+        self.resources["config/bundle/" + aiw_name] = Resource("config/bundle/" + aiw_name, load, FORMAT_OCTET_STREAM,
+                                                               [aiw_source] + [aim.sources[0] for aim in aims])
+
+    def get(self, path):
+        return self.resources.get(path)
+
+
+class Observer:
+    def __init__(self, addr, token):
+        self.addr = addr
+        self.token = token
+
+
+class StoreServer(asyncio.DatagramProtocol):
+    def __init__(self, store, args):
+        self.store = store
+        self.args = args
+        self.transport = None
+        self.mid = random.randrange(0x10000)
+        self.observe_seq = 0
+        self.observers = {}          # path -> {(addr, token): Observer}
+        self.notifications = {}      # mid -> (path, (addr, token)), to end an observation on RST
+        self.exchanges = {}          # (addr, mid) -> (time, reply), for the duplicated requests
+        self.stats = {"received": 0, "sent": 0, "dropped": 0, "duplicated": 0, "notifications": 0,
+                      "telemetry": 0}
+
+    def log(self, message):
+        if self.args.verbose:
+            print("%.3f %s" % (time.monotonic(), message), flush=True)
+
+    def next_mid(self):
+        self.mid = (self.mid + 1) & 0xFFFF
+        return self.mid
+
+    def connection_made(self, transport):
+        self.transport = transport
+
+    def send(self, msg, addr):
+        """Send a message after the injected latency, unless it's lost"""
+        if random.random() < self.args.loss:
+            self.stats["dropped"] += 1
+            self.log("-> %s lost (mid %d)" % (addr[0], msg.mid))
+            return
+        delay = max(0.0, self.args.delay + random.uniform(-self.args.jitter, self.args.jitter)) / 1000
+        data = msg.encode()
+
+        def send_now():
+            self.stats["sent"] += 1
+            self.transport.sendto(data, addr)
+        asyncio.get_running_loop().call_later(delay, send_now)
+
+    def datagram_received(self, data, addr):
+        if random.random() < self.args.loss:
+            self.stats["dropped"] += 1
+            self.log("<- %s lost" % addr[0])
+            return
+        self.stats["received"] += 1
+        try:
+            msg = Message.decode(data)
+        except (ValueError, IndexError, struct.error) as e:
+            self.log("<- %s malformed: %s" % (addr[0], e))
+            return
+
+        if msg.type == TYPE_RST:
+            path, key = self.notifications.pop(msg.mid, (None, None))
+            if path is not None and self.observers.get(path, {}).pop(key, None) is not None:
+                self.log("observation of %s by %s ended (RST)" % (path, addr[0]))
+            return
+        if msg.type == TYPE_ACK:
+            return
+        if msg.code == CODE_EMPTY:
+            # CoAP ping
+            if msg.type == TYPE_CON:
+                self.send(Message(TYPE_RST, CODE_EMPTY, msg.mid), addr)
+            return
+
+        now = time.monotonic()
+        self.exchanges = {key: value for key, value in self.exchanges.items() if now - value[0] < EXCHANGE_LIFETIME}
+        exchange = self.exchanges.get((addr, msg.mid))
+        if exchange is not None:
+            self.stats["duplicated"] += 1
+            self.log("<- %s duplicated (mid %d)" % (addr[0], msg.mid))
+            if exchange[1] is not None:
+                self.send(exchange[1], addr)
+            return
+
+        reply = self.handle(msg, addr)
+        no_response = msg.option(OPTION_NO_RESPONSE)
+        if no_response is not None and decode_uint(no_response) & (1 << ((reply.code >> 5) - 1)):
+            # the classes of replies not of interest are suppressed, a CON is still acknowledged
+            reply = Message(TYPE_ACK, CODE_EMPTY, msg.mid) if msg.type == TYPE_CON else None
+        elif msg.type == TYPE_CON:
+            reply.type, reply.mid = TYPE_ACK, msg.mid
+        else:
+            reply.type, reply.mid = TYPE_NON, self.next_mid()
+        self.exchanges[(addr, msg.mid)] = (now, reply)
+        if reply is not None:
+            self.send(reply, addr)
+
+    def handle(self, msg, addr):
+        path = "/".join(value.decode(errors="replace") for number, value in msg.options if number == OPTION_URI_PATH)
+        if msg.code == CODE_POST and path.startswith("telemetry/"):
+            return self.telemetry(msg, addr, path)
+        if msg.code != CODE_GET:
+            self.log("<- %s %s: method 0.%02d not allowed" % (addr[0], path, msg.code & 0x1F))
+            return Message(TYPE_ACK, CODE_METHOD_NOT_ALLOWED, 0, msg.token)
+        resource = self.store.get(path)
+        try:
+            if resource is not None:
+                resource.refresh()
+        except OSError:
+            resource = None
+        if resource is None:
+            self.log("<- %s GET %s: not found" % (addr[0], path))
+            return Message(TYPE_ACK, CODE_NOT_FOUND, 0, msg.token)
+
+        options = []
+        observe = msg.option(OPTION_OBSERVE)
+        if observe is not None:
+            key = (addr, msg.token)
+            if decode_uint(observe) == 0:
+                self.observers.setdefault(path, {})[key] = Observer(addr, msg.token)
+                options.append((OPTION_OBSERVE, encode_uint(self.observe_seq)))
+                self.log("observation of %s by %s registered" % (path, addr[0]))
+            elif self.observers.get(path, {}).pop(key, None) is not None:
+                self.log("observation of %s by %s cancelled" % (path, addr[0]))
+
+        etags = [value for number, value in msg.options if number == OPTION_ETAG]
+        if resource.etag in etags:
+            self.log("<- %s GET %s: valid" % (addr[0], path))
+            return Message(TYPE_ACK, CODE_VALID, 0, msg.token, options + [(OPTION_ETAG, resource.etag)])
+
+        num, szx = 0, 6
+        block2 = msg.option(OPTION_BLOCK2)
+        if block2 is not None:
+            value = decode_uint(block2)
+            num, szx = value >> 4, value & 0x07
+            if szx == 7:
+                return Message(TYPE_ACK, CODE_BAD_REQUEST, 0, msg.token)
+        self.log("<- %s GET %s: block %d of %d bytes" % (addr[0], path, num, 16 << szx))
+        return self.content(resource, msg.token, num, szx, options)
+
+    def telemetry(self, msg, addr, path):
+        """Log a batch of the telemetry uplink: records by channel, and the ones lost by the board"""
+        try:
+            batch, _ = decode_cbor(msg.payload)
+            channels = batch["ch"]
+            records = sum(len(channel) for channel in channels.values())
+        except (ValueError, IndexError, KeyError, TypeError, AttributeError, struct.error) as e:
+            self.log("<- %s POST %s: malformed batch: %s" % (addr[0], path, e))
+            return Message(TYPE_ACK, CODE_BAD_REQUEST, 0, msg.token)
+        self.stats["telemetry"] += 1
+        print("%s from %s: batch %d, %d records (%s), %d lost, %d bytes" %
+              (path, addr[0], batch.get("seq", -1), records,
+               ", ".join("%s %d" % (name, len(channel)) for name, channel in channels.items()),
+               batch.get("lost", 0), len(msg.payload)), flush=True)
+        if self.args.verbose:
+            for name, channel in channels.items():
+                # the records are delta encoded: back to the absolute values
+                t, values = batch.get("t0", 0), []
+                for record in channel:
+                    t += record[0]
+                    values = [value + (values[i] if i < len(values) else 0) for i, value in enumerate(record[1:])]
+                    self.log("  %s %d: %s" % (name, t, values))
+        return Message(TYPE_ACK, CODE_CHANGED, 0, msg.token)
+
+    def content(self, resource, token, num, szx, options):
+        """Reply with a block of a resource, as large as requested up to --block-size"""
+        offset = num * (16 << szx)
+        # with a block size smaller than the requested one, the block at the same offset
+        szx = min(szx, self.args.szx)
+        size = 16 << szx
+        num = offset // size
+        if offset > len(resource.data):
+            return Message(TYPE_ACK, CODE_BAD_REQUEST, 0, token)
+        payload = resource.data[offset:offset + size]
+        more = offset + size < len(resource.data)
+        options = options + [(OPTION_ETAG, resource.etag), (OPTION_CONTENT_FORMAT, encode_uint(resource.content_format))]
+        if more or num > 0:
+            options.append((OPTION_BLOCK2, encode_uint((num << 4) | (more << 3) | szx)))
+        if num == 0:
+            options.append((OPTION_SIZE2, encode_uint(len(resource.data))))
+        return Message(TYPE_ACK, CODE_CONTENT, 0, token, options, payload)
+
+    def notify(self, path):
+        """Send the first block of the new version of a resource to its observers"""
+        resource = self.store.get(path)
+        self.observe_seq = (self.observe_seq + 1) & 0xFFFFFF
+        for key, observer in self.observers.get(path, {}).items():
+            msg = self.content(resource, observer.token, 0, self.args.szx, [(OPTION_OBSERVE, encode_uint(self.observe_seq))])
+            msg.type, msg.mid = TYPE_NON, self.next_mid()
+            self.notifications[msg.mid] = (path, key)
+            self.stats["notifications"] += 1
+            self.log("-> %s notification of %s (seq %d)" % (observer.addr[0], path, self.observe_seq))
+            self.send(msg, observer.addr)
+
+    async def watch(self):
+        """Notify the changes of the files served"""
+        # the resources are also reloaded by the requests
+        etags = {path: resource.etag for path, resource in self.store.resources.items()}
+        while True:
+            await asyncio.sleep(WATCH_INTERVAL)
+            for path, resource in self.store.resources.items():
+                try:
+                    resource.refresh()
+                except OSError as e:
+                    print("mpai_store_server: %s not reloaded: %s" % (path, e), file=sys.stderr)
+                    continue
+                if resource.etag != etags[path]:
+                    etags[path] = resource.etag
+                    print("%s changed (ETag %s)" % (path, resource.etag.hex()), flush=True)
+                    self.notify(path)
+
+
+async def serve(args):
+    store = Store(args)
+    for path, resource in sorted(store.resources.items()):
+        print("%s: %d bytes, ETag %s" % (path, len(resource.data), resource.etag.hex()))
+    loop = asyncio.get_running_loop()
+    # stopped by a script too, printing the counters
+    loop.add_signal_handler(signal.SIGTERM, asyncio.current_task().cancel)
+    transport, server = await loop.create_datagram_endpoint(lambda: StoreServer(store, args), local_addr=(args.address, args.port))
+    print("MPAI Config Store on %s:%d (block size %d, delay %d±%d ms, loss %.0f%%)" %
+          (args.address, args.port, 16 << args.szx, args.delay, args.jitter, args.loss * 100), flush=True)
+    try:
+        await server.watch()
+    finally:
+        transport.close()
+        print("received %(received)d, sent %(sent)d, dropped %(dropped)d, duplicated %(duplicated)d, notifications %(notifications)d, telemetry %(telemetry)d"
+              % server.stats)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Local CoAP stand-in of the MPAI Config Store")
+    parser.add_argument("--address", default="0.0.0.0", help="address to listen on")
+    parser.add_argument("--port", type=int, default=5683)
+    parser.add_argument("--aif", help="AIF metadata (json)")
+    parser.add_argument("--aif-name", default="demo", help="name the AIF is served with (MPAI_LIBS_AIF_NAME)")
+    parser.add_argument("--aiw", nargs="*", default=[], help="AIW metadata (json)")
+    parser.add_argument("--aim", nargs="*", default=[], help="AIM metadata (json)")
+    parser.add_argument("--bin", help="binary configuration, served with the name of the AIF")
+    parser.add_argument("--no-bundle", action="store_true", help="don't serve the bundles of the AIWs")
+    parser.add_argument("--block-size", type=int, default=1024, choices=[16 << szx for szx in range(7)],
+                        help="max size of the blocks")
+    parser.add_argument("--delay", type=int, default=0, help="latency (ms) added to each reply")
+    parser.add_argument("--jitter", type=int, default=0, help="max variation (ms) of the latency")
+    parser.add_argument("--loss", type=float, default=0.0, help="probability of losing a datagram, in each direction")
+    parser.add_argument("--seed", type=int, help="seed of the latency and loss, to repeat a run")
+    parser.add_argument("-v", "--verbose", action="store_true", help="log every message")
+    args = parser.parse_args()
+
+    if not 0.0 <= args.loss < 1.0:
+        parser.error("--loss must be in [0, 1)")
+    if not args.aif and not args.aiw and not args.aim and not args.bin:
+        parser.error("nothing to serve: --aif, --aiw, --aim or --bin are required")
+    args.szx = (args.block_size // 16).bit_length() - 1
+    random.seed(args.seed)
+    try:
+        asyncio.run(serve(args))
+    except (KeyboardInterrupt, asyncio.CancelledError):
+        pass
+    except (OSError, KeyError, ValueError) as e:
+        fail(str(e))
+
+
+if __name__ == "__main__":
+    main()